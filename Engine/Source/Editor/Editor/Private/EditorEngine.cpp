@@ -15,16 +15,35 @@ void EditorEngine::OnInitialize()
 
 void EditorEngine::EngineLoop()
 {
+	Time::Init();
 	while (EngineShouldStop() == false)
-	{
-		UI::Get().PrepareNewFrame();
-
-		Renderer::Get().Tick();
+		ExecuteFrame();
+}
 
-		UI::Get().RenderNewFrame();
+void EditorEngine::RegisterFrameTasks()
+{
+	Engine::RegisterFrameTasks();
 
-		Time::CalculateNewTiming();
-	}
+	// ImGui_ImplVulkan_NewFrame doesn't use any Vulkan object, the GLFW backend read the inputs and set the cursor of the window
+	m_FrameGraph.AddTask("UI_PrepareNewFrame",
+		{
+			{ FrameResources::Window, TaskAccess::Write },
+			{ FrameResources::UI, TaskAccess::Write }
+		},
+		[]() { UI::Get().PrepareNewFrame(); },
+		TaskThread::MainThread
+	);
+	// Record the UI in the renderer frame, then present it on the thread of the window
+	m_FrameGraph.AddTask("UI_RenderNewFrame",
+		{
+			{ FrameResources::AccelerationStructure, TaskAccess::Read },
+			{ FrameResources::Frame, TaskAccess::Write },
+			{ FrameResources::Window, TaskAccess::Write },
+			{ FrameResources::UI, TaskAccess::Write }
+		},
+		[]() { UI::Get().RenderNewFrame(); },
+		TaskThread::MainThread
+	);
 }
 
 bool EditorEngine::EngineShouldStop()
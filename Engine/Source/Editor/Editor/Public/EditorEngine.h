@@ -17,4 +17,8 @@ public:
 	virtual bool EngineShouldStop() override;
 	//~ End Engine interface
 
+protected:
+	/** Add the tasks of the UI after the ones of the engine, the UI record and present the renderer frame */
+	virtual void RegisterFrameTasks() override;
+
 };
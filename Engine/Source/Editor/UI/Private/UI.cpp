@@ -53,7 +53,8 @@ void UI::Init()
 	initInfo.Subpass = 0;
 	initInfo.DescriptorPool = m_DescriptorPool;
 	initInfo.MinImageCount = 2;
-	initInfo.ImageCount = 2;
+	// ImGui rotate its vertex buffers on this count, the frames in flight must not share them
+	initInfo.ImageCount = std::max(initInfo.MinImageCount, Renderer::Get().m_VkSwapChain.GetFramesInFlight());
 	initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 	initInfo.Allocator = nullptr;
 	initInfo.CheckVkResultFn = [](VkResult error)
@@ -267,8 +268,6 @@ void UI::ShutDown()
 
 void UI::PrepareNewFrame()
 {
-	Renderer::Get().PrepareNewFrame();
-
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
@@ -298,15 +297,15 @@ void UI::RenderNewFrame()
 
 	RecordFrameCmdBuffer(frame);
 
-	Renderer::Get().m_VkSwapChain.SubmitWork(Renderer::Get().GetCurrentFrameIndex());
-	Renderer::Get().m_VkSwapChain.PresentFrame(Renderer::Get().GetCurrentFrameIndex());
+	Renderer::Get().m_VkSwapChain.SubmitWork();
+	Renderer::Get().m_VkSwapChain.PresentFrame();
 }
 
 void UI::RecordFrameCmdBuffer(const VulkanSwapChainFrame& frame)
 {
 	VulkanDeviceHandler& vulkanDevice = Renderer::Get().m_VkDevice;
 
-	frame.CommandBuffer.reset();
+	// The command pool of the frame has been reset when it was acquired
 	frame.CommandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
 
 	frame.CommandBuffer.bindPipeline(vk::PipelineBindPoint::eRayTracingKHR, Renderer::Get().m_Pipeline);
@@ -370,12 +369,17 @@ void UI::RecordFrameCmdBuffer(const VulkanSwapChainFrame& frame)
 
 	vk::RenderPassBeginInfo renderPassBeginInfo;
 	renderPassBeginInfo.renderPass = m_RenderPass;
-	renderPassBeginInfo.framebuffer = m_FrameBuffers[Renderer::Get().GetCurrentFrameIndex()];
+	renderPassBeginInfo.framebuffer = m_FrameBuffers[frame.ImageIndex];
 	renderPassBeginInfo.renderArea.extent = Renderer::Get().m_VkSwapChain.GetExtent();
 
-	frame.CommandBuffer.beginRenderPass(&renderPassBeginInfo, vk::SubpassContents::eInline);
-	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frame.CommandBuffer, nullptr);
-	frame.CommandBuffer.endRenderPass();
+	{
+		// The scope begins outside of the render pass, its queries are reset there
+		CREATE_GPU_SCOPE_TIMER(Renderer::Get().GetFrameGpuScopes(), frame.CommandBuffer, Renderer::ProfilingCategories::GpuUI);
+
+		frame.CommandBuffer.beginRenderPass(&renderPassBeginInfo, vk::SubpassContents::eInline);
+		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frame.CommandBuffer, nullptr);
+		frame.CommandBuffer.endRenderPass();
+	}
 
 	// Renderer::Get().PresentBarrier(frame.CommandBuffer, frame.Image, vk::AccessFlagBits::eColorAttachmentWrite, vk::ImageLayout::eColorAttachmentOptimal);
 
@@ -422,12 +426,13 @@ void UI::CreateRenderPass()
 
 void UI::CreateFrameBuffers()
 {
-	for (auto& frame : Renderer::Get().m_VkSwapChain.GetFrames())
+	// One per swap chain image, whatever the frame that render into it
+	for (auto& image : Renderer::Get().m_VkSwapChain.GetImages())
 	{
 		vk::FramebufferCreateInfo framebufferCreateInfo(
 			vk::FramebufferCreateFlags(),
 			m_RenderPass,
-			1, &frame.ImageView,
+			1, &image.ImageView,
 			Renderer::Get().m_VkSwapChain.GetExtent().width,
 			Renderer::Get().m_VkSwapChain.GetExtent().height,
 			1
@@ -19,8 +19,10 @@ public:
 	}
 
 public:
+	/** Start the ImGui frame, on the main thread (the renderer frame is prepared by its own task, @see Engine::RegisterFrameTasks) */
 	void PrepareNewFrame();
 
+	/** Draw the UI, then record, submit and present the renderer frame with it */
 	void RenderNewFrame();
 
 	void ShutDown(); // will be called by UIModule
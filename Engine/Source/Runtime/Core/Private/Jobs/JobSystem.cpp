@@ -0,0 +1,355 @@
+#include "Jobs/JobSystem.h"
+#include "Logging/LoggingMacros.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <cmath>
+
+DEFINE_LOG_CATEGORY(JobSystemLog);
+
+JobSystem* JobSystem::s_Instance = nullptr;
+
+namespace
+{
+	/** The system the calling thread belongs to, and its context in it */
+	struct CurrentThread
+	{
+		const JobSystem* System = nullptr;
+		void* Context = nullptr;
+	};
+	thread_local CurrentThread t_CurrentThread;
+
+	/** How many times a worker look for a job before going to sleep */
+	constexpr uint32_t IdleSpinCount = 64;
+
+	/** xorshift32, good enough to pick a victim */
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (state);
+	}
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+	: m_MainThreadId(std::this_thread::get_id())
+{
+	for (uint32_t i = 0; i <= workerCount; i++)
+	{
+		m_Threads.push_back(std::make_unique<ThreadContext>());
+		m_Threads.back()->Index = i;
+		m_Threads.back()->RandomState = 0x9E3779B9u * (i + 1);
+	}
+
+	m_PreviousSystem = t_CurrentThread.System;
+	m_PreviousContext = static_cast<ThreadContext*>(t_CurrentThread.Context);
+	t_CurrentThread = CurrentThread{ this, m_Threads[0].get() };
+
+	m_Workers.reserve(workerCount);
+	for (uint32_t i = 1; i <= workerCount; i++)
+		m_Workers.emplace_back(&JobSystem::WorkerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	// The jobs must have been waited for, but nothing waits for the main thread jobs
+	CHECK(IsMainThread() && m_QueuedJobCount == 0);
+	ExecuteMainThreadJobs();
+
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_bStopping = true;
+	}
+	m_WakeCondition.notify_all();
+	for (std::thread& worker : m_Workers)
+		worker.join();
+
+	t_CurrentThread = CurrentThread{ m_PreviousSystem, m_PreviousContext };
+}
+
+uint32_t JobSystem::GetDefaultWorkerCount()
+{
+	const uint32_t coreCount = std::thread::hardware_concurrency();
+	return (coreCount > 1 ? coreCount - 1 : 0);
+}
+
+JobSystem& JobSystem::Get()
+{
+	CHECK(s_Instance);
+	return (*s_Instance);
+}
+
+JobSystem& JobSystem::Create(uint32_t workerCount)
+{
+	CHECK(s_Instance == nullptr);
+	s_Instance = new JobSystem(workerCount);
+	OV_LOG(JobSystemLog, Verbose, "Job system created with {:d} workers", workerCount);
+	return (*s_Instance);
+}
+
+void JobSystem::Shutdown()
+{
+	delete s_Instance;
+	s_Instance = nullptr;
+}
+
+void JobSystem::Run(JobCounter& counter, JobFunction function)
+{
+	counter.m_PendingCount.fetch_add(1, std::memory_order_relaxed);
+	Submit(new Job{ std::move(function), &counter });
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	ThreadContext* context = GetCurrentContext();
+	const bool bMainThread = IsMainThread();
+
+	uint32_t idleCount = 0;
+	while (!counter.IsDone())
+	{
+		// A job waited for by the main thread may wait for a main thread job
+		if (bMainThread && m_MainThreadJobCount.load(std::memory_order_relaxed) > 0)
+			ExecuteMainThreadJobs();
+
+		if (Job* job = FindJob(context))
+		{
+			Execute(job);
+			idleCount = 0;
+		}
+		// The jobs left are running on other threads
+		else if (++idleCount > IdleSpinCount)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+uint32_t JobSystem::CalculateGrainSize(uint32_t count) const
+{
+	const uint32_t chunkCount = GetThreadCount() * 4;
+	return (std::max((count + chunkCount - 1) / chunkCount, 1u));
+}
+
+void JobSystem::RunOnMainThread(JobFunction function, JobCounter* counter)
+{
+	if (counter)
+		counter->m_PendingCount.fetch_add(1, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(m_MainThreadJobsMutex);
+	m_MainThreadJobs.push_back(new Job{ std::move(function), counter });
+	m_MainThreadJobCount.fetch_add(1, std::memory_order_release);
+}
+
+void JobSystem::ExecuteMainThreadJobs()
+{
+	CHECK(IsMainThread());
+
+	// The jobs queued while these run wait for the next call, a job queuing itself can't keep the main thread forever
+	std::vector<Job*> jobs;
+	{
+		std::lock_guard<std::mutex> lock(m_MainThreadJobsMutex);
+		jobs.swap(m_MainThreadJobs);
+		m_MainThreadJobCount.fetch_sub(static_cast<uint32_t>(jobs.size()), std::memory_order_relaxed);
+	}
+
+	for (Job* job : jobs)
+		Execute(job);
+}
+
+void JobSystem::WorkerMain(uint32_t threadIndex)
+{
+	ThreadContext* context = m_Threads[threadIndex].get();
+	t_CurrentThread = CurrentThread{ this, context };
+
+	uint32_t idleCount = 0;
+	while (!m_bStopping.load(std::memory_order_relaxed))
+	{
+		if (Job* job = FindJob(context))
+		{
+			Execute(job);
+			idleCount = 0;
+			continue;
+		}
+		if (++idleCount < IdleSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Sleep until a job is queued, Submit only lock the mutex to wake the workers when some are sleeping
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_SleepingWorkerCount.fetch_add(1);
+		m_WakeCondition.wait(lock, [this]() { return (m_QueuedJobCount.load() > 0 || m_bStopping.load()); });
+		m_SleepingWorkerCount.fetch_sub(1);
+		idleCount = 0;
+	}
+
+	t_CurrentThread = CurrentThread{};
+}
+
+JobSystem::Job* JobSystem::FindJob(ThreadContext* context)
+{
+	Job* job = nullptr;
+	if (context)
+		job = context->Queue.Pop();
+
+	if (!job && m_SharedJobCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_SharedJobsMutex);
+		if (m_SharedJobs.empty() == false)
+		{
+			job = m_SharedJobs.front();
+			m_SharedJobs.pop_front();
+			m_SharedJobCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (!job)
+	{
+		// Any thread can steal, the threads outside of the system too
+		const uint32_t threadCount = GetThreadCount();
+		const uint32_t firstVictim = (context ? NextRandom(context->RandomState) : 0) % threadCount;
+		for (uint32_t i = 0; i < threadCount && !job; i++)
+		{
+			ThreadContext* victim = m_Threads[(firstVictim + i) % threadCount].get();
+			if (victim != context)
+				job = victim->Queue.Steal();
+		}
+	}
+
+	if (job)
+		m_QueuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+	return (job);
+}
+
+void JobSystem::Execute(Job* job)
+{
+	job->Function();
+	if (job->Counter)
+		job->Counter->m_PendingCount.fetch_sub(1, std::memory_order_acq_rel);
+	delete job;
+}
+
+void JobSystem::Submit(Job* job)
+{
+	if (ThreadContext* context = GetCurrentContext())
+	{
+		context->Queue.Push(job);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_SharedJobsMutex);
+		m_SharedJobs.push_back(job);
+		m_SharedJobCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Paired with the sleeping workers checking the count after incrementing m_SleepingWorkerCount
+	m_QueuedJobCount.fetch_add(1);
+	if (m_SleepingWorkerCount.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+		}
+		m_WakeCondition.notify_one();
+	}
+}
+
+JobSystem::ThreadContext* JobSystem::GetCurrentContext() const
+{
+	return (t_CurrentThread.System == this ? static_cast<ThreadContext*>(t_CurrentThread.Context) : nullptr);
+}
+
+void JobSystem::LogBenchmark(uint32_t maxThreadCount)
+{
+	maxThreadCount = (maxThreadCount == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : maxThreadCount);
+
+	// 1, 2, 4, ... threads, and the max
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+		threadCounts.push_back(threadCount);
+	threadCounts.push_back(maxThreadCount);
+
+	constexpr uint32_t emptyJobCount = 1'000'000;
+	constexpr uint32_t forkJoinDepth = 18;
+	constexpr uint32_t loopCount = 1 << 22;
+
+	// Compute bound, a few hundred cycles per index, the result is kept so the loop isn't removed
+	std::vector<float> loopResults(loopCount);
+	auto loopBody = [&loopResults](uint32_t index)
+		{
+			float value = static_cast<float>(index);
+			for (uint32_t i = 0; i < 64; i++)
+				value = std::sqrt(value * 1.0001f + static_cast<float>(i));
+			loopResults[index] = value;
+		};
+
+	double singleThreadLoopMs = 0.0;
+	for (uint32_t threadCount : threadCounts)
+	{
+		JobSystem jobSystem(threadCount - 1);
+
+		// Empty jobs queued by the main thread, in batches so the deque doesn't grow too much
+		{
+			JobCounter counter;
+			START_TIMER;
+			for (uint32_t i = 0; i < emptyJobCount; i++)
+			{
+				jobSystem.Run(counter, []() {});
+				if ((i & 1023) == 1023)
+					jobSystem.Wait(counter);
+			}
+			jobSystem.Wait(counter);
+			STOP_TIMER;
+
+			const double elapsedMs = TO_DOUBLE_MILLISECONDS(TIMER_RESULT);
+			OV_LOG(JobSystemLog, Display, "[{:d} threads] Empty jobs: {:.2f} M jobs/s ({:.1f}ns per job)",
+				threadCount,
+				elapsedMs > 0.0 ? emptyJobCount / (elapsedMs * 1000.0) : 0.0,
+				elapsedMs * 1e6 / emptyJobCount
+			);
+		}
+
+		// Each job run two children and wait for them, down to forkJoinDepth
+		{
+			std::atomic<uint32_t> leafCount = 0;
+			std::function<void(uint32_t)> forkJoin = [&](uint32_t depth)
+				{
+					if (depth == forkJoinDepth)
+					{
+						leafCount.fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+					JobCounter counter;
+					jobSystem.Run(counter, [&forkJoin, depth]() { forkJoin(depth + 1); });
+					jobSystem.Run(counter, [&forkJoin, depth]() { forkJoin(depth + 1); });
+					jobSystem.Wait(counter);
+				};
+
+			START_TIMER;
+			forkJoin(0);
+			STOP_TIMER;
+
+			const double elapsedMs = TO_DOUBLE_MILLISECONDS(TIMER_RESULT);
+			const uint32_t jobCount = (2u << forkJoinDepth) - 2;
+			OV_LOG(JobSystemLog, Display, "[{:d} threads] Fork-join depth {:d}: {:.2f}ms, {:.2f} M jobs/s ({:d} leaves)",
+				threadCount, forkJoinDepth, elapsedMs,
+				elapsedMs > 0.0 ? jobCount / (elapsedMs * 1000.0) : 0.0, leafCount.load()
+			);
+		}
+
+		// The same loop on more and more threads
+		{
+			START_TIMER;
+			jobSystem.ParallelFor(loopCount, loopBody);
+			STOP_TIMER;
+
+			const double elapsedMs = TO_DOUBLE_MILLISECONDS(TIMER_RESULT);
+			if (threadCount == 1)
+				singleThreadLoopMs = elapsedMs;
+			const double speedup = (elapsedMs > 0.0 ? singleThreadLoopMs / elapsedMs : 0.0);
+			OV_LOG(JobSystemLog, Display, "[{:d} threads] ParallelFor {:d} indices (grain {:d}): {:.2f}ms, speedup {:.2f}x, efficiency {:.0f}%",
+				threadCount, loopCount, jobSystem.CalculateGrainSize(loopCount), elapsedMs, speedup, speedup * 100.0 / threadCount
+			);
+		}
+	}
+}
@@ -0,0 +1,299 @@
+#include "Jobs/TaskGraph.h"
+#include "Jobs/JobSystem.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+DEFINE_LOG_CATEGORY(TaskGraphLog);
+
+namespace
+{
+	/** The profiling macros are empty with NO_PROFILING, the logs still need the times */
+	double ToMilliseconds(std::chrono::nanoseconds time)
+	{
+		return (std::chrono::duration<double, std::milli>(time).count());
+	}
+}
+
+bool TaskGraph::AddTask(std::string_view name, std::vector<TaskResourceAccess> accesses, TaskFunction function, TaskThread::Type thread)
+{
+	if (HasTask(name))
+	{
+		OV_LOG(TaskGraphLog, Error, "A task named {:s} is already in the graph", name);
+		return (false);
+	}
+
+	Task& task = m_Tasks.emplace_back();
+	task.Name = name;
+	task.Accesses = std::move(accesses);
+	task.Function = std::move(function);
+	task.Thread = thread;
+	m_bDirty = true;
+	return (true);
+}
+
+bool TaskGraph::RemoveTask(std::string_view name)
+{
+	const uint32_t taskIndex = FindTask(name);
+	if (taskIndex == UINT32_MAX)
+		return (false);
+
+	m_Tasks.erase(m_Tasks.begin() + taskIndex);
+	m_LastCriticalPath.clear();
+	m_bDirty = true;
+	return (true);
+}
+
+bool TaskGraph::HasTask(std::string_view name) const
+{
+	return (FindTask(name) != UINT32_MAX);
+}
+
+void TaskGraph::Clear()
+{
+	m_Tasks.clear();
+	m_LastCriticalPath.clear();
+	m_bDirty = true;
+}
+
+void TaskGraph::Execute(JobSystem& jobSystem)
+{
+	CHECK(jobSystem.IsMainThread());
+
+	if (m_bDirty)
+		Compile();
+	if (m_Tasks.empty())
+		return;
+
+	Timer executeTimer;
+	for (uint32_t i = 0; i < m_Tasks.size(); i++)
+		m_PendingPredecessors[i].store(static_cast<uint32_t>(m_Tasks[i].Predecessors.size()), std::memory_order_relaxed);
+
+	// The successors are dispatched by the task that finish last, before it leave the counter, so it's only done once all of them ran
+	JobCounter counter;
+	for (uint32_t taskIndex : m_RootTasks)
+		Dispatch(jobSystem, counter, taskIndex);
+	jobSystem.Wait(counter);
+
+	m_LastExecuteTime = executeTimer.Elapsed();
+	CalculateCriticalPath();
+
+	REPORT_PERFRAME_TIMER(ProfilingCategories::CriticalPath, m_LastCriticalPathTime);
+	REPORT_PERFRAME_TIMER(ProfilingCategories::Execute, m_LastExecuteTime);
+	REPORT_PERFRAME_TIMER(ProfilingCategories::Work, m_LastWorkTime);
+}
+
+void TaskGraph::LogGraph()
+{
+	if (m_bDirty)
+		Compile();
+
+	OV_LOG(TaskGraphLog, Display, "{:d} tasks, {:d} roots", m_Tasks.size(), m_RootTasks.size());
+	for (uint32_t taskIndex : m_Order)
+	{
+		const Task& task = m_Tasks[taskIndex];
+
+		std::string predecessors;
+		for (uint32_t predecessor : task.Predecessors)
+			predecessors += (predecessors.empty() ? "" : ", ") + m_Tasks[predecessor].Name;
+		OV_LOG(TaskGraphLog, Display, "  {:s} ({:s}): {:.3f}ms, wait for [{:s}]",
+			task.Name, TaskThread::ToString(task.Thread), ToMilliseconds(task.LastTime), predecessors
+		);
+	}
+
+	std::string criticalPath;
+	for (std::string_view name : GetLastCriticalPath())
+		criticalPath += std::string(criticalPath.empty() ? "" : " -> ") + std::string(name);
+	OV_LOG(TaskGraphLog, Display, "Critical path: {:.3f}ms [{:s}], execute {:.3f}ms, work {:.3f}ms",
+		ToMilliseconds(m_LastCriticalPathTime), criticalPath, ToMilliseconds(m_LastExecuteTime), ToMilliseconds(m_LastWorkTime)
+	);
+}
+
+std::vector<std::string_view> TaskGraph::GetLastCriticalPath() const
+{
+	std::vector<std::string_view> names;
+	names.reserve(m_LastCriticalPath.size());
+	for (uint32_t taskIndex : m_LastCriticalPath)
+		names.push_back(m_Tasks[taskIndex].Name);
+	return (names);
+}
+
+void TaskGraph::Compile()
+{
+	/** The accesses to a resource since the last task that wrote it */
+	struct ResourceState
+	{
+		uint32_t LastWriter = UINT32_MAX;
+		std::vector<uint32_t> Readers;
+	};
+	std::unordered_map<std::string_view, ResourceState> resources;
+
+	for (Task& task : m_Tasks)
+	{
+		task.Predecessors.clear();
+		task.Successors.clear();
+	}
+
+	// Walk the tasks in the order they were added, each access depend on the previous conflicting ones
+	for (uint32_t taskIndex = 0; taskIndex < m_Tasks.size(); taskIndex++)
+	{
+		Task& task = m_Tasks[taskIndex];
+		for (const TaskResourceAccess& access : task.Accesses)
+		{
+			ResourceState& state = resources[access.Resource];
+			if (state.LastWriter != UINT32_MAX && state.LastWriter != taskIndex)
+				task.Predecessors.push_back(state.LastWriter);
+
+			if (access.Access == TaskAccess::Read)
+			{
+				state.Readers.push_back(taskIndex);
+				continue;
+			}
+
+			for (uint32_t reader : state.Readers)
+			{
+				if (reader != taskIndex)
+					task.Predecessors.push_back(reader);
+			}
+			state.LastWriter = taskIndex;
+			state.Readers.clear();
+		}
+
+		// A task accessing several resources may wait for the same task through each of them
+		std::sort(task.Predecessors.begin(), task.Predecessors.end());
+		task.Predecessors.erase(std::unique(task.Predecessors.begin(), task.Predecessors.end()), task.Predecessors.end());
+		for (uint32_t predecessor : task.Predecessors)
+			m_Tasks[predecessor].Successors.push_back(taskIndex);
+	}
+
+	// Kahn's algorithm, a depth at a time, so the tasks that can run together are next to each other
+	m_Order.clear();
+	m_RootTasks.clear();
+	std::vector<uint32_t> remainingPredecessors(m_Tasks.size());
+	for (uint32_t taskIndex = 0; taskIndex < m_Tasks.size(); taskIndex++)
+	{
+		remainingPredecessors[taskIndex] = static_cast<uint32_t>(m_Tasks[taskIndex].Predecessors.size());
+		if (remainingPredecessors[taskIndex] == 0)
+			m_RootTasks.push_back(taskIndex);
+	}
+
+	m_Order = m_RootTasks;
+	for (size_t depthBegin = 0; depthBegin < m_Order.size();)
+	{
+		const size_t depthEnd = m_Order.size();
+		for (size_t i = depthBegin; i < depthEnd; i++)
+		{
+			for (uint32_t successor : m_Tasks[m_Order[i]].Successors)
+			{
+				if (--remainingPredecessors[successor] == 0)
+					m_Order.push_back(successor);
+			}
+		}
+		depthBegin = depthEnd;
+	}
+	CHECK(m_Order.size() == m_Tasks.size());
+
+	m_PendingPredecessors = std::make_unique<std::atomic<uint32_t>[]>(m_Tasks.size());
+	m_bDirty = false;
+
+	OV_LOG(TaskGraphLog, Verbose, "Task graph compiled: {:d} tasks, {:d} roots", m_Tasks.size(), m_RootTasks.size());
+}
+
+void TaskGraph::Dispatch(JobSystem& jobSystem, JobCounter& counter, uint32_t taskIndex)
+{
+	auto job = [this, &jobSystem, &counter, taskIndex]() { RunTask(jobSystem, counter, taskIndex); };
+	if (m_Tasks[taskIndex].Thread == TaskThread::MainThread)
+		jobSystem.RunOnMainThread(job, &counter);
+	else
+		jobSystem.Run(counter, job);
+}
+
+void TaskGraph::RunTask(JobSystem& jobSystem, JobCounter& counter, uint32_t taskIndex)
+{
+	Task& task = m_Tasks[taskIndex];
+
+	Timer taskTimer;
+	task.Function();
+	task.LastTime = taskTimer.Elapsed();
+
+	for (uint32_t successor : task.Successors)
+	{
+		if (m_PendingPredecessors[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+			Dispatch(jobSystem, counter, successor);
+	}
+}
+
+void TaskGraph::CalculateCriticalPath()
+{
+	// Longest path in a DAG: in topological order, a task end after the predecessor that end last
+	std::vector<std::chrono::nanoseconds> endTimes(m_Tasks.size());
+	std::vector<uint32_t> longestPredecessors(m_Tasks.size(), UINT32_MAX);
+	uint32_t lastTask = UINT32_MAX;
+	m_LastWorkTime = std::chrono::nanoseconds(0);
+
+	for (uint32_t taskIndex : m_Order)
+	{
+		const Task& task = m_Tasks[taskIndex];
+		std::chrono::nanoseconds startTime{ 0 };
+		for (uint32_t predecessor : task.Predecessors)
+		{
+			if (endTimes[predecessor] >= startTime)
+			{
+				startTime = endTimes[predecessor];
+				longestPredecessors[taskIndex] = predecessor;
+			}
+		}
+
+		endTimes[taskIndex] = startTime + task.LastTime;
+		m_LastWorkTime += task.LastTime;
+		if (lastTask == UINT32_MAX || endTimes[taskIndex] > endTimes[lastTask])
+			lastTask = taskIndex;
+	}
+
+	m_LastCriticalPath.clear();
+	m_LastCriticalPathTime = (lastTask != UINT32_MAX ? endTimes[lastTask] : std::chrono::nanoseconds(0));
+	for (uint32_t taskIndex = lastTask; taskIndex != UINT32_MAX; taskIndex = longestPredecessors[taskIndex])
+		m_LastCriticalPath.push_back(taskIndex);
+	std::reverse(m_LastCriticalPath.begin(), m_LastCriticalPath.end());
+}
+
+uint32_t TaskGraph::FindTask(std::string_view name) const
+{
+	for (uint32_t i = 0; i < m_Tasks.size(); i++)
+	{
+		if (m_Tasks[i].Name == name)
+			return (i);
+	}
+	return (UINT32_MAX);
+}
+
+/* TASK ACCESS NAMESPACE */
+
+const char* TaskAccess::ToString(Type access)
+{
+	switch (access)
+	{
+	case Type::Read:
+		return ("Read");
+	case Type::Write:
+		return ("Write");
+	default:
+		return ("Unknown");
+	}
+}
+
+/* TASK THREAD NAMESPACE */
+
+const char* TaskThread::ToString(Type thread)
+{
+	switch (thread)
+	{
+	case Type::AnyThread:
+		return ("AnyThread");
+	case Type::MainThread:
+		return ("MainThread");
+	default:
+		return ("Unknown");
+	}
+}
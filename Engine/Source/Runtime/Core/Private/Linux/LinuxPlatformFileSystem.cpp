@@ -0,0 +1,48 @@
+// The platform files are all part of the module, only the ones of the current platform are compiled
+#ifdef PLATFORM_LINUX
+
+#include "Linux/LinuxPlatformFileSystem.h"
+#include "MacrosHelper.h"
+#include "Path.h"
+
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+Path LinuxPlatformFileSystem::MakeEngineRootDirectoryPath()
+{
+	// Get binary path, readlink doesn't add the null terminator
+	char buffer[MAX_PATH_LENGTH];
+	const ssize_t length = readlink("/proc/self/exe", buffer, MAX_PATH_LENGTH - 1);
+	if (length <= 0)
+		return ("");
+	buffer[length] = '\0';
+	Path binaryPath = buffer;
+
+	// Remove everything from "build" to the end
+	Path::size_type segmentIndex = binaryPath.RightFindSegment("build");
+	if (segmentIndex != static_cast<Path::size_type>(-1))
+		binaryPath.TrimSegments(segmentIndex, binaryPath.GetSegmentCount() - 1);
+	return (binaryPath);
+}
+
+Path LinuxPlatformFileSystem::MakeModuleDirectoryPath()
+{
+	// The shared object this function is part of
+	Dl_info currentModuleInfo;
+	if (dladdr(reinterpret_cast<const void*>(&LinuxPlatformFileSystem::MakeModuleDirectoryPath), &currentModuleInfo) == 0
+		|| currentModuleInfo.dli_fname == nullptr)
+		return ("");
+
+	// dli_fname is the path the module was loaded with, it can be relative
+	char* currentModulePath = realpath(currentModuleInfo.dli_fname, nullptr);
+	if (currentModulePath == nullptr)
+		return ("");
+	Path moduleDirectoryPath = currentModulePath;
+	free(currentModulePath);
+	moduleDirectoryPath.TrimTarget();
+
+	return (moduleDirectoryPath);
+}
+
+#endif // PLATFORM_LINUX
@@ -7,6 +7,7 @@
 #include <format>
 
 std::unique_ptr<File> Logger::s_LogFile = nullptr;
+std::mutex Logger::s_Mutex;
 
 void Logger::Log(Verbosity::Type verbosity, LogCategory& category, std::string message)
 {
@@ -18,10 +19,13 @@ void Logger::Log(Verbosity::Type verbosity, LogCategory& category, std::string m
 	cleanMessage.erase(std::remove(cleanMessage.begin(), cleanMessage.end(), '\n'), cleanMessage.end());
 
 	std::string logMessage = std::format("[{:s}]: {:s}: {:s}", category.GetName(), Verbosity::ToString(verbosity), cleanMessage);
+	{
+		std::lock_guard lock(s_Mutex);
 #ifdef OV_DEBUG
-	LogOntoConsole(logMessage);
+		LogOntoConsole(logMessage);
 #endif
-	LogOntoFile(logMessage);
+		LogOntoFile(logMessage);
+	}
 
 	if (verbosity == Verbosity::Fatal)
 		assert(false);
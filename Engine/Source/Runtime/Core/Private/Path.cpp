@@ -80,12 +80,13 @@ Path::size_type Path::FindSegment(const std::string_view segment) const
 
 Path::size_type Path::RightFindSegment(const std::string_view segment) const
 {
-	for (size_type i = m_Path.size() - 1; i >= 0; i--)
+	// size_type is unsigned, the loop stop after the first segment
+	for (size_type i = GetSegmentCount(); i > 0; i--)
 	{
-		if (m_Path[i] == segment)
-			return (i);
+		if (m_Path[i - 1] == segment)
+			return (i - 1);
 	}
-	return (-1);
+	return (static_cast<size_type>(-1));
 }
 
 void Path::SplitOntoSegment(const std::string_view path)
@@ -116,16 +117,17 @@ void Path::SplitOntoSegment(const std::string_view path)
 
 std::string Path::GetPath(const char separator) const
 {
-	char buffer[MAX_PATH_LENGTH] = "";
+	std::string path;
+	path.reserve(MAX_PATH_LENGTH);
 
 	for (size_t i = 0; i < m_Path.size(); i++)
 	{
-		strncat_s(buffer, m_Path[i].c_str(), m_Path[i].size());
+		path += m_Path[i];
 		if (i < m_Path.size() - 1)
-			strncat_s(buffer, &separator, 1);
+			path += separator;
 	}
 
-	return (std::string(buffer));
+	return (path);
 }
 
 const std::string_view Path::GetFileTarget() const
@@ -188,7 +190,7 @@ Path Path::GetLogDirectoryPath()
 
 Path Path::GetSavedDirectoryPath()
 {
-	return (GetEngineRootDirectoryPath().AppendSegment("saved\\"));
+	return (GetEngineRootDirectoryPath().AppendSegment("saved"));
 }
 #pragma endregion
 
@@ -1,6 +1,8 @@
 #include "Profiling/ProfilingPerFrame.h"
 
 std::unordered_map<std::string, PerFrameProfilingData> PerFrameProfilerStorage::s_ProfilingDatas;
+std::unordered_map<std::string, PerFrameCounterData> PerFrameProfilerStorage::s_CounterDatas;
+std::mutex PerFrameProfilerStorage::s_Mutex;
 
 void PerFrameProfilingData::AddCall(std::chrono::nanoseconds timeMicroSeconds)
 {
@@ -31,13 +33,21 @@ std::chrono::nanoseconds PerFrameProfilingData::CalculateTotal() const
 	return (sum);
 }
 
-void PerFrameProfilerStorage::Report(std::string_view categoryName, std::chrono::nanoseconds& timeMicroSeconds)
+void PerFrameCounterData::Add(uint64_t value)
+{
+	m_CallCount++;
+	m_Total += value;
+	m_Max = glm::max(m_Max, value);
+}
+
+void PerFrameProfilerStorage::Report(std::string_view categoryName, const std::chrono::nanoseconds& timeMicroSeconds)
 {
 	Report(categoryName.data(), timeMicroSeconds);
 }
 
-void PerFrameProfilerStorage::Report(const char* categoryName, std::chrono::nanoseconds& timeMicroSeconds)
+void PerFrameProfilerStorage::Report(const char* categoryName, const std::chrono::nanoseconds& timeMicroSeconds)
 {
+	std::lock_guard lock(s_Mutex);
 	if (s_ProfilingDatas.find(categoryName) == s_ProfilingDatas.end())
 		s_ProfilingDatas[categoryName] = PerFrameProfilingData();
 	s_ProfilingDatas[categoryName]
@@ -46,7 +56,9 @@ void PerFrameProfilerStorage::Report(const char* categoryName, std::chrono::nano
 
 void PerFrameProfilerStorage::ClearAllData()
 {
+	std::lock_guard lock(s_Mutex);
 	s_ProfilingDatas.clear();
+	s_CounterDatas.clear();
 }
 
 void PerFrameProfilerStorage::ClearData(std::string_view categoryName)
@@ -56,10 +68,27 @@ void PerFrameProfilerStorage::ClearData(std::string_view categoryName)
 
 void PerFrameProfilerStorage::ClearData(const char* categoryName)
 {
+	std::lock_guard lock(s_Mutex);
 	s_ProfilingDatas.erase(categoryName);
+	s_CounterDatas.erase(categoryName);
+}
+
+PerFrameProfilingData PerFrameProfilerStorage::GetData(std::string_view categoryName)
+{
+	std::lock_guard lock(s_Mutex);
+	auto dataIt = s_ProfilingDatas.find(std::string(categoryName));
+	return (dataIt != s_ProfilingDatas.end() ? dataIt->second : PerFrameProfilingData());
 }
 
-const PerFrameProfilingData& PerFrameProfilerStorage::GetData(std::string_view categoryName)
+void PerFrameProfilerStorage::ReportCounter(const char* counterName, uint64_t value)
 {
-	return (s_ProfilingDatas.at(categoryName.data()));
-}
\ No newline at end of file
+	std::lock_guard lock(s_Mutex);
+	s_CounterDatas[counterName].Add(value);
+}
+
+PerFrameCounterData PerFrameProfilerStorage::GetCounterData(std::string_view counterName)
+{
+	std::lock_guard lock(s_Mutex);
+	auto counterIt = s_CounterDatas.find(std::string(counterName));
+	return (counterIt != s_CounterDatas.end() ? counterIt->second : PerFrameCounterData());
+}
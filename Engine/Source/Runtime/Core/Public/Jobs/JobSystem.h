@@ -0,0 +1,196 @@
+#pragma once
+
+#include "Core_API.h"
+#include "MacrosHelper.h"
+#include "Jobs/WorkStealingQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Count the jobs of a group that haven't finished, the group is done when it reach 0.
+ * It's the handle JobSystem::Wait wait on, it must outlive the jobs it counts.
+ */
+class CORE_API JobCounter final
+{
+public:
+	JobCounter() = default;
+	~JobCounter() = default;
+
+	JobCounter(const JobCounter& rhs) = delete;
+	JobCounter& operator=(const JobCounter& rhs) = delete;
+
+	__forceinline bool IsDone() const { return (m_PendingCount.load(std::memory_order_acquire) == 0); }
+	__forceinline uint32_t GetPendingCount() const { return (m_PendingCount.load(std::memory_order_relaxed)); }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> m_PendingCount = 0;
+};
+
+/**
+ * Run jobs on a pool of worker threads.
+ * Each thread (the workers and the thread that created the system, the main thread) has its own Chase-Lev deque:
+ * the jobs a thread run go at the bottom of its deque, and the threads that are out of jobs steal from the top of the others.
+ * Waiting on a counter run jobs until it's done, so the jobs can wait for the jobs they run (fork-join) without blocking a worker.
+ * The jobs that must run on the main thread (e.g. GLFW, the module loading) go in a queue of their own, see RunOnMainThread.
+ */
+class CORE_API JobSystem final
+{
+public:
+	using JobFunction = std::function<void()>;
+
+public:
+	/** \param workerCount how many threads are created, on top of the calling thread that become the main thread of the system */
+	JobSystem(uint32_t workerCount = GetDefaultWorkerCount());
+	/** Stop the workers, every counter must be done */
+	~JobSystem();
+
+	JobSystem(const JobSystem& rhs) = delete;
+	JobSystem& operator=(const JobSystem& rhs) = delete;
+
+	/** A worker per core, but the one of the main thread */
+	static uint32_t GetDefaultWorkerCount();
+
+	/** Get the job system of the engine */
+	[[nodiscard]] static JobSystem& Get();
+	/** Create the job system of the engine, on the main thread */
+	static JobSystem& Create(uint32_t workerCount = GetDefaultWorkerCount());
+	/** Destroy the job system of the engine, on the main thread */
+	static void Shutdown();
+	static bool IsCreated() { return (s_Instance != nullptr); }
+
+#pragma region API
+public:
+	/** Run a job on any thread of the system, the counter is done once it (and the other jobs of the counter) finished */
+	void Run(JobCounter& counter, JobFunction function);
+	/** Run jobs (the main thread jobs too, on the main thread) until the counter is done */
+	void Wait(JobCounter& counter);
+
+	/**
+	 * Call body(index) for each index in [0, count), split in chunks of grainSize indices run in parallel, and wait for them.
+	 * The calling thread run the first chunk and then help with the others.
+	 *
+	 * \param grainSize how many indices a job handle, 0 to pick it from the count and the number of threads (@see CalculateGrainSize)
+	 */
+	template<typename F>
+	void ParallelFor(uint32_t count, F&& body, uint32_t grainSize = 0);
+	/** Split a range in about 4 chunks per thread, enough for the threads done early to steal from the others */
+	uint32_t CalculateGrainSize(uint32_t count) const;
+
+	/** Queue a job that only the main thread can run (from ExecuteMainThreadJobs or a Wait of the main thread), from any thread */
+	void RunOnMainThread(JobFunction function, JobCounter* counter = nullptr);
+	/** Main thread only: run the main thread jobs queued so far */
+	void ExecuteMainThreadJobs();
+
+	bool IsMainThread() const { return (std::this_thread::get_id() == m_MainThreadId); }
+	/** How many threads run the jobs, the main thread included */
+	uint32_t GetThreadCount() const { return (static_cast<uint32_t>(m_Threads.size())); }
+
+	/**
+	 * Micro benchmark of the job system, from 1 thread to maxThreadCount threads: throughput of empty jobs,
+	 * fork-join of a binary tree of jobs, and speedup of a ParallelFor on a compute bound loop.
+	 *
+	 * \param maxThreadCount 0 for a thread per core
+	 */
+	static void LogBenchmark(uint32_t maxThreadCount = 0);
+#pragma endregion
+
+private:
+	struct Job
+	{
+		JobFunction Function;
+		JobCounter* Counter = nullptr;
+	};
+
+	/** What each thread of the system own */
+	struct ThreadContext
+	{
+		WorkStealingQueue<Job*> Queue;
+		uint32_t Index = 0;
+		/** Where the search for a victim start, so the thieves don't all steal from the same thread */
+		uint32_t RandomState = 0;
+	};
+
+	/** Loop of the worker threads: run jobs, sleep when there is none */
+	void WorkerMain(uint32_t threadIndex);
+	/** Get a job: from the deque of the thread, then from the jobs of the threads outside the system, then from the other threads */
+	Job* FindJob(ThreadContext* context);
+	void Execute(Job* job);
+	/** Add a job to the deque of the thread, or to the shared queue when the thread isn't one of the system */
+	void Submit(Job* job);
+	/** The context of the calling thread, nullptr if it isn't a thread of this system */
+	ThreadContext* GetCurrentContext() const;
+
+private:
+	static JobSystem* s_Instance;
+
+	std::thread::id m_MainThreadId;
+	/** The context of each thread, the main thread is the first one */
+	std::vector<std::unique_ptr<ThreadContext>> m_Threads;
+	std::vector<std::thread> m_Workers;
+	std::atomic<bool> m_bStopping = false;
+
+	/** The jobs run by threads outside of the system */
+	std::mutex m_SharedJobsMutex;
+	std::deque<Job*> m_SharedJobs;
+	std::atomic<uint32_t> m_SharedJobCount = 0;
+
+	std::mutex m_MainThreadJobsMutex;
+	std::vector<Job*> m_MainThreadJobs;
+	std::atomic<uint32_t> m_MainThreadJobCount = 0;
+
+	/** The jobs in the queues, the workers sleep while it's 0 */
+	std::atomic<int64_t> m_QueuedJobCount = 0;
+	std::atomic<uint32_t> m_SleepingWorkerCount = 0;
+	std::mutex m_SleepMutex;
+	std::condition_variable m_WakeCondition;
+
+	/** The system of the main thread before this one was created, restored when it's destroyed */
+	const JobSystem* m_PreviousSystem = nullptr;
+	ThreadContext* m_PreviousContext = nullptr;
+};
+
+template<typename F>
+void JobSystem::ParallelFor(uint32_t count, F&& body, uint32_t grainSize)
+{
+	if (count == 0)
+		return;
+
+	grainSize = (grainSize == 0 ? CalculateGrainSize(count) : grainSize);
+	const uint32_t chunkCount = static_cast<uint32_t>((static_cast<uint64_t>(count) + grainSize - 1) / grainSize);
+
+	// The jobs only capture the chunk and this range, small enough to not be allocated by the std::function
+	struct Range
+	{
+		std::remove_reference_t<F>* Body;
+		uint32_t Count;
+		uint32_t GrainSize;
+
+		void RunChunk(uint32_t chunk) const
+		{
+			const uint64_t begin = static_cast<uint64_t>(chunk) * GrainSize;
+			const uint64_t end = std::min<uint64_t>(begin + GrainSize, Count);
+			for (uint32_t index = static_cast<uint32_t>(begin); index < end; index++)
+				(*Body)(index);
+		}
+	};
+	const Range range{ &body, count, grainSize };
+
+	JobCounter counter;
+	for (uint32_t chunk = 1; chunk < chunkCount; chunk++)
+		Run(counter, [&range, chunk]() { range.RunChunk(chunk); });
+
+	range.RunChunk(0);
+	Wait(counter);
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Core_API.h"
+#include "MacrosHelper.h"
+#include "Logging/LoggingMacros.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class JobSystem;
+class JobCounter;
+
+DECLARE_LOG_CATEGORY(TaskGraphLog);
+
+namespace TaskAccess
+{
+	/** What a task does with a resource */
+	enum Type : uint8_t
+	{
+		/** The tasks reading a resource run in parallel, after the last task that wrote it */
+		Read = 0,
+		/** A task writing a resource run alone, after the last task that wrote it and the tasks that read it since */
+		Write = 1,
+
+		COUNT = 2
+	};
+
+	const char* ToString(Type access);
+}
+
+namespace TaskThread
+{
+	/** Which threads can run a task */
+	enum Type : uint8_t
+	{
+		/** Any thread of the job system */
+		AnyThread = 0,
+		/** Only the main thread (e.g. GLFW calls) */
+		MainThread = 1,
+
+		COUNT = 2
+	};
+
+	const char* ToString(Type thread);
+}
+
+/** A resource (e.g. the world, the camera, the command buffers of the frame) a task read or write, resources are only names */
+struct TaskResourceAccess
+{
+	std::string Resource;
+	TaskAccess::Type Access = TaskAccess::Read;
+};
+
+/**
+ * A graph of tasks run every frame by the job system.
+ * The tasks don't depend on each other directly but declare the resources they read and write: two tasks that access
+ * the same resource, and at least one of them write it, run in the order they were added, the others run in parallel.
+ * The dependencies always go from a task to a task added after it, so the graph has no cycle.
+ *
+ * The dependencies and the topological order are built on the first Execute after the tasks changed, and reused by the next ones.
+ * Each Execute report the critical path of the frame to the PerFrameProfilerStorage (@see TaskGraph::ProfilingCategories):
+ * the chain of dependent tasks that took the longest, the frame can't be shorter than it however many threads run the tasks.
+ */
+class CORE_API TaskGraph final
+{
+public:
+	using TaskFunction = std::function<void()>;
+
+	/** Name of the PerFrameProfilerStorage categories the executions are reported to */
+	struct ProfilingCategories
+	{
+		/** Sum of the time of the tasks of the critical path */
+		static constexpr const char* CriticalPath = "TaskGraph_CriticalPath";
+		/** Time between the start of Execute and the end of the last task */
+		static constexpr const char* Execute = "TaskGraph_Execute";
+		/** Sum of the time of all the tasks, over Execute it's how many threads were busy on average */
+		static constexpr const char* Work = "TaskGraph_Work";
+	};
+
+public:
+	TaskGraph() = default;
+	~TaskGraph() = default;
+
+	TaskGraph(const TaskGraph& rhs) = delete;
+	TaskGraph& operator=(const TaskGraph& rhs) = delete;
+
+#pragma region API
+public:
+	/**
+	 * Add a task at the end of the graph, run by every Execute.
+	 *
+	 * \param name unique name of the task, for the logs and RemoveTask
+	 * \param accesses the resources the task read and write
+	 * \return false if a task already has this name
+	 */
+	bool AddTask(std::string_view name, std::vector<TaskResourceAccess> accesses, TaskFunction function, TaskThread::Type thread = TaskThread::AnyThread);
+	/** Remove a task, the tasks that depended on it through a resource now depend on the tasks it depended on */
+	bool RemoveTask(std::string_view name);
+	bool HasTask(std::string_view name) const;
+	void Clear();
+
+	/**
+	 * Run every task once, from the main thread of the job system, and wait for them.
+	 * The main thread run tasks too while waiting, the main thread tasks among them.
+	 */
+	void Execute(JobSystem& jobSystem);
+
+	/** Log the tasks in topological order with the tasks each one wait for, and the critical path of the last Execute */
+	void LogGraph();
+
+	__forceinline uint32_t GetTaskCount() const { return (static_cast<uint32_t>(m_Tasks.size())); }
+	/** Get the names of the tasks of the critical path of the last Execute, in execution order */
+	std::vector<std::string_view> GetLastCriticalPath() const;
+	__forceinline std::chrono::nanoseconds GetLastCriticalPathTime() const { return (m_LastCriticalPathTime); }
+	__forceinline std::chrono::nanoseconds GetLastExecuteTime() const { return (m_LastExecuteTime); }
+#pragma endregion
+
+private:
+	struct Task
+	{
+		std::string Name;
+		std::vector<TaskResourceAccess> Accesses;
+		TaskFunction Function;
+		TaskThread::Type Thread = TaskThread::AnyThread;
+
+		/** Built by Compile: the tasks it wait for, and the tasks that wait for it */
+		std::vector<uint32_t> Predecessors;
+		std::vector<uint32_t> Successors;
+
+		/** Time the task took in the last Execute */
+		std::chrono::nanoseconds LastTime{ 0 };
+	};
+
+	/** Build the dependencies from the resources accesses, and the topological order */
+	void Compile();
+	/** Queue a task whose predecessors are done */
+	void Dispatch(JobSystem& jobSystem, JobCounter& counter, uint32_t taskIndex);
+	/** Run a task, then dispatch the successors it was the last predecessor of */
+	void RunTask(JobSystem& jobSystem, JobCounter& counter, uint32_t taskIndex);
+	/** Find the longest chain of the last Execute, from the time of each task */
+	void CalculateCriticalPath();
+	uint32_t FindTask(std::string_view name) const;
+
+private:
+	std::vector<Task> m_Tasks;
+	/** Whether the tasks changed since the last Compile */
+	bool m_bDirty = true;
+
+	/** The tasks sorted so each one comes after its predecessors, by depth in the graph */
+	std::vector<uint32_t> m_Order;
+	/** The tasks without predecessor, dispatched at the start of Execute */
+	std::vector<uint32_t> m_RootTasks;
+	/** How many predecessors of each task haven't finished in the current Execute */
+	std::unique_ptr<std::atomic<uint32_t>[]> m_PendingPredecessors;
+
+	std::vector<uint32_t> m_LastCriticalPath;
+	std::chrono::nanoseconds m_LastCriticalPathTime{ 0 };
+	std::chrono::nanoseconds m_LastExecuteTime{ 0 };
+	std::chrono::nanoseconds m_LastWorkTime{ 0 };
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "MacrosHelper.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Chase-Lev work-stealing deque (with the memory orders of "Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013).
+ * The owner thread push and pop at the bottom (LIFO, the hot data of the last job it pushed), any other thread steal at the top (FIFO, the oldest and biggest jobs).
+ * It grows when full, the old arrays are kept until the queue dies because a thief may still be reading them.
+ *
+ * \tparam T a trivially copyable value (e.g. a pointer), T() is returned when there is nothing to pop or steal
+ */
+template<typename T>
+class WorkStealingQueue final
+{
+	static_assert(std::is_trivially_copyable_v<T>, "The values of a WorkStealingQueue are copied from atomics");
+
+public:
+	WorkStealingQueue(int64_t initialCapacity = 1024)
+	{
+		CHECK(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0);
+		m_Arrays.push_back(std::make_unique<RingArray>(initialCapacity));
+		m_Array.store(m_Arrays.back().get(), std::memory_order_relaxed);
+	}
+	~WorkStealingQueue() = default;
+
+	WorkStealingQueue(const WorkStealingQueue& rhs) = delete;
+	WorkStealingQueue& operator=(const WorkStealingQueue& rhs) = delete;
+
+#pragma region API
+public:
+	/** Owner thread only: add a value at the bottom */
+	void Push(T value)
+	{
+		const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		const int64_t top = m_Top.load(std::memory_order_acquire);
+		RingArray* array = m_Array.load(std::memory_order_relaxed);
+		if (bottom - top > array->Capacity - 1)
+			array = Grow(array, bottom, top);
+
+		array->Store(bottom, value);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	/** Owner thread only: take the value at the bottom, T() if the queue is empty */
+	T Pop()
+	{
+		const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		RingArray* array = m_Array.load(std::memory_order_relaxed);
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			// Empty, restore the bottom
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return (T());
+		}
+
+		T value = array->Load(bottom);
+		if (top == bottom)
+		{
+			// Last value, race the thieves for it
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				value = T();
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return (value);
+	}
+
+	/** Any thread: take the value at the top, T() if the queue is empty or another thread took it first */
+	T Steal()
+	{
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return (T());
+
+		RingArray* array = m_Array.load(std::memory_order_acquire);
+		T value = array->Load(top);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return (T());
+		return (value);
+	}
+
+	/** Approximate when other threads push or steal */
+	__forceinline bool IsEmpty() const { return (m_Bottom.load(std::memory_order_relaxed) <= m_Top.load(std::memory_order_relaxed)); }
+	__forceinline int64_t GetCapacity() const { return (m_Array.load(std::memory_order_relaxed)->Capacity); }
+#pragma endregion
+
+private:
+	/** A power of two ring, indexed by the ever growing top and bottom */
+	struct RingArray
+	{
+		RingArray(int64_t capacity)
+			: Capacity(capacity), Mask(capacity - 1), Values(new std::atomic<T>[capacity])
+		{}
+
+		__forceinline T Load(int64_t index) const { return (Values[index & Mask].load(std::memory_order_relaxed)); }
+		__forceinline void Store(int64_t index, T value) { Values[index & Mask].store(value, std::memory_order_relaxed); }
+
+		const int64_t Capacity;
+		const int64_t Mask;
+		std::unique_ptr<std::atomic<T>[]> Values;
+	};
+
+	/** Owner thread only: copy the values in an array twice as big */
+	RingArray* Grow(RingArray* array, int64_t bottom, int64_t top)
+	{
+		m_Arrays.push_back(std::make_unique<RingArray>(array->Capacity * 2));
+		RingArray* newArray = m_Arrays.back().get();
+		for (int64_t i = top; i < bottom; i++)
+			newArray->Store(i, array->Load(i));
+		m_Array.store(newArray, std::memory_order_release);
+		return (newArray);
+	}
+
+private:
+	/** Thieves and owner, on their own cache line so the owner pushing doesn't slow down the thieves */
+	alignas(64) std::atomic<int64_t> m_Top = 0;
+	/** Owner */
+	alignas(64) std::atomic<int64_t> m_Bottom = 0;
+	std::atomic<RingArray*> m_Array = nullptr;
+	/** Every array the queue used, owner only */
+	std::vector<std::unique_ptr<RingArray>> m_Arrays;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Core_API.h"
+
+class Path;
+
+/**
+ * A helper class to interact with Linux file system
+ */
+class CORE_API LinuxPlatformFileSystem
+{
+public:
+	/** Find Engine root directory Path */
+	static Path MakeEngineRootDirectoryPath();
+	/** Find the path where all the module are stored */
+	static Path MakeModuleDirectoryPath();
+};
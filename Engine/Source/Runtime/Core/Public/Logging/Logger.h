@@ -8,12 +8,14 @@
 #include <stdio.h>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <format>
 
 /**
  * Static Class that log message onto console and/or file.
  * TODO: Add file logging
- * TODO: Add thread safe logging (using a queue probably)
+ * The logs can come from any thread, they are written one at a time.
+ * TODO: Write the logs from a queue, so the threads don't wait for the file
  */
 class CORE_API Logger final
 {
@@ -27,4 +29,6 @@ private:
 
 private:
 	static std::unique_ptr<File> s_LogFile;
+	/** Guard the console and the log file */
+	static std::mutex s_Mutex;
 };
@@ -36,7 +36,7 @@
 #elif PLATFORM_MAC
 # define PLATFORM_NAME Mac
 #elif PLATFORM_LINUX
-# define PLATFORM_MAME Linux
+# define PLATFORM_NAME Linux
 #else
 # error PLATFORM_NAME not defined for this platform
 #endif
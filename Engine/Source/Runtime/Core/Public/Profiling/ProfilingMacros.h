@@ -39,6 +39,10 @@
 # define STOP_PERFRAME_TIMER(Category) EMPTY_MACRO
 
 # define GET_PERFRAME_TIMER_DATA(Category) EMPTY_MACRO
+# define REPORT_PERFRAME_TIMER(Category, Duration) EMPTY_MACRO
+
+# define REPORT_PERFRAME_COUNTER(Category, Value) EMPTY_MACRO
+# define GET_PERFRAME_COUNTER_DATA(Category) EMPTY_MACRO
 
 # define CREATE_SCOPE_NAMED_TIMER(Name, Lamda) EMPTY_MACRO
 # define CREATE_SCOPE_TIMER(Lamda) EMPTY_MACRO
@@ -102,6 +106,15 @@
 # define STOP_PERFRAME_TIMER(Category) PerFrameProfilerStorage::Report(#Category, TIMER_NAMED_ELAPSED(__PerFrameNamedTimer##Category))
 /** Get data of a per frame timer */
 # define GET_PERFRAME_TIMER_DATA(Category) GET_PERFRAME_DATA(#Category)
+/** Report a duration measured some other way (e.g. by a worker thread, or on the GPU) to a per frame timer category */
+# define REPORT_PERFRAME_TIMER(Category, Duration) PerFrameProfilerStorage::Report(Category, Duration)
+
+// Per frame counter
+
+/** Add a value to a per frame counter (How many time it's reported, total and max value per frame) */
+# define REPORT_PERFRAME_COUNTER(Category, Value) PerFrameProfilerStorage::ReportCounter(Category, Value)
+/** Get data of a per frame counter */
+# define GET_PERFRAME_COUNTER_DATA(Category) PerFrameProfilerStorage::GetCounterData(Category)
 
 // Scope timer
 
@@ -4,6 +4,7 @@
 #include "Profiling/ProfilingTimer.h"
 
 #include <glm/glm.hpp>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
@@ -31,23 +32,54 @@ protected:
 	std::chrono::nanoseconds m_Max{ 0 };
 };
 
+/** Perframe values collected by counters (e.g. how many bytes have been uploaded) */
+struct PerFrameCounterData
+{
+
+public:
+	void Add(uint64_t value);
+
+	/** Return how many time this counter has been reported this frame */
+	size_t GetCallCount() const { return (m_CallCount); }
+	/** Return the sum of the values reported this frame */
+	uint64_t GetTotal() const { return (m_Total); }
+	/** Return the biggest value reported this frame */
+	uint64_t GetMax() const { return (m_Max); }
+
+protected:
+	size_t m_CallCount = 0;
+	uint64_t m_Total = 0;
+	uint64_t m_Max = 0;
+};
+
 /**
  * This static cast collect/store data from PerFrame timer and store them.
+ * The reports can come from any thread (e.g. the tasks of the frame graph), the getters return a copy taken under the same lock
+ * so the datas can be read while the tasks of a frame are still reporting.
  */
 class CORE_API PerFrameProfilerStorage final
 {
 public:
-	static void Report(std::string_view categoryName, std::chrono::nanoseconds &timeMicroSeconds);
-	static void Report(const char* categoryName, std::chrono::nanoseconds &timeMicroSeconds);
+	static void Report(std::string_view categoryName, const std::chrono::nanoseconds& timeMicroSeconds);
+	static void Report(const char* categoryName, const std::chrono::nanoseconds& timeMicroSeconds);
 
 	static void ClearAllData();
 	static void ClearData(std::string_view categoryName);
 	static void ClearData(const char* categoryName);
 
-	static const PerFrameProfilingData& GetData(std::string_view categoryName);
+	/** Return a copy of the category, or an empty one if nothing has been reported this frame */
+	static PerFrameProfilingData GetData(std::string_view categoryName);
+
+	/** Add a value to a counter, the counters are cleared with the timers */
+	static void ReportCounter(const char* counterName, uint64_t value);
+	/** Return a copy of the counter, or an empty one if nothing has been reported this frame */
+	static PerFrameCounterData GetCounterData(std::string_view counterName);
 
 private:
 	static std::unordered_map<std::string, PerFrameProfilingData> s_ProfilingDatas;
+	static std::unordered_map<std::string, PerFrameCounterData> s_CounterDatas;
+	/** Guard the reports, the clears and the copies of the getters */
+	static std::mutex s_Mutex;
 };
 
 /**
@@ -0,0 +1,23 @@
+function CpuRendererModule(config)
+	local CpuRenderer = {}
+
+	CpuRenderer.Public_IncludeDirs = {
+		"Public",
+	}
+	CpuRenderer.Private_IncludeDirs = {
+		"Private",
+	}
+
+	-- Reference renderer for machines without GPU, must stay headless (no Vulkan/GLFW)
+	CpuRenderer.ModuleDependency = {
+		"Core",
+		"Voxel",
+	}
+	CpuRenderer.ThirdPartyDependency = {
+		"glm",
+	}
+
+	return CpuRenderer
+end
+
+return CpuRendererModule
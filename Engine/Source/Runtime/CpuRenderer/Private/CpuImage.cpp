@@ -0,0 +1,33 @@
+#include "CpuImage.h"
+#include "CpuRendererGlobals.h"
+#include "HAL/File.h"
+
+#include <format>
+#include <string>
+
+bool CpuImage::WritePPM(std::string_view fullPath) const
+{
+	std::unique_ptr<File> file = File::OpenUnique(fullPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (file == nullptr)
+		return (false);
+
+	// Build the whole file in memory, so it's written in one go
+	std::string content = std::format("P6\n{:d} {:d}\n255\n", m_Width, m_Height);
+	const size_t headerSize = content.size();
+	content.resize(headerSize + m_Pixels.size() * 3);
+
+	char* data = content.data() + headerSize;
+	for (const glm::vec4& pixel : m_Pixels)
+	{
+		const glm::vec3 color = glm::clamp(glm::vec3(pixel), 0.0f, 1.0f) * 255.0f + 0.5f;
+		*data++ = static_cast<char>(static_cast<uint8_t>(color.r));
+		*data++ = static_cast<char>(static_cast<uint8_t>(color.g));
+		*data++ = static_cast<char>(static_cast<uint8_t>(color.b));
+	}
+
+	*file << content;
+	file->Close();
+
+	CPURENDERER_LOG(Verbose, "Image written to \"{:s}\"", fullPath);
+	return (true);
+}
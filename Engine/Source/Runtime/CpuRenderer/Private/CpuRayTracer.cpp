@@ -0,0 +1,140 @@
+#include "CpuRayTracer.h"
+#include "CpuRendererGlobals.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+CpuImage CpuRayTracer::Render(const CpuRayTracerSettings& settings) const
+{
+	CHECK(settings.TileSize > 0);
+
+	CpuImage image(settings.Width, settings.Height);
+
+	const glm::uvec2 launchSize(settings.Width, settings.Height);
+	const glm::uvec2 tileCount = (launchSize + settings.TileSize - 1u) / settings.TileSize;
+	const uint32_t totalTileCount = tileCount.x * tileCount.y;
+
+	uint32_t threadCount = (settings.ThreadCount == 0 ? std::thread::hardware_concurrency() : settings.ThreadCount);
+	threadCount = glm::clamp(threadCount, 1u, glm::max(totalTileCount, 1u));
+
+	START_TIMER;
+
+	// Each thread take the next tile that hasn't been rendered yet, until there is no more tiles
+	std::atomic<uint32_t> nextTile = 0;
+	auto renderTiles = [&]()
+		{
+			for (uint32_t tile = nextTile++; tile < totalTileCount; tile = nextTile++)
+			{
+				const glm::uvec2 tileMin = glm::uvec2(tile % tileCount.x, tile / tileCount.x) * settings.TileSize;
+				const glm::uvec2 tileMax = glm::min(tileMin + settings.TileSize, launchSize);
+
+				for (uint32_t y = tileMin.y; y < tileMax.y; y++)
+				{
+					for (uint32_t x = tileMin.x; x < tileMax.x; x++)
+						image.SetPixel(x, y, RayGen(glm::uvec2(x, y), launchSize, settings));
+				}
+			}
+		};
+
+	// The calling thread render tiles too
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; i++)
+		workers.emplace_back(renderTiles);
+	renderTiles();
+	for (std::thread& worker : workers)
+		worker.join();
+
+	STOP_TIMER;
+	const double elapsedMs = TO_DOUBLE_MILLISECONDS(TIMER_RESULT);
+	CPURENDERER_LOG(Display, "Rendered {:d}x{:d} (DEBUG_VIEW={:s} INSIDE_HITS={:d}, {:d} tiles, {:d} threads) in {:.2f}ms, {:.2f} Mrays/s",
+		settings.Width, settings.Height, CpuRayTracerDebugView::ToString(settings.DebugView), settings.bInsideHits ? 1 : 0, totalTileCount, threadCount, elapsedMs,
+		elapsedMs > 0.0 ? static_cast<double>(settings.Width) * settings.Height / (elapsedMs * 1000.0) : 0.0
+	);
+
+	return (image);
+}
+
+glm::vec4 CpuRayTracer::RayGen(const glm::uvec2& launchId, const glm::uvec2& launchSize, const CpuRayTracerSettings& settings) const
+{
+	// Keep in sync with raytrace.rgen
+	glm::vec2 uv = glm::vec2(launchId) / glm::vec2(launchSize);
+	uv = (uv * 2.0f - 1.0f) * glm::vec2(1.0f, -1.0f);
+
+	const glm::vec3 cameraPosition = glm::vec3(-20.0f, 20.0f, -20.0f);
+	const glm::vec3 cameraDirection = -glm::normalize(cameraPosition);
+
+	RayPayload payload;
+	TraceRay(
+		cameraPosition,
+		0.001f,
+		cameraDirection + glm::vec3(uv.x, uv.y, 0.0f),
+		100.0f,
+		settings,
+		payload
+	);
+
+	if (settings.DebugView == CpuRayTracerDebugView::HitDistance)
+		payload.Color = glm::vec3(payload.bDidHit ? payload.DistanceAlongTheRay / 100.0f : 1.0f);
+	else if (settings.DebugView == CpuRayTracerDebugView::HitMask)
+		payload.Color = glm::vec3(payload.bDidHit ? 1.0f : 0.0f);
+	else if (payload.bDidHit)
+		payload.Color = payload.Color * (payload.DistanceAlongTheRay / 5.0f);
+
+	return (glm::vec4(payload.Color, 1.0f));
+}
+
+void CpuRayTracer::TraceRay(const glm::vec3& origin, float tMin, const glm::vec3& direction, float tMax, const CpuRayTracerSettings& settings, RayPayload& payload) const
+{
+	const VoxelRay ray{ origin, direction };
+
+	// With INSIDE_HITS, raytrace.rint report max(entry, tMin) for the AABB the ray is in at tMin, nothing can be closer
+	if (settings.bInsideHits && m_Octree.GetVoxel(glm::ivec3(glm::round(origin + direction * tMin))) != EmptyVoxel)
+	{
+		ClosestHit(ray, tMin, payload);
+		return;
+	}
+
+	// raytrace.rint report the entry distance of the AABB, and the closest one in [tMin, tMax] is kept
+	VoxelRayHit hit;
+	if (m_Octree.Raycast(ray, hit, tMin, tMax))
+		ClosestHit(ray, hit.Distance, payload);
+	else
+		Miss(ray, payload);
+}
+
+void CpuRayTracer::ClosestHit(const VoxelRay& ray, float hitDistance, RayPayload& payload) const
+{
+	// Keep in sync with raytrace.rchit
+	payload.DistanceAlongTheRay = hitDistance;
+	payload.Color = glm::vec3(1.0f, 1.0f, 1.0f);
+	payload.bDidHit = true;
+}
+
+void CpuRayTracer::Miss(const VoxelRay& ray, RayPayload& payload) const
+{
+	// Keep in sync with raytrace.rmiss
+	const glm::vec3 rayEndPosition = ray.Origin + 100.0f * ray.Direction;
+	const glm::vec3 rayPositionNormal = glm::normalize(rayEndPosition);
+
+	payload.Color = rayPositionNormal;
+	payload.bDidHit = false;
+}
+
+/* CPU RAY TRACER DEBUG VIEW */
+
+const char* CpuRayTracerDebugView::ToString(Type debugView)
+{
+	switch (debugView)
+	{
+	case CpuRayTracerDebugView::None:
+		return ("None");
+	case CpuRayTracerDebugView::HitDistance:
+		return ("HitDistance");
+	case CpuRayTracerDebugView::HitMask:
+		return ("HitMask");
+	}
+	return ("Unknown");
+}
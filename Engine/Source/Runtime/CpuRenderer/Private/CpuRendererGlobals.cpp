@@ -0,0 +1,3 @@
+#include "CpuRendererGlobals.h"
+
+DEFINE_LOG_CATEGORY(LogCpuRenderer);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CpuRenderer_API.h"
+
+#include <glm/glm.hpp>
+#include <string_view>
+#include <vector>
+
+/**
+ * A RGBA 32 bits float image living in RAM, same format as the storage image written by raytrace.rgen.
+ * The pixel (0, 0) is the top left corner.
+ */
+class CPURENDERER_API CpuImage final
+{
+public:
+	CpuImage(uint32_t width, uint32_t height)
+		: m_Width(width), m_Height(height), m_Pixels(static_cast<size_t>(width) * height, glm::vec4(0.0f))
+	{}
+
+#pragma region API
+public:
+	__forceinline uint32_t GetWidth() const { return (m_Width); }
+	__forceinline uint32_t GetHeight() const { return (m_Height); }
+
+	__forceinline const glm::vec4& GetPixel(uint32_t x, uint32_t y) const { return (m_Pixels[static_cast<size_t>(y) * m_Width + x]); }
+	__forceinline void SetPixel(uint32_t x, uint32_t y, const glm::vec4& color) { m_Pixels[static_cast<size_t>(y) * m_Width + x] = color; }
+	/** Access all the pixels, row by row */
+	__forceinline const std::vector<glm::vec4>& GetPixels() const { return (m_Pixels); }
+
+	/**
+	 * Write the image in a binary PPM file (P6, 8 bits per channel, alpha is dropped).
+	 * The colors are clamped in [0, 1] like when the storage image is blit onto the swapchain.
+	 *
+	 * \return false if the file couldn't be opened
+	 */
+	bool WritePPM(std::string_view fullPath) const;
+#pragma endregion
+
+private:
+	uint32_t m_Width;
+	uint32_t m_Height;
+	std::vector<glm::vec4> m_Pixels;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "CpuRenderer_API.h"
+#include "CpuImage.h"
+#include "SparseVoxelOctree.h"
+#include "VoxelWorld.h"
+
+namespace CpuRayTracerDebugView
+{
+	/** What RayGen write in the image, same values as the DEBUG_VIEW specialization constant of raytrace.rgen (@see RayTracingDebugView) */
+	enum Type : uint8_t
+	{
+		/** The shaded voxels */
+		None = 0,
+		/** The distance to the hit, in grayscale */
+		HitDistance = 1,
+		/** White where a voxel is hit, black elsewhere */
+		HitMask = 2,
+
+		COUNT = 3
+	};
+
+	CPURENDERER_API const char* ToString(Type debugView);
+}
+
+/** Settings of a CpuRayTracer::Render call, the permutations match the ones of the pipeline the GPU image is compared to */
+struct CpuRayTracerSettings
+{
+	/** Size of the image, same as gl_LaunchSizeEXT */
+	uint32_t Width = 1280;
+	uint32_t Height = 720;
+	/** The image is split in square tiles of this size, each tile is rendered by a single thread */
+	uint32_t TileSize = 32;
+	/** How many threads render the tiles (0 = one per hardware thread) */
+	uint32_t ThreadCount = 0;
+
+	/** Same as DEBUG_VIEW in raytrace.rgen */
+	CpuRayTracerDebugView::Type DebugView = CpuRayTracerDebugView::None;
+	/** Same as INSIDE_HITS in raytrace.rint: a ray starting inside a voxel hit it at tMin, instead of going through it */
+	bool bInsideHits = false;
+};
+
+/**
+ * Headless reference ray tracer, reproduce the Vulkan ray tracing pipeline on the CPU.
+ * Each stage of raytrace.rgen/.rint/.rchit/.rmiss has its own function with the same math and the same payload semantic,
+ * so the images can be compared with the GPU ones (regression images) and profiled on machines without GPU.
+ *
+ * The voxels are intersected through a SparseVoxelOctree built from the world,
+ * which gives the same closest hit as testing every AABB of the BLAS.
+ */
+class CPURENDERER_API CpuRayTracer final
+{
+public:
+	CpuRayTracer() = default;
+
+#pragma region API
+public:
+	/** Build the acceleration structure from a world, must be called again when the world change */
+	template<typename TStorage>
+	void SetWorld(const TVoxelWorld<TStorage>& world) { m_Octree.Build(world); }
+
+	/** Render a whole image, the tiles are spread over several threads */
+	CpuImage Render(const CpuRayTracerSettings& settings) const;
+
+	/** Compute the color of a single pixel, same as one invocation of raytrace.rgen with the permutations of the settings */
+	glm::vec4 RayGen(const glm::uvec2& launchId, const glm::uvec2& launchSize, const CpuRayTracerSettings& settings) const;
+
+	/** Access the acceleration structure used to trace the rays */
+	__forceinline const SparseVoxelOctree& GetOctree() const { return (m_Octree); }
+#pragma endregion
+
+private:
+	/** Same as the RayPayload struct of the shaders */
+	struct RayPayload
+	{
+		glm::vec3 Color;
+		float DistanceAlongTheRay;
+		bool bDidHit;
+	};
+
+	/** Same as traceRayEXT: call ClosestHit or Miss depending on what the ray hit between tMin and tMax (@see CpuRayTracerSettings::bInsideHits) */
+	void TraceRay(const glm::vec3& origin, float tMin, const glm::vec3& direction, float tMax, const CpuRayTracerSettings& settings, RayPayload& payload) const;
+	/** raytrace.rchit */
+	void ClosestHit(const VoxelRay& ray, float hitDistance, RayPayload& payload) const;
+	/** raytrace.rmiss */
+	void Miss(const VoxelRay& ray, RayPayload& payload) const;
+
+private:
+	SparseVoxelOctree m_Octree;
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "CpuRenderer_API.h"
+#include "Logging/LoggingMacros.h"
+
+CPURENDERER_API DECLARE_LOG_CATEGORY(LogCpuRenderer);
+
+#define CPURENDERER_LOG(Verbosity, Format, ...) \
+	OV_LOG(LogCpuRenderer, Verbosity, Format, __VA_ARGS__);
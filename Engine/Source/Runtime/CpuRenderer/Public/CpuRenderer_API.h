@@ -0,0 +1,9 @@
+#pragma once
+
+#include "MacrosHelper.h"
+
+#ifdef OV_BUILD_CPURENDERER_DLL
+# define CPURENDERER_API OV_DLL_EXPORT
+#else
+# define CPURENDERER_API OV_DLL_IMPORT
+#endif
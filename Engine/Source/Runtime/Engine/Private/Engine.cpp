@@ -1,18 +1,67 @@
 #include "Engine.h"
+#include "Profiling/ProfilingMacros.h"
+#include "HAL/Time.h"
+#include "Jobs/JobSystem.h"
+#include "Renderer.h"
 
 void Engine::Initialize()
 {
 	m_State = EngineState::Type::Starting;
+
+	JobSystem::Create();
 	OnInitialize();
+	RegisterFrameTasks();
 }
 
 void Engine::Start()
 {
 	m_State = EngineState::Type::Running;
 	EngineLoop();
+
+	// The last main thread jobs run before the engine (and the renderer it shutdown) is destroyed
+	JobSystem::Shutdown();
+	m_State = EngineState::Type::Stopped;
 }
 
 void Engine::Stop()
 {
 	m_State = EngineState::Type::Stopping;
-}
\ No newline at end of file
+}
+
+void Engine::RegisterFrameTasks()
+{
+	// GLFW only run on the main thread
+	m_FrameGraph.AddTask("Engine_Tick",
+		{ { FrameResources::Window, TaskAccess::Write } },
+		[this]() { Tick(Time::GetTimeStep()); },
+		TaskThread::MainThread
+	);
+	// On a worker: it never call GLFW, and the swap chain, the queues and the frame slot it use are only used by the tasks that write the Frame after it.
+	// It acquire an image of the window surface, so it run after the events of the window and before the tasks that write it again (e.g. ImGui)
+	m_FrameGraph.AddTask("Renderer_PrepareNewFrame",
+		{
+			{ FrameResources::Window, TaskAccess::Read },
+			{ FrameResources::VoxelWorld, TaskAccess::Read },
+			{ FrameResources::AccelerationStructure, TaskAccess::Write },
+			{ FrameResources::Frame, TaskAccess::Write }
+		},
+		[]() { Renderer::Get().PrepareNewFrame(); }
+	);
+}
+
+void Engine::ExecuteFrame()
+{
+	CLEAR_ALL_PERFRAME_TIMER_DATA();
+
+	// What the jobs of the previous frame left for the main thread
+	JobSystem::Get().ExecuteMainThreadJobs();
+
+	m_FrameGraph.Execute(JobSystem::Get());
+
+	Time::CalculateNewTiming();
+}
+
+void Engine::Tick(float timeStep)
+{
+	Renderer::Get().Tick();
+}
@@ -22,23 +22,23 @@ void GameEngine::EngineLoop()
 
 	Time::Init();
 	while (EngineShouldStop() == false)
-	{
-		CLEAR_ALL_PERFRAME_TIMER_DATA();
-
-		Renderer::Get().PrepareNewFrame();
-
-		float timeStep = Time::GetTimeStep();
-		Tick(timeStep);
-
-		Renderer::Get().RenderNewFrame();
-
-		Time::CalculateNewTiming();
-	}
+		ExecuteFrame();
 }
 
-void GameEngine::Tick(float timeStep)
+void GameEngine::RegisterFrameTasks()
 {
-	Renderer::Get().Tick();
+	Engine::RegisterFrameTasks();
+
+	// Present on the thread of the window
+	m_FrameGraph.AddTask("Renderer_RenderNewFrame",
+		{
+			{ FrameResources::AccelerationStructure, TaskAccess::Read },
+			{ FrameResources::Frame, TaskAccess::Write },
+			{ FrameResources::Window, TaskAccess::Write }
+		},
+		[]() { Renderer::Get().RenderNewFrame(); },
+		TaskThread::MainThread
+	);
 }
 
 bool GameEngine::EngineShouldStop()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Engine_API.h"
+#include "Jobs/TaskGraph.h"
 
 #include <iostream>
 #include <memory>
@@ -19,9 +20,36 @@ namespace EngineState
 /**
  * Abstract class.
  * The Engine own the lifetime of the process.
+ *
+ * It also own the job system and the frame graph: each frame of the engine loop is one Execute of the graph (@see ExecuteFrame),
+ * the engines and the systems add their tasks to it.
  */
 class ENGINE_API Engine
 {
+public:
+	/**
+	 * Name of the resources the tasks of the frame graph read and write.
+	 * The Vulkan objects that must be externally synchronized belong to one of them, so the tasks that use the same one never run at the same time.
+	 */
+	struct FrameResources
+	{
+		/**
+		 * The GLFW window: its events, its title, its surface and the images presented on it (the GLFW calls are on the main thread).
+		 * Acquiring a swap chain image read it, the events can resize the surface.
+		 */
+		static constexpr const char* Window = "Window";
+		/** The ImGui context of the editor: its frame, its inputs and its platform windows */
+		static constexpr const char* UI = "UI";
+		/** The voxels of the renderer */
+		static constexpr const char* VoxelWorld = "VoxelWorld";
+		/** The acceleration structures and their builds, submitted on the compute and the transfer queues */
+		static constexpr const char* AccelerationStructure = "AccelerationStructure";
+		/**
+		 * The swap chain frame being recorded: its command buffer and descriptor set, the swap chain (acquire and present),
+		 * and the graphic queue. The compute and transfer queues may be the graphic one, the tasks that build the acceleration structures write it too.
+		 */
+		static constexpr const char* Frame = "Frame";
+	};
 
 protected:
 	Engine() = default;
@@ -36,7 +64,7 @@ public:
 
 #pragma region Methods
 public:
-	/** Called before starting the engine */
+	/** Called before starting the engine, create the job system then fill the frame graph */
 	void Initialize();
 	/** Create and start the engine, called constructor */
 	void Start();
@@ -49,6 +77,25 @@ public:
 	virtual void OnInitialize() = 0;
 	/** Called after start, the engine will cleanup automatically when this function die */
 	virtual void EngineLoop() = 0;
+
+	/** Get the tasks run every frame, the systems add theirs to it */
+	__forceinline TaskGraph& GetFrameGraph() { return (m_FrameGraph); }
+
+protected:
+	/**
+	 * Add the tasks of the engine to the frame graph, called after OnInitialize.
+	 * Add the tick of the window and the preparation of the renderer frame, the engines add the tasks that record and present it after.
+	 */
+	virtual void RegisterFrameTasks();
+	/** Run a frame: the jobs left for the main thread by the previous one, then the frame graph */
+	void ExecuteFrame();
+
+	/**
+	 * Tick function call at every frame. (update function if you like)
+	 *
+	 * \param timestep The time step between the last frame and the current frame. (in second)
+	 */
+	virtual void Tick(float timeStep);
 #pragma endregion
 
 #pragma region Accessor - Get
@@ -59,6 +106,9 @@ public:
 #pragma region Properties
 protected:
 	EngineState::Type m_State = EngineState::Type::Stopped;
+
+	/** The tasks of a frame, run in parallel by the job system when they don't access the same resources */
+	TaskGraph m_FrameGraph;
 #pragma endregion
 };
 
@@ -22,11 +22,7 @@ public:
 	bool EngineShouldStop() override;
 	//~ End Engine Interface
 
-private:
-	/**
-	 * Tick function call at every frame. (update function if you like)
-	 *
-	 * \param timestep The time step between the last frame and the current frame. (in second)
-	 */
-	void Tick(float timestep);
+protected:
+	/** Add the task that record and present the renderer frame after the ones of the engine */
+	virtual void RegisterFrameTasks() override;
 };
@@ -13,6 +13,8 @@ function OpenVoxelApplication(config)
 		"Core",
 		"Engine",
 		"Renderer",
+		"Voxel",
+		"CpuRenderer",
 	}
 
 	-- check whether or not the configuration START with "Editor"
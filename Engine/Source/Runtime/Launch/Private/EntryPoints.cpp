@@ -1,5 +1,33 @@
 #include "GameEngine.h"
 #include "OVModuleManager.h"
+#include "CpuRayTracer.h"
+#include "VoxelRayPacket.h"
+#include "VoxelBvh.h"
+#include "VoxelLbvh.h"
+#include "VoxelAabbMerger.h"
+#include "VoxelStorage.h"
+#include "VoxelWorld.h"
+#include "SparseVoxelOctree.h"
+#include "SparseVoxelDag.h"
+#include "VoxelTerrain.h"
+#include "Renderer.h"
+#include "Vulkan/VulkanMemoryAllocator.h"
+#include "Vulkan/VulkanFrameRing.h"
+#include "Vulkan/VulkanStagingRing.h"
+#include "Vulkan/VulkanTimeline.h"
+#include "Vulkan/VulkanQueueFamilies.h"
+#include "Vulkan/VulkanPipelineCacheFile.h"
+#include "Vulkan/VulkanBlasRefitHeuristic.h"
+#include "Vulkan/VulkanAccelerationStructureBuildPlanner.h"
+#include "Vulkan/VulkanChunkInstanceTracker.h"
+#include "Vulkan/VulkanGpuProfiler.h"
+#include "Vulkan/VulkanShaderReflection.h"
+#include "Vulkan/VulkanShaderCompiler.h"
+#include "Path.h"
+#include "Jobs/JobSystem.h"
+
+#include <charconv>
+#include <string_view>
 
 #ifdef WITH_EDITOR
 # include "EditorEngine.h"
@@ -9,6 +37,165 @@
 
 int main(int argc, char** argv)
 {
+	// Voxels of the terrain toggled every frame, to run the refits of the BLAS (@see VulkanBlasRefitHeuristic)
+	uint32_t editsPerFrame = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view argument = argv[i];
+
+		// Memory and access speed of the palette chunk storage against the dense one
+		if (argument == "-BenchmarkVoxelStorage")
+		{
+			PaletteVoxelStorage::LogBenchmark();
+			return (0);
+		}
+		// Micro benchmark of the SIMD ray-box kernels, for each instruction set supported by this CPU
+		if (argument == "-BenchmarkRayPacket")
+		{
+			VoxelRayPacketKernels::LogBenchmark();
+			return (0);
+		}
+		// Build and traversal benchmark of the SAH BVH, from 10k to 10M boxes
+		if (argument == "-BenchmarkBvh")
+		{
+			VoxelBvh::LogBenchmark();
+			return (0);
+		}
+		// Build and traversal speed of the sparse voxel octree, on generated terrains
+		if (argument == "-BenchmarkSvo")
+		{
+			SparseVoxelOctree::LogBenchmark();
+			return (0);
+		}
+		// Memory saved by the sparse voxel DAG against its traversal speed, the same rays go through the octree and the DAG
+		if (argument == "-BenchmarkDag")
+		{
+			SparseVoxelDag::LogBenchmark();
+			return (0);
+		}
+		// Phase timings of the LBVH builder, on the same scenes than -BenchmarkBvh
+		if (argument == "-BenchmarkLbvh")
+		{
+			VoxelLbvhBuilder::LogBenchmark();
+			return (0);
+		}
+		// Primitive reduction and time of the greedy AABB merge, on a generated terrain
+		if (argument == "-BenchmarkAabbMerge")
+		{
+			VoxelAabbMerger::LogBenchmark();
+			return (0);
+		}
+		// Throughput and fragmentation of the device memory sub-allocator, on a fake memory type table (no GPU needed)
+		if (argument == "-BenchmarkMemoryAllocator")
+		{
+			return (VulkanMemoryAllocator::LogBenchmark() ? 0 : 1);
+		}
+
+		// Voxels set across the chunk borders, palette growth and removal of the emptied chunks, with both chunk storages (no GPU needed)
+		if (argument == "-TestVoxelWorld")
+		{
+			const bool bDensePassed = VoxelWorld::LogSelfTest();
+			const bool bPalettePassed = PaletteVoxelWorld::LogSelfTest();
+			return (bDensePassed && bPalettePassed ? 0 : 1);
+		}
+
+		// Slot reuse and frame/image indices of the frames in flight, against a fake GPU (no GPU needed)
+		if (argument == "-TestFrameRing")
+		{
+			return (VulkanFrameRing::LogSelfTest() ? 0 : 1);
+		}
+
+		// Wraparound, retirement and growth of the staging ring, against scripted then random submissions (no GPU needed)
+		if (argument == "-TestStagingRing")
+		{
+			return (VulkanStagingRing::LogSelfTest() ? 0 : 1);
+		}
+
+		// Waits and retirements of the staging ring and of the frame slots, on a timeline signaled late by a fake GPU thread (no GPU needed)
+		if (argument == "-TestTimeline")
+		{
+			return (VulkanCpuTimeline::LogSelfTest() ? 0 : 1);
+		}
+
+		// Queue family picked for each queue type, on synthetic family lists (no GPU needed)
+		if (argument == "-TestQueueFamilies")
+		{
+			return (VulkanQueueFamilyIndices::LogSelfTest() ? 0 : 1);
+		}
+
+		// Rejection of the damaged or foreign pipeline cache files, on synthetic blobs and a temporary directory (no GPU needed)
+		if (argument == "-TestPipelineCacheFile")
+		{
+			return (VulkanPipelineCacheFile::LogSelfTest() ? 0 : 1);
+		}
+
+		// Refit or rebuild decisions and primitive capacity of the BLAS of the edited chunks (no GPU needed)
+		if (argument == "-TestBlasRefitHeuristic")
+		{
+			return (VulkanBlasRefitHeuristic::LogSelfTest() ? 0 : 1);
+		}
+
+		// Batches of BLAS builds planned in the scratch budget, against scripted then random queues (no GPU needed)
+		if (argument == "-TestBuildPlanner")
+		{
+			return (VulkanAccelerationStructureBuildPlanner::LogSelfTest() ? 0 : 1);
+		}
+
+		// TLAS instances of the chunks, with fake BLAS addresses, while chunks are added, edited and removed (no GPU needed)
+		if (argument == "-TestChunkInstanceTracker")
+		{
+			return (VulkanChunkInstanceTracker::LogSelfTest() ? 0 : 1);
+		}
+
+		// Nesting and durations of the GPU scopes, from the ticks of fake timestamp queries (no GPU needed)
+		if (argument == "-TestGpuProfiler")
+		{
+			return (VulkanGpuScopes::LogSelfTest() ? 0 : 1);
+		}
+
+		// Bindings reflected from the ray tracing shaders, compiled like the renderer does (no GPU needed)
+		if (argument == "-TestShaderReflection")
+		{
+			VulkanShaderCompiler shaderCompiler(VulkanShaderCompiler::CreateShadercBackend(), Renderer::GetShaderCompilerSettings());
+			return (VulkanShaderReflection::LogSelfTest(shaderCompiler) ? 0 : 1);
+		}
+
+		// Empty job throughput, fork-join and ParallelFor scaling of the job system, from 1 thread to a thread per core
+		if (argument == "-BenchmarkJobSystem")
+		{
+			JobSystem::LogBenchmark();
+			return (0);
+		}
+
+		// Run the engine while editing the terrain, so the BLAS of the edited chunks are refit: "-EditChunks" or "-EditChunks=<EditsPerFrame>"
+		if (argument == "-EditChunks" || argument.starts_with("-EditChunks="))
+		{
+			editsPerFrame = 4;
+			if (argument.starts_with("-EditChunks="))
+				std::from_chars(argument.data() + std::string_view("-EditChunks=").size(), argument.data() + argument.size(), editsPerFrame);
+			continue;
+		}
+
+		// Headless reference render, for the machines without GPU: "-CpuRender" or "-CpuRender=<OutputFile.ppm>"
+		if (argument != "-CpuRender" && argument.starts_with("-CpuRender=") == false)
+			continue;
+
+		// Same world as the one created by the Renderer
+		VoxelWorld world;
+		VoxelTerrain::Generate(world, Renderer::WorldRadius);
+
+		CpuRayTracer rayTracer;
+		rayTracer.SetWorld(world);
+		const CpuImage image = rayTracer.Render(CpuRayTracerSettings{});
+
+		const std::string outputPath = (argument.starts_with("-CpuRender=")
+			? std::string(argument.substr(std::string_view("-CpuRender=").size()))
+			: std::string(Path::GetSavedDirectoryPath().AppendSegment("CpuRender.ppm"))
+		);
+		return (image.WritePPM(outputPath) ? 0 : 1);
+	}
+
 	OVModuleManager::LoadModule("Renderer");
 
 #ifdef WITH_EDITOR
@@ -19,6 +206,19 @@ int main(int argc, char** argv)
 
 	g_Engine->Initialize();
 
+	// After the tasks of the engine: the edits of a frame are built by the next PrepareNewFrame, the refits show in the verbose logs of LogVulkan
+	if (editsPerFrame > 0)
+	{
+		g_Engine->GetFrameGraph().AddTask("EntryPoints_EditChunks",
+			{ { Engine::FrameResources::VoxelWorld, TaskAccess::Write } },
+			[editsPerFrame, editIndex = uint32_t(0)]() mutable
+			{
+				for (uint32_t i = 0; i < editsPerFrame; i++)
+					VoxelTerrain::ToggleSurfaceVoxel(Renderer::Get().GetVoxelWorld(), Renderer::WorldRadius, editIndex++);
+			}
+		);
+	}
+
 	g_Engine->Start();
 
 	delete g_Engine;
@@ -1,5 +1,9 @@
 #include "Renderer.h"
 #include "Vulkan/VulkanDebugMessenger.h"
+#include "Vulkan/VulkanPipelineCacheFile.h"
+#include "Vulkan/VulkanDescriptorWriter.h"
+#include "VoxelTerrain.h"
+#include "Path.h"
 #include "HAL/Time.h"
 
 #include <format>
@@ -7,6 +11,14 @@
 GLFWwindow* Renderer::s_Window = nullptr;
 Renderer* Renderer::s_Instance = nullptr;
 
+namespace
+{
+	std::filesystem::path GetPipelineCacheFilePath()
+	{
+		return (std::string(Path::GetSavedDirectoryPath().AppendSegment("PipelineCache.bin")));
+	}
+}
+
 Renderer::Renderer(GLFWwindow* window)
 {
 	s_Window = window;
@@ -27,95 +39,40 @@ Renderer::Renderer(GLFWwindow* window)
 	);
 	m_CommandPool = m_VkDevice.Raw().createCommandPool(commandPoolCreateInfo);
 
+	m_GraphicTimeline.CreateTimeline(&m_VkDevice);
+	m_ComputeTimeline.CreateTimeline(&m_VkDevice);
+	m_TransferTimeline.CreateTimeline(&m_VkDevice);
+
+	// The descriptor set of the frames is made from the descriptors of the shaders
+	m_ShaderCompiler = std::make_unique<VulkanShaderCompiler>(VulkanShaderCompiler::CreateShadercBackend(), GetShaderCompilerSettings());
+
+	m_Pipeline.SetVulkanDevice(&m_VkDevice);
+	m_Pipeline.SetDispatchLoaderDynamic(&m_Dldi);
+	m_Pipeline.SetShaderCompiler(m_ShaderCompiler.get());
+	if (!m_Pipeline.LoadShaders())
+		OV_LOG(LogVulkan, Fatal, "Unable to load the ray tracing shaders");
+
 	InitSwapChain();
+	InitGpuProfiler();
+
+	// Hills spread over several chunks in front of the camera of raytrace.rgen, so each chunk get its own BLAS
+	VoxelTerrain::Generate(m_VoxelWorld, WorldRadius);
 
-	auto randomFrame = m_VkSwapChain.GetFrames().back();
 	m_AccelerationStructure.SetVulkanDevice(&m_VkDevice);
 	m_AccelerationStructure.SetDispatchLoaderDynamic(&m_Dldi);
-	m_AccelerationStructure.CreateAccelerationStructure(randomFrame.CommandBuffer);
+	m_AccelerationStructure.SetTimelines(&m_ComputeTimeline, &m_TransferTimeline, &m_GraphicTimeline);
+	m_AccelerationStructure.CreateAccelerationStructure(m_VoxelWorld);
 
-	m_PipelineCache = m_VkDevice.Raw().createPipelineCache(vk::PipelineCacheCreateInfo());
+	InitPipelineCache();
 
-	m_Pipeline.SetVulkanDevice(&m_VkDevice);
-	m_Pipeline.SetDispatchLoaderDynamic(&m_Dldi);
-	m_Pipeline.CreateRayTracingPipeline(randomFrame.DescriptorSetLayout, m_PipelineCache);
+	m_Pipeline.CreateRayTracingPipeline(m_VkSwapChain.GetDescriptorSetLayout(), m_PipelineCache);
 
 	m_ShaderBindingTable.SetVulkanDevice(&m_VkDevice);
 	m_ShaderBindingTable.SetVulkanRayTracingPipeline(&m_Pipeline);
 	m_ShaderBindingTable.SetDispatchLoaderDynamic(&m_Dldi);
 	m_ShaderBindingTable.CreateShaderBindingTable();
 
-	// Record each command buffer and set their descriptor set
-	for (auto& frame : m_VkSwapChain.GetFrames())
-	{
-		std::vector<vk::WriteDescriptorSet> descriptorWrites;
-
-		// Get TLAS and write it on the descriptor set (layout location 0)
-		vk::AccelerationStructureKHR accelerationStructure = m_AccelerationStructure.GetTlas();
-		vk::WriteDescriptorSetAccelerationStructureKHR accelerationStructureInfo(
-			1, &accelerationStructure
-		);
-		descriptorWrites.push_back(
-			vk::WriteDescriptorSet(
-				frame.DescriptorSet,
-				0,
-				0,
-				1, vk::DescriptorType::eAccelerationStructureKHR,
-				nullptr,
-				nullptr,
-				nullptr,
-				&accelerationStructureInfo
-			)
-		);
-
-		// Write the current image view on the descriptor set (layout location 1)
-		vk::DescriptorImageInfo imageInfo(
-			vk::Sampler(),
-			frame.ImageView,
-			vk::ImageLayout::eGeneral
-		);
-		descriptorWrites.push_back(
-			vk::WriteDescriptorSet(
-				frame.DescriptorSet,
-				1,
-				0,
-				1, vk::DescriptorType::eStorageImage,
-				&imageInfo,
-				nullptr,
-				nullptr
-			)
-		);
-
-		// Push all the update to the descriptor set (so it's actually updated)
-		m_VkDevice.Raw().updateDescriptorSets(
-			descriptorWrites.size(), descriptorWrites.data(),
-			0,
-			nullptr
-		);
-
-		// Buffer
-		frame.CommandBuffer.reset();
-		frame.CommandBuffer.begin({ vk::CommandBufferUsageFlagBits::eSimultaneousUse });
-
-		// Bind raytracing pipeline
-		frame.CommandBuffer.bindPipeline(vk::PipelineBindPoint::eRayTracingKHR, m_Pipeline);
-
-		// Bind the descriptor set (allow shader to access the data stored in the descriptor set)
-		frame.CommandBuffer.bindDescriptorSets(
-			vk::PipelineBindPoint::eRayTracingKHR,
-			m_Pipeline.GetPipelineLayout(),
-			0,
-			1, &frame.DescriptorSet,
-			0,
-			nullptr
-		);
-
-		ShaderWriteBarrier(frame.CommandBuffer, frame.Image, vk::AccessFlagBits::eMemoryRead, vk::ImageLayout::eUndefined);
-		TraceRays(frame.CommandBuffer);
-		PresentBarrier(frame.CommandBuffer, frame.Image, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eGeneral);
-
-		frame.CommandBuffer.end();
-	}
+	// The command buffers are recorded each frame, with the descriptor set of their frame slot
 }
 
 Renderer::~Renderer()
@@ -125,10 +82,15 @@ Renderer::~Renderer()
 	m_ShaderBindingTable.DestroyShaderBindingTable();
 	m_AccelerationStructure.DestroyAccelerationStructure();
 
+	SavePipelineCache();
 	m_VkDevice.Raw().destroyPipelineCache(m_PipelineCache);
 	m_Pipeline.DestroyRayTracingPipeline();
 
+	m_GpuProfiler.Destroy();
 	m_VkSwapChain.DestroySwapChain();
+	m_GraphicTimeline.DestroyTimeline();
+	m_ComputeTimeline.DestroyTimeline();
+	m_TransferTimeline.DestroyTimeline();
 
 	m_VkDevice.Raw().destroyCommandPool(m_CommandPool);
 	m_VkDevice.Raw().destroyImageView(m_RayTracingImageView);
@@ -170,15 +132,37 @@ void Renderer::Shutdown()
 	s_Instance = nullptr;
 }
 
+VulkanShaderCompiler::Settings Renderer::GetShaderCompilerSettings()
+{
+	VulkanShaderCompiler::Settings settings;
+	settings.SourceDirectory = std::string(Path::GetEngineRootDirectoryPath().Append("Source/Runtime/Renderer/Private/Shaders"));
+	settings.CacheDirectory = std::string(Path::GetSavedDirectoryPath().AppendSegment("ShaderCache"));
+	return (settings);
+}
+
 void Renderer::PrepareNewFrame()
 {
-	m_CurrentFrameIndex = m_VkSwapChain.AcquireNextFrameIndex();
+	// Only wait for the frame that used the same slot, the previous ones can still be rendering
+	m_VkSwapChain.AcquireNextFrame();
+	// The previous frame of the slot is complete, its GPU scopes can be read back
+	m_GpuProfiler.BeginFrame(GetCurrentFrame().FrameIndex);
+
+	// Queue the chunks edited since the last frame and submit the next batch, the descriptors are written below anyway
+	m_AccelerationStructure.UpdateAccelerationStructure(m_VoxelWorld);
+	// Destroy what the acceleration structure builds replaced, once they are complete
+	m_AccelerationStructure.RetireCompletedBuilds();
+	// The builds are on the compute queue, the frame trace rays once the last one is complete
+	m_VkSwapChain.AddFrameWait(m_AccelerationStructure.GetBuildWait());
+
+	UpdateFrameDescriptorSet(GetCurrentFrame());
 }
 
 void Renderer::RenderNewFrame()
 {
-	m_VkSwapChain.SubmitWork(GetCurrentFrameIndex());
-	m_VkSwapChain.PresentFrame(GetCurrentFrameIndex());
+	RecordFrameCmdBuffer(GetCurrentFrame());
+
+	m_VkSwapChain.SubmitWork();
+	m_VkSwapChain.PresentFrame();
 }
 
 void Renderer::Tick()
@@ -246,6 +230,11 @@ void Renderer::InitVulkanDevice()
 	// Required by VK_KHR_spirv_1_4
 	m_VkDevice.AddExtension(VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME);
 
+	// Synchronize the submissions with a single semaphore instead of a fence each
+	vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+	timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+	m_VkDevice.AddExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, &timelineSemaphoreFeatures);
+
 	/* Layers */
 
 #if OV_DEBUG
@@ -259,9 +248,97 @@ void Renderer::InitSwapChain()
 {
 	m_VkSwapChain.SetVulkanDevice(&m_VkDevice);
 	m_VkSwapChain.SetSurface(&m_Surface);
-	m_VkSwapChain.SetCommandPool(&m_CommandPool);
+	m_VkSwapChain.SetTimeline(&m_GraphicTimeline);
+	m_VkSwapChain.SetFrameDescriptorLayout(&m_Pipeline.GetDescriptorLayout());
 
-	m_VkSwapChain.CreateSwapChain(vk::PresentModeKHR::eFifo);
+	m_VkSwapChain.CreateSwapChain(vk::PresentModeKHR::eFifo, VulkanSwapChainHandler::DefaultFramesInFlight);
+}
+
+void Renderer::InitGpuProfiler()
+{
+	const VulkanTimestampConversion conversion = VulkanDeviceTimestampQueries::GetConversion(m_VkDevice, VulkanQueueType::Graphic);
+	if (!conversion.IsSupported())
+	{
+		OV_LOG(LogVulkan, Warning, "The graphic queue doesn't support timestamps, the GPU scopes are disabled");
+		return;
+	}
+
+	std::vector<std::unique_ptr<VulkanTimestampQueries>> frameQueries;
+	for (uint32_t i = 0; i < m_VkSwapChain.GetFramesInFlight(); i++)
+		frameQueries.push_back(std::make_unique<VulkanDeviceTimestampQueries>(m_VkDevice.Raw(), VulkanGpuProfiler::DefaultScopesPerFrame * 2));
+	m_GpuProfiler.Create(std::move(frameQueries), conversion);
+}
+
+void Renderer::InitPipelineCache()
+{
+	const VulkanPipelineCacheDeviceInfo deviceInfo = VulkanPipelineCacheDeviceInfo::FromProperties(m_VkDevice.GetPhysicalDeviceProperties());
+	const std::vector<uint8_t> cacheData = VulkanPipelineCacheFile::Load(GetPipelineCacheFilePath(), deviceInfo);
+
+	vk::PipelineCacheCreateInfo pipelineCacheCreateInfo(
+		vk::PipelineCacheCreateFlags(),
+		cacheData.size(), cacheData.data()
+	);
+	vk::Result result = m_VkDevice.Raw().createPipelineCache(&pipelineCacheCreateInfo, nullptr, &m_PipelineCache);
+	if (result != vk::Result::eSuccess && cacheData.empty() == false)
+	{
+		// The driver refused the data despite its header, start from an empty cache
+		OV_LOG(LogVulkan, Warning, "Unable to create the pipeline cache from the saved one: {:s}", vk::to_string(result));
+		m_PipelineCache = m_VkDevice.Raw().createPipelineCache(vk::PipelineCacheCreateInfo());
+	}
+	else
+	{
+		CHECK_VULKAN_RESULT(result, "Unable to create the pipeline cache");
+	}
+
+	OV_LOG_IF(cacheData.empty() == false, LogVulkan, Verbose, "Pipeline cache loaded ({:d}KB)", cacheData.size() / 1024);
+}
+
+void Renderer::SavePipelineCache() const
+{
+	const std::vector<uint8_t> cacheData = m_VkDevice.Raw().getPipelineCacheData(m_PipelineCache);
+	if (VulkanPipelineCacheFile::Save(GetPipelineCacheFilePath(), cacheData))
+		OV_LOG(LogVulkan, Verbose, "Pipeline cache saved ({:d}KB)", cacheData.size() / 1024);
+}
+
+void Renderer::UpdateFrameDescriptorSet(const VulkanSwapChainFrame& frame)
+{
+	// The descriptors are written by the name the shaders give them, their binding comes from the reflection of the shaders
+	VulkanDescriptorWriter descriptorWriter(m_Pipeline.GetDescriptorLayout(), frame.DescriptorSet);
+
+	// The TLAS is recreated when it grows
+	descriptorWriter.WriteAccelerationStructure("topLevelAS", m_AccelerationStructure.GetTlas());
+	// The image view the frame render into
+	descriptorWriter.WriteImage("image", frame.ImageView, vk::ImageLayout::eGeneral);
+	// The address of the AABBs of each chunk
+	descriptorWriter.WriteBuffer("ChunkAabbAddresses", m_AccelerationStructure.GetAabbAddressBuffer());
+
+	// Push all the update to the descriptor set (so it's actually updated), the previous submission of the slot is complete
+	descriptorWriter.Update(m_VkDevice.Raw());
+}
+
+void Renderer::RecordFrameCmdBuffer(const VulkanSwapChainFrame& frame)
+{
+	// The command pool of the frame has been reset when it was acquired
+	frame.CommandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+	// Bind raytracing pipeline
+	frame.CommandBuffer.bindPipeline(vk::PipelineBindPoint::eRayTracingKHR, m_Pipeline);
+
+	// Bind the descriptor set (allow shader to access the data stored in the descriptor set)
+	frame.CommandBuffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eRayTracingKHR,
+		m_Pipeline.GetPipelineLayout(),
+		0,
+		1, &frame.DescriptorSet,
+		0,
+		nullptr
+	);
+
+	ShaderWriteBarrier(frame.CommandBuffer, frame.Image, vk::AccessFlagBits::eMemoryRead, vk::ImageLayout::eUndefined);
+	TraceRays(frame.CommandBuffer);
+	PresentBarrier(frame.CommandBuffer, frame.Image, vk::AccessFlagBits::eShaderWrite, vk::ImageLayout::eGeneral);
+
+	frame.CommandBuffer.end();
 }
 
 void Renderer::ShaderWriteBarrier(const vk::CommandBuffer& cmdBuffer, const vk::Image& image, vk::AccessFlagBits previousAccessFlag, vk::ImageLayout previousImageLayout)
@@ -292,6 +369,8 @@ void Renderer::ShaderWriteBarrier(const vk::CommandBuffer& cmdBuffer, const vk::
 
 void Renderer::TraceRays(const vk::CommandBuffer& cmdBuffer)
 {
+	CREATE_GPU_SCOPE_TIMER(GetFrameGpuScopes(), cmdBuffer, ProfilingCategories::GpuTraceRays);
+
 	auto rgen = m_ShaderBindingTable.GetRaygenShaderBindingTable();
 	auto rmiss = m_ShaderBindingTable.GetMissShaderBindingTable();
 	auto rchit = m_ShaderBindingTable.GetHitShaderBindingTable();
@@ -1,241 +1,425 @@
 #include "Vulkan/VulkanAccelerationStructure.h"
+#include "VoxelWorld.h"
 
-void VulkanAccelerationStructure::CreateAccelerationStructure(const vk::CommandBuffer& commandBuffer)
-{
-	CHECK(m_VkDevice);
-
-	vk::MemoryAllocateFlagsInfo memoryAllocateFlagsInfo(
-		vk::MemoryAllocateFlagBits::eDeviceAddress
-	);
+#include <algorithm>
 
-	// Used to wait for the BLAS/TLAS build to complete
-	vk::Fence buildingFence = m_VkDevice->Raw().createFence(vk::FenceCreateInfo());
+void VulkanAccelerationStructure::CreateAccelerationStructure(const VoxelWorld& world)
+{
+	CHECK(m_VkDevice && m_BuildTimeline && m_UploadTimeline && m_FrameTimeline && m_ChunkBlases.empty() && !m_Tlas);
 
-	/* CUBES */
+	VulkanAccelerationStructureBuildPlannerSettings plannerSettings = m_BuildPlanner.GetSettings();
+	plannerSettings.ScratchAlignment = m_VkDevice->GetAccelerationStructureProperties().minAccelerationStructureScratchOffsetAlignment;
+	m_BuildPlanner.SetSettings(plannerSettings);
 
-	struct Aabb
-	{
-		glm::vec3 Min;
-		glm::vec3 Max;
-
-		Aabb(glm::vec3&& min, glm::vec3&& max)
-			: Min(std::move(min)), Max(std::move(max))
-		{}
-	};
-
-	std::vector<Aabb> aabbs;
-	aabbs.push_back(
-		Aabb(
-			glm::vec3(-0.5, -0.5, -0.5),
-			glm::vec3(0.5, 0.5, 0.5)
-		)
+	vk::CommandPoolCreateInfo commandPoolCreateInfo(
+		vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient,
+		m_VkDevice->GetQueue(VulkanQueueType::Compute).FamilyIndex
 	);
+	m_CommandPool = m_VkDevice->Raw().createCommandPool(commandPoolCreateInfo);
+	commandPoolCreateInfo.queueFamilyIndex = m_VkDevice->GetQueue(VulkanQueueType::Transfer).FamilyIndex;
+	m_UploadCommandPool = m_VkDevice->Raw().createCommandPool(commandPoolCreateInfo);
+	m_StagingBuffer.CreateStagingBuffer(m_VkDevice, VulkanQueueType::Transfer, m_UploadTimeline);
+	m_GpuTimestampConversion = VulkanDeviceTimestampQueries::GetConversion(*m_VkDevice, VulkanQueueType::Compute);
+	m_bTlasDirty = true;
+
+	// Nothing is tracked yet: every chunk is new, they are all submitted before the first frame
+	UpdateAccelerationStructure(world);
+	while (m_BuildPlanner.HasQueuedBuilds())
+	{
+		if (m_PendingSubmissions.size() >= MaxSubmissionsInFlight)
+			WaitForOldestSubmission();
+		SubmitBuildBatch();
+	}
 
-	vk::BufferCreateInfo aabbBufferInfo(
-		vk::BufferCreateFlags(),
-		sizeof(Aabb),
-		vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-		vk::SharingMode::eExclusive,
-		1, &m_VkDevice->GetQueue(VulkanQueueType::Graphic).FamilyIndex
-	);
-
-	m_AabbBuffer = m_VkDevice->Raw().createBuffer(aabbBufferInfo);
-
-	VulkanMemoryRequirementsExtended aabbBufferMemoryRequirement = m_VkDevice->FindMemoryRequirement(m_AabbBuffer, vk::MemoryPropertyFlagBits::eHostVisible);
+	// The compacted sizes are known once the builds are complete, the copies are submitted before the first frame too
+	if (m_bCompactBlas)
+	{
+		WaitForBuilds();
+		if (m_QueuedCompactions.empty() == false)
+			SubmitBuildBatch();
+	}
+}
 
-	vk::MemoryAllocateInfo aabbBufferMemoryAllocateInfo(
-		aabbBufferMemoryRequirement.size,
-		aabbBufferMemoryRequirement.MemoryTypeIndex,
-		&memoryAllocateFlagsInfo
-	);
+bool VulkanAccelerationStructure::UpdateAccelerationStructure(const VoxelWorld& world)
+{
+	CHECK(m_VkDevice && m_CommandPool);
 
-	m_AabbBufferMemory = m_VkDevice->Raw().allocateMemory(aabbBufferMemoryAllocateInfo);
+	RetireCompletedBuilds();
+	QueueWorldChanges(world);
 
-	m_VkDevice->Raw().bindBufferMemory(m_AabbBuffer, m_AabbBufferMemory, 0);
+	if (m_BuildPlanner.HasQueuedBuilds() == false && m_QueuedCompactions.empty() && m_bTlasDirty == false)
+		return (false);
 
-	void* aabbBufferMemoryData = m_VkDevice->Raw().mapMemory(m_AabbBufferMemory, 0, sizeof(Aabb), vk::MemoryMapFlags());
-	memcpy(aabbBufferMemoryData, aabbs.data(), sizeof(Aabb));
+	// The builds stay queued, the next updates will submit them once a batch is complete
+	if (m_PendingSubmissions.size() >= MaxSubmissionsInFlight)
+		return (false);
 
-	/* BOTTOM LEVEL ACCELERATION STRUCTURE */
-	uint32_t blasSize = 0;
-	uint32_t blasScratchBufferMaxSize = 0;
+	return (SubmitBuildBatch());
+}
 
-	vk::DeviceAddress aabbBufferAddress = m_VkDevice->Raw().getBufferAddress({ m_AabbBuffer }, *m_Dldi);
+void VulkanAccelerationStructure::RetireCompletedBuilds()
+{
+	// The uploads of a batch are complete before it
+	while (m_PendingSubmissions.empty() == false && m_BuildTimeline->IsComplete(m_PendingSubmissions.front().SignalValue))
+	{
+		BuildSubmission submission = std::move(m_PendingSubmissions.front());
+		m_PendingSubmissions.pop_front();
 
-	vk::AccelerationStructureGeometryAabbsDataKHR aabbGeometryData(
-		aabbBufferAddress,
-		vk::DeviceSize(sizeof(Aabb))
-	);
+		QueueCompactions(submission);
+		if (submission.GpuScopes)
+			submission.GpuScopes->Collect();
+		DestroyRetiredResources(submission.Retired);
+		m_FreeSubmissions.push_back(std::move(submission));
+	}
 
-	vk::AccelerationStructureGeometryKHR aabbGeometry(
-		vk::GeometryTypeKHR::eAabbs,
-		aabbGeometryData,
-		vk::GeometryFlagBitsKHR::eOpaque
-	);
+	m_StagingBuffer.RetireCompletedSubmissions();
+}
 
-	vk::AccelerationStructureBuildRangeInfoKHR aabbBuildOffsetInfo(
-		aabbs.size(), // primitiveCount
-		0, // primitiveOffset
-		0, // firstVertex
-		0  // transformOffset
-	);
+void VulkanAccelerationStructure::WaitForBuilds()
+{
+	while (m_PendingSubmissions.empty() == false)
+		WaitForOldestSubmission();
+}
 
-	/* BLAS BUILD INFO */
+void VulkanAccelerationStructure::DestroyAccelerationStructure()
+{
+	WaitForBuilds();
+
+	for (auto& [coordinate, chunkBlas] : m_ChunkBlases)
+		m_RetiringResources.Blases.push_back(chunkBlas);
+	m_ChunkBlases.clear();
+	m_InstanceTracker.Clear();
+	m_BuildPlanner.Clear();
+	m_QueuedChunkBuilds.clear();
+	m_QueuedCompactions.clear();
+	m_CompactionStatistics = VulkanBlasCompactionStatistics();
+	m_AabbCount = 0;
+	m_InstanceCount = 0;
+
+	RetireTlas();
+	if (m_ScratchBuffer)
+		RetireBuffer(m_ScratchBuffer, m_ScratchBufferAllocation);
+	m_ScratchBufferSize = 0;
+	DestroyRetiredResources(m_RetiringResources);
+
+	for (BuildSubmission& submission : m_FreeSubmissions)
+		m_VkDevice->Raw().destroyQueryPool(submission.CompactionQueryPool);
+	m_FreeSubmissions.clear();
+	if (m_CommandPool)
+		m_VkDevice->Raw().destroyCommandPool(m_CommandPool); // Free the command buffers with it
+	if (m_UploadCommandPool)
+		m_VkDevice->Raw().destroyCommandPool(m_UploadCommandPool);
+	m_CommandPool = VK_NULL_HANDLE;
+	m_UploadCommandPool = VK_NULL_HANDLE;
+
+	m_StagingBuffer.DestroyStagingBuffer();
+}
 
-	vk::AccelerationStructureBuildGeometryInfoKHR blasBuildGeometryInfo(
-		vk::AccelerationStructureTypeKHR::eBottomLevel,
-		vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace,
-		vk::BuildAccelerationStructureModeKHR::eBuild,
-		VK_NULL_HANDLE, // Will be resolve later
-		VK_NULL_HANDLE, // Will be resolve later
-		aabbs.size(), &aabbGeometry
-	);
-	vk::AccelerationStructureBuildRangeInfoKHR blasBuildOffsetInfo = aabbBuildOffsetInfo;
+void VulkanAccelerationStructure::QueueWorldChanges(const VoxelWorld& world)
+{
+	m_InstanceTracker.SyncWithWorld(world);
 
-	vk::AccelerationStructureBuildSizesInfoKHR blasBuildSizesInfo =
-		m_VkDevice->Raw().getAccelerationStructureBuildSizesKHR(
-			vk::AccelerationStructureBuildTypeKHR::eDevice,
-			blasBuildGeometryInfo,
-			blasBuildOffsetInfo.primitiveCount,
-			*m_Dldi
-		);
-	blasSize = blasBuildSizesInfo.accelerationStructureSize;
-	blasScratchBufferMaxSize = blasBuildSizesInfo.buildScratchSize;
+	/* REMOVED CHUNKS */
 
-	/* BLAS SCRATCH BUFFER */
+	for (const ChunkCoordinate& coordinate : m_InstanceTracker.TakeRemovedChunks())
+	{
+		auto chunkBlasIt = m_ChunkBlases.find(coordinate);
+		if (chunkBlasIt == m_ChunkBlases.end())
+			continue;
+
+		// The frames in flight may still trace rays through it
+		m_AabbCount -= chunkBlasIt->second.AabbCount;
+		m_RetiringResources.Blases.push_back(chunkBlasIt->second);
+		m_ChunkBlases.erase(chunkBlasIt);
+		m_bTlasDirty = true;
+	}
+
+	// Removed before their BLAS has been submitted
+	for (auto queuedChunkIt = m_QueuedChunkBuilds.begin(); queuedChunkIt != m_QueuedChunkBuilds.end();)
+	{
+		if (world.FindChunk(queuedChunkIt->first) == nullptr)
+		{
+			m_BuildPlanner.Cancel(queuedChunkIt->first);
+			queuedChunkIt = m_QueuedChunkBuilds.erase(queuedChunkIt);
+		}
+		else
+			++queuedChunkIt;
+	}
 
-	vk::BufferCreateInfo blasScratchBufferInfo(
-		vk::BufferCreateFlags(),
-		blasScratchBufferMaxSize,
-		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-		vk::SharingMode::eExclusive,
-		1, &m_VkDevice->GetQueue(VulkanQueueType::Graphic).FamilyIndex
-	);
+	/* DIRTY CHUNKS */
 
-	vk::Buffer blasScratchBuffer = m_VkDevice->Raw().createBuffer(blasScratchBufferInfo);
+	// How much the voxels of the queued chunks have been merged into bigger boxes
+	VoxelAabbMergeStatistics mergeStatistics;
+	uint32_t queuedCount = 0;
 
-	VulkanMemoryRequirementsExtended blasScratchBufferMemoryRequirement = m_VkDevice->FindMemoryRequirement(blasScratchBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	for (const ChunkCoordinate& coordinate : m_InstanceTracker.GetDirtyChunks())
+	{
+		const VoxelChunk* chunk = world.FindChunk(coordinate);
+		CHECK(chunk);
 
-	vk::MemoryAllocateInfo blasScratchBufferMemoryAllocateInfo(
-		blasScratchBufferMemoryRequirement.size,
-		blasScratchBufferMemoryRequirement.MemoryTypeIndex,
-		&memoryAllocateFlagsInfo
-	);
+		// Already queued from the same revision
+		auto queuedChunkIt = m_QueuedChunkBuilds.find(coordinate);
+		if (queuedChunkIt != m_QueuedChunkBuilds.end() && queuedChunkIt->second.Revision == chunk->GetRevision())
+			continue;
 
-	vk::DeviceMemory blasScratchBufferMemory = m_VkDevice->Raw().allocateMemory(blasScratchBufferMemoryAllocateInfo);
+		QueuedChunkBuild queuedBuild;
+		queuedBuild.Revision = chunk->GetRevision();
 
-	m_VkDevice->Raw().bindBufferMemory(blasScratchBuffer, blasScratchBufferMemory, 0);
+		VoxelAabbMergeStatistics chunkMergeStatistics;
+		queuedBuild.Aabbs = VulkanChunkInstanceTracker::GenerateChunkAabbs(*chunk, &chunkMergeStatistics);
+		CHECK(queuedBuild.Aabbs.empty() == false);
+		mergeStatistics += chunkMergeStatistics;
 
-	vk::DeviceAddress blasScratchBufferAddress = m_VkDevice->Raw().getBufferAddress({ blasScratchBuffer }, *m_Dldi);
+		const uint32_t aabbCount = static_cast<uint32_t>(queuedBuild.Aabbs.size());
+		auto chunkBlasIt = m_ChunkBlases.find(coordinate);
+		const VulkanBlasRefitCounters* refitCounters = (chunkBlasIt != m_ChunkBlases.end()) ? &chunkBlasIt->second.RefitCounters : nullptr;
 
-	vk::AccelerationStructureCreateInfoKHR blasCreateInfo;
-	blasCreateInfo.type = vk::AccelerationStructureTypeKHR::eBottomLevel;
-	blasCreateInfo.size = blasSize;
+		// A refit move each primitive in place, the edit size is how many of them differ from the current BLAS
+		const uint32_t changedPrimitiveCount = (refitCounters != nullptr && refitCounters->bAllowUpdate)
+			? VulkanBlasRefitHeuristic::CountChangedPrimitives(chunkBlasIt->second.RefitAabbs, queuedBuild.Aabbs)
+			: aabbCount;
 
-	vk::BufferCreateInfo blasBufferInfo(
-		vk::BufferCreateFlags(),
-		blasSize,
-		vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-		vk::SharingMode::eExclusive,
-		1, &m_VkDevice->GetQueue(VulkanQueueType::Graphic).FamilyIndex
-	);
+		queuedBuild.Kind = m_RefitHeuristic.Decide(refitCounters, aabbCount, changedPrimitiveCount);
+		if (queuedBuild.Kind == VulkanBlasBuildKind::Refit)
+		{
+			queuedBuild.ChangedPrimitiveCount = changedPrimitiveCount;
+			// An update must keep the flags and the primitive count of the build
+			queuedBuild.BuildFlags = chunkBlasIt->second.BuildFlags;
+			queuedBuild.PrimitiveCapacity = refitCounters->PrimitiveCapacity;
+		}
+		else
+		{
+			// The chunks edited after they were loaded will be refit, the static ones are compacted
+			const bool bAllowUpdate = m_RefitHeuristic.ShouldAllowUpdate(refitCounters);
+			queuedBuild.BuildFlags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace;
+			if (bAllowUpdate)
+				queuedBuild.BuildFlags |= vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate;
+			else if (m_bCompactBlas)
+				queuedBuild.BuildFlags |= vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction;
+			queuedBuild.PrimitiveCapacity = m_RefitHeuristic.GetPrimitiveCapacity(aabbCount, bAllowUpdate);
+		}
 
-	m_BlasBuffer = m_VkDevice->Raw().createBuffer(blasBufferInfo);
+		// Only the primitive count matter to get the sizes, the addresses are set when the build is recorded
+		vk::AccelerationStructureGeometryKHR blasGeometry(
+			vk::GeometryTypeKHR::eAabbs,
+			vk::AccelerationStructureGeometryAabbsDataKHR(vk::DeviceAddress(0), vk::DeviceSize(sizeof(VoxelAabb))),
+			vk::GeometryFlagBitsKHR::eOpaque
+		);
+		vk::AccelerationStructureBuildGeometryInfoKHR blasBuildGeometryInfo(
+			vk::AccelerationStructureTypeKHR::eBottomLevel,
+			queuedBuild.BuildFlags,
+			vk::BuildAccelerationStructureModeKHR::eBuild,
+			VK_NULL_HANDLE,
+			VK_NULL_HANDLE,
+			1, &blasGeometry
+		);
+		queuedBuild.BuildSizes = m_VkDevice->Raw().getAccelerationStructureBuildSizesKHR(
+			vk::AccelerationStructureBuildTypeKHR::eDevice,
+			blasBuildGeometryInfo,
+			queuedBuild.PrimitiveCapacity,
+			*m_Dldi
+		);
 
-	VulkanMemoryRequirementsExtended blasBufferMemoryRequirement = m_VkDevice->FindMemoryRequirement(m_BlasBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		const vk::DeviceSize scratchSize = (queuedBuild.Kind == VulkanBlasBuildKind::Refit) ? queuedBuild.BuildSizes.updateScratchSize : queuedBuild.BuildSizes.buildScratchSize;
+		m_BuildPlanner.Enqueue(coordinate, scratchSize);
+		m_QueuedChunkBuilds[coordinate] = std::move(queuedBuild);
+		queuedCount++;
+	}
 
-	vk::MemoryAllocateInfo blasBufferMemoryAllocateInfo(
-		blasBufferMemoryRequirement.size,
-		blasBufferMemoryRequirement.MemoryTypeIndex,
-		&memoryAllocateFlagsInfo
-	);
+#ifndef NO_PROFILING
+	if (queuedCount > 0)
+	{
+		OV_LOG(LogVulkan, Verbose, "Queued {:d} chunks BLAS: {:d} voxels -> {:d} AABBs (x{:.1f} less primitives), merge {:.2f}ms",
+			queuedCount, mergeStatistics.VoxelCount, mergeStatistics.AabbCount, mergeStatistics.GetReductionRatio(),
+			TO_DOUBLE_MILLISECONDS(mergeStatistics.Duration)
+		);
+	}
+#endif
+}
 
-	m_BlasBufferMemory = m_VkDevice->Raw().allocateMemory(blasBufferMemoryAllocateInfo);
+bool VulkanAccelerationStructure::SubmitBuildBatch()
+{
+	START_NAMED_TIMER(SubmitTimer);
 
-	m_VkDevice->Raw().bindBufferMemory(m_BlasBuffer, m_BlasBufferMemory, 0);
+	// Before the builds: the chunks still queued aren't compacted, they are rebuilt anyway
+	std::vector<vk::CopyAccelerationStructureInfoKHR> compactionCopies;
+	PrepareCompactions(compactionCopies);
 
-	vk::DeviceAddress blasBufferAddress = m_VkDevice->Raw().getBufferAddress({ m_BlasBuffer }, *m_Dldi);
+	VulkanAccelerationStructureBuildPlanner::Batch batch;
+	m_BuildPlanner.PlanBatch(batch);
+	const size_t buildCount = batch.Builds.size();
 
-	blasCreateInfo.buffer = m_BlasBuffer;
+	/* BLAS */
 
-	m_Blas = m_VkDevice->Raw().createAccelerationStructureKHR(blasCreateInfo, nullptr, *m_Dldi);
+	// The build infos point to the geometries, those arrays must not be resized once filled
+	std::vector<vk::AccelerationStructureGeometryKHR> blasGeometries(buildCount);
+	std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> blasBuildGeometryInfos(buildCount);
+	std::vector<vk::AccelerationStructureBuildRangeInfoKHR> blasBuildRangeInfos(buildCount);
+	std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> blasBuildRangeInfosPtrs(buildCount);
+	std::vector<QueuedCompaction> compactionCandidates;
+	std::vector<vk::AccelerationStructureKHR> compactionCandidateBlases;
 
-	/* BLAS BUILD */
+	uint32_t refitCount = 0;
 
-	blasBuildGeometryInfo.dstAccelerationStructure = m_Blas;
-	blasBuildGeometryInfo.scratchData.deviceAddress = blasScratchBufferAddress;
+	for (size_t i = 0; i < buildCount; i++)
+	{
+		const ChunkCoordinate& coordinate = batch.Builds[i].Coordinate;
+		auto queuedChunkIt = m_QueuedChunkBuilds.find(coordinate);
+		CHECK(queuedChunkIt != m_QueuedChunkBuilds.end());
+		QueuedChunkBuild& queuedBuild = queuedChunkIt->second;
+		const uint32_t aabbCount = static_cast<uint32_t>(queuedBuild.Aabbs.size());
+
+		auto chunkBlasIt = m_ChunkBlases.find(coordinate);
+		const bool bRefit = (queuedBuild.Kind == VulkanBlasBuildKind::Refit);
+		CHECK(bRefit == false || (chunkBlasIt != m_ChunkBlases.end() && chunkBlasIt->second.RefitCounters.PrimitiveCapacity == queuedBuild.PrimitiveCapacity));
+
+		// A refit update the BLAS and the AABBs in place, a build replace them
+		ChunkBlas chunkBlas;
+		if (bRefit)
+			chunkBlas = chunkBlasIt->second;
+		chunkBlas.AabbCount = aabbCount;
+		chunkBlas.BuildFlags = queuedBuild.BuildFlags;
+
+		/* CUBES */
+
+		// The primitives after the AABBs of the chunk are degenerate boxes (never hit by the intersection shader), the slack of the BLAS that can be refit
+		queuedBuild.Aabbs.resize(queuedBuild.PrimitiveCapacity, VoxelAabb{ glm::vec3(0.0f), glm::vec3(0.0f) });
+		const vk::DeviceSize aabbBufferSize = sizeof(VoxelAabb) * queuedBuild.Aabbs.size();
+		if (bRefit == false)
+		{
+			CreateBuffer(
+				aabbBufferSize,
+				vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR
+				| vk::BufferUsageFlagBits::eShaderDeviceAddress
+				| vk::BufferUsageFlagBits::eStorageBuffer // The intersection shader read the AABBs back
+				| vk::BufferUsageFlagBits::eTransferDst,
+				vk::MemoryPropertyFlagBits::eDeviceLocal,
+				{ VulkanQueueType::Transfer, VulkanQueueType::Compute, VulkanQueueType::Graphic },
+				chunkBlas.AabbBuffer, chunkBlas.AabbBufferAllocation
+			);
+		}
+		UploadToBuffer(chunkBlas.AabbBuffer, queuedBuild.Aabbs.data(), aabbBufferSize);
 
-	const vk::AccelerationStructureBuildRangeInfoKHR* blasBuildRangeInfosPtr = &blasBuildOffsetInfo;
+		// The next edit of the BLAS that can be refit is compared to these AABBs, without the padding
+		const bool bAllowUpdate = static_cast<bool>(queuedBuild.BuildFlags & vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate);
+		if (bAllowUpdate)
+		{
+			queuedBuild.Aabbs.resize(aabbCount);
+			chunkBlas.RefitAabbs = std::move(queuedBuild.Aabbs);
+		}
+		else
+			chunkBlas.RefitAabbs.clear();
 
-	commandBuffer.reset();
-	commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
-	commandBuffer.buildAccelerationStructuresKHR(1, &blasBuildGeometryInfo, &blasBuildRangeInfosPtr, *m_Dldi);
-	commandBuffer.end();
+		const vk::DeviceAddress aabbBufferAddress = m_VkDevice->Raw().getBufferAddress({ chunkBlas.AabbBuffer }, *m_Dldi);
 
-	vk::SubmitInfo blasSubmitInfo(
-		0, nullptr,
-		nullptr,
-		1, &commandBuffer
-	);
+		/* BLAS BUILD INFO */
 
-	m_VkDevice->GetQueue(VulkanQueueType::Graphic).submit(1, &blasSubmitInfo, nullptr);
-	m_VkDevice->GetQueue(VulkanQueueType::Graphic).waitIdle();
+		vk::AccelerationStructureGeometryAabbsDataKHR aabbGeometryData(
+			aabbBufferAddress,
+			vk::DeviceSize(sizeof(VoxelAabb)) // stride
+		);
 
-	m_VkDevice->Raw().destroyBuffer(blasScratchBuffer);
-	m_VkDevice->Raw().freeMemory(blasScratchBufferMemory);
+		blasGeometries[i] = vk::AccelerationStructureGeometryKHR(
+			vk::GeometryTypeKHR::eAabbs,
+			aabbGeometryData,
+			vk::GeometryFlagBitsKHR::eOpaque
+		);
 
-	/* TOP LEVEL ACCELERATION STRUCTURE */
+		blasBuildRangeInfos[i] = vk::AccelerationStructureBuildRangeInfoKHR(
+			queuedBuild.PrimitiveCapacity, // primitiveCount
+			0, // primitiveOffset
+			0, // firstVertex
+			0  // transformOffset
+		);
+		blasBuildRangeInfosPtrs[i] = &blasBuildRangeInfos[i];
+
+		blasBuildGeometryInfos[i] = vk::AccelerationStructureBuildGeometryInfoKHR(
+			vk::AccelerationStructureTypeKHR::eBottomLevel,
+			queuedBuild.BuildFlags,
+			bRefit ? vk::BuildAccelerationStructureModeKHR::eUpdate : vk::BuildAccelerationStructureModeKHR::eBuild,
+			VK_NULL_HANDLE, // Will be resolve later
+			VK_NULL_HANDLE, // Will be resolve later
+			1, &blasGeometries[i] // All the AABBs of the chunk are in a single geometry
+		);
 
-	vk::DeviceAddress blasAddress = m_VkDevice->Raw().getAccelerationStructureAddressKHR({ m_Blas }, *m_Dldi);
+		/* BLAS */
 
-	vk::TransformMatrixKHR identityMatrix(std::array<std::array<float, 4>, 3>(
+		if (bRefit)
 		{
-			{1.0f, 0.0f, 0.0f, 0.0f},
-			{0.0f, 1.0f, 0.0f, 0.0f},
-			{0.0f, 0.0f, 1.0f, 0.0f}
+			// Updated in place, the source is the destination
+			blasBuildGeometryInfos[i].srcAccelerationStructure = chunkBlas.Blas;
+			chunkBlas.RefitCounters = m_RefitHeuristic.OnRefit(chunkBlas.RefitCounters, aabbCount, queuedBuild.ChangedPrimitiveCount);
+			refitCount++;
 		}
-	));
-
-	vk::AccelerationStructureInstanceKHR tlasInstance(
-		identityMatrix,
-		0,
-		0xFF,
-		0,
-		vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable,
-		blasAddress
-	);
+		else
+		{
+			CreateBuffer(
+				queuedBuild.BuildSizes.accelerationStructureSize,
+				vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+				vk::MemoryPropertyFlagBits::eDeviceLocal,
+				{ VulkanQueueType::Compute, VulkanQueueType::Graphic },
+				chunkBlas.BlasBuffer, chunkBlas.BlasBufferAllocation
+			);
+
+			vk::AccelerationStructureCreateInfoKHR blasCreateInfo;
+			blasCreateInfo.type = vk::AccelerationStructureTypeKHR::eBottomLevel;
+			blasCreateInfo.size = queuedBuild.BuildSizes.accelerationStructureSize;
+			blasCreateInfo.buffer = chunkBlas.BlasBuffer;
+
+			chunkBlas.Blas = m_VkDevice->Raw().createAccelerationStructureKHR(blasCreateInfo, nullptr, *m_Dldi);
+			chunkBlas.BlasSize = queuedBuild.BuildSizes.accelerationStructureSize;
+
+			chunkBlas.RefitCounters = m_RefitHeuristic.OnBuilt(chunkBlasIt != m_ChunkBlases.end() ? &chunkBlasIt->second.RefitCounters : nullptr, aabbCount, bAllowUpdate);
+
+			if (queuedBuild.BuildFlags & vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction)
+			{
+				compactionCandidates.push_back(QueuedCompaction{ coordinate, chunkBlas.Blas, 0 });
+				compactionCandidateBlases.push_back(chunkBlas.Blas);
+			}
+		}
+		blasBuildGeometryInfos[i].dstAccelerationStructure = chunkBlas.Blas;
 
-	vk::BufferCreateInfo tlasInstanceBufferInfo(
-		vk::BufferCreateFlags(),
-		sizeof(vk::AccelerationStructureInstanceKHR),
-		vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-		vk::SharingMode::eExclusive,
-		1, &m_VkDevice->GetQueue(VulkanQueueType::Graphic).FamilyIndex
-	);
+		// The address of the BLAS is known as soon as it's created, the TLAS instances can be generated before the build
+		const vk::DeviceAddress blasAddress = m_VkDevice->Raw().getAccelerationStructureAddressKHR({ chunkBlas.Blas }, *m_Dldi);
+		m_InstanceTracker.OnChunkBuilt(coordinate, queuedBuild.Revision, blasAddress, aabbBufferAddress);
 
-	m_TlasInstanceBuffer = m_VkDevice->Raw().createBuffer(tlasInstanceBufferInfo);
+		if (chunkBlasIt != m_ChunkBlases.end())
+		{
+			// The frames in flight may still trace rays through the replaced one
+			m_AabbCount -= chunkBlasIt->second.AabbCount;
+			if (bRefit == false)
+				m_RetiringResources.Blases.push_back(std::move(chunkBlasIt->second));
+			chunkBlasIt->second = std::move(chunkBlas);
+		}
+		else
+			m_ChunkBlases.emplace(coordinate, std::move(chunkBlas));
+		m_AabbCount += aabbCount;
 
-	VulkanMemoryRequirementsExtended tlasInstanceBufferMemoryRequirement = m_VkDevice->FindMemoryRequirement(m_TlasInstanceBuffer, vk::MemoryPropertyFlagBits::eHostVisible);
+		m_QueuedChunkBuilds.erase(queuedChunkIt);
+	}
 
-	vk::MemoryAllocateInfo tlasInstanceBufferMemoryAllocateInfo(
-		tlasInstanceBufferMemoryRequirement.size,
-		tlasInstanceBufferMemoryRequirement.MemoryTypeIndex,
-		&memoryAllocateFlagsInfo
-	);
-
-	m_TlasInstanceBufferMemory = m_VkDevice->Raw().allocateMemory(tlasInstanceBufferMemoryAllocateInfo);
+	/* TOP LEVEL ACCELERATION STRUCTURE */
 
-	m_VkDevice->Raw().bindBufferMemory(m_TlasInstanceBuffer, m_TlasInstanceBufferMemory, 0);
+	VulkanChunkInstanceTracker::InstanceList instanceList;
+	m_InstanceTracker.GenerateInstances(instanceList);
+	m_InstanceCount = static_cast<uint32_t>(instanceList.Instances.size());
 
-	void* data = m_VkDevice->Raw().mapMemory(m_TlasInstanceBufferMemory, 0, sizeof(vk::AccelerationStructureInstanceKHR), vk::MemoryMapFlags());
-	memcpy(data, &tlasInstance, sizeof(vk::AccelerationStructureInstanceKHR));
+	const bool bTlasRecreated = ReserveTlas(m_InstanceCount);
 
-	m_VkDevice->Raw().unmapMemory(m_TlasInstanceBufferMemory);
+	if (m_InstanceCount > 0)
+	{
+		UploadToBuffer(m_TlasInstanceBuffer, instanceList.Instances.data(), sizeof(vk::AccelerationStructureInstanceKHR) * m_InstanceCount, true);
+		UploadToBuffer(m_AabbAddressBuffer, instanceList.AabbBufferAddresses.data(), sizeof(vk::DeviceAddress) * m_InstanceCount);
+	}
 
-	vk::DeviceAddress tlasInstanceBufferAddress = m_VkDevice->Raw().getBufferAddress({ m_TlasInstanceBuffer }, *m_Dldi);
+	// The BLAS builds run together, each one in its own range, then the TLAS build reuse the beginning of the buffer
+	ReserveScratchBuffer(std::max(batch.ScratchSize, m_TlasScratchSize));
+	const vk::DeviceAddress scratchAddress = m_VkDevice->Raw().getBufferAddress({ m_ScratchBuffer }, *m_Dldi);
+	for (size_t i = 0; i < buildCount; i++)
+		blasBuildGeometryInfos[i].scratchData.deviceAddress = scratchAddress + batch.Builds[i].ScratchOffset;
 
 	vk::AccelerationStructureGeometryInstancesDataKHR tlasInstanceData;
-	tlasInstanceData.data.deviceAddress = tlasInstanceBufferAddress;
+	tlasInstanceData.data.deviceAddress = m_VkDevice->Raw().getBufferAddress({ m_TlasInstanceBuffer }, *m_Dldi);
 
 	vk::AccelerationStructureGeometryKHR tlasGeometry(
 		vk::GeometryTypeKHR::eInstances,
@@ -247,119 +431,426 @@ void VulkanAccelerationStructure::CreateAccelerationStructure(const vk::CommandB
 		vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace,
 		vk::BuildAccelerationStructureModeKHR::eBuild,
 		VK_NULL_HANDLE,
-		VK_NULL_HANDLE,
+		m_Tlas,
 		1, &tlasGeometry
 	);
+	tlasBuildGeometryInfo.scratchData.deviceAddress = scratchAddress;
 
-	vk::AccelerationStructureBuildSizesInfoKHR tlasBuildSizeInfo = m_VkDevice->Raw().getAccelerationStructureBuildSizesKHR(
-		vk::AccelerationStructureBuildTypeKHR::eDevice,
-		tlasBuildGeometryInfo,
-		1,
-		*m_Dldi
+	vk::AccelerationStructureBuildRangeInfoKHR tlasBuildRangeInfo(m_InstanceCount, 0, 0, 0);
+	const vk::AccelerationStructureBuildRangeInfoKHR* tlasBuildRangeInfoPtr = &tlasBuildRangeInfo;
+
+	/* BUILD */
+
+	BuildSubmission submission = AcquireSubmission();
+
+	// The frames submitted before may still trace rays through the TLAS, the refit BLAS and their AABBs
+	const VulkanTimelineWait framesWait{ m_FrameTimeline, m_FrameTimeline->GetLastSignalValue(), vk::PipelineStageFlagBits::eAllCommands };
+
+	VulkanTimelineSubmitInfo buildSubmitInfo;
+	buildSubmitInfo.TimelineWaits.push_back(framesWait);
+
+	// The uploads are the next submission of the transfer timeline, the staging ring reuse the regions of the copies once it's complete
+	if (m_StagingBuffer.HasQueuedCopies())
+	{
+		const vk::CommandBuffer& uploadCommandBuffer = submission.UploadCommandBuffer;
+		uploadCommandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+		m_StagingBuffer.RecordCopies(uploadCommandBuffer);
+		uploadCommandBuffer.end();
+
+		// The copies also overwrite the TLAS instances the previous batches may still read
+		VulkanTimelineSubmitInfo uploadSubmitInfo;
+		uploadSubmitInfo.CommandBuffers.push_back(uploadCommandBuffer);
+		uploadSubmitInfo.TimelineWaits.push_back(framesWait);
+		uploadSubmitInfo.TimelineWaits.push_back(VulkanTimelineWait{ m_BuildTimeline, m_BuildTimeline->GetLastSignalValue(), vk::PipelineStageFlagBits::eAllCommands });
+		const uint64_t uploadValue = m_UploadTimeline->Submit(m_VkDevice->GetQueue(VulkanQueueType::Transfer), uploadSubmitInfo);
+
+		buildSubmitInfo.TimelineWaits.push_back(VulkanTimelineWait{ m_UploadTimeline, uploadValue, vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR });
+	}
+
+	const vk::CommandBuffer& commandBuffer = submission.CommandBuffer;
+	commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+	if (compactionCandidates.empty() == false)
+		commandBuffer.resetQueryPool(submission.CompactionQueryPool, 0, static_cast<uint32_t>(compactionCandidates.size()));
+
+	// The previous batch may still build with the scratch buffer
+	vk::MemoryBarrier previousSubmissionsBarrier(
+		vk::AccessFlagBits::eAccelerationStructureWriteKHR,
+		vk::AccessFlagBits::eAccelerationStructureReadKHR | vk::AccessFlagBits::eAccelerationStructureWriteKHR
+	);
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+		vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+		vk::DependencyFlags(),
+		1, &previousSubmissionsBarrier,
+		0, nullptr,
+		0, nullptr
 	);
 
-	vk::AccelerationStructureCreateInfoKHR tlasCreateInfo;
-	tlasCreateInfo.type = vk::AccelerationStructureTypeKHR::eTopLevel;
-	tlasCreateInfo.size = tlasBuildSizeInfo.accelerationStructureSize;
+	// The TLAS instances have been released by the transfer family
+	m_StagingBuffer.RecordAcquires(
+		commandBuffer,
+		m_VkDevice->GetQueue(VulkanQueueType::Compute).FamilyIndex,
+		vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+		vk::AccessFlagBits::eShaderRead
+	);
 
-	vk::BufferCreateInfo tlasBufferInfo(
-		vk::BufferCreateFlags(),
-		tlasBuildSizeInfo.accelerationStructureSize,
-		vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-		vk::SharingMode::eExclusive,
-		1, &m_VkDevice->GetQueue(VulkanQueueType::Graphic).FamilyIndex
+	if (buildCount > 0 || compactionCopies.empty() == false)
+	{
+		CREATE_GPU_SCOPE_TIMER(submission.GpuScopes.get(), commandBuffer, ProfilingCategories::GpuBlasBuild);
+
+		// The BLAS compacted by this batch were built by a previous one
+		for (const vk::CopyAccelerationStructureInfoKHR& compactionCopy : compactionCopies)
+			commandBuffer.copyAccelerationStructureKHR(compactionCopy, *m_Dldi);
+
+		// Every BLAS are built by the same command, then the TLAS once they are done
+		if (buildCount > 0)
+		{
+			commandBuffer.buildAccelerationStructuresKHR(
+				static_cast<uint32_t>(buildCount), blasBuildGeometryInfos.data(), blasBuildRangeInfosPtrs.data(),
+				*m_Dldi
+			);
+		}
+
+		// The TLAS build (and the compacted size queries) read the BLAS, and the TLAS build write the scratch buffer the BLAS builds used
+		vk::MemoryBarrier blasBuildBarrier(
+			vk::AccessFlagBits::eAccelerationStructureWriteKHR,
+			vk::AccessFlagBits::eAccelerationStructureReadKHR | vk::AccessFlagBits::eAccelerationStructureWriteKHR
+		);
+		commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+			vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+			vk::DependencyFlags(),
+			1, &blasBuildBarrier,
+			0, nullptr,
+			0, nullptr
+		);
+	}
+	// Read back once the batch is complete (@see QueueCompactions)
+	if (compactionCandidates.empty() == false)
+	{
+		commandBuffer.writeAccelerationStructuresPropertiesKHR(
+			compactionCandidateBlases,
+			vk::QueryType::eAccelerationStructureCompactedSizeKHR,
+			submission.CompactionQueryPool, 0,
+			*m_Dldi
+		);
+	}
+	{
+		CREATE_GPU_SCOPE_TIMER(submission.GpuScopes.get(), commandBuffer, ProfilingCategories::GpuTlasBuild);
+		commandBuffer.buildAccelerationStructuresKHR(1, &tlasBuildGeometryInfo, &tlasBuildRangeInfoPtr, *m_Dldi);
+	}
+	commandBuffer.end();
+
+	// The frames submitted after wait for the value of the batch before tracing rays through the new TLAS (@see GetBuildWait)
+	buildSubmitInfo.CommandBuffers.push_back(commandBuffer);
+	submission.SignalValue = m_BuildTimeline->Submit(m_VkDevice->GetQueue(VulkanQueueType::Compute), buildSubmitInfo);
+
+	submission.CompactionCandidates = std::move(compactionCandidates);
+	submission.Retired = std::move(m_RetiringResources);
+	m_RetiringResources = RetiredResources();
+	m_PendingSubmissions.push_back(std::move(submission));
+	m_bTlasDirty = false;
+
+#ifndef NO_PROFILING
+	OV_LOG(LogVulkan, Verbose, "Submitted {:d} BLAS builds ({:d} refits, {:d} still queued, {:d} batches in flight), scratch {:d}KB, recorded in {:.2f}ms",
+		buildCount, refitCount, m_BuildPlanner.GetQueuedCount(), m_PendingSubmissions.size(), batch.ScratchSize / 1024,
+		TO_DOUBLE_MILLISECONDS(TIMER_NAMED_ELAPSED(SubmitTimer))
 	);
+#endif
+
+	return (bTlasRecreated);
+}
 
-	m_TlasBuffer = m_VkDevice->Raw().createBuffer(tlasBufferInfo);
+VulkanAccelerationStructure::BuildSubmission VulkanAccelerationStructure::AcquireSubmission()
+{
+	if (m_FreeSubmissions.empty() == false)
+	{
+		BuildSubmission submission = std::move(m_FreeSubmissions.back());
+		m_FreeSubmissions.pop_back();
+		return (submission);
+	}
+
+	BuildSubmission submission;
+	vk::CommandBufferAllocateInfo commandBufferAllocateInfo(
+		m_CommandPool,
+		vk::CommandBufferLevel::ePrimary,
+		1
+	);
+	submission.CommandBuffer = m_VkDevice->Raw().allocateCommandBuffers(commandBufferAllocateInfo)[0];
+	commandBufferAllocateInfo.commandPool = m_UploadCommandPool;
+	submission.UploadCommandBuffer = m_VkDevice->Raw().allocateCommandBuffers(commandBufferAllocateInfo)[0];
+
+	// One query per BLAS of a batch at most
+	vk::QueryPoolCreateInfo queryPoolCreateInfo(
+		vk::QueryPoolCreateFlags(),
+		vk::QueryType::eAccelerationStructureCompactedSizeKHR,
+		m_BuildPlanner.GetSettings().MaxBuildsPerBatch
+	);
+	submission.CompactionQueryPool = m_VkDevice->Raw().createQueryPool(queryPoolCreateInfo);
 
-	VulkanMemoryRequirementsExtended tlasBufferMemoryRequirement = m_VkDevice->FindMemoryRequirement(m_TlasBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	// A scope for the BLAS and one for the TLAS, read back with the compacted sizes
+	if (m_GpuTimestampConversion.IsSupported())
+		submission.GpuScopes = std::make_unique<VulkanGpuScopes>(std::make_unique<VulkanDeviceTimestampQueries>(m_VkDevice->Raw(), 4), m_GpuTimestampConversion);
+	return (submission);
+}
 
-	vk::MemoryAllocateInfo tlasBufferMemoryAllocateInfo(
-		tlasBufferMemoryRequirement.size,
-		tlasBufferMemoryRequirement.MemoryTypeIndex,
-		&memoryAllocateFlagsInfo
+void VulkanAccelerationStructure::QueueCompactions(BuildSubmission& submission)
+{
+	if (submission.CompactionCandidates.empty())
+		return;
+
+	const uint32_t candidateCount = static_cast<uint32_t>(submission.CompactionCandidates.size());
+	std::vector<uint64_t> compactedSizes(candidateCount);
+	const vk::Result result = m_VkDevice->Raw().getQueryPoolResults(
+		submission.CompactionQueryPool,
+		0, candidateCount,
+		sizeof(uint64_t) * candidateCount, compactedSizes.data(), sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64
 	);
+	CHECK_VULKAN_RESULT(result, "Unable to read the compacted size of the BLAS");
 
-	m_TlasBufferMemory = m_VkDevice->Raw().allocateMemory(tlasBufferMemoryAllocateInfo);
+	for (uint32_t i = 0; i < candidateCount && result == vk::Result::eSuccess; i++)
+	{
+		QueuedCompaction& candidate = submission.CompactionCandidates[i];
+		candidate.CompactedSize = compactedSizes[i];
+
+		// Rebuilt or removed by a batch submitted after this one
+		auto chunkBlasIt = m_ChunkBlases.find(candidate.Coordinate);
+		if (chunkBlasIt == m_ChunkBlases.end() || chunkBlasIt->second.Blas != candidate.Blas)
+			continue;
+
+		if (candidate.CompactedSize > 0 && candidate.CompactedSize < chunkBlasIt->second.BlasSize)
+			m_QueuedCompactions.push_back(candidate);
+	}
+	submission.CompactionCandidates.clear();
+}
 
-	m_VkDevice->Raw().bindBufferMemory(m_TlasBuffer, m_TlasBufferMemory, 0);
+void VulkanAccelerationStructure::PrepareCompactions(std::vector<vk::CopyAccelerationStructureInfoKHR>& outCopies)
+{
+	VulkanBlasCompactionStatistics batchStatistics;
 
-	tlasCreateInfo.buffer = m_TlasBuffer;
+	for (const QueuedCompaction& compaction : m_QueuedCompactions)
+	{
+		auto chunkBlasIt = m_ChunkBlases.find(compaction.Coordinate);
+		if (chunkBlasIt == m_ChunkBlases.end() || chunkBlasIt->second.Blas != compaction.Blas || m_BuildPlanner.IsQueued(compaction.Coordinate))
+			continue;
+
+		ChunkBlas& chunkBlas = chunkBlasIt->second;
+
+		// Only the BLAS is replaced, the AABBs stay where they are
+		ChunkBlas compactedBlas = chunkBlas;
+		CreateBuffer(
+			compaction.CompactedSize,
+			vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			{ VulkanQueueType::Compute, VulkanQueueType::Graphic },
+			compactedBlas.BlasBuffer, compactedBlas.BlasBufferAllocation
+		);
 
-	m_Tlas = m_VkDevice->Raw().createAccelerationStructureKHR(tlasCreateInfo, nullptr, *m_Dldi);
+		vk::AccelerationStructureCreateInfoKHR blasCreateInfo;
+		blasCreateInfo.type = vk::AccelerationStructureTypeKHR::eBottomLevel;
+		blasCreateInfo.size = compaction.CompactedSize;
+		blasCreateInfo.buffer = compactedBlas.BlasBuffer;
 
-	/* TLAS SCRACH BUFFER */
+		compactedBlas.Blas = m_VkDevice->Raw().createAccelerationStructureKHR(blasCreateInfo, nullptr, *m_Dldi);
+		compactedBlas.BlasSize = compaction.CompactedSize;
+		compactedBlas.bCompacted = true;
 
-	vk::BufferCreateInfo tlasScratchBufferInfo(
+		outCopies.push_back(vk::CopyAccelerationStructureInfoKHR(chunkBlas.Blas, compactedBlas.Blas, vk::CopyAccelerationStructureModeKHR::eCompact));
+
+		// The TLAS of the batch reference the compacted BLAS
+		const VulkanChunkInstanceTracker::ChunkState* chunkState = m_InstanceTracker.FindChunk(compaction.Coordinate);
+		CHECK(chunkState);
+		const vk::DeviceAddress compactedBlasAddress = m_VkDevice->Raw().getAccelerationStructureAddressKHR({ compactedBlas.Blas }, *m_Dldi);
+		m_InstanceTracker.OnChunkBuilt(compaction.Coordinate, chunkState->BuiltRevision, compactedBlasAddress, chunkState->AabbBufferAddress);
+
+		OV_LOG(LogVulkan, VeryVerbose, "Compacted the BLAS of the chunk ({:d}, {:d}, {:d}): {:d}KB -> {:d}KB",
+			compaction.Coordinate.x, compaction.Coordinate.y, compaction.Coordinate.z, chunkBlas.BlasSize / 1024, compaction.CompactedSize / 1024
+		);
+		batchStatistics.ChunkCount++;
+		batchStatistics.OriginalSize += chunkBlas.BlasSize;
+		batchStatistics.CompactedSize += compaction.CompactedSize;
+
+		// The frames in flight may still trace rays through the original, and the copy read it
+		m_RetiringResources.AccelerationStructures.push_back(chunkBlas.Blas);
+		RetireBuffer(chunkBlas.BlasBuffer, chunkBlas.BlasBufferAllocation);
+		chunkBlas = compactedBlas;
+	}
+	m_QueuedCompactions.clear();
+
+	if (batchStatistics.ChunkCount > 0)
+	{
+		m_CompactionStatistics += batchStatistics;
+		OV_LOG(LogVulkan, Verbose, "Compacted {:d} BLAS: {:d}KB -> {:d}KB ({:.1f}KB saved per chunk, {:d}KB saved in total)",
+			batchStatistics.ChunkCount, batchStatistics.OriginalSize / 1024, batchStatistics.CompactedSize / 1024,
+			batchStatistics.GetSavedSizePerChunk() / 1024.0, m_CompactionStatistics.GetSavedSize() / 1024
+		);
+	}
+}
+
+void VulkanAccelerationStructure::WaitForOldestSubmission()
+{
+	CHECK(m_PendingSubmissions.empty() == false);
+
+	m_BuildTimeline->Wait(m_PendingSubmissions.front().SignalValue);
+	RetireCompletedBuilds();
+}
+
+void VulkanAccelerationStructure::CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperty, std::initializer_list<VulkanQueueType::Type> queueTypes, vk::Buffer& outBuffer, VulkanMemoryAllocation& outAllocation, vk::DeviceSize minAlignment) const
+{
+	const std::vector<uint32_t> queueFamilies = m_VkDevice->GetQueueFamilies().GetUniqueFamilies(queueTypes);
+	vk::BufferCreateInfo bufferInfo(
 		vk::BufferCreateFlags(),
-		tlasBuildSizeInfo.buildScratchSize,
-		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-		vk::SharingMode::eExclusive,
-		1, &m_VkDevice->GetQueue(VulkanQueueType::Graphic).FamilyIndex
+		size,
+		usage,
+		queueFamilies.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+		static_cast<uint32_t>(queueFamilies.size()), queueFamilies.data()
 	);
 
-	vk::Buffer tlasScratchBuffer = m_VkDevice->Raw().createBuffer(tlasScratchBufferInfo);
+	outBuffer = m_VkDevice->Raw().createBuffer(bufferInfo);
+	outAllocation = m_VkDevice->AllocateBufferMemory(outBuffer, memoryProperty, minAlignment);
+	CHECK(outAllocation.IsValid());
+}
 
-	VulkanMemoryRequirementsExtended tlasScratchBufferMemoryRequirement = m_VkDevice->FindMemoryRequirement(tlasScratchBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+void VulkanAccelerationStructure::DestroyBuffer(vk::Buffer& buffer, VulkanMemoryAllocation& allocation) const
+{
+	m_VkDevice->Raw().destroyBuffer(buffer);
+	m_VkDevice->FreeMemory(allocation);
+	buffer = VK_NULL_HANDLE;
+}
 
-	vk::MemoryAllocateInfo tlasScratchBufferMemoryAllocateInfo(
-		tlasScratchBufferMemoryRequirement.size,
-		tlasScratchBufferMemoryRequirement.MemoryTypeIndex,
-		&memoryAllocateFlagsInfo
-	);
+void VulkanAccelerationStructure::UploadToBuffer(vk::Buffer buffer, const void* data, vk::DeviceSize size, bool bExclusiveToCompute)
+{
+	m_StagingBuffer.Upload(data, size, buffer, 0, bExclusiveToCompute ? m_VkDevice->GetQueue(VulkanQueueType::Compute).FamilyIndex : VK_QUEUE_FAMILY_IGNORED);
+}
 
-	vk::DeviceMemory tlasScratchBufferMemory = m_VkDevice->Raw().allocateMemory(tlasScratchBufferMemoryAllocateInfo);
+void VulkanAccelerationStructure::DestroyChunkBlas(ChunkBlas& chunkBlas) const
+{
+	m_VkDevice->Raw().destroyAccelerationStructureKHR(chunkBlas.Blas, nullptr, *m_Dldi);
+	DestroyBuffer(chunkBlas.BlasBuffer, chunkBlas.BlasBufferAllocation);
+	DestroyBuffer(chunkBlas.AabbBuffer, chunkBlas.AabbBufferAllocation);
+}
 
-	m_VkDevice->Raw().bindBufferMemory(tlasScratchBuffer, tlasScratchBufferMemory, 0);
+void VulkanAccelerationStructure::RetireBuffer(vk::Buffer& buffer, VulkanMemoryAllocation& allocation)
+{
+	m_RetiringResources.Buffers.push_back(RetiredBuffer{ buffer, allocation });
+	buffer = VK_NULL_HANDLE;
+	allocation = VulkanMemoryAllocation();
+}
 
-	/* TLAS BUILD */
+void VulkanAccelerationStructure::DestroyRetiredResources(RetiredResources& resources) const
+{
+	for (ChunkBlas& chunkBlas : resources.Blases)
+		DestroyChunkBlas(chunkBlas);
+	for (vk::AccelerationStructureKHR accelerationStructure : resources.AccelerationStructures)
+		m_VkDevice->Raw().destroyAccelerationStructureKHR(accelerationStructure, nullptr, *m_Dldi);
+	for (RetiredBuffer& retiredBuffer : resources.Buffers)
+		DestroyBuffer(retiredBuffer.Buffer, retiredBuffer.Allocation);
+
+	resources = RetiredResources();
+}
 
-	vk::DeviceAddress tlasScratchBufferAddress = m_VkDevice->Raw().getBufferAddress({ tlasScratchBuffer }, *m_Dldi);
+bool VulkanAccelerationStructure::ReserveTlas(uint32_t instanceCount)
+{
+	if (m_Tlas && instanceCount <= m_TlasCapacity)
+		return (false);
+
+	// Grow by at least twice the size, so adding chunks one by one doesn't recreate the TLAS every time
+	const uint32_t capacity = glm::max(glm::max(instanceCount, m_TlasCapacity * 2), 1u);
+	RetireTlas();
+	m_TlasCapacity = capacity;
+
+	CreateBuffer(
+		sizeof(vk::AccelerationStructureInstanceKHR) * capacity,
+		vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		{ VulkanQueueType::Compute }, // Only read by the builds, the uploads release it to the compute family
+		m_TlasInstanceBuffer, m_TlasInstanceBufferAllocation
+	);
 
-	tlasBuildGeometryInfo.dstAccelerationStructure = m_Tlas;
-	tlasBuildGeometryInfo.scratchData.deviceAddress = tlasScratchBufferAddress;
+	CreateBuffer(
+		sizeof(vk::DeviceAddress) * capacity,
+		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		{ VulkanQueueType::Transfer, VulkanQueueType::Graphic },
+		m_AabbAddressBuffer, m_AabbAddressBufferAllocation
+	);
 
-	vk::AccelerationStructureBuildRangeInfoKHR tlasBuildRangeInfo(1, 0, 0, 0);
-	const vk::AccelerationStructureBuildRangeInfoKHR* tlaspBuildRangeInfo = &tlasBuildRangeInfo;
+	// The sizes only depend on the maximum instance count
+	vk::AccelerationStructureGeometryKHR tlasGeometry(
+		vk::GeometryTypeKHR::eInstances,
+		vk::AccelerationStructureGeometryInstancesDataKHR()
+	);
 
-	commandBuffer.reset();
-	commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
-	commandBuffer.buildAccelerationStructuresKHR(1, &tlasBuildGeometryInfo, &tlaspBuildRangeInfo, *m_Dldi);
-	commandBuffer.end();
+	vk::AccelerationStructureBuildGeometryInfoKHR tlasBuildGeometryInfo(
+		vk::AccelerationStructureTypeKHR::eTopLevel,
+		vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace,
+		vk::BuildAccelerationStructureModeKHR::eBuild,
+		VK_NULL_HANDLE,
+		VK_NULL_HANDLE,
+		1, &tlasGeometry
+	);
 
-	vk::SubmitInfo tlasBuildSubmitInfo;
-	tlasBuildSubmitInfo.commandBufferCount = 1;
-	tlasBuildSubmitInfo.pCommandBuffers = &commandBuffer;
+	vk::AccelerationStructureBuildSizesInfoKHR tlasBuildSizeInfo = m_VkDevice->Raw().getAccelerationStructureBuildSizesKHR(
+		vk::AccelerationStructureBuildTypeKHR::eDevice,
+		tlasBuildGeometryInfo,
+		capacity,
+		*m_Dldi
+	);
 
-	m_VkDevice->GetQueue(VulkanQueueType::Graphic).submit(1, &tlasBuildSubmitInfo, VK_NULL_HANDLE);
-	m_VkDevice->GetQueue(VulkanQueueType::Graphic).waitIdle();
+	CreateBuffer(
+		tlasBuildSizeInfo.accelerationStructureSize,
+		vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		{ VulkanQueueType::Compute, VulkanQueueType::Graphic },
+		m_TlasBuffer, m_TlasBufferAllocation
+	);
 
-	m_VkDevice->Raw().freeMemory(tlasScratchBufferMemory, nullptr);
-	m_VkDevice->Raw().destroyBuffer(tlasScratchBuffer, nullptr);
+	vk::AccelerationStructureCreateInfoKHR tlasCreateInfo;
+	tlasCreateInfo.type = vk::AccelerationStructureTypeKHR::eTopLevel;
+	tlasCreateInfo.size = tlasBuildSizeInfo.accelerationStructureSize;
+	tlasCreateInfo.buffer = m_TlasBuffer;
+
+	m_Tlas = m_VkDevice->Raw().createAccelerationStructureKHR(tlasCreateInfo, nullptr, *m_Dldi);
+
+	// Built with the shared scratch buffer (@see ReserveScratchBuffer)
+	m_TlasScratchSize = tlasBuildSizeInfo.buildScratchSize;
 
-	m_VkDevice->Raw().destroyFence(buildingFence);
+	return (true);
 }
 
-void VulkanAccelerationStructure::DestroyAccelerationStructure()
+void VulkanAccelerationStructure::RetireTlas()
 {
-#define _VK_FREE(x) m_VkDevice->Raw().freeMemory(x)
-#define _VK_DESTROY_BUFF(x) m_VkDevice->Raw().destroyBuffer(x)
-
-	m_VkDevice->Raw().destroyAccelerationStructureKHR(m_Tlas, nullptr, *m_Dldi);
-	m_VkDevice->Raw().destroyAccelerationStructureKHR(m_Blas, nullptr, *m_Dldi);
+	if (!m_Tlas)
+		return;
 
-	_VK_FREE(m_AabbBufferMemory);
-	_VK_DESTROY_BUFF(m_AabbBuffer);
+	m_RetiringResources.AccelerationStructures.push_back(m_Tlas);
+	m_Tlas = VK_NULL_HANDLE;
 
-	_VK_FREE(m_BlasBufferMemory);
-	_VK_DESTROY_BUFF(m_BlasBuffer);
+	RetireBuffer(m_TlasBuffer, m_TlasBufferAllocation);
+	RetireBuffer(m_TlasInstanceBuffer, m_TlasInstanceBufferAllocation);
+	RetireBuffer(m_AabbAddressBuffer, m_AabbAddressBufferAllocation);
+	m_TlasCapacity = 0;
+	m_TlasScratchSize = 0;
+}
 
-	_VK_FREE(m_TlasInstanceBufferMemory);
-	_VK_DESTROY_BUFF(m_TlasInstanceBuffer);
+void VulkanAccelerationStructure::ReserveScratchBuffer(vk::DeviceSize size)
+{
+	if (m_ScratchBufferSize >= size)
+		return;
 
-	_VK_FREE(m_TlasBufferMemory);
-	_VK_DESTROY_BUFF(m_TlasBuffer);
+	// The previous batches may still build with it
+	if (m_ScratchBuffer)
+		RetireBuffer(m_ScratchBuffer, m_ScratchBufferAllocation);
 
-#undef _VK_FREE
-#undef _VK_DESTROY_BUFF
+	// Grow up to the budget of the planner at once, so the next batches don't recreate it
+	m_ScratchBufferSize = std::max(size, std::min<vk::DeviceSize>(m_ScratchBufferSize * 2, m_BuildPlanner.GetSettings().ScratchBudget));
+	CreateBuffer(
+		m_ScratchBufferSize,
+		vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		{ VulkanQueueType::Compute },
+		m_ScratchBuffer, m_ScratchBufferAllocation,
+		m_VkDevice->GetAccelerationStructureProperties().minAccelerationStructureScratchOffsetAlignment
+	);
 }
@@ -0,0 +1,281 @@
+#include "Vulkan/VulkanAccelerationStructureBuildPlanner.h"
+#include "Vulkan/VulkanUtils.h"
+#include "MacrosHelper.h"
+
+#include <algorithm>
+#include <format>
+#include <random>
+#include <string_view>
+
+VulkanAccelerationStructureBuildPlanner::VulkanAccelerationStructureBuildPlanner(const VulkanAccelerationStructureBuildPlannerSettings& settings)
+{
+	SetSettings(settings);
+}
+
+void VulkanAccelerationStructureBuildPlanner::Enqueue(const ChunkCoordinate& coordinate, uint64_t scratchSize)
+{
+	auto queuedBuildIt = m_QueuedBuildsIndex.find(coordinate);
+	if (queuedBuildIt != m_QueuedBuildsIndex.end())
+	{
+		queuedBuildIt->second->ScratchSize = scratchSize;
+		return;
+	}
+
+	m_QueuedBuilds.push_back(QueuedBuild{ coordinate, scratchSize });
+	m_QueuedBuildsIndex.emplace(coordinate, std::prev(m_QueuedBuilds.end()));
+}
+
+bool VulkanAccelerationStructureBuildPlanner::Cancel(const ChunkCoordinate& coordinate)
+{
+	auto queuedBuildIt = m_QueuedBuildsIndex.find(coordinate);
+	if (queuedBuildIt == m_QueuedBuildsIndex.end())
+		return (false);
+
+	m_QueuedBuilds.erase(queuedBuildIt->second);
+	m_QueuedBuildsIndex.erase(queuedBuildIt);
+	return (true);
+}
+
+void VulkanAccelerationStructureBuildPlanner::PlanBatch(Batch& outBatch)
+{
+	outBatch.Builds.clear();
+	outBatch.ScratchSize = 0;
+
+	const uint64_t alignmentMask = m_Settings.ScratchAlignment - 1;
+	for (auto queuedBuildIt = m_QueuedBuilds.begin(); queuedBuildIt != m_QueuedBuilds.end() && outBatch.Builds.size() < m_Settings.MaxBuildsPerBatch;)
+	{
+		const uint64_t scratchOffset = (outBatch.ScratchSize + alignmentMask) & ~alignmentMask;
+
+		// The first one is taken even if it's over the budget, the others wait for a batch with enough space left
+		if (outBatch.Builds.empty() == false && scratchOffset + queuedBuildIt->ScratchSize > m_Settings.ScratchBudget)
+		{
+			++queuedBuildIt;
+			continue;
+		}
+
+		outBatch.Builds.push_back(PlannedBuild{ queuedBuildIt->Coordinate, scratchOffset, queuedBuildIt->ScratchSize });
+		outBatch.ScratchSize = scratchOffset + queuedBuildIt->ScratchSize;
+
+		m_QueuedBuildsIndex.erase(queuedBuildIt->Coordinate);
+		queuedBuildIt = m_QueuedBuilds.erase(queuedBuildIt);
+	}
+}
+
+void VulkanAccelerationStructureBuildPlanner::Clear()
+{
+	m_QueuedBuilds.clear();
+	m_QueuedBuildsIndex.clear();
+}
+
+void VulkanAccelerationStructureBuildPlanner::SetSettings(const VulkanAccelerationStructureBuildPlannerSettings& settings)
+{
+	CHECK(settings.MaxBuildsPerBatch > 0);
+	CHECK(settings.ScratchAlignment > 0 && (settings.ScratchAlignment & (settings.ScratchAlignment - 1)) == 0);
+	m_Settings = settings;
+}
+
+bool VulkanAccelerationStructureBuildPlanner::LogSelfTest(uint32_t randomOperationCount)
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Acceleration structure build planner self test, {:s}: expected {:s}", scenario, expectation);
+		failureCount++;
+	};
+	auto expectBatch = [&expect](const Batch& batch, std::string_view scenario, std::vector<PlannedBuild> expectedBuilds, uint64_t expectedScratchSize)
+	{
+		bool bSameBuilds = (batch.Builds.size() == expectedBuilds.size());
+		for (size_t i = 0; i < expectedBuilds.size() && bSameBuilds; i++)
+		{
+			bSameBuilds = (batch.Builds[i].Coordinate == expectedBuilds[i].Coordinate && batch.Builds[i].ScratchOffset == expectedBuilds[i].ScratchOffset
+				&& batch.Builds[i].ScratchSize == expectedBuilds[i].ScratchSize);
+		}
+		expect(bSameBuilds, scenario, std::format("a batch of {:d} builds at the expected offsets (got {:d} builds)", expectedBuilds.size(), batch.Builds.size()));
+		expect(batch.ScratchSize == expectedScratchSize, scenario, std::format("a batch using {:d} bytes of scratch (got {:d})", expectedScratchSize, batch.ScratchSize));
+	};
+	auto chunk = [](int32_t x) { return (ChunkCoordinate(x, 0, 0)); };
+
+	VulkanAccelerationStructureBuildPlannerSettings settings;
+	settings.MaxBuildsPerBatch = 256;
+	settings.ScratchBudget = 1000;
+	settings.ScratchAlignment = 128;
+	Batch batch;
+
+	/* OVERSIZED FIRST BUILD */
+	{
+		const std::string_view scenario = "oversized first build";
+		VulkanAccelerationStructureBuildPlanner planner(settings);
+
+		planner.Enqueue(chunk(0), 2000);
+		planner.Enqueue(chunk(1), 100);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(0), 0, 2000 } }, 2000);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(1), 0, 100 } }, 100);
+
+		// Behind another build, it waits for a batch of its own
+		planner.Enqueue(chunk(2), 100);
+		planner.Enqueue(chunk(3), 2000);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(2), 0, 100 } }, 100);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(3), 0, 2000 } }, 2000);
+		expect(planner.HasQueuedBuilds() == false, scenario, "an empty queue");
+
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, {}, 0);
+	}
+
+	/* ALIGNED OFFSETS */
+	{
+		const std::string_view scenario = "aligned offsets";
+		VulkanAccelerationStructureBuildPlanner planner(settings);
+
+		planner.Enqueue(chunk(0), 100);
+		planner.Enqueue(chunk(1), 1);
+		planner.Enqueue(chunk(2), 300);
+		// 300 bytes from 256 end at 556, the next offset is 640 where 500 bytes are over the budget
+		planner.Enqueue(chunk(3), 500);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(0), 0, 100 }, { chunk(1), 128, 1 }, { chunk(2), 256, 300 } }, 556);
+
+		// A size already aligned need no padding after it
+		planner.Enqueue(chunk(4), 128);
+		planner.Enqueue(chunk(5), 300);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(3), 0, 500 }, { chunk(4), 512, 128 }, { chunk(5), 640, 300 } }, 940);
+	}
+
+	/* SKIP PAST OVER-BUDGET BUILDS */
+	{
+		const std::string_view scenario = "skip past over-budget builds";
+		VulkanAccelerationStructureBuildPlanner planner(settings);
+
+		planner.Enqueue(chunk(0), 600);
+		planner.Enqueue(chunk(1), 500);
+		planner.Enqueue(chunk(2), 300);
+		planner.Enqueue(chunk(3), 100);
+		planner.PlanBatch(batch);
+		// The second build doesn't fit after the first one, the third one does (first fit)
+		expectBatch(batch, scenario, { { chunk(0), 0, 600 }, { chunk(2), 640, 300 } }, 940);
+		expect(planner.IsQueued(chunk(1)) && planner.IsQueued(chunk(3)) && planner.GetQueuedCount() == 2, scenario, "the skipped builds to stay queued");
+
+		// The skipped build is now the oldest one
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(1), 0, 500 }, { chunk(3), 512, 100 } }, 612);
+	}
+
+	/* MAX BUILDS PER BATCH */
+	{
+		const std::string_view scenario = "max builds per batch";
+		VulkanAccelerationStructureBuildPlannerSettings maxBuildsSettings = settings;
+		maxBuildsSettings.MaxBuildsPerBatch = 3;
+		VulkanAccelerationStructureBuildPlanner planner(maxBuildsSettings);
+
+		for (int32_t x = 0; x < 5; x++)
+			planner.Enqueue(chunk(x), 10);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(0), 0, 10 }, { chunk(1), 128, 10 }, { chunk(2), 256, 10 } }, 266);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(3), 0, 10 }, { chunk(4), 128, 10 } }, 138);
+	}
+
+	/* ENQUEUE AND CANCEL */
+	{
+		const std::string_view scenario = "enqueue and cancel";
+		VulkanAccelerationStructureBuildPlanner planner(settings);
+
+		planner.Enqueue(chunk(0), 100);
+		planner.Enqueue(chunk(1), 100);
+		planner.Enqueue(chunk(0), 300);
+		expect(planner.GetQueuedCount() == 2, scenario, "a chunk queued twice to be queued once");
+
+		expect(planner.Cancel(chunk(1)), scenario, "a queued chunk to be cancelled");
+		expect(planner.Cancel(chunk(1)) == false && planner.IsQueued(chunk(1)) == false, scenario, "a cancelled chunk to not be queued anymore");
+		expect(planner.Cancel(chunk(7)) == false, scenario, "a chunk never queued to not be cancelled");
+
+		// A cancelled chunk queued again goes at the end, the re-queued one kept its place with its new size
+		planner.Enqueue(chunk(2), 100);
+		planner.Enqueue(chunk(1), 100);
+		planner.PlanBatch(batch);
+		expectBatch(batch, scenario, { { chunk(0), 0, 300 }, { chunk(2), 384, 100 }, { chunk(1), 512, 100 } }, 612);
+
+		planner.Enqueue(chunk(3), 100);
+		planner.Clear();
+		expect(planner.HasQueuedBuilds() == false && planner.IsQueued(chunk(3)) == false, scenario, "an empty queue after Clear");
+	}
+
+	/* RANDOM OPERATIONS */
+	{
+		const std::string_view scenario = "random operations";
+		std::mt19937 random(42);
+		VulkanAccelerationStructureBuildPlannerSettings randomSettings;
+		randomSettings.MaxBuildsPerBatch = 8;
+		randomSettings.ScratchBudget = 4096;
+		randomSettings.ScratchAlignment = 256;
+		VulkanAccelerationStructureBuildPlanner planner(randomSettings);
+		// What should be queued, oldest first
+		std::vector<QueuedBuild> expectedQueue;
+
+		for (uint32_t i = 0; i < randomOperationCount && failureCount == 0; i++)
+		{
+			const ChunkCoordinate coordinate = chunk(random() % 32);
+			auto expectedBuildIt = std::find_if(expectedQueue.begin(), expectedQueue.end(), [&coordinate](const QueuedBuild& build) { return (build.Coordinate == coordinate); });
+
+			switch (random() % 3)
+			{
+			case 0:
+			{
+				const uint64_t scratchSize = 1 + random() % 5000;
+				planner.Enqueue(coordinate, scratchSize);
+				if (expectedBuildIt != expectedQueue.end())
+					expectedBuildIt->ScratchSize = scratchSize;
+				else
+					expectedQueue.push_back(QueuedBuild{ coordinate, scratchSize });
+				break;
+			}
+			case 1:
+				expect(planner.Cancel(coordinate) == (expectedBuildIt != expectedQueue.end()), scenario, "Cancel to tell whether or not the chunk was queued");
+				if (expectedBuildIt != expectedQueue.end())
+					expectedQueue.erase(expectedBuildIt);
+				break;
+			default:
+			{
+				planner.PlanBatch(batch);
+				expect(batch.Builds.empty() == expectedQueue.empty(), scenario, "a batch as long as builds are queued");
+				if (batch.Builds.empty())
+					break;
+
+				expect(batch.Builds.front().Coordinate == expectedQueue.front().Coordinate, scenario, "the oldest build to always be taken");
+				expect(batch.Builds.size() <= randomSettings.MaxBuildsPerBatch, scenario, "at most MaxBuildsPerBatch builds");
+				expect(batch.Builds.size() == 1 || batch.ScratchSize <= randomSettings.ScratchBudget, scenario, "a batch over the budget to only have one build");
+
+				uint64_t scratchEnd = 0;
+				auto searchStartIt = expectedQueue.begin();
+				for (const PlannedBuild& build : batch.Builds)
+				{
+					expect(build.ScratchOffset % randomSettings.ScratchAlignment == 0 && build.ScratchOffset >= scratchEnd, scenario, "aligned scratch ranges that don't overlap");
+					scratchEnd = build.ScratchOffset + build.ScratchSize;
+
+					// In the order they were queued, with their last scratch size
+					auto queuedBuildIt = std::find_if(searchStartIt, expectedQueue.end(), [&build](const QueuedBuild& queuedBuild) { return (queuedBuild.Coordinate == build.Coordinate); });
+					expect(queuedBuildIt != expectedQueue.end() && queuedBuildIt->ScratchSize == build.ScratchSize, scenario, "the builds in the order they were queued");
+					if (queuedBuildIt == expectedQueue.end())
+						break;
+					searchStartIt = expectedQueue.erase(queuedBuildIt);
+				}
+				expect(scratchEnd == batch.ScratchSize, scenario, "the scratch size of the batch to end with its last build");
+				break;
+			}
+			}
+
+			expect(planner.GetQueuedCount() == expectedQueue.size(), scenario, "the queued chunks to match the enqueued and cancelled ones");
+		}
+	}
+
+	OV_LOG(LogVulkan, Display, "Acceleration structure build planner self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
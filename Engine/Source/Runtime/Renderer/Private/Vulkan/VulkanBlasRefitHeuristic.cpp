@@ -0,0 +1,211 @@
+#include "Vulkan/VulkanBlasRefitHeuristic.h"
+#include "Vulkan/VulkanUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <string_view>
+
+namespace
+{
+	/** How many primitives a ratio of the last full build allow to change, at least one so the small chunks can be refit */
+	__forceinline uint64_t GetPrimitiveChangeLimit(const VulkanBlasRefitCounters& counters, float ratio)
+	{
+		return (std::max<uint64_t>(static_cast<uint64_t>(std::floor(counters.BuiltAabbCount * ratio)), 1));
+	}
+}
+
+VulkanBlasBuildKind::Type VulkanBlasRefitHeuristic::Decide(const VulkanBlasRefitCounters* counters, uint32_t aabbCount, uint32_t changedPrimitiveCount) const
+{
+	if (m_Settings.bEnabled == false || counters == nullptr || counters->bAllowUpdate == false)
+		return (VulkanBlasBuildKind::Build);
+
+	if (aabbCount > counters->PrimitiveCapacity || counters->RefitCount >= m_Settings.MaxRefitCount)
+		return (VulkanBlasBuildKind::Build);
+
+	if (changedPrimitiveCount > GetPrimitiveChangeLimit(*counters, m_Settings.MaxEditRatio))
+		return (VulkanBlasBuildKind::Build);
+	if (counters->AccumulatedPrimitiveChange + changedPrimitiveCount > GetPrimitiveChangeLimit(*counters, m_Settings.MaxAccumulatedEditRatio))
+		return (VulkanBlasBuildKind::Build);
+
+	return (VulkanBlasBuildKind::Refit);
+}
+
+bool VulkanBlasRefitHeuristic::ShouldAllowUpdate(const VulkanBlasRefitCounters* counters) const
+{
+	// Built before: the chunk is edited, it will probably be again
+	return (m_Settings.bEnabled && counters != nullptr && counters->BuildCount > 0);
+}
+
+uint32_t VulkanBlasRefitHeuristic::GetPrimitiveCapacity(uint32_t aabbCount, bool bAllowUpdate) const
+{
+	if (bAllowUpdate == false)
+		return (aabbCount);
+
+	const uint32_t slack = std::max(static_cast<uint32_t>(std::ceil(aabbCount * m_Settings.PrimitiveSlackRatio)), m_Settings.MinPrimitiveSlack);
+	return (aabbCount + slack);
+}
+
+VulkanBlasRefitCounters VulkanBlasRefitHeuristic::OnBuilt(const VulkanBlasRefitCounters* previous, uint32_t aabbCount, bool bAllowUpdate) const
+{
+	VulkanBlasRefitCounters counters;
+	counters.BuildCount = (previous ? previous->BuildCount : 0) + 1;
+	counters.bAllowUpdate = bAllowUpdate;
+	counters.PrimitiveCapacity = GetPrimitiveCapacity(aabbCount, bAllowUpdate);
+	counters.BuiltAabbCount = aabbCount;
+	counters.AabbCount = aabbCount;
+	return (counters);
+}
+
+VulkanBlasRefitCounters VulkanBlasRefitHeuristic::OnRefit(const VulkanBlasRefitCounters& previous, uint32_t aabbCount, uint32_t changedPrimitiveCount) const
+{
+	VulkanBlasRefitCounters counters = previous;
+	counters.AccumulatedPrimitiveChange += changedPrimitiveCount;
+	counters.AabbCount = aabbCount;
+	counters.RefitCount++;
+	return (counters);
+}
+
+uint32_t VulkanBlasRefitHeuristic::CountChangedPrimitives(const std::vector<VoxelAabb>& previous, const std::vector<VoxelAabb>& current)
+{
+	const size_t commonCount = std::min(previous.size(), current.size());
+	uint32_t changedCount = static_cast<uint32_t>(std::max(previous.size(), current.size()) - commonCount);
+	for (size_t i = 0; i < commonCount; i++)
+	{
+		if (previous[i].Min != current[i].Min || previous[i].Max != current[i].Max)
+			changedCount++;
+	}
+	return (changedCount);
+}
+
+bool VulkanBlasRefitHeuristic::LogSelfTest()
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "BLAS refit heuristic self test, {:s}: expected {:s}", scenario, expectation);
+		failureCount++;
+	};
+
+	// The thresholds below are the ones of the default settings
+	const VulkanBlasRefitHeuristic heuristic;
+	const VulkanBlasRefitSettings& settings = heuristic.GetSettings();
+	expect(settings.MaxRefitCount == 16 && settings.MaxEditRatio == 0.1f && settings.MaxAccumulatedEditRatio == 0.5f
+		&& settings.PrimitiveSlackRatio == 0.25f && settings.MinPrimitiveSlack == 8, "default settings", "the settings the test is written for");
+	// A chunk built when it was loaded, then rebuilt for its first edit (with eAllowUpdate)
+	auto buildEditedChunk = [](const VulkanBlasRefitHeuristic& heuristic, uint32_t aabbCount)
+	{
+		const VulkanBlasRefitCounters loaded = heuristic.OnBuilt(nullptr, aabbCount, false);
+		return (heuristic.OnBuilt(&loaded, aabbCount, heuristic.ShouldAllowUpdate(&loaded)));
+	};
+
+	/* LOADED THEN EDITED CHUNK */
+	{
+		const std::string_view scenario = "loaded then edited chunk";
+		expect(heuristic.Decide(nullptr, 100, 0) == VulkanBlasBuildKind::Build, scenario, "a full build for a chunk never built");
+		expect(heuristic.ShouldAllowUpdate(nullptr) == false, scenario, "the loaded chunks to be built for tracing (compacted, no update)");
+
+		const VulkanBlasRefitCounters loaded = heuristic.OnBuilt(nullptr, 100, false);
+		expect(loaded.BuildCount == 1 && loaded.PrimitiveCapacity == 100 && loaded.RefitCount == 0, scenario, "a first build without slack");
+		expect(heuristic.Decide(&loaded, 100, 1) == VulkanBlasBuildKind::Build, scenario, "the first edit to rebuild a BLAS that doesn't allow update");
+		expect(heuristic.ShouldAllowUpdate(&loaded), scenario, "the first edit to rebuild with eAllowUpdate");
+
+		const VulkanBlasRefitCounters edited = heuristic.OnBuilt(&loaded, 100, true);
+		expect(edited.BuildCount == 2 && edited.bAllowUpdate && edited.PrimitiveCapacity == 125, scenario, "the rebuild to have a slack of 25%");
+		expect(heuristic.Decide(&edited, 100, 1) == VulkanBlasBuildKind::Refit, scenario, "the next small edit to refit");
+	}
+
+	/* PRIMITIVE CAPACITY */
+	{
+		const std::string_view scenario = "primitive capacity";
+		const uint32_t expectedCapacities[][3] = {
+			// AABB count, without update, with update
+			{ 0, 0, 8 },
+			{ 10, 10, 18 },
+			{ 32, 32, 40 },
+			{ 33, 33, 42 },
+			{ 100, 100, 125 },
+			{ 101, 101, 127 },
+		};
+		for (const auto& [aabbCount, capacity, capacityWithUpdate] : expectedCapacities)
+		{
+			expect(heuristic.GetPrimitiveCapacity(aabbCount, false) == capacity, scenario, std::format("no slack for {:d} AABBs without update", aabbCount));
+			expect(heuristic.GetPrimitiveCapacity(aabbCount, true) == capacityWithUpdate, scenario,
+				std::format("{:d} primitives for {:d} AABBs with update (got {:d})", capacityWithUpdate, aabbCount, heuristic.GetPrimitiveCapacity(aabbCount, true)));
+		}
+	}
+
+	/* THRESHOLDS */
+	{
+		const std::string_view scenario = "thresholds";
+		const VulkanBlasRefitCounters edited = buildEditedChunk(heuristic, 100);
+
+		// 10% of the 100 AABBs of the last full build
+		expect(heuristic.Decide(&edited, 100, 10) == VulkanBlasBuildKind::Refit, scenario, "an edit of 10 primitives to refit");
+		expect(heuristic.Decide(&edited, 100, 11) == VulkanBlasBuildKind::Build, scenario, "an edit of 11 primitives to rebuild");
+		// The slack is the limit of the AABBs a refit can add
+		expect(heuristic.Decide(&edited, 125, 10) == VulkanBlasBuildKind::Refit, scenario, "an edit that fill the slack to refit");
+		expect(heuristic.Decide(&edited, 126, 10) == VulkanBlasBuildKind::Build, scenario, "an edit over the slack to rebuild");
+
+		// 50% of the last full build in total, the counters of the refits add up
+		VulkanBlasRefitCounters counters = edited;
+		for (uint32_t i = 0; i < 5; i++)
+		{
+			expect(heuristic.Decide(&counters, 100, 10) == VulkanBlasBuildKind::Refit, scenario, std::format("the refit {:d} of 10 primitives to stay under the accumulated limit", i));
+			counters = heuristic.OnRefit(counters, 100, 10);
+		}
+		expect(counters.RefitCount == 5 && counters.AccumulatedPrimitiveChange == 50 && counters.BuiltAabbCount == 100, scenario, "the refits to be counted");
+		expect(heuristic.Decide(&counters, 100, 1) == VulkanBlasBuildKind::Build, scenario, "a rebuild once the refits changed half the primitives");
+
+		const VulkanBlasRefitCounters rebuilt = heuristic.OnBuilt(&counters, 100, heuristic.ShouldAllowUpdate(&counters));
+		expect(rebuilt.BuildCount == 3 && rebuilt.RefitCount == 0 && rebuilt.AccumulatedPrimitiveChange == 0, scenario, "a rebuild to reset the refit counters");
+
+		// Refits of a single primitive in a row, far from the accumulated limit
+		counters = rebuilt;
+		for (uint32_t i = 0; i < settings.MaxRefitCount; i++)
+			counters = heuristic.OnRefit(counters, 100, 1);
+		expect(heuristic.Decide(&counters, 100, 1) == VulkanBlasBuildKind::Build, scenario, "a rebuild after MaxRefitCount refits in a row");
+
+		// The limits are at least one primitive, so the chunks with a few AABBs can be refit too
+		const VulkanBlasRefitCounters small = buildEditedChunk(heuristic, 3);
+		expect(heuristic.Decide(&small, 3, 1) == VulkanBlasBuildKind::Refit, scenario, "an edit of 1 primitive of a 3 AABBs chunk to refit");
+		expect(heuristic.Decide(&small, 3, 2) == VulkanBlasBuildKind::Build, scenario, "an edit of 2 primitives of a 3 AABBs chunk to rebuild");
+	}
+
+	/* DISABLED */
+	{
+		const std::string_view scenario = "disabled";
+		VulkanBlasRefitSettings disabledSettings;
+		disabledSettings.bEnabled = false;
+		const VulkanBlasRefitHeuristic disabled(disabledSettings);
+
+		const VulkanBlasRefitCounters edited = buildEditedChunk(heuristic, 100);
+		expect(disabled.Decide(&edited, 100, 1) == VulkanBlasBuildKind::Build, scenario, "every edit to rebuild");
+		expect(disabled.ShouldAllowUpdate(&edited) == false, scenario, "no BLAS built with eAllowUpdate");
+	}
+
+	/* CHANGED PRIMITIVES */
+	{
+		const std::string_view scenario = "changed primitives";
+		auto makeAabb = [](float x) { return (VoxelAabb{ glm::vec3(x, 0.0f, 0.0f), glm::vec3(x + 1.0f, 1.0f, 1.0f) }); };
+		const std::vector<VoxelAabb> aabbs = { makeAabb(0.0f), makeAabb(1.0f), makeAabb(2.0f), makeAabb(3.0f) };
+
+		expect(CountChangedPrimitives(aabbs, aabbs) == 0, scenario, "no change between the same AABBs");
+		expect(CountChangedPrimitives({}, aabbs) == 4 && CountChangedPrimitives(aabbs, {}) == 4, scenario, "every AABB added or removed to count");
+
+		std::vector<VoxelAabb> grown = aabbs;
+		grown[1].Max.y = 2.0f;
+		grown.push_back(makeAabb(4.0f));
+		expect(CountChangedPrimitives(aabbs, grown) == 2, scenario, "a changed AABB and an added one to count 2");
+
+		// Removing the first box move every other one to a new index, each of them is changed by the refit
+		const std::vector<VoxelAabb> shifted(aabbs.begin() + 1, aabbs.end());
+		expect(CountChangedPrimitives(aabbs, shifted) == 4, scenario, "the AABBs that moved to another index to count");
+	}
+
+	OV_LOG(LogVulkan, Display, "BLAS refit heuristic self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
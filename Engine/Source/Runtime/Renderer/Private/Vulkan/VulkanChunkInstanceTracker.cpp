@@ -0,0 +1,296 @@
+#include "Vulkan/VulkanChunkInstanceTracker.h"
+#include "Vulkan/VulkanUtils.h"
+
+#include <algorithm>
+#include <format>
+#include <string_view>
+
+void VulkanChunkInstanceTracker::MarkChunkDirty(const ChunkCoordinate& coordinate)
+{
+	auto chunkIt = m_Chunks.find(coordinate);
+	if (chunkIt != m_Chunks.end())
+		chunkIt->second.bDirty = true;
+}
+
+void VulkanChunkInstanceTracker::MarkAllChunksDirty()
+{
+	for (auto& [coordinate, state] : m_Chunks)
+		state.bDirty = true;
+}
+
+std::vector<ChunkCoordinate> VulkanChunkInstanceTracker::GetDirtyChunks() const
+{
+	std::vector<ChunkCoordinate> dirtyChunks;
+	for (const auto& [coordinate, state] : m_Chunks)
+	{
+		if (state.bDirty)
+			dirtyChunks.push_back(coordinate);
+	}
+	SortCoordinates(dirtyChunks);
+	return (dirtyChunks);
+}
+
+bool VulkanChunkInstanceTracker::HasDirtyChunks() const
+{
+	return (std::any_of(m_Chunks.begin(), m_Chunks.end(), [](const auto& chunk) { return (chunk.second.bDirty); }));
+}
+
+void VulkanChunkInstanceTracker::OnChunkBuilt(const ChunkCoordinate& coordinate, uint64_t revision, vk::DeviceAddress blasAddress, vk::DeviceAddress aabbBufferAddress)
+{
+	ChunkState& state = m_Chunks[coordinate];
+	state.BuiltRevision = revision;
+	state.BlasAddress = blasAddress;
+	state.AabbBufferAddress = aabbBufferAddress;
+	state.bDirty = false;
+}
+
+std::vector<ChunkCoordinate> VulkanChunkInstanceTracker::TakeRemovedChunks()
+{
+	std::vector<ChunkCoordinate> removedChunks = std::move(m_RemovedChunks);
+	m_RemovedChunks.clear();
+	return (removedChunks);
+}
+
+const VulkanChunkInstanceTracker::ChunkState* VulkanChunkInstanceTracker::FindChunk(const ChunkCoordinate& coordinate) const
+{
+	auto chunkIt = m_Chunks.find(coordinate);
+	return (chunkIt == m_Chunks.end() ? nullptr : &chunkIt->second);
+}
+
+void VulkanChunkInstanceTracker::Clear()
+{
+	m_Chunks.clear();
+	m_RemovedChunks.clear();
+}
+
+glm::mat4 VulkanChunkInstanceTracker::MakeChunkTransform(const ChunkCoordinate& coordinate)
+{
+	glm::mat4 transform(1.0f);
+	transform[3] = glm::vec4(glm::vec3(VoxelWorld::ToChunkOrigin(coordinate)), 1.0f);
+	return (transform);
+}
+
+vk::TransformMatrixKHR VulkanChunkInstanceTracker::PackTransform(const glm::mat4& transform)
+{
+	// glm is column major (transform[column][row]), Vulkan want the 3 first rows
+	std::array<std::array<float, 4>, 3> matrix;
+	for (uint32_t row = 0; row < 3; row++)
+	{
+		for (uint32_t column = 0; column < 4; column++)
+			matrix[row][column] = transform[column][row];
+	}
+	return (vk::TransformMatrixKHR(matrix));
+}
+
+vk::AccelerationStructureInstanceKHR VulkanChunkInstanceTracker::MakeInstance(const glm::mat4& transform, uint32_t customIndex, vk::DeviceAddress blasAddress)
+{
+	CHECK(customIndex < MaxInstanceCount);
+
+	return (vk::AccelerationStructureInstanceKHR(
+		PackTransform(transform),
+		customIndex,
+		0xFF, // mask
+		0, // instanceShaderBindingTableRecordOffset
+		vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable,
+		blasAddress
+	));
+}
+
+void VulkanChunkInstanceTracker::SortCoordinates(std::vector<ChunkCoordinate>& coordinates)
+{
+	std::sort(coordinates.begin(), coordinates.end(),
+		[](const ChunkCoordinate& a, const ChunkCoordinate& b)
+		{
+			if (a.z != b.z)
+				return (a.z < b.z);
+			if (a.y != b.y)
+				return (a.y < b.y);
+			return (a.x < b.x);
+		}
+	);
+}
+
+bool VulkanChunkInstanceTracker::LogSelfTest()
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Chunk instance tracker self test, {:s}: expected {:s}", scenario, expectation);
+		failureCount++;
+	};
+
+	// Fake device addresses derived from the coordinate, so an instance can be matched with the chunk it was built for
+	auto blasAddress = [](const ChunkCoordinate& coordinate)
+	{
+		return (static_cast<vk::DeviceAddress>(((coordinate.x + 128) | (coordinate.y + 128) << 8 | (coordinate.z + 128) << 16) + 1) << 16);
+	};
+	auto aabbBufferAddress = [&blasAddress](const ChunkCoordinate& coordinate) { return (blasAddress(coordinate) | 0x100); };
+	auto buildDirtyChunks = [&blasAddress, &aabbBufferAddress](VulkanChunkInstanceTracker& tracker, const VoxelWorld& world)
+	{
+		for (const ChunkCoordinate& coordinate : tracker.GetDirtyChunks())
+			tracker.OnChunkBuilt(coordinate, world.FindChunk(coordinate)->GetRevision(), blasAddress(coordinate), aabbBufferAddress(coordinate));
+	};
+	// Each instance must have its index as custom index, and the BLAS, AABBs and translation of the chunk at the same index
+	auto expectInstances = [&](const InstanceList& instances, std::string_view scenario, const std::vector<ChunkCoordinate>& expectedCoordinates)
+	{
+		expect(instances.Coordinates == expectedCoordinates, scenario, std::format("the {:d} expected chunks, sorted (got {:d})", expectedCoordinates.size(), instances.Coordinates.size()));
+		expect(instances.Instances.size() == instances.Coordinates.size() && instances.AabbBufferAddresses.size() == instances.Coordinates.size(), scenario,
+			"as many instances and AABB addresses as chunks");
+		for (size_t i = 0; i < std::min({ instances.Instances.size(), instances.AabbBufferAddresses.size(), instances.Coordinates.size() }); i++)
+		{
+			const vk::AccelerationStructureInstanceKHR& instance = instances.Instances[i];
+			const ChunkCoordinate& coordinate = instances.Coordinates[i];
+			const glm::ivec3 origin = VoxelWorld::ToChunkOrigin(coordinate);
+			expect(instance.instanceCustomIndex == i, scenario, std::format("the custom index {:d} (got {:d})", i, static_cast<uint32_t>(instance.instanceCustomIndex)));
+			expect(instance.accelerationStructureReference == blasAddress(coordinate) && instances.AabbBufferAddresses[i] == aabbBufferAddress(coordinate), scenario,
+				std::format("the BLAS and AABBs of the chunk ({:d}, {:d}, {:d}) at the index {:d}", coordinate.x, coordinate.y, coordinate.z, i));
+			expect(instance.transform.matrix[0][3] == static_cast<float>(origin.x) && instance.transform.matrix[1][3] == static_cast<float>(origin.y)
+				&& instance.transform.matrix[2][3] == static_cast<float>(origin.z), scenario,
+				std::format("the instance {:d} translated to the origin of its chunk", i));
+		}
+	};
+
+	const int32_t size = VoxelChunkDimension::Size;
+	const ChunkCoordinate first(0, 0, 0);
+	const ChunkCoordinate second(1, 0, 0);
+	const ChunkCoordinate third(-1, 2, 0);
+	const ChunkCoordinate fourth(0, 0, 1);
+
+	/* ADD AND REMOVE CHUNKS */
+	{
+		const std::string_view scenario = "add and remove";
+		VoxelWorld world;
+		VulkanChunkInstanceTracker tracker;
+		InstanceList instances;
+
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(first), 1);
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(second), 1);
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(third), 1);
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(fourth), 1);
+		tracker.SyncWithWorld(world);
+		expect(tracker.GetDirtyChunks() == std::vector<ChunkCoordinate>{ first, second, third, fourth }, scenario, "the 4 new chunks dirty, sorted by z, y then x");
+		tracker.GenerateInstances(instances);
+		expectInstances(instances, scenario, {});
+
+		buildDirtyChunks(tracker, world);
+		tracker.SyncWithWorld(world);
+		expect(!tracker.HasDirtyChunks(), scenario, "no dirty chunk once they are built");
+		tracker.GenerateInstances(instances);
+		expectInstances(instances, scenario, { first, second, third, fourth });
+
+		// Removing a chunk from the middle of the list: the chunks after it move down and keep their own BLAS and AABBs
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(second), EmptyVoxel);
+		tracker.SyncWithWorld(world);
+		expect(tracker.FindChunk(second) == nullptr && tracker.GetChunkCount() == 3, scenario, "the removed chunk forgotten");
+		expect(tracker.TakeRemovedChunks() == std::vector<ChunkCoordinate>{ second }, scenario, "the removed chunk to destroy its BLAS");
+		expect(tracker.TakeRemovedChunks().empty(), scenario, "the removed chunks taken only once");
+		tracker.GenerateInstances(instances);
+		expectInstances(instances, scenario, { first, third, fourth });
+
+		// Adding it back, it takes its index again and shifts the ones after it
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(second) + glm::ivec3(size - 1), 2);
+		tracker.SyncWithWorld(world);
+		expect(tracker.GetDirtyChunks() == std::vector<ChunkCoordinate>{ second }, scenario, "only the added chunk dirty");
+		buildDirtyChunks(tracker, world);
+		tracker.GenerateInstances(instances);
+		expectInstances(instances, scenario, { first, second, third, fourth });
+
+		// A chunk removed before its BLAS was built has nothing to destroy
+		const ChunkCoordinate unbuilt(5, 5, 5);
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(unbuilt), 1);
+		tracker.SyncWithWorld(world);
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(unbuilt), EmptyVoxel);
+		tracker.SyncWithWorld(world);
+		expect(tracker.FindChunk(unbuilt) == nullptr && tracker.TakeRemovedChunks().empty(), scenario, "a chunk never built forgotten without being removed");
+
+		tracker.Clear();
+		expect(tracker.GetChunkCount() == 0 && tracker.TakeRemovedChunks().empty(), scenario, "no chunk after a clear");
+	}
+
+	/* DIRTY TRACKING */
+	{
+		const std::string_view scenario = "dirty tracking";
+		VoxelWorld world;
+		VulkanChunkInstanceTracker tracker;
+		InstanceList instances;
+
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(first), 1);
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(second), 1);
+		tracker.SyncWithWorld(world);
+		buildDirtyChunks(tracker, world);
+
+		// An edit only dirties its chunk, which keeps its previous BLAS until it is rebuilt
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(second) + glm::ivec3(1, 0, 0), 3);
+		tracker.SyncWithWorld(world);
+		expect(tracker.GetDirtyChunks() == std::vector<ChunkCoordinate>{ second }, scenario, "only the edited chunk dirty");
+		tracker.GenerateInstances(instances);
+		expectInstances(instances, scenario, { first, second });
+		buildDirtyChunks(tracker, world);
+
+		// Writing the voxel already there doesn't change the revision
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(second) + glm::ivec3(1, 0, 0), 3);
+		tracker.SyncWithWorld(world);
+		expect(!tracker.HasDirtyChunks(), scenario, "no dirty chunk after writing the same voxel");
+
+		tracker.MarkChunkDirty(first);
+		tracker.MarkChunkDirty(third);
+		expect(tracker.GetDirtyChunks() == std::vector<ChunkCoordinate>{ first } && tracker.FindChunk(third) == nullptr, scenario,
+			"a chunk marked dirty, and an untracked one ignored");
+		tracker.MarkAllChunksDirty();
+		expect(tracker.GetDirtyChunks() == std::vector<ChunkCoordinate>{ first, second }, scenario, "every chunk marked dirty");
+	}
+
+	/* VISIBLE CHUNKS */
+	{
+		const std::string_view scenario = "visible chunks";
+		VoxelWorld world;
+		VulkanChunkInstanceTracker tracker;
+		InstanceList instances;
+
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(first), 1);
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(second), 1);
+		world.SetVoxel(VoxelWorld::ToChunkOrigin(third), 1);
+		tracker.SyncWithWorld(world);
+		buildDirtyChunks(tracker, world);
+
+		// The instances of the hidden chunks are skipped, the custom indices of the visible ones stay dense
+		tracker.GenerateInstances(instances, [&first](const ChunkCoordinate& coordinate) { return (coordinate != first); });
+		expectInstances(instances, scenario, { second, third });
+	}
+
+	/* TRANSFORM PACKING */
+	{
+		const std::string_view scenario = "transform packing";
+
+		// Vulkan want the rows of the matrix, glm store its columns
+		glm::mat4 transform(0.0f);
+		for (uint32_t column = 0; column < 4; column++)
+		{
+			for (uint32_t row = 0; row < 4; row++)
+				transform[column][row] = static_cast<float>(10 * row + column);
+		}
+		const vk::TransformMatrixKHR packed = PackTransform(transform);
+		bool bRowMajor = true;
+		for (uint32_t row = 0; row < 3; row++)
+		{
+			for (uint32_t column = 0; column < 4; column++)
+				bRowMajor &= (packed.matrix[row][column] == static_cast<float>(10 * row + column));
+		}
+		expect(bRowMajor, scenario, "the 3 first rows of the matrix");
+
+		const vk::AccelerationStructureInstanceKHR instance = MakeInstance(MakeChunkTransform(third), 42, blasAddress(third));
+		expect(instance.transform.matrix[0][0] == 1.0f && instance.transform.matrix[1][1] == 1.0f && instance.transform.matrix[2][2] == 1.0f
+			&& instance.transform.matrix[0][1] == 0.0f && instance.transform.matrix[1][0] == 0.0f, scenario, "a chunk transform without rotation nor scale");
+		expect(instance.transform.matrix[0][3] == static_cast<float>(-size) && instance.transform.matrix[1][3] == static_cast<float>(2 * size)
+			&& instance.transform.matrix[2][3] == 0.0f, scenario, "the chunk (-1, 2, 0) translated to its first voxel");
+		expect(instance.instanceCustomIndex == 42 && instance.mask == 0xFF && instance.instanceShaderBindingTableRecordOffset == 0
+			&& instance.flags == static_cast<uint32_t>(vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable)
+			&& instance.accelerationStructureReference == blasAddress(third), scenario, "the custom index, mask, hit group, flags and BLAS of the instance");
+	}
+
+	OV_LOG(LogVulkan, Display, "Chunk instance tracker self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
@@ -0,0 +1,103 @@
+#include "Vulkan/VulkanDescriptorWriter.h"
+
+#include <algorithm>
+
+VulkanDescriptorWriter::VulkanDescriptorWriter(const VulkanDescriptorLayout& layout, vk::DescriptorSet descriptorSet, uint32_t set)
+	: m_Layout(layout), m_DescriptorSet(descriptorSet), m_Set(set)
+{}
+
+bool VulkanDescriptorWriter::WriteAccelerationStructure(std::string_view name, vk::AccelerationStructureKHR accelerationStructure)
+{
+	const VulkanDescriptorBinding* binding = FindBinding(name, { vk::DescriptorType::eAccelerationStructureKHR });
+	if (!binding)
+		return (false);
+
+	m_AccelerationStructures.push_back(accelerationStructure);
+	m_AccelerationStructureInfos.push_back(vk::WriteDescriptorSetAccelerationStructureKHR(1, &m_AccelerationStructures.back()));
+	m_Writes.push_back(
+		vk::WriteDescriptorSet(
+			m_DescriptorSet,
+			binding->Binding,
+			0,
+			1, binding->Type,
+			nullptr,
+			nullptr,
+			nullptr,
+			&m_AccelerationStructureInfos.back()
+		)
+	);
+	return (true);
+}
+
+bool VulkanDescriptorWriter::WriteImage(std::string_view name, vk::ImageView imageView, vk::ImageLayout imageLayout, vk::Sampler sampler)
+{
+	const VulkanDescriptorBinding* binding = FindBinding(name, {
+		vk::DescriptorType::eStorageImage, vk::DescriptorType::eSampledImage, vk::DescriptorType::eCombinedImageSampler, vk::DescriptorType::eInputAttachment
+	});
+	if (!binding)
+		return (false);
+
+	m_ImageInfos.push_back(vk::DescriptorImageInfo(sampler, imageView, imageLayout));
+	m_Writes.push_back(
+		vk::WriteDescriptorSet(
+			m_DescriptorSet,
+			binding->Binding,
+			0,
+			1, binding->Type,
+			&m_ImageInfos.back(),
+			nullptr,
+			nullptr
+		)
+	);
+	return (true);
+}
+
+bool VulkanDescriptorWriter::WriteBuffer(std::string_view name, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+	const VulkanDescriptorBinding* binding = FindBinding(name, { vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eUniformBuffer });
+	if (!binding)
+		return (false);
+
+	m_BufferInfos.push_back(vk::DescriptorBufferInfo(buffer, offset, range));
+	m_Writes.push_back(
+		vk::WriteDescriptorSet(
+			m_DescriptorSet,
+			binding->Binding,
+			0,
+			1, binding->Type,
+			nullptr,
+			&m_BufferInfos.back(),
+			nullptr
+		)
+	);
+	return (true);
+}
+
+void VulkanDescriptorWriter::Update(vk::Device device)
+{
+	if (m_Writes.empty() == false)
+		device.updateDescriptorSets(static_cast<uint32_t>(m_Writes.size()), m_Writes.data(), 0, nullptr);
+
+	m_Writes.clear();
+	m_AccelerationStructures.clear();
+	m_AccelerationStructureInfos.clear();
+	m_ImageInfos.clear();
+	m_BufferInfos.clear();
+}
+
+const VulkanDescriptorBinding* VulkanDescriptorWriter::FindBinding(std::string_view name, std::initializer_list<vk::DescriptorType> types) const
+{
+	const VulkanDescriptorBinding* binding = m_Layout.FindBinding(name);
+	if (!binding || binding->Set != m_Set)
+	{
+		// The optimizer remove the descriptors a shader doesn't use, so it's not an error
+		OV_LOG(LogVulkan, Verbose, "No shader use the descriptor \"{:s}\" in the set {:d}", std::string(name), m_Set);
+		return (nullptr);
+	}
+	if (std::find(types.begin(), types.end(), binding->Type) == types.end())
+	{
+		OV_LOG(LogVulkan, Error, "The descriptor \"{:s}\" is a {:s} in the shaders", std::string(name), vk::to_string(binding->Type));
+		return (nullptr);
+	}
+	return (binding);
+}
@@ -1,7 +1,8 @@
 #include "Vulkan/VulkanDeviceHandler.h"
 #include "Vulkan/VulkanInstanceHandler.h"
 
-#include <set>
+#include <algorithm>
+#include <string>
 
 VulkanDeviceHandler::VulkanDeviceHandler(const VulkanInstanceHandler* instance)
 	: m_VkInstance(instance)
@@ -32,8 +33,8 @@ void VulkanDeviceHandler::CreateDevice(const vk::SurfaceKHR& surface)
 	OV_LOG(LogVulkan, Verbose, "Vulkan device layers enabled:");
 	OV_LOG_ARRAY(LogVulkan, Verbose, m_Layers, "\t\"{:s}\"");
 
-	auto famillyIndices = FindQueueFamilyIndices(surface);
-	auto queuesCreateInfo = SetupQueuesCreateInfo(famillyIndices);
+	m_QueueFamilies = FindQueueFamilyIndices(surface);
+	auto queuesCreateInfo = SetupQueuesCreateInfo(m_QueueFamilies);
 
 	vk::PhysicalDeviceFeatures physicalDeviceFeatures = {};
 	vk::DeviceCreateInfo deviceCreateInfo(
@@ -46,19 +47,34 @@ void VulkanDeviceHandler::CreateDevice(const vk::SurfaceKHR& surface)
 	);
 	m_Device = m_PhysicalDevice.createDevice(deviceCreateInfo);
 
-	// Initialize m_Queues array with all the queue that has been create at the logical device creation
+	// Initialize m_Queues array with all the queue that has been create at the logical device creation, the types on the same family get the same queue
 	for (uint8_t i = 0; i < VulkanQueueType::COUNT; i++)
 	{
 		VulkanQueueType::Type queueType = static_cast<VulkanQueueType::Type>(i);
-		m_Queues[queueType] = VulkanQueue(m_Device.getQueue(famillyIndices[queueType], 0));
-		m_Queues[queueType].FamilyIndex = famillyIndices[queueType];
+		m_Queues[queueType] = VulkanQueue(m_Device.getQueue(m_QueueFamilies[queueType], 0));
+		m_Queues[queueType].FamilyIndex = m_QueueFamilies[queueType];
 	}
 
 	m_PhysicalDeviceProperties = m_PhysicalDevice.getProperties();
 
 	m_PhysicalDeviceProperties2.pNext = &m_RaytracingProperties;
+	m_RaytracingProperties.pNext = &m_AccelerationStructureProperties;
 	m_PhysicalDevice.getProperties2(&m_PhysicalDeviceProperties2);
 
+	// The blocks can only be bound to buffers that have a device address when they are allocated with the flag
+	const bool bBufferDeviceAddress = std::any_of(m_Extensions.begin(), m_Extensions.end(),
+		[](const char* extension) { return (strcmp(extension, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME) == 0); }
+	);
+
+	VulkanMemoryAllocatorSettings memoryAllocatorSettings;
+	memoryAllocatorSettings.BufferImageGranularity = m_PhysicalDeviceProperties.limits.bufferImageGranularity;
+	memoryAllocatorSettings.MaxDeviceAllocationCount = m_PhysicalDeviceProperties.limits.maxMemoryAllocationCount;
+	m_MemoryAllocator = std::make_unique<VulkanMemoryAllocator>(
+		VulkanMemoryTypeTable::FromProperties(GetPhysicalDeviceMemoryProperties()),
+		std::make_unique<VulkanDeviceMemoryBlockSource>(m_Device, bBufferDeviceAddress),
+		std::move(memoryAllocatorSettings)
+	);
+
 	m_IsDeviceCreated = true;
 }
 
@@ -66,6 +82,9 @@ void VulkanDeviceHandler::DestroyDevice()
 {
 	CHECK(m_IsDeviceCreated);
 
+	// Every resource must be destroyed at this point, what is still allocated is logged as a leak
+	m_MemoryAllocator.reset();
+
 	m_Device.destroy();
 
 	m_VkInstance = nullptr;
@@ -201,95 +220,54 @@ bool VulkanDeviceHandler::allLayersAreSupported() const
 	return (areTheyAllSupported);
 }
 
-std::array<uint32_t, VulkanQueueType::COUNT> VulkanDeviceHandler::FindQueueFamilyIndices(const vk::SurfaceKHR& surface) const
+VulkanQueueFamilyIndices VulkanDeviceHandler::FindQueueFamilyIndices(const vk::SurfaceKHR& surface) const
 {
 	CHECK(m_PhysicalDevice, "No physical device selected, Unable to find queues indices's");
-	std::array<uint32_t, VulkanQueueType::COUNT> queueFamilyIndices;
-	// Fill with default value otherwise it will be filled with garbage or 0 (which is a valid index)
-	queueFamilyIndices.fill(UINT32_MAX);
 
-	auto queueFamilyProperties = m_PhysicalDevice.getQueueFamilyProperties();
-	for (uint32_t i = 0; i < queueFamilyProperties.size(); i++)
-	{
-		if (queueFamilyIndices[VulkanQueueType::Graphic] == UINT32_MAX
-			&& queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eGraphics)
-			queueFamilyIndices[VulkanQueueType::Graphic] = i;
-		if (queueFamilyIndices[VulkanQueueType::Present] == UINT32_MAX
-			&& m_PhysicalDevice.getSurfaceSupportKHR(i, surface))
-			queueFamilyIndices[VulkanQueueType::Present] = i;
-		/* Not using compute nor transfer yet
-		if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eCompute)
-			queueFamilyIndices[VulkanQueueType::Compute] = i;
-		if (queueFamilyProperties[i].queueFlags & vk::QueueFlagBits::eTransfer)
-			queueFamilyIndices[VulkanQueueType::Transfer] = i;
-		*/
-	}
+	VulkanQueueFamilyIndices queueFamilyIndices = VulkanQueueFamilyIndices::Select(
+		m_PhysicalDevice.getQueueFamilyProperties(),
+		[this, &surface](uint32_t familyIndex) { return (m_PhysicalDevice.getSurfaceSupportKHR(familyIndex, surface) == VK_TRUE); }
+	);
+	OV_LOG_IF(queueFamilyIndices.IsComplete() == false, LogVulkan, Fatal, "No queue family can render or present on the surface");
+
+	OV_LOG_IF(queueFamilyIndices.IsDedicated(VulkanQueueType::Compute) == false, LogVulkan, Verbose, "No dedicated compute queue family, the acceleration structures are built on the graphic queue");
+	OV_LOG_IF(queueFamilyIndices.IsDedicated(VulkanQueueType::Transfer) == false, LogVulkan, Verbose, "No dedicated transfer queue family, the uploads are submitted on the graphic queue");
 
 	return (queueFamilyIndices);
 }
 
-std::vector<vk::DeviceQueueCreateInfo> VulkanDeviceHandler::SetupQueuesCreateInfo(const std::array<uint32_t, VulkanQueueType::COUNT>& queueFamilyIndices) const
+std::vector<vk::DeviceQueueCreateInfo> VulkanDeviceHandler::SetupQueuesCreateInfo(const VulkanQueueFamilyIndices& queueFamilyIndices) const
 {
 	std::vector<vk::DeviceQueueCreateInfo> queuesCreateInfo;
-	std::set<uint32_t> uniqueQueueFamillyIndices = { // a set will also remove duplicates
-		queueFamilyIndices[VulkanQueueType::Graphic],
-		queueFamilyIndices[VulkanQueueType::Present],
-		// queueFamilyIndices[VulkanQueueType::Compute], // Not using compute nor transfer yet
-		// queueFamilyIndices[VulkanQueueType::Transfer]
-	};
 
 	OV_LOG(LogVulkan, VeryVerbose, "Vulkan Queue families indices's:");
 
-	float queuePriority = 1.0f;
-	for (uint32_t uniqueQueueFamillyIndex : uniqueQueueFamillyIndices)
+	// Must outlive the device creation, the create infos point to it
+	static const float queuePriority = 1.0f;
+	for (uint32_t uniqueQueueFamillyIndex : queueFamilyIndices.GetUniqueFamilies())
 	{
-		// UINT32_MAX is a value that I setup to tell that no family index is available
-		if (uniqueQueueFamillyIndex != UINT32_MAX)
+		vk::DeviceQueueCreateInfo queueCreateInfo(
+			vk::DeviceQueueCreateFlags(),
+			uniqueQueueFamillyIndex,
+			1,
+			&queuePriority
+		);
+		queuesCreateInfo.push_back(queueCreateInfo);
+
+#if WITH_LOGGING
+		std::string queueTypes;
+		for (uint8_t i = 0; i < VulkanQueueType::COUNT; i++)
 		{
-			vk::DeviceQueueCreateInfo queueCreateInfo(
-				vk::DeviceQueueCreateFlags(),
-				uniqueQueueFamillyIndex,
-				1,
-				&queuePriority
-			);
-			queuesCreateInfo.push_back(queueCreateInfo);
-
-			OV_LOG(LogVulkan, VeryVerbose, "\tQueue family {:d} will be used for: {:s} ",
-				uniqueQueueFamillyIndex,
-				VulkanQueueType::ToString(
-					uniqueQueueFamillyIndex == queueFamilyIndices[VulkanQueueType::Graphic] ? VulkanQueueType::Graphic :
-					uniqueQueueFamillyIndex == queueFamilyIndices[VulkanQueueType::Present] ? VulkanQueueType::Present : VulkanQueueType::COUNT
-					// Not using compute nor transfer yet
-					// uniqueQueueFamillyIndex == queueFamilyIndices[VulkanQueueType::Compute] ? VulkanQueueType::Compute :
-					// uniqueQueueFamillyIndex == queueFamilyIndices[VulkanQueueType::Transfer] ? VulkanQueueType::Transfer :
-				)
-			);
+			const VulkanQueueType::Type queueType = static_cast<VulkanQueueType::Type>(i);
+			if (queueFamilyIndices[queueType] == uniqueQueueFamillyIndex)
+				queueTypes += (queueTypes.empty() ? "" : ", ") + std::string(VulkanQueueType::ToString(queueType));
 		}
+		OV_LOG(LogVulkan, VeryVerbose, "\tQueue family {:d} will be used for: {:s}", uniqueQueueFamillyIndex, queueTypes);
+#endif
 	}
 	return (queuesCreateInfo);
 }
 
-/* VULKAN QUEUE TYPE NAMESPACE */
-
-const char* VulkanQueueType::ToString(Type vulkanQueueType)
-{
-	switch (vulkanQueueType)
-	{
-	case Type::Graphic:
-		return ("Graphic");
-	case Type::Present:
-		return ("Present");
-	/* Not using compute nor transfer yet
-	case Type::Compute:
-		return ("Compute");
-	case Type::Transfer:
-		return ("Transfer");
-	*/
-	default:
-		return ("Unknown");
-	}
-}
-
 VulkanMemoryRequirementsExtended VulkanDeviceHandler::FindMemoryRequirement(const vk::Buffer& buffer, vk::MemoryPropertyFlags memoryProperty) const
 {
 	VulkanMemoryRequirementsExtended memoryRequirements = static_cast<VulkanMemoryRequirementsExtended>(m_Device.getBufferMemoryRequirements(buffer));
@@ -306,21 +284,36 @@ VulkanMemoryRequirementsExtended VulkanDeviceHandler::FindMemoryRequirement(cons
 	return (memoryRequirements);
 }
 
-uint32_t VulkanDeviceHandler::FindMemoryTypeIndex(const VulkanMemoryRequirementsExtended& memoryRequirements, vk::MemoryPropertyFlags memoryProperty) const
+VulkanMemoryAllocation VulkanDeviceHandler::AllocateBufferMemory(const vk::Buffer& buffer, vk::MemoryPropertyFlags memoryProperty, vk::DeviceSize minAlignment) const
 {
-	vk::PhysicalDeviceMemoryProperties memoryProperties = GetPhysicalDeviceMemoryProperties();
+	VulkanMemoryRequirementsExtended memoryRequirements = FindMemoryRequirement(buffer, memoryProperty);
+	memoryRequirements.alignment = std::max(memoryRequirements.alignment, minAlignment);
+	CHECK(memoryRequirements.MemoryTypeIndex != UINT32_MAX);
+
+	VulkanMemoryAllocation allocation = m_MemoryAllocator->Allocate(memoryRequirements, memoryRequirements.MemoryTypeIndex);
+	if (allocation.IsValid())
+		m_Device.bindBufferMemory(buffer, allocation.Memory, allocation.Offset);
+	return (allocation);
+}
 
-	uint32_t memoryTypeIndex = -1;
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
-	{
-		if (memoryRequirements.memoryTypeBits & (1 << i))
-		{
-			if (memoryProperties.memoryTypes[i].propertyFlags & memoryProperty)
-			{
-				memoryTypeIndex = i;
-				break;
-			}
-		}
-	}
-	return (memoryTypeIndex);
-}
\ No newline at end of file
+VulkanMemoryAllocation VulkanDeviceHandler::AllocateImageMemory(const vk::Image& image, vk::MemoryPropertyFlags memoryProperty) const
+{
+	const VulkanMemoryRequirementsExtended memoryRequirements = FindMemoryRequirement(image, memoryProperty);
+	CHECK(memoryRequirements.MemoryTypeIndex != UINT32_MAX);
+
+	VulkanMemoryAllocation allocation = m_MemoryAllocator->Allocate(memoryRequirements, memoryRequirements.MemoryTypeIndex, false);
+	if (allocation.IsValid())
+		m_Device.bindImageMemory(image, allocation.Memory, allocation.Offset);
+	return (allocation);
+}
+
+void VulkanDeviceHandler::FreeMemory(VulkanMemoryAllocation& allocation) const
+{
+	m_MemoryAllocator->Free(allocation);
+}
+
+uint32_t VulkanDeviceHandler::FindMemoryTypeIndex(const VulkanMemoryRequirementsExtended& memoryRequirements, vk::MemoryPropertyFlags memoryProperty) const
+{
+	// Every requested property must be there (a host visible memory that isn't coherent doesn't do for a host coherent request)
+	return (m_MemoryAllocator->GetMemoryTypes().FindMemoryTypeIndex(memoryRequirements.memoryTypeBits, memoryProperty));
+}
@@ -0,0 +1,212 @@
+#include "Vulkan/VulkanFrameRing.h"
+#include "Vulkan/VulkanTimeline.h"
+#include "Vulkan/VulkanUtils.h"
+#include "MacrosHelper.h"
+
+#include <algorithm>
+#include <deque>
+#include <format>
+#include <random>
+#include <string>
+#include <string_view>
+
+VulkanFrameRing::VulkanFrameRing(uint32_t frameCount, uint32_t imageCount)
+	: m_Frames(frameCount), m_ImageOwners(imageCount, InvalidIndex)
+{
+	CHECK(frameCount > 0 && imageCount > 0);
+}
+
+uint32_t VulkanFrameRing::BeginFrame()
+{
+	CHECK(m_Frames.empty() == false);
+
+	// The previous frame must have been submitted, its slot is reused once every other slot has been
+	CHECK(m_bFrameBegun == false);
+	m_bFrameBegun = true;
+
+	m_CurrentFrame = (m_CurrentFrame == InvalidIndex) ? 0 : (m_CurrentFrame + 1) % GetFrameCount();
+	m_FrameNumber++;
+	return (m_CurrentFrame);
+}
+
+uint32_t VulkanFrameRing::AcquireImage(uint32_t imageIndex)
+{
+	CHECK(m_bFrameBegun && imageIndex < GetImageCount());
+
+	FrameSlot& frame = m_Frames[m_CurrentFrame];
+	CHECK(frame.bInFlight == false && frame.ImageIndex == InvalidIndex);
+
+	// Completing the previous owner doesn't release the image anymore, it's already given to the current frame
+	const uint32_t previousOwner = m_ImageOwners[imageIndex];
+	m_ImageOwners[imageIndex] = m_CurrentFrame;
+	frame.ImageIndex = imageIndex;
+
+	return ((previousOwner != InvalidIndex && m_Frames[previousOwner].bInFlight) ? previousOwner : InvalidIndex);
+}
+
+void VulkanFrameRing::SubmitFrame(uint64_t timelineValue)
+{
+	CHECK(m_bFrameBegun);
+
+	FrameSlot& frame = m_Frames[m_CurrentFrame];
+	CHECK(frame.bInFlight == false && frame.ImageIndex != InvalidIndex);
+	frame.bInFlight = true;
+	frame.TimelineValue = timelineValue;
+	m_bFrameBegun = false;
+}
+
+void VulkanFrameRing::CompleteFrame(uint32_t frameIndex)
+{
+	CHECK(frameIndex < GetFrameCount());
+
+	FrameSlot& frame = m_Frames[frameIndex];
+	if (frame.bInFlight == false)
+		return;
+
+	if (m_ImageOwners[frame.ImageIndex] == frameIndex)
+		m_ImageOwners[frame.ImageIndex] = InvalidIndex;
+	frame.ImageIndex = InvalidIndex;
+	frame.bInFlight = false;
+}
+
+void VulkanFrameRing::WaitForFrame(uint32_t frameIndex, VulkanTimeline& timeline)
+{
+	CHECK(frameIndex < GetFrameCount());
+	if (m_Frames[frameIndex].bInFlight == false)
+		return;
+
+	timeline.Wait(m_Frames[frameIndex].TimelineValue);
+	CompleteFrame(frameIndex);
+}
+
+bool VulkanFrameRing::LogSelfTest(uint32_t randomFrameCount)
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Frame ring self test, {:s}: expected {:s}", scenario, expectation);
+		failureCount++;
+	};
+
+	/* SLOT REUSE */
+	{
+		const std::string_view scenario = "slot reuse";
+		VulkanFrameRing ring(2, 3);
+
+		expect(ring.BeginFrame() == 0, scenario, "the first frame in slot 0");
+		expect(ring.AcquireImage(0) == InvalidIndex, scenario, "a free image for the first frame");
+		ring.SubmitFrame();
+		expect(ring.BeginFrame() == 1, scenario, "the second frame in slot 1");
+		expect(ring.AcquireImage(1) == InvalidIndex, scenario, "a free image for the second frame");
+		ring.SubmitFrame();
+
+		// Slot 0 come back while the GPU still render the first frame, it must be completed before its resources are reused
+		expect(ring.BeginFrame() == 0, scenario, "the third frame to reuse slot 0");
+		expect(ring.IsFrameInFlight(0), scenario, "slot 0 still in flight when it's reused");
+		ring.CompleteFrame(0);
+		expect(ring.IsFrameInFlight(0) == false && ring.GetImageOwner(0) == InvalidIndex, scenario, "the completed slot to release its image");
+		expect(ring.AcquireImage(2) == InvalidIndex, scenario, "a free image for the third frame");
+		expect(ring.IsFrameInFlight(1), scenario, "slot 1 untouched by the completion of slot 0");
+		ring.SubmitFrame();
+		expect(ring.GetFrameNumber() == 3, scenario, "3 frames begun");
+	}
+
+	/* FRAME AND IMAGE INDICES */
+	{
+		const std::string_view scenario = "frame and image indices";
+		VulkanFrameRing ring(2, 3);
+
+		// The presentation engine give the images in any order, the slot and the image of a frame are unrelated
+		const uint32_t acquiredImages[] = { 2, 0, 1, 2 };
+		for (uint32_t frameNumber = 0; frameNumber < 4; frameNumber++)
+		{
+			const uint32_t frameIndex = ring.BeginFrame();
+			ring.CompleteFrame(frameIndex);
+			ring.AcquireImage(acquiredImages[frameNumber]);
+
+			expect(ring.GetCurrentFrame() == frameNumber % 2, scenario, "the slots to follow the frames");
+			expect(ring.GetCurrentImage() == acquiredImages[frameNumber], scenario, "the current image to be the acquired one");
+			expect(ring.GetFrameImage(frameIndex) == acquiredImages[frameNumber], scenario, "the slot to own the acquired image");
+			expect(ring.GetImageOwner(acquiredImages[frameNumber]) == frameIndex, scenario, "the acquired image to be owned by the slot");
+			ring.SubmitFrame();
+		}
+	}
+
+	/* MORE SLOTS THAN IMAGES */
+	{
+		const std::string_view scenario = "more slots than images";
+		VulkanFrameRing ring(3, 2);
+
+		ring.BeginFrame();
+		ring.AcquireImage(0);
+		ring.SubmitFrame();
+		ring.BeginFrame();
+		ring.AcquireImage(1);
+		ring.SubmitFrame();
+
+		// Slot 2 is free, but its image is still rendered by slot 0
+		expect(ring.BeginFrame() == 2, scenario, "the third frame in slot 2");
+		expect(ring.AcquireImage(0) == 0, scenario, "slot 0 to be completed before rendering into its image");
+		ring.CompleteFrame(0);
+		expect(ring.GetImageOwner(0) == 2, scenario, "completing slot 0 to keep the image given to slot 2");
+		expect(ring.GetFrameImage(0) == InvalidIndex, scenario, "the completed slot to have no image");
+		ring.SubmitFrame();
+	}
+
+	/* RANDOM FRAMES */
+	{
+		std::mt19937 random(42);
+
+		for (uint32_t frameCount = 1; frameCount <= 4; frameCount++)
+		{
+			for (uint32_t imageCount = 1; imageCount <= 4; imageCount++)
+			{
+				const std::string scenario = std::format("random frames with {:d} slots and {:d} images", frameCount, imageCount);
+				VulkanFrameRing ring(frameCount, imageCount);
+				// The fake GPU complete the submissions in order, some frames later
+				std::deque<uint32_t> submittedFrames;
+				// The next frames would break the same expectations, only the first broken frame is logged
+				const uint32_t previousFailureCount = failureCount;
+
+				for (uint32_t frameNumber = 0; frameNumber < randomFrameCount / 16 && failureCount == previousFailureCount; frameNumber++)
+				{
+					while (submittedFrames.empty() == false && random() % 2 == 0)
+					{
+						ring.CompleteFrame(submittedFrames.front());
+						submittedFrames.pop_front();
+					}
+
+					const uint32_t frameIndex = ring.BeginFrame();
+					expect(frameIndex == frameNumber % frameCount, scenario, "the slots to be used in turn");
+					if (ring.IsFrameInFlight(frameIndex))
+						ring.CompleteFrame(frameIndex);
+
+					const uint32_t imageIndex = random() % imageCount;
+					const uint32_t previousOwner = ring.AcquireImage(imageIndex);
+					expect(previousOwner == InvalidIndex || (previousOwner != frameIndex && ring.IsFrameInFlight(previousOwner)), scenario, "the previous owner of the image to be another slot in flight");
+					if (previousOwner != InvalidIndex)
+						ring.CompleteFrame(previousOwner);
+
+					// No two slots in flight render into the same image
+					for (uint32_t otherFrame = 0; otherFrame < frameCount; otherFrame++)
+					{
+						if (otherFrame != frameIndex && ring.IsFrameInFlight(otherFrame))
+							expect(ring.GetFrameImage(otherFrame) != imageIndex, scenario, "an image owned by a single slot in flight");
+					}
+					expect(ring.GetImageOwner(imageIndex) == frameIndex, scenario, "the acquired image to be owned by the slot");
+
+					ring.SubmitFrame();
+					std::erase(submittedFrames, frameIndex);
+					std::erase(submittedFrames, previousOwner);
+					submittedFrames.push_back(frameIndex);
+				}
+			}
+		}
+	}
+
+	OV_LOG(LogVulkan, Display, "Frame ring self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
@@ -0,0 +1,398 @@
+#include "Vulkan/VulkanGpuProfiler.h"
+
+#include <cmath>
+#include <format>
+#include <string_view>
+
+VulkanGpuScopes::VulkanGpuScopes(std::unique_ptr<VulkanTimestampQueries> queries, const VulkanTimestampConversion& conversion)
+	: m_Queries(std::move(queries)), m_Conversion(conversion)
+{
+	CHECK(m_Queries);
+	m_Scopes.reserve(GetMaxScopeCount());
+	m_Ticks.resize(GetMaxScopeCount() * 2);
+	m_Timings.reserve(GetMaxScopeCount());
+}
+
+uint32_t VulkanGpuScopes::BeginScope(const vk::CommandBuffer& commandBuffer, const char* categoryName, vk::PipelineStageFlagBits stage)
+{
+	if (GetScopeCount() >= GetMaxScopeCount())
+	{
+#if WITH_LOGGING
+		OV_LOG_IF(!m_bOverflowLogged, LogVulkan, Warning, "Too many GPU scopes in a submission (max {}), {} is dropped", GetMaxScopeCount(), categoryName);
+		m_bOverflowLogged = true;
+#endif
+		return (InvalidScope);
+	}
+
+	const uint32_t scope = GetScopeCount();
+	m_Scopes.push_back(Scope{ categoryName, m_OpenScope, false });
+	m_OpenScope = scope;
+
+	m_Queries->ResetQueries(commandBuffer, scope * 2, 2);
+	m_Queries->WriteTimestamp(commandBuffer, stage, scope * 2);
+	return (scope);
+}
+
+void VulkanGpuScopes::EndScope(const vk::CommandBuffer& commandBuffer, uint32_t scope, vk::PipelineStageFlagBits stage)
+{
+	if (scope == InvalidScope)
+		return;
+	// The scopes it contains are ended first, so it's the innermost open one
+	CHECK(scope < GetScopeCount() && !m_Scopes[scope].bEnded && scope == m_OpenScope);
+
+	m_Queries->WriteTimestamp(commandBuffer, stage, scope * 2 + 1);
+	m_Scopes[scope].bEnded = true;
+	m_OpenScope = m_Scopes[scope].Parent;
+}
+
+bool VulkanGpuScopes::Collect()
+{
+	m_Timings.clear();
+	if (m_Scopes.empty())
+		return (true);
+
+	bool bSuccess = m_Queries->ReadTimestamps(0, GetScopeCount() * 2, m_Ticks.data());
+	if (bSuccess)
+	{
+		bSuccess = ResolveTimings(m_Scopes, m_Ticks.data(), m_Conversion, m_Timings);
+		for (const VulkanGpuScopeTiming& timing : m_Timings)
+			REPORT_PERFRAME_TIMER(timing.CategoryName, timing.Duration);
+	}
+	OV_LOG_IF(!bSuccess, LogVulkan, Verbose, "Some GPU scopes timestamps were not available or not resolved, {} of {} scopes dropped",
+		GetScopeCount() - m_Timings.size(), GetScopeCount());
+
+	Discard();
+	return (bSuccess);
+}
+
+void VulkanGpuScopes::Discard()
+{
+	m_Scopes.clear();
+	m_OpenScope = InvalidScope;
+}
+
+bool VulkanGpuScopes::ResolveTimings(const std::vector<Scope>& scopes, const uint64_t* ticks, const VulkanTimestampConversion& conversion, std::vector<VulkanGpuScopeTiming>& outTimings)
+{
+	outTimings.clear();
+
+	bool bResolved = true;
+	for (uint32_t i = 0; i < scopes.size(); i++)
+	{
+		const Scope& scope = scopes[i];
+		// A scope never ended has no end timestamp
+		if (!scope.bEnded)
+		{
+			bResolved = false;
+			continue;
+		}
+
+		// A child begin and end while its parent is running, measured from the beginning of the parent as the ticks can wrap around
+		if (scope.Parent != InvalidScope && scopes[scope.Parent].bEnded)
+		{
+			const uint64_t parentBegin = ticks[scope.Parent * 2];
+			const uint64_t parentTicks = conversion.GetElapsedTicks(parentBegin, ticks[scope.Parent * 2 + 1]);
+			const uint64_t beginTicks = conversion.GetElapsedTicks(parentBegin, ticks[i * 2]);
+			const uint64_t endTicks = conversion.GetElapsedTicks(parentBegin, ticks[i * 2 + 1]);
+			if (beginTicks > endTicks || endTicks > parentTicks)
+			{
+				bResolved = false;
+				continue;
+			}
+		}
+
+		// There is a few scopes per submission, the chain of parents is short
+		uint32_t depth = 0;
+		for (uint32_t parent = scope.Parent; parent != InvalidScope; parent = scopes[parent].Parent)
+			depth++;
+
+		outTimings.push_back(VulkanGpuScopeTiming{ scope.CategoryName, depth, conversion.ToDuration(ticks[i * 2], ticks[i * 2 + 1]) });
+	}
+	return (bResolved);
+}
+
+/* SELF TEST */
+
+namespace
+{
+	/** Queries written by a scripted GPU: each timestamp take the value of the clock, that the test advance between the commands */
+	class FakeTimestampQueries final : public VulkanTimestampQueries
+	{
+	public:
+		FakeTimestampQueries(uint32_t queryCount)
+			: m_Ticks(queryCount, 0), m_bReset(queryCount, false), m_bWritten(queryCount, false)
+		{}
+
+		virtual uint32_t GetQueryCount() const override { return (static_cast<uint32_t>(m_Ticks.size())); }
+		virtual void ResetQueries(const vk::CommandBuffer& commandBuffer, uint32_t firstQuery, uint32_t count) override
+		{
+			for (uint32_t query = firstQuery; query < firstQuery + count; query++)
+			{
+				m_bReset[query] = true;
+				m_bWritten[query] = false;
+			}
+		}
+		virtual void WriteTimestamp(const vk::CommandBuffer& commandBuffer, vk::PipelineStageFlagBits stage, uint32_t query) override
+		{
+			// A query must be reset before each write
+			m_UnresetWriteCount += (m_bReset[query] ? 0 : 1);
+			m_bReset[query] = false;
+			m_bWritten[query] = true;
+			m_Ticks[query] = Clock;
+		}
+		virtual bool ReadTimestamps(uint32_t firstQuery, uint32_t count, uint64_t* outTicks) override
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!m_bWritten[firstQuery + i])
+					return (false);
+				outTicks[i] = m_Ticks[firstQuery + i];
+			}
+			return (true);
+		}
+
+		/** Replace the ticks written in a query (e.g. a timestamp of another submission) */
+		__forceinline void OverwriteTicks(uint32_t query, uint64_t ticks) { m_Ticks[query] = ticks; }
+		/** Make a query unavailable, like a timestamp the GPU hasn't written yet */
+		__forceinline void ForgetQuery(uint32_t query) { m_bWritten[query] = false; }
+		__forceinline uint32_t GetUnresetWriteCount() const { return (m_UnresetWriteCount); }
+
+	public:
+		/** The ticks written by the next timestamps */
+		uint64_t Clock = 0;
+
+	private:
+		std::vector<uint64_t> m_Ticks;
+		std::vector<bool> m_bReset;
+		std::vector<bool> m_bWritten;
+		uint32_t m_UnresetWriteCount = 0;
+	};
+}
+
+bool VulkanGpuScopes::LogSelfTest()
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+		{
+			if (bCondition)
+				return;
+			OV_LOG(LogVulkan, Error, "GPU profiler self test, {:s}: expected {:s}", scenario, expectation);
+			failureCount++;
+		};
+	auto expectTiming = [&expect](const std::vector<VulkanGpuScopeTiming>& timings, size_t index, const char* categoryName, uint32_t depth, double milliseconds, std::string_view scenario)
+		{
+			if (index >= timings.size())
+			{
+				expect(false, scenario, std::format("a timing for the scope {:s}", categoryName));
+				return;
+			}
+			const VulkanGpuScopeTiming& timing = timings[index];
+			expect(timing.CategoryName == categoryName && timing.Depth == depth, scenario,
+				std::format("the scope {:s} at the depth {:d}, got {:s} at the depth {:d}", categoryName, depth, timing.CategoryName, timing.Depth));
+			// The durations are truncated to the nanosecond
+			expect(std::abs(timing.GetMilliseconds() - milliseconds) < 1e-5, scenario,
+				std::format("{:.6f}ms for the scope {:s}, got {:.6f}ms", milliseconds, categoryName, timing.GetMilliseconds()));
+		};
+
+	// The command buffer is only given to the queries, the fake ones never use it
+	const vk::CommandBuffer commandBuffer;
+	auto createScopes = [](uint32_t queryCount, const VulkanTimestampConversion& conversion, FakeTimestampQueries*& outQueries)
+		{
+			std::unique_ptr<FakeTimestampQueries> queries = std::make_unique<FakeTimestampQueries>(queryCount);
+			outQueries = queries.get();
+			return (std::make_unique<VulkanGpuScopes>(std::move(queries), conversion));
+		};
+
+	/* NESTED SCOPES */
+	{
+		const std::string_view scenario = "nested scopes";
+		// A tick per microsecond
+		const VulkanTimestampConversion conversion{ 1000.0f, 64 };
+		FakeTimestampQueries* queries = nullptr;
+		std::unique_ptr<VulkanGpuScopes> scopes = createScopes(16, conversion, queries);
+
+		// Frame [1000, 3000] contains A [1100, 1600] and B [1700, 2900], that contains C [1800, 2000]
+		queries->Clock = 1000; const uint32_t frame = scopes->BeginScope(commandBuffer, "Frame");
+		queries->Clock = 1100; const uint32_t a = scopes->BeginScope(commandBuffer, "A");
+		queries->Clock = 1600; scopes->EndScope(commandBuffer, a);
+		queries->Clock = 1700; const uint32_t b = scopes->BeginScope(commandBuffer, "B");
+		queries->Clock = 1800; const uint32_t c = scopes->BeginScope(commandBuffer, "C");
+		queries->Clock = 2000; scopes->EndScope(commandBuffer, c);
+		queries->Clock = 2900; scopes->EndScope(commandBuffer, b);
+		queries->Clock = 3000; scopes->EndScope(commandBuffer, frame);
+
+		expect(scopes->Collect() && scopes->GetScopeCount() == 0, scenario, "the scopes collected and forgotten");
+		const std::vector<VulkanGpuScopeTiming>& timings = scopes->GetLastTimings();
+		expect(timings.size() == 4, scenario, std::format("4 timings, got {:d}", timings.size()));
+		expectTiming(timings, 0, "Frame", 0, 2.0, scenario);
+		expectTiming(timings, 1, "A", 1, 0.5, scenario);
+		expectTiming(timings, 2, "B", 1, 1.2, scenario);
+		expectTiming(timings, 3, "C", 2, 0.2, scenario);
+
+		// The next submission of the slot reuse the same queries, reset again before they are written
+		queries->Clock = 5000; const uint32_t next = scopes->BeginScope(commandBuffer, "Next");
+		queries->Clock = 5250; scopes->EndScope(commandBuffer, next);
+		expect(scopes->Collect() && scopes->GetLastTimings().size() == 1, scenario, "a single timing for the next submission");
+		expectTiming(scopes->GetLastTimings(), 0, "Next", 0, 0.25, scenario);
+		expect(queries->GetUnresetWriteCount() == 0, scenario, "every query reset before it's written");
+	}
+
+	/* TIMESTAMP PERIODS */
+	{
+		const std::string_view scenario = "timestamp periods";
+		// Nanoseconds per tick: whole, fractional, and below 1
+		const float periods[] = { 1.0f, 83.333f, 40.0f, 0.5f };
+		for (float period : periods)
+		{
+			const VulkanTimestampConversion conversion{ period, 64 };
+			FakeTimestampQueries* queries = nullptr;
+			std::unique_ptr<VulkanGpuScopes> scopes = createScopes(2, conversion, queries);
+
+			queries->Clock = 5000; const uint32_t scope = scopes->BeginScope(commandBuffer, "Scope");
+			queries->Clock = 125000; scopes->EndScope(commandBuffer, scope);
+			expect(scopes->Collect(), scenario, std::format("the scope collected with a period of {:.3f}ns", period));
+			expectTiming(scopes->GetLastTimings(), 0, "Scope", 0, 120000.0 * static_cast<double>(period) / 1e6, scenario);
+		}
+	}
+
+	/* WRAPPED AROUND TICKS */
+	{
+		const std::string_view scenario = "wrapped around ticks";
+		// 36 valid bits, the clock wrap around during the parent and during its child
+		constexpr uint64_t wrap = 1ull << 36;
+		const VulkanTimestampConversion conversion{ 1.0f, 36 };
+		FakeTimestampQueries* queries = nullptr;
+		std::unique_ptr<VulkanGpuScopes> scopes = createScopes(4, conversion, queries);
+
+		queries->Clock = wrap - 500; const uint32_t parent = scopes->BeginScope(commandBuffer, "Parent");
+		queries->Clock = wrap - 100; const uint32_t child = scopes->BeginScope(commandBuffer, "Child");
+		queries->Clock = 300; scopes->EndScope(commandBuffer, child);
+		queries->Clock = 700; scopes->EndScope(commandBuffer, parent);
+
+		expect(scopes->Collect() && scopes->GetLastTimings().size() == 2, scenario, "both scopes resolved across the wraparound");
+		expectTiming(scopes->GetLastTimings(), 0, "Parent", 0, 0.0012, scenario);
+		expectTiming(scopes->GetLastTimings(), 1, "Child", 1, 0.0004, scenario);
+	}
+
+	/* SCOPE NEVER ENDED */
+	{
+		const std::string_view scenario = "scope never ended";
+		const VulkanTimestampConversion conversion{ 1.0f, 64 };
+		FakeTimestampQueries* queries = nullptr;
+		std::unique_ptr<VulkanGpuScopes> scopes = createScopes(8, conversion, queries);
+
+		queries->Clock = 100; const uint32_t ended = scopes->BeginScope(commandBuffer, "Ended");
+		queries->Clock = 200; scopes->EndScope(commandBuffer, ended);
+		queries->Clock = 300; scopes->BeginScope(commandBuffer, "NeverEnded");
+
+		// Resolved with ticks in its end query (e.g. written by a previous submission), the scope is still dropped
+		const uint64_t ticks[] = { 100, 200, 300, 400 };
+		std::vector<VulkanGpuScopeTiming> timings;
+		expect(!ResolveTimings(scopes->m_Scopes, ticks, conversion, timings), scenario, "a failed resolve");
+		expect(timings.size() == 1, scenario, "only the ended scope resolved");
+		expectTiming(timings, 0, "Ended", 0, 0.0001, scenario);
+
+		// Its end query is never written, so it can't be read back
+		expect(!scopes->Collect() && scopes->GetScopeCount() == 0 && scopes->GetLastTimings().empty(), scenario, "a failed collect that forget the scopes anyway");
+
+		// The scope left open doesn't become the parent of the scopes of the next submission
+		queries->Clock = 500; const uint32_t next = scopes->BeginScope(commandBuffer, "Next");
+		queries->Clock = 600; scopes->EndScope(commandBuffer, next);
+		expect(scopes->Collect(), scenario, "the next submission collected");
+		expectTiming(scopes->GetLastTimings(), 0, "Next", 0, 0.0001, scenario);
+	}
+
+	/* TIMESTAMPS NOT AVAILABLE */
+	{
+		const std::string_view scenario = "timestamps not available";
+		const VulkanTimestampConversion conversion{ 1.0f, 64 };
+		FakeTimestampQueries* queries = nullptr;
+		std::unique_ptr<VulkanGpuScopes> scopes = createScopes(4, conversion, queries);
+
+		queries->Clock = 100; const uint32_t scope = scopes->BeginScope(commandBuffer, "Scope");
+		queries->Clock = 200; scopes->EndScope(commandBuffer, scope);
+		queries->ForgetQuery(1);
+
+		expect(!scopes->Collect() && scopes->GetScopeCount() == 0 && scopes->GetLastTimings().empty(), scenario, "the scopes dropped without any timing");
+	}
+
+	/* CHILD OUTSIDE OF ITS PARENT */
+	{
+		const std::string_view scenario = "child outside of its parent";
+		const VulkanTimestampConversion conversion{ 1.0f, 64 };
+		FakeTimestampQueries* queries = nullptr;
+		std::unique_ptr<VulkanGpuScopes> scopes = createScopes(4, conversion, queries);
+
+		queries->Clock = 1000; const uint32_t parent = scopes->BeginScope(commandBuffer, "Parent");
+		queries->Clock = 1500; const uint32_t child = scopes->BeginScope(commandBuffer, "Child");
+		queries->Clock = 1800; scopes->EndScope(commandBuffer, child);
+		queries->Clock = 2000; scopes->EndScope(commandBuffer, parent);
+		// The end of the child comes from another submission, after the end of its parent
+		queries->OverwriteTicks(3, 2500);
+
+		expect(!scopes->Collect(), scenario, "a failed collect");
+		expect(scopes->GetLastTimings().size() == 1, scenario, "only the parent resolved");
+		expectTiming(scopes->GetLastTimings(), 0, "Parent", 0, 0.001, scenario);
+	}
+
+	/* TOO MANY SCOPES */
+	{
+		const std::string_view scenario = "too many scopes";
+		const VulkanTimestampConversion conversion{ 1.0f, 64 };
+		FakeTimestampQueries* queries = nullptr;
+		std::unique_ptr<VulkanGpuScopes> scopes = createScopes(4, conversion, queries);
+
+		// 2 scopes fit in 4 queries, the third one is dropped and its end ignored
+		queries->Clock = 100; const uint32_t first = scopes->BeginScope(commandBuffer, "First");
+		queries->Clock = 200; const uint32_t second = scopes->BeginScope(commandBuffer, "Second");
+		queries->Clock = 300; const uint32_t third = scopes->BeginScope(commandBuffer, "Third");
+		expect(third == InvalidScope && scopes->GetScopeCount() == 2, scenario, "the scope past the query count dropped");
+		queries->Clock = 400; scopes->EndScope(commandBuffer, third);
+		queries->Clock = 500; scopes->EndScope(commandBuffer, second);
+		queries->Clock = 600; scopes->EndScope(commandBuffer, first);
+
+		expect(scopes->Collect() && scopes->GetLastTimings().size() == 2, scenario, "the 2 scopes that fit resolved");
+		expectTiming(scopes->GetLastTimings(), 0, "First", 0, 0.0005, scenario);
+		expectTiming(scopes->GetLastTimings(), 1, "Second", 1, 0.0003, scenario);
+		expect(queries->GetUnresetWriteCount() == 0, scenario, "every query reset before it's written");
+	}
+
+	OV_LOG(LogVulkan, Display, "GPU profiler self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
+
+/* VULKAN GPU PROFILER */
+
+void VulkanGpuProfiler::Create(std::vector<std::unique_ptr<VulkanTimestampQueries>> frameQueries, const VulkanTimestampConversion& conversion)
+{
+	CHECK(!IsCreated() && !frameQueries.empty());
+
+	m_Frames.reserve(frameQueries.size());
+	for (std::unique_ptr<VulkanTimestampQueries>& queries : frameQueries)
+		m_Frames.push_back(std::make_unique<VulkanGpuScopes>(std::move(queries), conversion));
+	m_CurrentFrame = UINT32_MAX;
+}
+
+void VulkanGpuProfiler::Destroy()
+{
+	m_Frames.clear();
+	m_CurrentFrame = UINT32_MAX;
+}
+
+void VulkanGpuProfiler::BeginFrame(uint32_t frameIndex)
+{
+	if (!IsCreated())
+		return;
+	CHECK(frameIndex < m_Frames.size());
+
+	// The slot is reused: the frame that recorded into it is done
+	m_Frames[frameIndex]->Collect();
+	m_CurrentFrame = frameIndex;
+}
+
+VulkanGpuScopes* VulkanGpuProfiler::GetFrameScopes() const
+{
+	if (m_CurrentFrame >= m_Frames.size())
+		return (nullptr);
+	return (m_Frames[m_CurrentFrame].get());
+}
@@ -0,0 +1,262 @@
+#include "Vulkan/VulkanMemoryAllocationPolicy.h"
+#include "MacrosHelper.h"
+
+#include <algorithm>
+#include <bit>
+
+VulkanTlsfAllocationPolicy::VulkanTlsfAllocationPolicy(uint64_t capacity)
+	: m_Capacity(capacity)
+{
+	CHECK(capacity > 0);
+
+	for (auto& secondLevel : m_FreeLists)
+		secondLevel.fill(NullRange);
+
+	// At first the whole block is a single free range
+	const uint32_t rangeIndex = CreateRange();
+	m_Ranges[rangeIndex].Offset = 0;
+	m_Ranges[rangeIndex].Size = capacity;
+	InsertFreeRange(rangeIndex);
+}
+
+bool VulkanTlsfAllocationPolicy::Allocate(uint64_t size, uint64_t alignment, VulkanSubAllocation& outAllocation)
+{
+	CHECK(alignment > 0 && std::has_single_bit(alignment));
+	size = std::max<uint64_t>(size, 1);
+
+	auto alignUp = [alignment](uint64_t offset) { return ((offset + alignment - 1) & ~(alignment - 1)); };
+	auto fits = [&](uint32_t rangeIndex) { return (alignUp(m_Ranges[rangeIndex].Offset) + size <= m_Ranges[rangeIndex].Offset + m_Ranges[rangeIndex].Size); };
+
+	// Most of the ranges are already aligned, only ask for the worst case padding when the first candidate doesn't fit
+	uint32_t rangeIndex = FindFreeRange(size);
+	if (rangeIndex == NullRange || fits(rangeIndex) == false)
+		rangeIndex = FindFreeRange(size + alignment - 1);
+	if (rangeIndex == NullRange)
+	{
+		// The search round up to the next size class, a range of the class of the size itself can still be big enough
+		uint32_t firstLevel;
+		uint32_t secondLevel;
+		MapInsert(size, firstLevel, secondLevel);
+		for (rangeIndex = m_FreeLists[firstLevel][secondLevel]; rangeIndex != NullRange && fits(rangeIndex) == false; rangeIndex = m_Ranges[rangeIndex].NextFree);
+		if (rangeIndex == NullRange)
+			return (false);
+	}
+	CHECK(fits(rangeIndex));
+
+	RemoveFreeRange(rangeIndex);
+
+	// Give the padding before the aligned offset back to the free ranges
+	const uint64_t alignedOffset = alignUp(m_Ranges[rangeIndex].Offset);
+	if (alignedOffset > m_Ranges[rangeIndex].Offset)
+	{
+		const uint32_t alignedRangeIndex = SplitRange(rangeIndex, alignedOffset);
+		InsertFreeRange(rangeIndex);
+		rangeIndex = alignedRangeIndex;
+	}
+
+	// Same for what is left after the allocation (its next neighbour is allocated, as free neighbours are always merged)
+	if (m_Ranges[rangeIndex].Size > size)
+		InsertFreeRange(SplitRange(rangeIndex, alignedOffset + size));
+
+	m_Ranges[rangeIndex].bFree = false;
+	m_UsedSize += size;
+	m_AllocationCount++;
+
+	outAllocation.Offset = alignedOffset;
+	outAllocation.Size = size;
+	outAllocation.Handle = rangeIndex;
+	return (true);
+}
+
+void VulkanTlsfAllocationPolicy::Free(uint32_t handle)
+{
+	CHECK(handle < m_Ranges.size() && m_Ranges[handle].bFree == false);
+
+	m_UsedSize -= m_Ranges[handle].Size;
+	m_AllocationCount--;
+
+	uint32_t rangeIndex = handle;
+	const uint32_t nextIndex = m_Ranges[rangeIndex].NextPhysical;
+	if (nextIndex != NullRange && m_Ranges[nextIndex].bFree)
+	{
+		RemoveFreeRange(nextIndex);
+		MergeWithNext(rangeIndex);
+	}
+
+	const uint32_t previousIndex = m_Ranges[rangeIndex].PreviousPhysical;
+	if (previousIndex != NullRange && m_Ranges[previousIndex].bFree)
+	{
+		RemoveFreeRange(previousIndex);
+		MergeWithNext(previousIndex);
+		rangeIndex = previousIndex;
+	}
+
+	InsertFreeRange(rangeIndex);
+}
+
+VulkanSubAllocationStatistics VulkanTlsfAllocationPolicy::GetStatistics() const
+{
+	VulkanSubAllocationStatistics statistics;
+	statistics.Capacity = m_Capacity;
+	statistics.UsedSize = m_UsedSize;
+	statistics.AllocationCount = m_AllocationCount;
+	statistics.FreeRangeCount = m_FreeRangeCount;
+
+	// The largest free range is in the last non empty list, but the ranges of a list aren't sorted
+	if (m_FirstLevelBitmap != 0)
+	{
+		const uint32_t firstLevel = 63 - std::countl_zero(m_FirstLevelBitmap);
+		const uint32_t secondLevel = 31 - std::countl_zero(m_SecondLevelBitmaps[firstLevel]);
+		for (uint32_t rangeIndex = m_FreeLists[firstLevel][secondLevel]; rangeIndex != NullRange; rangeIndex = m_Ranges[rangeIndex].NextFree)
+			statistics.LargestFreeRange = std::max(statistics.LargestFreeRange, m_Ranges[rangeIndex].Size);
+	}
+	return (statistics);
+}
+
+void VulkanTlsfAllocationPolicy::MapInsert(uint64_t size, uint32_t& outFirstLevel, uint32_t& outSecondLevel)
+{
+	// The small sizes all go in the first level, with one list per size
+	if (size < SecondLevelCount)
+	{
+		outFirstLevel = 0;
+		outSecondLevel = static_cast<uint32_t>(size);
+		return;
+	}
+
+	const uint32_t mostSignificantBit = 63 - std::countl_zero(size);
+	outFirstLevel = mostSignificantBit - SecondLevelLog2 + 1;
+	outSecondLevel = static_cast<uint32_t>(size >> (mostSignificantBit - SecondLevelLog2)) - SecondLevelCount;
+}
+
+void VulkanTlsfAllocationPolicy::MapSearch(uint64_t size, uint32_t& outFirstLevel, uint32_t& outSecondLevel)
+{
+	// Round up to the next size class, so any range of the list found is big enough
+	if (size >= SecondLevelCount)
+	{
+		const uint32_t mostSignificantBit = 63 - std::countl_zero(size);
+		size += (1ull << (mostSignificantBit - SecondLevelLog2)) - 1;
+	}
+	MapInsert(size, outFirstLevel, outSecondLevel);
+}
+
+uint32_t VulkanTlsfAllocationPolicy::FindFreeRange(uint64_t size) const
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MapSearch(size, firstLevel, secondLevel);
+	if (firstLevel >= FirstLevelCount)
+		return (NullRange);
+
+	// A big enough list in the same first level, else the smallest list of a bigger first level
+	uint32_t secondLevelMap = m_SecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		const uint64_t firstLevelMap = m_FirstLevelBitmap & (~0ull << (firstLevel + 1));
+		if (firstLevelMap == 0)
+			return (NullRange);
+
+		firstLevel = std::countr_zero(firstLevelMap);
+		secondLevelMap = m_SecondLevelBitmaps[firstLevel];
+	}
+	secondLevel = std::countr_zero(secondLevelMap);
+
+	return (m_FreeLists[firstLevel][secondLevel]);
+}
+
+void VulkanTlsfAllocationPolicy::InsertFreeRange(uint32_t rangeIndex)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MapInsert(m_Ranges[rangeIndex].Size, firstLevel, secondLevel);
+
+	Range& range = m_Ranges[rangeIndex];
+	range.bFree = true;
+	range.PreviousFree = NullRange;
+	range.NextFree = m_FreeLists[firstLevel][secondLevel];
+	if (range.NextFree != NullRange)
+		m_Ranges[range.NextFree].PreviousFree = rangeIndex;
+	m_FreeLists[firstLevel][secondLevel] = rangeIndex;
+
+	m_FirstLevelBitmap |= 1ull << firstLevel;
+	m_SecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	m_FreeRangeCount++;
+}
+
+void VulkanTlsfAllocationPolicy::RemoveFreeRange(uint32_t rangeIndex)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	MapInsert(m_Ranges[rangeIndex].Size, firstLevel, secondLevel);
+
+	Range& range = m_Ranges[rangeIndex];
+	CHECK(range.bFree);
+	if (range.PreviousFree != NullRange)
+		m_Ranges[range.PreviousFree].NextFree = range.NextFree;
+	else
+		m_FreeLists[firstLevel][secondLevel] = range.NextFree;
+	if (range.NextFree != NullRange)
+		m_Ranges[range.NextFree].PreviousFree = range.PreviousFree;
+	range.PreviousFree = NullRange;
+	range.NextFree = NullRange;
+	range.bFree = false;
+
+	if (m_FreeLists[firstLevel][secondLevel] == NullRange)
+	{
+		m_SecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (m_SecondLevelBitmaps[firstLevel] == 0)
+			m_FirstLevelBitmap &= ~(1ull << firstLevel);
+	}
+	m_FreeRangeCount--;
+}
+
+uint32_t VulkanTlsfAllocationPolicy::SplitRange(uint32_t rangeIndex, uint64_t offset)
+{
+	// Create first, it may resize m_Ranges
+	const uint32_t secondIndex = CreateRange();
+	Range& range = m_Ranges[rangeIndex];
+	Range& second = m_Ranges[secondIndex];
+	CHECK(offset > range.Offset && offset < range.Offset + range.Size);
+
+	second.Offset = offset;
+	second.Size = range.Offset + range.Size - offset;
+	second.PreviousPhysical = rangeIndex;
+	second.NextPhysical = range.NextPhysical;
+	if (range.NextPhysical != NullRange)
+		m_Ranges[range.NextPhysical].PreviousPhysical = secondIndex;
+
+	range.Size = offset - range.Offset;
+	range.NextPhysical = secondIndex;
+	return (secondIndex);
+}
+
+void VulkanTlsfAllocationPolicy::MergeWithNext(uint32_t rangeIndex)
+{
+	Range& range = m_Ranges[rangeIndex];
+	const uint32_t nextIndex = range.NextPhysical;
+	const Range& next = m_Ranges[nextIndex];
+
+	range.Size += next.Size;
+	range.NextPhysical = next.NextPhysical;
+	if (next.NextPhysical != NullRange)
+		m_Ranges[next.NextPhysical].PreviousPhysical = rangeIndex;
+
+	ReleaseRange(nextIndex);
+}
+
+uint32_t VulkanTlsfAllocationPolicy::CreateRange()
+{
+	if (m_UnusedRanges.empty() == false)
+	{
+		const uint32_t rangeIndex = m_UnusedRanges.back();
+		m_UnusedRanges.pop_back();
+		m_Ranges[rangeIndex] = Range();
+		return (rangeIndex);
+	}
+	m_Ranges.emplace_back();
+	return (static_cast<uint32_t>(m_Ranges.size() - 1));
+}
+
+void VulkanTlsfAllocationPolicy::ReleaseRange(uint32_t rangeIndex)
+{
+	m_UnusedRanges.push_back(rangeIndex);
+}
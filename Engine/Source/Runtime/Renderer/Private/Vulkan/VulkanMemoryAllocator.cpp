@@ -0,0 +1,522 @@
+#include "Vulkan/VulkanMemoryAllocator.h"
+#include "Vulkan/VulkanUtils.h"
+
+#include <algorithm>
+#include <format>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+namespace
+{
+	__forceinline vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+	{
+		return ((value + alignment - 1) & ~(alignment - 1));
+	}
+
+	constexpr double ToMegabytes(vk::DeviceSize size) { return (static_cast<double>(size) / (1024.0 * 1024.0)); }
+}
+
+/* MEMORY TYPE TABLE */
+
+VulkanMemoryTypeTable VulkanMemoryTypeTable::FromProperties(const vk::PhysicalDeviceMemoryProperties& memoryProperties)
+{
+	VulkanMemoryTypeTable table;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		table.Types.push_back(VulkanMemoryType{ memoryProperties.memoryTypes[i].propertyFlags, memoryProperties.memoryTypes[i].heapIndex });
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+		table.HeapSizes.push_back(memoryProperties.memoryHeaps[i].size);
+	return (table);
+}
+
+uint32_t VulkanMemoryTypeTable::FindMemoryTypeIndex(uint32_t memoryTypeBits, vk::MemoryPropertyFlags memoryProperty) const
+{
+	for (uint32_t i = 0; i < Types.size(); i++)
+	{
+		if ((memoryTypeBits & (1 << i)) && (Types[i].PropertyFlags & memoryProperty) == memoryProperty)
+			return (i);
+	}
+	return (UINT32_MAX);
+}
+
+/* DEVICE BLOCK SOURCE */
+
+vk::DeviceMemory VulkanDeviceMemoryBlockSource::AllocateBlock(uint32_t memoryTypeIndex, vk::DeviceSize size)
+{
+	vk::MemoryAllocateFlagsInfo memoryAllocateFlagsInfo(
+		vk::MemoryAllocateFlagBits::eDeviceAddress
+	);
+	vk::MemoryAllocateInfo memoryAllocateInfo(
+		size,
+		memoryTypeIndex,
+		m_bDeviceAddress ? &memoryAllocateFlagsInfo : nullptr
+	);
+
+	// Running out of memory isn't fatal, the allocator can try a smaller block
+	vk::DeviceMemory memory;
+	if (m_Device.allocateMemory(&memoryAllocateInfo, nullptr, &memory) != vk::Result::eSuccess)
+		return (VK_NULL_HANDLE);
+	return (memory);
+}
+
+void VulkanDeviceMemoryBlockSource::FreeBlock(vk::DeviceMemory memory)
+{
+	// Also unmap it
+	m_Device.freeMemory(memory);
+}
+
+void* VulkanDeviceMemoryBlockSource::MapBlock(vk::DeviceMemory memory, vk::DeviceSize size)
+{
+	void* data = nullptr;
+	if (m_Device.mapMemory(memory, 0, size, vk::MemoryMapFlags(), &data) != vk::Result::eSuccess)
+		return (nullptr);
+	return (data);
+}
+
+/* ALLOCATOR */
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VulkanMemoryTypeTable memoryTypes, std::unique_ptr<VulkanMemoryBlockSource> blockSource, VulkanMemoryAllocatorSettings settings)
+	: m_MemoryTypes(std::move(memoryTypes)), m_BlockSource(std::move(blockSource)), m_Settings(std::move(settings))
+{
+	CHECK(m_BlockSource);
+	CHECK(m_Settings.CreatePolicy);
+
+	m_Pools.resize(m_MemoryTypes.Types.size());
+	for (uint32_t i = 0; i < m_Pools.size(); i++)
+	{
+		// A small heap (like the 256MB of device local host visible memory without resizable BAR) get smaller blocks
+		const vk::DeviceSize heapSize = m_MemoryTypes.HeapSizes[m_MemoryTypes.Types[i].HeapIndex];
+		m_Pools[i].BlockSize = std::max<vk::DeviceSize>(std::min(m_Settings.BlockSize, heapSize / 8), 1);
+	}
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+	Release();
+}
+
+VulkanMemoryAllocation VulkanMemoryAllocator::Allocate(const vk::MemoryRequirements& requirements, uint32_t memoryTypeIndex, bool bLinear)
+{
+	CHECK(memoryTypeIndex < m_Pools.size());
+
+	vk::DeviceSize size = requirements.size;
+	vk::DeviceSize alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+	if (bLinear == false)
+	{
+		// The whole pages of an optimal image belong to it, so no buffer can be in the same page
+		alignment = std::max(alignment, m_Settings.BufferImageGranularity);
+		size = AlignUp(size, m_Settings.BufferImageGranularity);
+	}
+
+	std::lock_guard lock(m_Mutex);
+	m_TotalAllocationCount++;
+
+	Pool& pool = m_Pools[memoryTypeIndex];
+	const vk::DeviceSize dedicatedThreshold = m_Settings.DedicatedThreshold != 0 ? m_Settings.DedicatedThreshold : pool.BlockSize / 2;
+	if (size > dedicatedThreshold)
+		return (AllocateDedicated(size, memoryTypeIndex));
+
+	auto makeAllocation = [&](uint32_t blockIndex, const VulkanSubAllocation& subAllocation)
+		{
+			const Block& block = pool.Blocks[blockIndex];
+
+			VulkanMemoryAllocation allocation;
+			allocation.Memory = block.Memory;
+			allocation.Offset = subAllocation.Offset;
+			allocation.Size = subAllocation.Size;
+			allocation.MappedData = block.MappedData ? block.MappedData + subAllocation.Offset : nullptr;
+			allocation.MemoryTypeIndex = memoryTypeIndex;
+			allocation.BlockIndex = blockIndex;
+			allocation.Handle = subAllocation.Handle;
+			return (allocation);
+		};
+
+	VulkanSubAllocation subAllocation;
+	for (uint32_t blockIndex = 0; blockIndex < pool.Blocks.size(); blockIndex++)
+	{
+		Block& block = pool.Blocks[blockIndex];
+		if (block.Memory && block.Policy->Allocate(size, alignment, subAllocation))
+			return (makeAllocation(blockIndex, subAllocation));
+	}
+
+	// Every block is full, the offset 0 of a new block is always aligned
+	const uint32_t blockIndex = CreateBlock(memoryTypeIndex, size);
+	if (blockIndex == UINT32_MAX || pool.Blocks[blockIndex].Policy->Allocate(size, alignment, subAllocation) == false)
+	{
+		OV_LOG(LogVulkan, Error, "Out of device memory: unable to allocate {:d} bytes on the memory type {:d}", size, memoryTypeIndex);
+		return (VulkanMemoryAllocation());
+	}
+	return (makeAllocation(blockIndex, subAllocation));
+}
+
+void VulkanMemoryAllocator::Free(VulkanMemoryAllocation& allocation)
+{
+	if (allocation.IsValid() == false)
+		return;
+
+	std::lock_guard lock(m_Mutex);
+	Pool& pool = m_Pools[allocation.MemoryTypeIndex];
+
+	if (allocation.IsDedicated())
+	{
+		auto memoryIt = std::find(pool.DedicatedAllocations.begin(), pool.DedicatedAllocations.end(), allocation.Memory);
+		CHECK(memoryIt != pool.DedicatedAllocations.end());
+		*memoryIt = pool.DedicatedAllocations.back();
+		pool.DedicatedAllocations.pop_back();
+		pool.DedicatedSize -= allocation.Size;
+
+		m_BlockSource->FreeBlock(allocation.Memory);
+		m_DeviceAllocationCount--;
+		allocation = VulkanMemoryAllocation();
+		return;
+	}
+
+	Block& block = pool.Blocks[allocation.BlockIndex];
+	CHECK(block.Memory == allocation.Memory);
+	block.Policy->Free(allocation.Handle);
+
+	// Keep a single empty block per pool, so allocating and freeing in a loop doesn't allocate a block each time
+	if (block.Policy->IsEmpty())
+	{
+		const bool bHasOtherEmptyBlock = std::any_of(pool.Blocks.begin(), pool.Blocks.end(),
+			[&block](const Block& other) { return (&other != &block && other.Memory && other.Policy->IsEmpty()); }
+		);
+		if (bHasOtherEmptyBlock)
+		{
+			m_BlockSource->FreeBlock(block.Memory);
+			m_DeviceAllocationCount--;
+			block = Block();
+		}
+	}
+
+	allocation = VulkanMemoryAllocation();
+}
+
+void VulkanMemoryAllocator::Release()
+{
+	std::lock_guard lock(m_Mutex);
+
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < m_Pools.size(); memoryTypeIndex++)
+	{
+		Pool& pool = m_Pools[memoryTypeIndex];
+		for (Block& block : pool.Blocks)
+		{
+			if (!block.Memory)
+				continue;
+
+			OV_LOG_IF(block.Policy->IsEmpty() == false, LogVulkan, Error, "{:d} device memory allocations leaked on the memory type {:d}",
+				block.Policy->GetStatistics().AllocationCount, memoryTypeIndex);
+			m_BlockSource->FreeBlock(block.Memory);
+		}
+		pool.Blocks.clear();
+
+		OV_LOG_IF(pool.DedicatedAllocations.empty() == false, LogVulkan, Error, "{:d} dedicated device memory allocations leaked on the memory type {:d}",
+			pool.DedicatedAllocations.size(), memoryTypeIndex);
+		for (vk::DeviceMemory memory : pool.DedicatedAllocations)
+			m_BlockSource->FreeBlock(memory);
+		pool.DedicatedAllocations.clear();
+		pool.DedicatedSize = 0;
+	}
+	m_DeviceAllocationCount = 0;
+}
+
+VulkanMemoryAllocatorStatistics VulkanMemoryAllocator::GetStatistics() const
+{
+	std::lock_guard lock(m_Mutex);
+
+	VulkanMemoryAllocatorStatistics statistics;
+	for (const Pool& pool : m_Pools)
+	{
+		const VulkanMemoryAllocatorStatistics poolStatistics = GetPoolStatistics(pool);
+		statistics.Blocks += poolStatistics.Blocks;
+		statistics.BlockCount += poolStatistics.BlockCount;
+		statistics.DedicatedAllocationCount += poolStatistics.DedicatedAllocationCount;
+		statistics.DedicatedSize += poolStatistics.DedicatedSize;
+	}
+	statistics.TotalAllocationCount = m_TotalAllocationCount;
+	return (statistics);
+}
+
+VulkanMemoryAllocatorStatistics VulkanMemoryAllocator::GetStatistics(uint32_t memoryTypeIndex) const
+{
+	CHECK(memoryTypeIndex < m_Pools.size());
+	std::lock_guard lock(m_Mutex);
+
+	VulkanMemoryAllocatorStatistics statistics = GetPoolStatistics(m_Pools[memoryTypeIndex]);
+	statistics.TotalAllocationCount = m_TotalAllocationCount;
+	return (statistics);
+}
+
+void VulkanMemoryAllocator::LogStatistics() const
+{
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < m_Pools.size(); memoryTypeIndex++)
+	{
+		const VulkanMemoryAllocatorStatistics statistics = GetStatistics(memoryTypeIndex);
+		if (statistics.GetDeviceAllocationCount() == 0)
+			continue;
+
+		OV_LOG(LogVulkan, Display, "Memory type {:d} {:s}: {:d} blocks ({:.1f}/{:.1f}MB used by {:d} allocations, {:d} free ranges, {:.1f}% fragmentation), {:d} dedicated ({:.1f}MB)",
+			memoryTypeIndex, vk::to_string(m_MemoryTypes.Types[memoryTypeIndex].PropertyFlags),
+			statistics.BlockCount, ToMegabytes(statistics.Blocks.UsedSize), ToMegabytes(statistics.Blocks.Capacity), statistics.Blocks.AllocationCount,
+			statistics.Blocks.FreeRangeCount, statistics.Blocks.GetFragmentation() * 100.0f,
+			statistics.DedicatedAllocationCount, ToMegabytes(statistics.DedicatedSize)
+		);
+	}
+}
+
+uint32_t VulkanMemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, vk::DeviceSize minSize)
+{
+	Pool& pool = m_Pools[memoryTypeIndex];
+
+	// When the heap is almost full, a smaller block may still fit
+	vk::DeviceSize blockSize = std::max(pool.BlockSize, minSize);
+	vk::DeviceMemory memory = m_BlockSource->AllocateBlock(memoryTypeIndex, blockSize);
+	while (!memory && blockSize / 2 >= minSize)
+	{
+		blockSize /= 2;
+		memory = m_BlockSource->AllocateBlock(memoryTypeIndex, blockSize);
+	}
+	if (!memory)
+		return (UINT32_MAX);
+	OnDeviceAllocation();
+
+	// Reuse the slot of a freed block, the index of the blocks in use must not change
+	auto blockIt = std::find_if(pool.Blocks.begin(), pool.Blocks.end(), [](const Block& block) { return (!block.Memory); });
+	if (blockIt == pool.Blocks.end())
+		blockIt = pool.Blocks.emplace(pool.Blocks.end());
+
+	blockIt->Memory = memory;
+	blockIt->Policy = m_Settings.CreatePolicy(blockSize);
+	blockIt->MappedData = m_MemoryTypes.IsHostVisible(memoryTypeIndex) ? static_cast<uint8_t*>(m_BlockSource->MapBlock(memory, blockSize)) : nullptr;
+
+	return (static_cast<uint32_t>(blockIt - pool.Blocks.begin()));
+}
+
+VulkanMemoryAllocation VulkanMemoryAllocator::AllocateDedicated(vk::DeviceSize size, uint32_t memoryTypeIndex)
+{
+	Pool& pool = m_Pools[memoryTypeIndex];
+
+	VulkanMemoryAllocation allocation;
+	allocation.Memory = m_BlockSource->AllocateBlock(memoryTypeIndex, size);
+	if (!allocation.Memory)
+	{
+		OV_LOG(LogVulkan, Error, "Out of device memory: unable to allocate {:d} bytes on the memory type {:d}", size, memoryTypeIndex);
+		return (allocation);
+	}
+	OnDeviceAllocation();
+
+	allocation.Size = size;
+	allocation.MappedData = m_MemoryTypes.IsHostVisible(memoryTypeIndex) ? m_BlockSource->MapBlock(allocation.Memory, size) : nullptr;
+	allocation.MemoryTypeIndex = memoryTypeIndex;
+
+	pool.DedicatedAllocations.push_back(allocation.Memory);
+	pool.DedicatedSize += size;
+	return (allocation);
+}
+
+void VulkanMemoryAllocator::OnDeviceAllocation()
+{
+	m_DeviceAllocationCount++;
+	OV_LOG_IF(m_DeviceAllocationCount == m_Settings.MaxDeviceAllocationCount, LogVulkan, Warning,
+		"{:d} device memory allocations, the maxMemoryAllocationCount of the device is reached", m_DeviceAllocationCount);
+}
+
+VulkanMemoryAllocatorStatistics VulkanMemoryAllocator::GetPoolStatistics(const Pool& pool) const
+{
+	VulkanMemoryAllocatorStatistics statistics;
+	for (const Block& block : pool.Blocks)
+	{
+		if (!block.Memory)
+			continue;
+		statistics.Blocks += block.Policy->GetStatistics();
+		statistics.BlockCount++;
+	}
+	statistics.DedicatedAllocationCount = static_cast<uint32_t>(pool.DedicatedAllocations.size());
+	statistics.DedicatedSize = pool.DedicatedSize;
+	return (statistics);
+}
+
+/* BENCHMARK */
+
+namespace
+{
+	/** Hand out fake handles, nothing is allocated but the size of the heaps is respected */
+	class FakeMemoryBlockSource final : public VulkanMemoryBlockSource
+	{
+	public:
+		FakeMemoryBlockSource(const VulkanMemoryTypeTable& memoryTypes)
+			: m_MemoryTypes(memoryTypes), m_HeapUsages(memoryTypes.HeapSizes.size(), 0)
+		{}
+
+		virtual vk::DeviceMemory AllocateBlock(uint32_t memoryTypeIndex, vk::DeviceSize size) override
+		{
+			const uint32_t heapIndex = m_MemoryTypes.Types[memoryTypeIndex].HeapIndex;
+			if (m_HeapUsages[heapIndex] + size > m_MemoryTypes.HeapSizes[heapIndex])
+				return (VK_NULL_HANDLE);
+			m_HeapUsages[heapIndex] += size;
+
+			const vk::DeviceMemory memory(reinterpret_cast<VkDeviceMemory>(static_cast<uintptr_t>(++m_LastHandle)));
+			m_Blocks.emplace(m_LastHandle, std::make_pair(heapIndex, size));
+			return (memory);
+		}
+		virtual void FreeBlock(vk::DeviceMemory memory) override
+		{
+			auto blockIt = m_Blocks.find(reinterpret_cast<uintptr_t>(static_cast<VkDeviceMemory>(memory)));
+			CHECK(blockIt != m_Blocks.end());
+			m_HeapUsages[blockIt->second.first] -= blockIt->second.second;
+			m_Blocks.erase(blockIt);
+		}
+		virtual void* MapBlock(vk::DeviceMemory memory, vk::DeviceSize size) override { return (nullptr); }
+
+		/** Get the size of a block allocated and not freed yet, 0 otherwise */
+		vk::DeviceSize GetBlockSize(vk::DeviceMemory memory) const
+		{
+			auto blockIt = m_Blocks.find(reinterpret_cast<uintptr_t>(static_cast<VkDeviceMemory>(memory)));
+			return (blockIt != m_Blocks.end() ? blockIt->second.second : 0);
+		}
+		__forceinline vk::DeviceSize GetHeapUsage(uint32_t heapIndex) const { return (m_HeapUsages[heapIndex]); }
+		__forceinline size_t GetBlockCount() const { return (m_Blocks.size()); }
+
+	private:
+		VulkanMemoryTypeTable m_MemoryTypes;
+		std::vector<vk::DeviceSize> m_HeapUsages;
+		/** Heap index and size of each block */
+		std::unordered_map<uint64_t, std::pair<uint32_t, vk::DeviceSize>> m_Blocks;
+		uint64_t m_LastHandle = 0;
+	};
+}
+
+bool VulkanMemoryAllocator::LogBenchmark(uint32_t operationCount)
+{
+	// CHECK is compiled out of the release builds, the invariants are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view invariant)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Memory allocator benchmark: expected {:s}", invariant);
+		failureCount++;
+	};
+
+	// A discrete GPU: device local, host memory, and the small device local host visible heap
+	VulkanMemoryTypeTable memoryTypes;
+	memoryTypes.HeapSizes = { 8ull << 30, 16ull << 30, 256ull << 20 };
+	memoryTypes.Types = {
+		VulkanMemoryType{ vk::MemoryPropertyFlagBits::eDeviceLocal, 0 },
+		VulkanMemoryType{ vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, 1 },
+		VulkanMemoryType{ vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, 2 },
+	};
+
+	VulkanMemoryAllocatorSettings settings;
+	settings.BufferImageGranularity = 1024;
+	std::unique_ptr<FakeMemoryBlockSource> blockSource = std::make_unique<FakeMemoryBlockSource>(memoryTypes);
+	const FakeMemoryBlockSource* fakeBlockSource = blockSource.get();
+	VulkanMemoryAllocator allocator(memoryTypes, std::move(blockSource), settings);
+
+	// Fixed seed xorshift, so every run does the same operations
+	uint64_t state = 0x9E3779B97F4A7C15ull;
+	auto random = [&state]()
+		{
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return (state);
+		};
+
+	// The live allocation count oscillate around half of this
+	constexpr uint64_t maxLiveAllocationCount = 40000;
+	std::vector<VulkanMemoryAllocation> allocations;
+	allocations.reserve(maxLiveAllocationCount);
+
+	START_NAMED_TIMER(BenchmarkTimer);
+	for (uint32_t i = 0; i < operationCount; i++)
+	{
+		if (allocations.empty() || random() % maxLiveAllocationCount >= allocations.size())
+		{
+			// From 256B to 4MB, with more small ones (like the AABBs of the chunks)
+			const vk::DeviceSize maxSize = 256ull << (random() % 15);
+			const vk::MemoryRequirements requirements(256 + random() % maxSize, 256, 0b111);
+			const uint64_t typeRoll = random() % 100;
+			const uint32_t memoryTypeIndex = typeRoll < 70 ? 0 : typeRoll < 98 ? 1 : 2;
+
+			VulkanMemoryAllocation allocation = allocator.Allocate(requirements, memoryTypeIndex, random() % 8 != 0);
+			if (allocation.IsValid())
+				allocations.push_back(allocation);
+		}
+		else
+		{
+			const size_t index = random() % allocations.size();
+			allocator.Free(allocations[index]);
+			allocations[index] = allocations.back();
+			allocations.pop_back();
+		}
+	}
+	STOP_NAMED_TIMER(BenchmarkTimer);
+
+	const VulkanMemoryAllocatorStatistics statistics = allocator.GetStatistics();
+	OV_LOG(LogVulkan, Display, "Memory allocator: {:d} operations in {:.2f}ms ({:.1f}M op/s)",
+		operationCount, TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(BenchmarkTimer)),
+		operationCount / TO_DOUBLE_SECONDS(TIMER_NAMED_RESULT(BenchmarkTimer)) / 1e6
+	);
+	OV_LOG(LogVulkan, Display, "Memory allocator: {:d} live allocations in {:d} device allocations ({:d} blocks, {:d} dedicated), {:.1f}/{:.1f}MB used, {:d} free ranges, {:.1f}% fragmentation",
+		allocations.size(), statistics.GetDeviceAllocationCount(), statistics.BlockCount, statistics.DedicatedAllocationCount,
+		ToMegabytes(statistics.Blocks.UsedSize), ToMegabytes(statistics.Blocks.Capacity),
+		statistics.Blocks.FreeRangeCount, statistics.Blocks.GetFragmentation() * 100.0f
+	);
+	allocator.LogStatistics();
+
+	/* NO OVERLAPPING LIVE ALLOCATIONS */
+	{
+		std::vector<VulkanMemoryAllocation> sortedAllocations = allocations;
+		std::sort(sortedAllocations.begin(), sortedAllocations.end(), [](const VulkanMemoryAllocation& lhs, const VulkanMemoryAllocation& rhs)
+			{
+				return (std::make_tuple(static_cast<VkDeviceMemory>(lhs.Memory), lhs.Offset) < std::make_tuple(static_cast<VkDeviceMemory>(rhs.Memory), rhs.Offset));
+			}
+		);
+		for (size_t i = 0; i < sortedAllocations.size() && failureCount == 0; i++)
+		{
+			const VulkanMemoryAllocation& allocation = sortedAllocations[i];
+			expect(allocation.Offset % 256 == 0, std::format("allocations aligned on their requirements (offset {:d})", allocation.Offset));
+			expect(allocation.Offset + allocation.Size <= fakeBlockSource->GetBlockSize(allocation.Memory), "allocations inside a device allocation that is still alive");
+			if (i + 1 < sortedAllocations.size() && sortedAllocations[i + 1].Memory == allocation.Memory)
+				expect(allocation.Offset + allocation.Size <= sortedAllocations[i + 1].Offset, std::format("no overlap between the allocations at {:d} and {:d} of a block", allocation.Offset, sortedAllocations[i + 1].Offset));
+		}
+
+		// What the device gave is what the pools hold
+		for (uint32_t heapIndex = 0; heapIndex < memoryTypes.HeapSizes.size(); heapIndex++)
+		{
+			vk::DeviceSize heapSize = 0;
+			for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryTypes.Types.size(); memoryTypeIndex++)
+			{
+				const VulkanMemoryAllocatorStatistics typeStatistics = allocator.GetStatistics(memoryTypeIndex);
+				if (memoryTypes.Types[memoryTypeIndex].HeapIndex == heapIndex)
+					heapSize += typeStatistics.Blocks.Capacity + typeStatistics.DedicatedSize;
+			}
+			expect(fakeBlockSource->GetHeapUsage(heapIndex) == heapSize, std::format("the usage of the heap {:d} to be the size of the blocks and dedicated allocations of its types", heapIndex));
+		}
+	}
+
+	/* FREE RANGES COALESCED */
+	for (VulkanMemoryAllocation& allocation : allocations)
+		allocator.Free(allocation);
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryTypes.Types.size(); memoryTypeIndex++)
+	{
+		const VulkanMemoryAllocatorStatistics typeStatistics = allocator.GetStatistics(memoryTypeIndex);
+		expect(typeStatistics.Blocks.AllocationCount == 0 && typeStatistics.Blocks.UsedSize == 0 && typeStatistics.DedicatedAllocationCount == 0,
+			std::format("nothing allocated on the memory type {:d} once everything is freed", memoryTypeIndex));
+		// A single empty block is kept per pool, its free ranges must be merged back into a range as big as the block
+		expect(typeStatistics.BlockCount <= 1, std::format("at most one empty block kept on the memory type {:d}", memoryTypeIndex));
+		expect(typeStatistics.Blocks.FreeRangeCount == typeStatistics.BlockCount && typeStatistics.Blocks.LargestFreeRange == typeStatistics.Blocks.Capacity,
+			std::format("a single free range per block on the memory type {:d} once everything is freed ({:d} free ranges in {:d} blocks)",
+				memoryTypeIndex, typeStatistics.Blocks.FreeRangeCount, typeStatistics.BlockCount));
+	}
+
+	/* HEAPS BACK TO 0 */
+	allocator.Release();
+	for (uint32_t heapIndex = 0; heapIndex < memoryTypes.HeapSizes.size(); heapIndex++)
+		expect(fakeBlockSource->GetHeapUsage(heapIndex) == 0, std::format("the usage of the heap {:d} back to 0 once the allocator is released", heapIndex));
+	expect(fakeBlockSource->GetBlockCount() == 0 && allocator.GetStatistics().GetDeviceAllocationCount() == 0, "no device allocation alive once the allocator is released");
+
+	OV_LOG(LogVulkan, Display, "Memory allocator benchmark invariants: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
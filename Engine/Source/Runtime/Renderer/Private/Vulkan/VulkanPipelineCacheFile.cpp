@@ -0,0 +1,332 @@
+#include "Vulkan/VulkanPipelineCacheFile.h"
+#include "Vulkan/VulkanUtils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+
+namespace
+{
+	/** Layout of VkPipelineCacheHeaderVersionOne, at the start of the data of every pipeline cache */
+	constexpr size_t CacheHeaderSize = 16 + VK_UUID_SIZE;
+	constexpr uint32_t CacheHeaderVersionOne = 1;
+
+	uint32_t ReadUint32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return (value);
+	}
+
+	void WriteUint32(uint8_t* data, uint32_t value)
+	{
+		memcpy(data, &value, sizeof(value));
+	}
+
+	/** FNV-1a on the bytes of the data */
+	uint64_t HashData(const uint8_t* data, size_t size)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return (hash);
+	}
+}
+
+VulkanPipelineCacheDeviceInfo VulkanPipelineCacheDeviceInfo::FromProperties(const vk::PhysicalDeviceProperties& properties)
+{
+	VulkanPipelineCacheDeviceInfo deviceInfo;
+	deviceInfo.VendorID = properties.vendorID;
+	deviceInfo.DeviceID = properties.deviceID;
+	std::copy_n(properties.pipelineCacheUUID.begin(), VK_UUID_SIZE, deviceInfo.PipelineCacheUUID.begin());
+	return (deviceInfo);
+}
+
+VulkanPipelineCacheValidity::Type VulkanPipelineCacheFile::ValidateCacheData(const uint8_t* data, size_t size, const VulkanPipelineCacheDeviceInfo& device)
+{
+	if (size < CacheHeaderSize)
+		return (VulkanPipelineCacheValidity::Truncated);
+
+	const uint32_t headerSize = ReadUint32(data);
+	const uint32_t headerVersion = ReadUint32(data + 4);
+	if (headerSize < CacheHeaderSize || headerSize > size || headerVersion != CacheHeaderVersionOne)
+		return (VulkanPipelineCacheValidity::InvalidCacheHeader);
+
+	if (ReadUint32(data + 8) != device.VendorID)
+		return (VulkanPipelineCacheValidity::VendorMismatch);
+	if (ReadUint32(data + 12) != device.DeviceID)
+		return (VulkanPipelineCacheValidity::DeviceMismatch);
+	if (memcmp(data + 16, device.PipelineCacheUUID.data(), VK_UUID_SIZE) != 0)
+		return (VulkanPipelineCacheValidity::UUIDMismatch);
+	return (VulkanPipelineCacheValidity::Valid);
+}
+
+VulkanPipelineCacheValidity::Type VulkanPipelineCacheFile::ValidateFile(const std::vector<uint8_t>& fileContent, const VulkanPipelineCacheDeviceInfo& device)
+{
+	if (fileContent.size() < sizeof(FileHeader))
+		return (VulkanPipelineCacheValidity::Truncated);
+
+	FileHeader header;
+	memcpy(&header, fileContent.data(), sizeof(FileHeader));
+	if (header.Magic != Magic || header.Version != Version)
+		return (VulkanPipelineCacheValidity::InvalidFileHeader);
+	if (header.DataSize != fileContent.size() - sizeof(FileHeader))
+		return (VulkanPipelineCacheValidity::Truncated);
+
+	const uint8_t* data = fileContent.data() + sizeof(FileHeader);
+	if (HashData(data, header.DataSize) != header.DataHash)
+		return (VulkanPipelineCacheValidity::Corrupted);
+	return (ValidateCacheData(data, header.DataSize, device));
+}
+
+std::vector<uint8_t> VulkanPipelineCacheFile::Serialize(const std::vector<uint8_t>& cacheData)
+{
+	FileHeader header;
+	header.DataSize = cacheData.size();
+	header.DataHash = HashData(cacheData.data(), cacheData.size());
+
+	std::vector<uint8_t> fileContent(sizeof(FileHeader) + cacheData.size());
+	memcpy(fileContent.data(), &header, sizeof(FileHeader));
+	if (cacheData.empty() == false)
+		memcpy(fileContent.data() + sizeof(FileHeader), cacheData.data(), cacheData.size());
+	return (fileContent);
+}
+
+std::vector<uint8_t> VulkanPipelineCacheFile::Deserialize(const std::vector<uint8_t>& fileContent)
+{
+	if (fileContent.size() < sizeof(FileHeader))
+		return {};
+	return (std::vector<uint8_t>(fileContent.begin() + sizeof(FileHeader), fileContent.end()));
+}
+
+std::vector<uint8_t> VulkanPipelineCacheFile::Load(const std::filesystem::path& filePath, const VulkanPipelineCacheDeviceInfo& device)
+{
+	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		OV_LOG(LogVulkan, Verbose, "No pipeline cache at \"{:s}\", starting from an empty one", filePath.string());
+		return {};
+	}
+
+	const std::streamsize fileSize = file.tellg();
+	file.seekg(0, std::ios::beg);
+	std::vector<uint8_t> fileContent(static_cast<size_t>(std::max<std::streamsize>(fileSize, 0)));
+	file.read(reinterpret_cast<char*>(fileContent.data()), fileSize);
+	if (!file)
+	{
+		OV_LOG(LogVulkan, Warning, "Unable to read the pipeline cache \"{:s}\"", filePath.string());
+		return {};
+	}
+
+	const VulkanPipelineCacheValidity::Type validity = ValidateFile(fileContent, device);
+	if (validity != VulkanPipelineCacheValidity::Valid)
+	{
+		OV_LOG(LogVulkan, Warning, "Pipeline cache \"{:s}\" dropped: {:s}", filePath.string(), VulkanPipelineCacheValidity::ToString(validity));
+		return {};
+	}
+	return (Deserialize(fileContent));
+}
+
+bool VulkanPipelineCacheFile::Save(const std::filesystem::path& filePath, const std::vector<uint8_t>& cacheData)
+{
+	std::error_code error;
+	if (filePath.has_parent_path())
+		std::filesystem::create_directories(filePath.parent_path(), error);
+
+	// Never truncate the previous file before the new one is complete
+	std::filesystem::path tmpFilePath = filePath;
+	tmpFilePath += ".tmp";
+	{
+		const std::vector<uint8_t> fileContent = Serialize(cacheData);
+		std::ofstream file(tmpFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(fileContent.data()), fileContent.size());
+		file.flush();
+		if (!file)
+		{
+			OV_LOG(LogVulkan, Warning, "Unable to write the pipeline cache \"{:s}\"", tmpFilePath.string());
+			file.close();
+			std::filesystem::remove(tmpFilePath, error);
+			return (false);
+		}
+	}
+
+	// Replace the previous file in one step
+	std::filesystem::rename(tmpFilePath, filePath, error);
+	if (error)
+	{
+		OV_LOG(LogVulkan, Warning, "Unable to replace the pipeline cache \"{:s}\": {:s}", filePath.string(), error.message());
+		std::filesystem::remove(tmpFilePath, error);
+		return (false);
+	}
+	return (true);
+}
+
+bool VulkanPipelineCacheFile::LogSelfTest()
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Pipeline cache file self test, {:s}: expected {:s}", scenario, expectation);
+		failureCount++;
+	};
+	auto expectValidity = [&expect](VulkanPipelineCacheValidity::Type validity, VulkanPipelineCacheValidity::Type expectedValidity, std::string_view scenario, std::string_view blob)
+	{
+		expect(validity == expectedValidity, scenario, std::format("{:s} to be {:s} (got {:s})",
+			blob, VulkanPipelineCacheValidity::ToString(expectedValidity), VulkanPipelineCacheValidity::ToString(validity)));
+	};
+
+	VulkanPipelineCacheDeviceInfo device;
+	device.VendorID = 0x10DE;
+	device.DeviceID = 0x2684;
+	for (uint8_t i = 0; i < VK_UUID_SIZE; i++)
+		device.PipelineCacheUUID[i] = i * 7 + 1;
+
+	// What the driver give: a VkPipelineCacheHeaderVersionOne for the device, followed by its own data
+	std::vector<uint8_t> cacheData(CacheHeaderSize + 1000);
+	WriteUint32(cacheData.data(), CacheHeaderSize);
+	WriteUint32(cacheData.data() + 4, CacheHeaderVersionOne);
+	WriteUint32(cacheData.data() + 8, device.VendorID);
+	WriteUint32(cacheData.data() + 12, device.DeviceID);
+	std::copy_n(device.PipelineCacheUUID.begin(), VK_UUID_SIZE, cacheData.begin() + 16);
+	for (size_t i = CacheHeaderSize; i < cacheData.size(); i++)
+		cacheData[i] = static_cast<uint8_t>(i * 31);
+	const std::vector<uint8_t> fileContent = Serialize(cacheData);
+
+	/* VALID */
+	{
+		const std::string_view scenario = "valid";
+		expectValidity(ValidateCacheData(cacheData.data(), cacheData.size(), device), VulkanPipelineCacheValidity::Valid, scenario, "the data");
+		expectValidity(ValidateFile(fileContent, device), VulkanPipelineCacheValidity::Valid, scenario, "the file");
+		expect(Deserialize(fileContent) == cacheData, scenario, "the data back from the file");
+	}
+
+	/* TRUNCATED FILES */
+	{
+		const std::string_view scenario = "truncated files";
+		for (size_t size : { size_t(0), sizeof(FileHeader) - 1, sizeof(FileHeader), fileContent.size() - 1 })
+		{
+			const std::vector<uint8_t> truncatedContent(fileContent.begin(), fileContent.begin() + size);
+			expectValidity(ValidateFile(truncatedContent, device), VulkanPipelineCacheValidity::Truncated, scenario, std::format("a file of {:d} bytes", size));
+		}
+		expect(Deserialize(std::vector<uint8_t>(sizeof(FileHeader) - 1)).empty(), scenario, "no data from a file smaller than its header");
+
+		// Complete, but the driver gave less than its own header
+		expectValidity(ValidateFile(Serialize({}), device), VulkanPipelineCacheValidity::Truncated, scenario, "a file without data");
+	}
+
+	/* BAD MAGIC OR HASH */
+	{
+		const std::string_view scenario = "bad magic or hash";
+		auto expectPatched = [&](size_t offset, std::string_view blob, VulkanPipelineCacheValidity::Type expectedValidity)
+		{
+			std::vector<uint8_t> patchedContent = fileContent;
+			patchedContent[offset] ^= 0x01;
+			expectValidity(ValidateFile(patchedContent, device), expectedValidity, scenario, blob);
+		};
+		expectPatched(offsetof(FileHeader, Magic), "a file with another magic", VulkanPipelineCacheValidity::InvalidFileHeader);
+		expectPatched(offsetof(FileHeader, Version), "a file of another version", VulkanPipelineCacheValidity::InvalidFileHeader);
+		expectPatched(offsetof(FileHeader, DataHash), "a file with another hash", VulkanPipelineCacheValidity::Corrupted);
+		expectPatched(sizeof(FileHeader) + cacheData.size() / 2, "a file with a byte of data changed", VulkanPipelineCacheValidity::Corrupted);
+		expectPatched(sizeof(FileHeader) + 8, "a file with a byte of the Vulkan header changed", VulkanPipelineCacheValidity::Corrupted);
+	}
+
+	/* VENDOR, DEVICE OR UUID MISMATCH */
+	{
+		const std::string_view scenario = "vendor, device or uuid mismatch";
+		VulkanPipelineCacheDeviceInfo otherVendor = device;
+		otherVendor.VendorID = 0x1002;
+		VulkanPipelineCacheDeviceInfo otherDevice = device;
+		otherDevice.DeviceID++;
+		// A driver update
+		VulkanPipelineCacheDeviceInfo otherUUID = device;
+		otherUUID.PipelineCacheUUID[VK_UUID_SIZE - 1]++;
+
+		expectValidity(ValidateFile(fileContent, otherVendor), VulkanPipelineCacheValidity::VendorMismatch, scenario, "a file of another vendor");
+		expectValidity(ValidateFile(fileContent, otherDevice), VulkanPipelineCacheValidity::DeviceMismatch, scenario, "a file of another device");
+		expectValidity(ValidateFile(fileContent, otherUUID), VulkanPipelineCacheValidity::UUIDMismatch, scenario, "a file of another driver");
+	}
+
+	/* SHORT VULKAN HEADER */
+	{
+		const std::string_view scenario = "short vulkan header";
+		expectValidity(ValidateCacheData(cacheData.data(), CacheHeaderSize - 1, device), VulkanPipelineCacheValidity::Truncated, scenario, "data smaller than a Vulkan header");
+
+		auto expectHeader = [&](uint32_t headerSize, uint32_t headerVersion, std::string_view blob)
+		{
+			std::vector<uint8_t> patchedData = cacheData;
+			WriteUint32(patchedData.data(), headerSize);
+			WriteUint32(patchedData.data() + 4, headerVersion);
+			expectValidity(ValidateCacheData(patchedData.data(), patchedData.size(), device), VulkanPipelineCacheValidity::InvalidCacheHeader, scenario, blob);
+			// The hash of the file is computed on the patched data, only the Vulkan header is wrong
+			expectValidity(ValidateFile(Serialize(patchedData), device), VulkanPipelineCacheValidity::InvalidCacheHeader, scenario, std::format("the file of {:s}", blob));
+		};
+		expectHeader(CacheHeaderSize - 4, CacheHeaderVersionOne, "data announcing a header shorter than VkPipelineCacheHeaderVersionOne");
+		expectHeader(static_cast<uint32_t>(cacheData.size()) + 1, CacheHeaderVersionOne, "data announcing a header bigger than itself");
+		expectHeader(CacheHeaderSize, CacheHeaderVersionOne + 1, "data of an unknown header version");
+	}
+
+	/* SAVE AND LOAD */
+	{
+		const std::string_view scenario = "save and load";
+		std::error_code error;
+		const std::filesystem::path directoryPath = std::filesystem::temp_directory_path(error) / "OVPipelineCacheSelfTest";
+		const std::filesystem::path filePath = directoryPath / "PipelineCache.bin";
+		std::filesystem::remove_all(directoryPath, error);
+
+		expect(Load(filePath, device).empty(), scenario, "no data without a file");
+		expect(Save(filePath, cacheData), scenario, "the file to be written");
+		expect(std::filesystem::exists(filePath.string() + ".tmp") == false, scenario, "no temporary file left");
+		expect(Load(filePath, device) == cacheData, scenario, "the saved data to be loaded back");
+		expect(Load(filePath, VulkanPipelineCacheDeviceInfo()).empty(), scenario, "no data for another device");
+
+		// A partial write of a previous version that didn't rename
+		{
+			std::ofstream file(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(fileContent.data()), fileContent.size() / 2);
+		}
+		expect(Load(filePath, device).empty(), scenario, "no data from a truncated file");
+
+		expect(Save(filePath, cacheData) && Load(filePath, device) == cacheData, scenario, "the truncated file to be replaced");
+		std::filesystem::remove_all(directoryPath, error);
+	}
+
+	OV_LOG(LogVulkan, Display, "Pipeline cache file self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
+
+/* VULKAN PIPELINE CACHE VALIDITY NAMESPACE */
+
+const char* VulkanPipelineCacheValidity::ToString(Type validity)
+{
+	switch (validity)
+	{
+	case Type::Valid:
+		return ("Valid");
+	case Type::Truncated:
+		return ("Truncated");
+	case Type::InvalidFileHeader:
+		return ("InvalidFileHeader");
+	case Type::Corrupted:
+		return ("Corrupted");
+	case Type::InvalidCacheHeader:
+		return ("InvalidCacheHeader");
+	case Type::VendorMismatch:
+		return ("VendorMismatch");
+	case Type::DeviceMismatch:
+		return ("DeviceMismatch");
+	case Type::UUIDMismatch:
+		return ("UUIDMismatch");
+	default:
+		return ("Unknown");
+	}
+}
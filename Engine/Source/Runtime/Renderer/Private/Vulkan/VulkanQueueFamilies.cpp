@@ -0,0 +1,191 @@
+#include "Vulkan/VulkanQueueFamilies.h"
+#include "Vulkan/VulkanUtils.h"
+
+#include <algorithm>
+#include <format>
+#include <string_view>
+
+namespace
+{
+	/** Find the first family that has all the flags of required and none of excluded */
+	uint32_t FindFamily(const std::vector<vk::QueueFamilyProperties>& families, vk::QueueFlags required, vk::QueueFlags excluded)
+	{
+		for (uint32_t i = 0; i < families.size(); i++)
+		{
+			if (families[i].queueCount > 0 && (families[i].queueFlags & required) == required && !(families[i].queueFlags & excluded))
+				return (i);
+		}
+		return (VulkanQueueFamilyIndices::InvalidIndex);
+	}
+}
+
+VulkanQueueFamilyIndices VulkanQueueFamilyIndices::Select(const std::vector<vk::QueueFamilyProperties>& families, const std::function<bool(uint32_t)>& canPresent)
+{
+	VulkanQueueFamilyIndices indices;
+
+	indices.Indices[VulkanQueueType::Graphic] = FindFamily(families, vk::QueueFlagBits::eGraphics, vk::QueueFlags());
+
+	// Presenting from the graphic queue avoid sharing the swap chain images with another family
+	const uint32_t graphicFamily = indices[VulkanQueueType::Graphic];
+	if (graphicFamily != InvalidIndex && canPresent(graphicFamily))
+		indices.Indices[VulkanQueueType::Present] = graphicFamily;
+	else
+	{
+		for (uint32_t i = 0; i < families.size() && indices[VulkanQueueType::Present] == InvalidIndex; i++)
+		{
+			if (families[i].queueCount > 0 && canPresent(i))
+				indices.Indices[VulkanQueueType::Present] = i;
+		}
+	}
+
+	// A graphic family always support compute and transfer, the fallbacks end on it
+	indices.Indices[VulkanQueueType::Compute] = FindFamily(families, vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics);
+	if (indices[VulkanQueueType::Compute] == InvalidIndex)
+		indices.Indices[VulkanQueueType::Compute] = graphicFamily;
+
+	indices.Indices[VulkanQueueType::Transfer] = FindFamily(families, vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute);
+	if (indices[VulkanQueueType::Transfer] == InvalidIndex)
+		indices.Indices[VulkanQueueType::Transfer] = indices[VulkanQueueType::Compute];
+
+	return (indices);
+}
+
+bool VulkanQueueFamilyIndices::IsComplete() const
+{
+	return (std::find(Indices.begin(), Indices.end(), InvalidIndex) == Indices.end());
+}
+
+std::vector<uint32_t> VulkanQueueFamilyIndices::GetUniqueFamilies(std::initializer_list<VulkanQueueType::Type> types) const
+{
+	std::vector<uint32_t> uniqueFamilies;
+	for (VulkanQueueType::Type type : types)
+	{
+		if (Indices[type] != InvalidIndex)
+			uniqueFamilies.push_back(Indices[type]);
+	}
+
+	std::sort(uniqueFamilies.begin(), uniqueFamilies.end());
+	uniqueFamilies.erase(std::unique(uniqueFamilies.begin(), uniqueFamilies.end()), uniqueFamilies.end());
+	return (uniqueFamilies);
+}
+
+std::vector<uint32_t> VulkanQueueFamilyIndices::GetUniqueFamilies() const
+{
+	return (GetUniqueFamilies({ VulkanQueueType::Graphic, VulkanQueueType::Present, VulkanQueueType::Compute, VulkanQueueType::Transfer }));
+}
+
+bool VulkanQueueFamilyIndices::LogSelfTest()
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Queue families self test, {:s}: expected {:s}", scenario, expectation);
+		failureCount++;
+	};
+	auto makeFamily = [](vk::QueueFlags flags, uint32_t queueCount = 1)
+	{
+		vk::QueueFamilyProperties family;
+		family.queueFlags = flags;
+		family.queueCount = queueCount;
+		return (family);
+	};
+	auto expectFamilies = [&expect](const VulkanQueueFamilyIndices& indices, std::string_view scenario, std::array<uint32_t, VulkanQueueType::COUNT> expectedIndices)
+	{
+		for (uint8_t type = 0; type < VulkanQueueType::COUNT; type++)
+		{
+			const VulkanQueueType::Type queueType = static_cast<VulkanQueueType::Type>(type);
+			expect(indices[queueType] == expectedIndices[type], scenario, std::format("the {:s} queue on family {:d} (got {:d})",
+				VulkanQueueType::ToString(queueType), expectedIndices[type], indices[queueType]));
+		}
+	};
+	const vk::QueueFlags universal = vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer;
+	const auto presentEverywhere = [](uint32_t) { return (true); };
+
+	/* SINGLE UNIVERSAL FAMILY */
+	{
+		const std::string_view scenario = "single universal family";
+		const VulkanQueueFamilyIndices indices = Select({ makeFamily(universal, 16) }, presentEverywhere);
+
+		expectFamilies(indices, scenario, { 0, 0, 0, 0 });
+		expect(indices.IsComplete(), scenario, "every type to have a family");
+		expect(indices.IsDedicated(VulkanQueueType::Compute) == false && indices.IsDedicated(VulkanQueueType::Transfer) == false, scenario, "every type to share the graphic queue");
+		expect(indices.GetUniqueFamilies() == std::vector<uint32_t>{ 0 }, scenario, "a single queue to create");
+	}
+
+	/* SEPARATE COMPUTE AND TRANSFER FAMILIES */
+	{
+		const std::string_view scenario = "separate compute and transfer families";
+		// A transfer only family before the compute one, and a second universal family that must not be picked
+		const VulkanQueueFamilyIndices indices = Select({
+			makeFamily(universal),
+			makeFamily(vk::QueueFlagBits::eTransfer),
+			makeFamily(vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer),
+			makeFamily(universal)
+		}, presentEverywhere);
+
+		expectFamilies(indices, scenario, { 0, 0, 2, 1 });
+		expect(indices.IsDedicated(VulkanQueueType::Compute) && indices.IsDedicated(VulkanQueueType::Transfer), scenario, "dedicated compute and transfer queues");
+		expect(indices.GetUniqueFamilies() == std::vector<uint32_t>{ 0, 1, 2 }, scenario, "a queue to create per family used");
+		expect(indices.GetUniqueFamilies({ VulkanQueueType::Graphic, VulkanQueueType::Present }) == std::vector<uint32_t>{ 0 }, scenario, "the swap chain images exclusive to the graphic family");
+	}
+
+	/* PRESENT ONLY ON A NON-GRAPHICS FAMILY */
+	{
+		const std::string_view scenario = "present only on a non-graphics family";
+		// Family 1 could present but has no queue
+		const VulkanQueueFamilyIndices indices = Select({
+			makeFamily(universal),
+			makeFamily(vk::QueueFlagBits::eTransfer, 0),
+			makeFamily(vk::QueueFlagBits::eCompute)
+		}, [](uint32_t familyIndex) { return (familyIndex != 0); });
+
+		expectFamilies(indices, scenario, { 0, 2, 2, 2 });
+		expect(indices.IsComplete(), scenario, "every type to have a family");
+		expect(indices.GetUniqueFamilies({ VulkanQueueType::Graphic, VulkanQueueType::Present }) == std::vector<uint32_t>{ 0, 2 }, scenario, "the swap chain images shared by the graphic and present families");
+	}
+
+	/* NO DEDICATED TRANSFER FAMILY */
+	{
+		const std::string_view scenario = "no dedicated transfer family";
+		const VulkanQueueFamilyIndices withCompute = Select({ makeFamily(universal), makeFamily(vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer) }, presentEverywhere);
+		expectFamilies(withCompute, scenario, { 0, 0, 1, 1 });
+
+		// Neither dedicated compute nor transfer: both fall back on the graphic family
+		const VulkanQueueFamilyIndices graphicOnly = Select({ makeFamily(universal), makeFamily(universal) }, presentEverywhere);
+		expectFamilies(graphicOnly, scenario, { 0, 0, 0, 0 });
+	}
+
+	/* NO GRAPHIC FAMILY */
+	{
+		const std::string_view scenario = "no graphic family";
+		const VulkanQueueFamilyIndices indices = Select({ makeFamily(vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer) }, [](uint32_t) { return (false); });
+
+		expectFamilies(indices, scenario, { InvalidIndex, InvalidIndex, 0, 0 });
+		expect(indices.IsComplete() == false, scenario, "the device to be rejected");
+	}
+
+	OV_LOG(LogVulkan, Display, "Queue families self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
+
+/* VULKAN QUEUE TYPE NAMESPACE */
+
+const char* VulkanQueueType::ToString(Type vulkanQueueType)
+{
+	switch (vulkanQueueType)
+	{
+	case Type::Graphic:
+		return ("Graphic");
+	case Type::Present:
+		return ("Present");
+	case Type::Compute:
+		return ("Compute");
+	case Type::Transfer:
+		return ("Transfer");
+	default:
+		return ("Unknown");
+	}
+}
@@ -1,7 +1,61 @@
 #include "Vulkan/VulkanRayTracingPipeline.h"
 #include "Vulkan/VulkanDeviceHandler.h"
 
-#include <fstream>
+#include <algorithm>
+
+namespace
+{
+	/** The source of each shader, before the defines of its variants */
+	const std::array<VulkanShaderSource, RayTracingShaderType::COUNT> ShaderSources = {
+		VulkanShaderSource{ "raytrace.rgen", vk::ShaderStageFlagBits::eRaygenKHR },
+		VulkanShaderSource{ "raytrace.rmiss", vk::ShaderStageFlagBits::eMissKHR },
+		VulkanShaderSource{ "raytrace.rchit", vk::ShaderStageFlagBits::eClosestHitKHR },
+		VulkanShaderSource{ "raytrace.rint", vk::ShaderStageFlagBits::eIntersectionKHR },
+	};
+}
+
+bool VulkanRayTracingPipeline::LoadShaders()
+{
+	// Load shaders, compiled only if they changed since the last launch
+	CHECK(m_ShaderCompiler);
+	m_DescriptorLayout.Clear();
+
+	// The variants of all the shaders are compiled together, in parallel
+	std::vector<VulkanShaderSource> variantSources;
+	for (int i = 0; i < RayTracingShaderType::COUNT; ++i)
+	{
+		const VulkanShaderPermutationDomain& permutationDomain = GetPermutationDomain(static_cast<RayTracingShaderType::Type>(i));
+		m_VariantKeys[i] = permutationDomain.GetVariantKeys();
+		for (uint32_t variantKey : m_VariantKeys[i])
+			variantSources.push_back(permutationDomain.MakeVariantSource(ShaderSources[i], variantKey));
+	}
+
+	std::vector<std::vector<uint32_t>> variantSpirvs;
+	if (!m_ShaderCompiler->GetSpirv(variantSources, variantSpirvs))
+		return (false);
+
+	size_t variant = 0;
+	for (int i = 0; i < RayTracingShaderType::COUNT; ++i)
+	{
+		for (size_t j = 0; j < m_VariantKeys[i].size(); ++j, ++variant)
+		{
+			const vk::ShaderModule shaderModule = CreateShaderModule(variantSources[variant], variantSpirvs[variant]);
+			if (!shaderModule)
+				return (false);
+			m_ShaderModules[i].push_back(shaderModule);
+		}
+	}
+
+#if WITH_LOGGING
+	for (const VulkanDescriptorBinding& binding : m_DescriptorLayout.GetBindings())
+	{
+		OV_LOG(LogVulkan, Verbose, "Descriptor \"{:s}\": set {:d}, binding {:d}, {:d} {:s} ({:s})",
+			binding.Name, binding.Set, binding.Binding, binding.Count, vk::to_string(binding.Type), vk::to_string(binding.Stages)
+		);
+	}
+#endif
+	return (true);
+}
 
 void VulkanRayTracingPipeline::CreateRayTracingPipeline(const vk::DescriptorSetLayout& vkDescriptorLayout, const vk::PipelineCache& pipelineCache)
 {
@@ -16,49 +70,41 @@ void VulkanRayTracingPipeline::CreateRayTracingPipeline(const vk::DescriptorSetL
 
 	m_PipelineLayout = m_VkDevice->Raw().createPipelineLayout(pipelineLayoutInfo, nullptr, *m_Dldi);
 
-	// Load shaders
-	m_ShaderModules[RayTracingShaderType::RayGeneration].push_back(CreateShaderModule("C:/MyProject/OpenVoxel/Engine/intermediate/Shaders/RayGen.spv"));
-	m_ShaderModules[RayTracingShaderType::Miss].push_back(CreateShaderModule("C:/MyProject/OpenVoxel/Engine/intermediate/Shaders/Miss.spv"));
-	m_ShaderModules[RayTracingShaderType::ClossestHit].push_back(CreateShaderModule("C:/MyProject/OpenVoxel/Engine/intermediate/Shaders/Hit.spv"));
-	m_ShaderModules[RayTracingShaderType::Intersection].push_back(CreateShaderModule("C:/MyProject/OpenVoxel/Engine/intermediate/Shaders/Intersection.spv"));
+	// The shaders have been loaded by LoadShaders
+	CHECK(m_ShaderModules[RayTracingShaderType::RayGeneration].empty() == false);
 
+	// The specialization constants of the permutation of each shader, they must live until the pipeline is created
+	std::array<std::vector<vk::SpecializationMapEntry>, RayTracingShaderType::COUNT> specializationEntries;
+	std::array<std::vector<uint32_t>, RayTracingShaderType::COUNT> specializationData;
+	std::array<vk::SpecializationInfo, RayTracingShaderType::COUNT> specializationInfos;
+	auto createShaderStage = [&](RayTracingShaderType::Type rayTracingShaderType)
+		{
+			const VulkanShaderPermutationDomain& permutationDomain = GetPermutationDomain(rayTracingShaderType);
+			permutationDomain.GetSpecialization(m_PermutationKeys[rayTracingShaderType], specializationEntries[rayTracingShaderType], specializationData[rayTracingShaderType]);
+			specializationInfos[rayTracingShaderType] = vk::SpecializationInfo(
+				static_cast<uint32_t>(specializationEntries[rayTracingShaderType].size()), specializationEntries[rayTracingShaderType].data(),
+				specializationData[rayTracingShaderType].size() * sizeof(uint32_t), specializationData[rayTracingShaderType].data()
+			);
+
+			OV_LOG_IF(permutationDomain.IsEmpty() == false, LogVulkan, Verbose, "Shader \"{:s}\" permutation: {:s}",
+				ShaderSources[rayTracingShaderType].Name, permutationDomain.ToString(m_PermutationKeys[rayTracingShaderType])
+			);
+
+			return (vk::PipelineShaderStageCreateInfo(
+				vk::PipelineShaderStageCreateFlags(),
+				RayTracingShaderType::ToShaderStageFlagBits(rayTracingShaderType),
+				GetShaderModule(rayTracingShaderType),
+				"main",
+				specializationEntries[rayTracingShaderType].empty() ? nullptr : &specializationInfos[rayTracingShaderType]
+			));
+		};
+
+	// The groups refer to the shaders by their index in the stages
 	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
-	shaderStages.push_back(
-		vk::PipelineShaderStageCreateInfo(
-			vk::PipelineShaderStageCreateFlags(),
-			vk::ShaderStageFlagBits::eRaygenKHR,
-			m_ShaderModules[RayTracingShaderType::RayGeneration][0],
-			"main",
-			nullptr
-		)
-	);
-	shaderStages.push_back(
-		vk::PipelineShaderStageCreateInfo(
-			vk::PipelineShaderStageCreateFlags(),
-			vk::ShaderStageFlagBits::eClosestHitKHR,
-			m_ShaderModules[RayTracingShaderType::ClossestHit][0],
-			"main",
-			nullptr
-		)
-	);
-	shaderStages.push_back(
-		vk::PipelineShaderStageCreateInfo(
-			vk::PipelineShaderStageCreateFlags(),
-			vk::ShaderStageFlagBits::eMissKHR,
-			m_ShaderModules[RayTracingShaderType::Miss][0],
-			"main",
-			nullptr
-		)
-	);
-	shaderStages.push_back(
-		vk::PipelineShaderStageCreateInfo(
-			vk::PipelineShaderStageCreateFlags(),
-			vk::ShaderStageFlagBits::eIntersectionKHR,
-			m_ShaderModules[RayTracingShaderType::Intersection][0],
-			"main",
-			nullptr
-		)
-	);
+	shaderStages.push_back(createShaderStage(RayTracingShaderType::RayGeneration));
+	shaderStages.push_back(createShaderStage(RayTracingShaderType::ClossestHit));
+	shaderStages.push_back(createShaderStage(RayTracingShaderType::Miss));
+	shaderStages.push_back(createShaderStage(RayTracingShaderType::Intersection));
 
 	m_ShaderGroups.clear();
 	m_ShaderGroups.push_back(
@@ -119,31 +165,54 @@ void VulkanRayTracingPipeline::DestroyRayTracingPipeline()
 	m_VkDevice->Raw().destroyPipeline(m_Pipeline);
 }
 
-vk::ShaderModule VulkanRayTracingPipeline::CreateShaderModule(const char* path) const
+vk::ShaderModule VulkanRayTracingPipeline::CreateShaderModule(const VulkanShaderSource& source, const std::vector<uint32_t>& spirv)
 {
-	// load path to text
-	std::ifstream shaderFile(path, std::ios::ate | std::ios::binary);
-	if (!shaderFile.is_open())
+	// The layout of the descriptors is made from what the shaders declare
+	VulkanShaderReflection reflection;
+	std::string reflectionError;
+	if (!VulkanShaderReflection::Reflect(spirv, reflection, reflectionError) || !m_DescriptorLayout.AddShader(reflection, reflectionError))
 	{
-		OV_LOG(LogVulkan, Fatal, "Unable to load shader \"{:s}\"", path);
+		OV_LOG(LogVulkan, Fatal, "Unable to reflect the descriptors of the shader \"{:s}\": {:s}", source.Name, reflectionError);
 		return {};
 	}
 
-	std::streamsize fileSize = shaderFile.tellg();
-	shaderFile.seekg(0, std::ios::beg);
-	std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
-	shaderFile.read((char*)buffer.data(), fileSize);
-
-	shaderFile.close();
-
 	vk::ShaderModuleCreateInfo createInfo(
 		vk::ShaderModuleCreateFlags(),
-		buffer.size() * sizeof(uint32_t), reinterpret_cast<const uint32_t*>(buffer.data())
+		spirv.size() * sizeof(uint32_t), spirv.data()
 	);
 
 	return m_VkDevice->Raw().createShaderModule(createInfo);
 }
 
+vk::ShaderModule VulkanRayTracingPipeline::GetShaderModule(RayTracingShaderType::Type rayTracingShaderType) const
+{
+	const uint32_t variantKey = GetPermutationDomain(rayTracingShaderType).GetVariantKey(m_PermutationKeys[rayTracingShaderType]);
+	const std::vector<uint32_t>& variantKeys = m_VariantKeys[rayTracingShaderType];
+	const auto variantIt = std::find(variantKeys.begin(), variantKeys.end(), variantKey);
+	CHECK(variantIt != variantKeys.end());
+	return (m_ShaderModules[rayTracingShaderType][variantIt - variantKeys.begin()]);
+}
+
+const VulkanShaderPermutationDomain& VulkanRayTracingPipeline::GetPermutationDomain(RayTracingShaderType::Type rayTracingShaderType)
+{
+	// The dimensions of each shader, they must match the defines and the constant_id of its source
+	static const std::array<VulkanShaderPermutationDomain, RayTracingShaderType::COUNT> permutationDomains = {
+		// raytrace.rgen: what the image show, chosen when creating the pipeline
+		VulkanShaderPermutationDomain({
+			{ "DEBUG_VIEW", RayTracingDebugView::COUNT, VulkanShaderPermutationBinding::SpecializationConstant, 0 },
+		}),
+		// raytrace.rmiss
+		VulkanShaderPermutationDomain(),
+		// raytrace.rchit
+		VulkanShaderPermutationDomain(),
+		// raytrace.rint: whether or not a ray starting in a voxel hit it, a variant of its own
+		VulkanShaderPermutationDomain({
+			{ "INSIDE_HITS", 2, VulkanShaderPermutationBinding::Define },
+		}),
+	};
+	return (permutationDomains[rayTracingShaderType]);
+}
+
 /* RAYTRACING SHADER TYPE */
 
 vk::ShaderStageFlagBits RayTracingShaderType::ToShaderStageFlagBits(Type rayTracingShaderType)
@@ -161,3 +230,19 @@ vk::ShaderStageFlagBits RayTracingShaderType::ToShaderStageFlagBits(Type rayTrac
 	}
 	return (vk::ShaderStageFlagBits::eAll);
 }
+
+/* RAYTRACING DEBUG VIEW */
+
+const char* RayTracingDebugView::ToString(Type debugView)
+{
+	switch (debugView)
+	{
+	case RayTracingDebugView::None:
+		return ("None");
+	case RayTracingDebugView::HitDistance:
+		return ("HitDistance");
+	case RayTracingDebugView::HitMask:
+		return ("HitMask");
+	}
+	return ("Unknown");
+}
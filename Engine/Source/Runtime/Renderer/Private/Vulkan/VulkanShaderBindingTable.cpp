@@ -50,32 +50,21 @@ void VulkanShaderBindingTable::CreateShaderBindingTable()
 
 	m_SbtBuffer = m_VkDevice->Raw().createBuffer(sbtBufferInfo);
 
-	VulkanMemoryRequirementsExtended sbtMemoryRequirements =
-		m_VkDevice->FindMemoryRequirement(
-			m_SbtBuffer,
-			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-		);
-
-	vk::MemoryAllocateFlagsInfo memoryAllocateFlagsInfo(
-		vk::MemoryAllocateFlagBits::eDeviceAddress
+	// The start of each table must be aligned on the shader group base alignment
+	m_SbtBufferAllocation = m_VkDevice->AllocateBufferMemory(
+		m_SbtBuffer,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		baseAlignment
 	);
-	vk::MemoryAllocateInfo sbtMemoryAllocateInfo(
-		sbtMemoryRequirements.size,
-		sbtMemoryRequirements.MemoryTypeIndex,
-		&memoryAllocateFlagsInfo
-	);
-
-	m_SbtBufferMemory = m_VkDevice->Raw().allocateMemory(sbtMemoryAllocateInfo);
-
-	m_VkDevice->Raw().bindBufferMemory(m_SbtBuffer, m_SbtBufferMemory, 0);
+	CHECK(m_SbtBufferAllocation.IsValid());
 
 	vk::DeviceAddress sbtDeviceAddress = m_VkDevice->Raw().getBufferAddress({ m_SbtBuffer });
 	m_RaygenShaderBindingTable.deviceAddress = sbtDeviceAddress;
 	m_MissShaderBindingTable.deviceAddress = sbtDeviceAddress + m_RaygenShaderBindingTable.size;
 	m_HitShaderBindingTable.deviceAddress = sbtDeviceAddress + m_RaygenShaderBindingTable.size + m_MissShaderBindingTable.size;
 
-	void* data;
-	m_VkDevice->Raw().mapMemory(m_SbtBufferMemory, 0, sbtSize, vk::MemoryMapFlags(), &data);
+	// The host visible memory stays mapped
+	void* data = m_SbtBufferAllocation.MappedData;
 
 	auto getHandle = [handles, handleSize](int i) { return handles.data() + i * handleSize; };
 
@@ -104,11 +93,10 @@ void VulkanShaderBindingTable::CreateShaderBindingTable()
 	memcpy(pData, getHandle(handleIndex), handleSize);
 	handleIndex++;
 
-	m_VkDevice->Raw().unmapMemory(m_SbtBufferMemory);
 }
 
 void VulkanShaderBindingTable::DestroyShaderBindingTable()
 {
-	m_VkDevice->Raw().freeMemory(m_SbtBufferMemory);
 	m_VkDevice->Raw().destroyBuffer(m_SbtBuffer);
+	m_VkDevice->FreeMemory(m_SbtBufferAllocation);
 }
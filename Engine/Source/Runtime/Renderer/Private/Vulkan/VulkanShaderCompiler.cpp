@@ -0,0 +1,336 @@
+#include "Vulkan/VulkanShaderCompiler.h"
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <system_error>
+
+namespace
+{
+	constexpr uint64_t HashOffsetBasis = 14695981039346656037ull;
+
+	/** FNV-1a on the bytes of the data, continuing from hash */
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HashOffsetBasis)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return (hash);
+	}
+
+	/** Hash the length before the content, so ("ab", "c") and ("a", "bc") differ */
+	uint64_t HashString(const std::string& str, uint64_t hash)
+	{
+		const uint64_t length = str.size();
+		hash = HashBytes(&length, sizeof(length), hash);
+		return (HashBytes(str.data(), str.size(), hash));
+	}
+
+	template<typename T>
+	void WriteValue(std::vector<uint8_t>& data, const T& value)
+	{
+		const size_t offset = data.size();
+		data.resize(offset + sizeof(T));
+		memcpy(data.data() + offset, &value, sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadValue(const std::vector<uint8_t>& data, size_t& offset, T& outValue)
+	{
+		if (data.size() - offset < sizeof(T))
+			return (false);
+		memcpy(&outValue, data.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return (true);
+	}
+
+	bool ReadFile(const std::filesystem::path& filePath, std::string& outContent)
+	{
+		std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+		if (!file.is_open())
+			return (false);
+
+		const std::streamsize fileSize = file.tellg();
+		file.seekg(0, std::ios::beg);
+		outContent.resize(static_cast<size_t>(std::max<std::streamsize>(fileSize, 0)));
+		file.read(outContent.data(), fileSize);
+		return (static_cast<bool>(file));
+	}
+
+	/** Write the file next to its destination then rename it, a crash never leave a partial entry in the cache */
+	bool WriteFileAtomically(const std::filesystem::path& filePath, const std::vector<uint8_t>& content)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(filePath.parent_path(), error);
+
+		std::filesystem::path tmpFilePath = filePath;
+		tmpFilePath += ".tmp";
+		{
+			std::ofstream file(tmpFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(content.data()), content.size());
+			file.flush();
+			if (!file)
+			{
+				file.close();
+				std::filesystem::remove(tmpFilePath, error);
+				return (false);
+			}
+		}
+
+		std::filesystem::rename(tmpFilePath, filePath, error);
+		if (error)
+		{
+			std::filesystem::remove(tmpFilePath, error);
+			return (false);
+		}
+		return (true);
+	}
+
+	/** Name of a file relative to the source directory, the same whatever the separators and the "." / ".." in the path */
+	std::string MakeSourceName(const std::filesystem::path& relativePath)
+	{
+		return (relativePath.lexically_normal().generic_string());
+	}
+}
+
+/* VULKAN SHADER CACHE ENTRY */
+
+std::vector<uint8_t> VulkanShaderCacheEntry::Serialize() const
+{
+	std::vector<uint8_t> data;
+	WriteValue(data, Magic);
+	WriteValue(data, Version);
+	WriteValue(data, static_cast<uint32_t>(Dependencies.size()));
+	WriteValue(data, static_cast<uint32_t>(Spirv.size()));
+	for (const Dependency& dependency : Dependencies)
+	{
+		WriteValue(data, static_cast<uint32_t>(dependency.Name.size()));
+		data.insert(data.end(), dependency.Name.begin(), dependency.Name.end());
+		WriteValue(data, dependency.ContentHash);
+	}
+
+	const size_t spirvOffset = data.size();
+	data.resize(spirvOffset + Spirv.size() * sizeof(uint32_t));
+	if (Spirv.empty() == false)
+		memcpy(data.data() + spirvOffset, Spirv.data(), Spirv.size() * sizeof(uint32_t));
+
+	// Catch the entries that have been damaged on disk
+	WriteValue(data, HashBytes(data.data(), data.size()));
+	return (data);
+}
+
+bool VulkanShaderCacheEntry::Deserialize(const std::vector<uint8_t>& data, VulkanShaderCacheEntry& outEntry)
+{
+	if (data.size() < sizeof(uint64_t))
+		return (false);
+	const size_t contentSize = data.size() - sizeof(uint64_t);
+	uint64_t contentHash;
+	memcpy(&contentHash, data.data() + contentSize, sizeof(uint64_t));
+	if (HashBytes(data.data(), contentSize) != contentHash)
+		return (false);
+
+	size_t offset = 0;
+	uint32_t magic, version, dependencyCount, spirvWordCount;
+	if (!ReadValue(data, offset, magic) || !ReadValue(data, offset, version) || magic != Magic || version != Version)
+		return (false);
+	if (!ReadValue(data, offset, dependencyCount) || !ReadValue(data, offset, spirvWordCount))
+		return (false);
+
+	VulkanShaderCacheEntry entry;
+	for (uint32_t i = 0; i < dependencyCount; i++)
+	{
+		uint32_t nameLength;
+		if (!ReadValue(data, offset, nameLength) || contentSize - offset < nameLength)
+			return (false);
+
+		Dependency dependency;
+		dependency.Name.assign(reinterpret_cast<const char*>(data.data() + offset), nameLength);
+		offset += nameLength;
+		if (!ReadValue(data, offset, dependency.ContentHash))
+			return (false);
+		entry.Dependencies.push_back(std::move(dependency));
+	}
+
+	if (contentSize - offset != static_cast<size_t>(spirvWordCount) * sizeof(uint32_t))
+		return (false);
+	entry.Spirv.resize(spirvWordCount);
+	if (spirvWordCount > 0)
+		memcpy(entry.Spirv.data(), data.data() + offset, spirvWordCount * sizeof(uint32_t));
+
+	outEntry = std::move(entry);
+	return (true);
+}
+
+/* VULKAN SHADER COMPILER */
+
+VulkanShaderCompiler::VulkanShaderCompiler(std::unique_ptr<VulkanShaderCompilerBackend> backend, const Settings& settings)
+	: m_Backend(std::move(backend)), m_Settings(settings)
+{
+	CHECK(m_Backend);
+}
+
+bool VulkanShaderCompiler::GetSpirv(const VulkanShaderSource& source, std::vector<uint32_t>& outSpirv)
+{
+	START_NAMED_TIMER(ShaderTimer);
+
+	std::string sourceContent;
+	if (!ReadSource(source.Name, sourceContent))
+	{
+		OV_LOG(LogVulkan, Error, "Unable to read the shader \"{:s}\" in \"{:s}\"", source.Name, m_Settings.SourceDirectory.string());
+		m_Statistics.Failures++;
+		return (false);
+	}
+
+	const std::filesystem::path entryPath = m_Settings.CacheDirectory / (MakeCacheKey(source, sourceContent) + ".spvcache");
+
+	// A missing, damaged or stale entry is compiled again and replaced
+	std::string entryContent;
+	VulkanShaderCacheEntry entry;
+	if (ReadFile(entryPath, entryContent)
+		&& VulkanShaderCacheEntry::Deserialize(std::vector<uint8_t>(entryContent.begin(), entryContent.end()), entry)
+		&& AreDependenciesUpToDate(entry))
+	{
+		m_Statistics.CacheHits++;
+		outSpirv = std::move(entry.Spirv);
+		return (true);
+	}
+	m_Statistics.CacheMisses++;
+
+	// Record the includes while they are resolved, with the content the shader is compiled from
+	entry = VulkanShaderCacheEntry();
+	VulkanShaderCompileRequest request;
+	request.Name = MakeSourceName(source.Name);
+	request.Source = std::move(sourceContent);
+	request.Stage = source.Stage;
+	request.Defines = source.Defines;
+	request.EntryPoint = source.EntryPoint;
+	request.TargetVulkanVersion = m_Settings.TargetVulkanVersion;
+	request.bOptimize = m_Settings.bOptimize;
+	request.ResolveInclude = [this, &entry](const std::string& requestedName, const std::string& includerName, bool bRelative, std::string& outName, std::string& outContent)
+	{
+		// "..." is searched next to its includer first, <...> only from the source directory
+		std::vector<std::string> candidates;
+		if (bRelative)
+			candidates.push_back(MakeSourceName(std::filesystem::path(includerName).parent_path() / requestedName));
+		candidates.push_back(MakeSourceName(requestedName));
+
+		for (const std::string& candidate : candidates)
+		{
+			if (!ReadSource(candidate, outContent))
+				continue;
+
+			outName = candidate;
+			const VulkanShaderCacheEntry::Dependency dependency{ candidate, HashBytes(outContent.data(), outContent.size()) };
+			if (std::find(entry.Dependencies.begin(), entry.Dependencies.end(), dependency) == entry.Dependencies.end())
+				entry.Dependencies.push_back(dependency);
+			return (true);
+		}
+		return (false);
+	};
+
+	std::string compileLog;
+	if (!m_Backend->Compile(request, entry.Spirv, compileLog))
+	{
+		OV_LOG(LogVulkan, Error, "Unable to compile the shader \"{:s}\":\n{:s}", source.Name, compileLog);
+		m_Statistics.Failures++;
+		return (false);
+	}
+	OV_LOG_IF(compileLog.empty() == false, LogVulkan, Warning, "Shader \"{:s}\" compiled with warnings:\n{:s}", source.Name, compileLog);
+
+	// The shader is still usable if the cache can't be written, it will just be compiled again
+	const bool bCached = WriteFileAtomically(entryPath, entry.Serialize());
+	OV_LOG_IF(!bCached, LogVulkan, Warning, "Unable to write the shader cache entry \"{:s}\"", entryPath.string());
+
+#ifndef NO_PROFILING
+	OV_LOG(LogVulkan, Verbose, "Compiled the shader \"{:s}\" ({:d} includes) in {:.2f}ms",
+		source.Name, entry.Dependencies.size(), TO_DOUBLE_MILLISECONDS(TIMER_NAMED_ELAPSED(ShaderTimer))
+	);
+#endif
+
+	outSpirv = std::move(entry.Spirv);
+	return (true);
+}
+
+bool VulkanShaderCompiler::GetSpirv(const std::vector<VulkanShaderSource>& sources, std::vector<std::vector<uint32_t>>& outSpirvs)
+{
+	outSpirvs.assign(sources.size(), std::vector<uint32_t>());
+	if (sources.empty())
+		return (true);
+
+	START_NAMED_TIMER(ShadersTimer);
+
+	// The cache entries are different files, so the sources can be compiled by any thread
+	std::atomic<bool> bSucceeded = true;
+	auto compileSource = [&](uint32_t source)
+		{
+			if (!GetSpirv(sources[source], outSpirvs[source]))
+				bSucceeded = false;
+		};
+
+	uint32_t threadCount = 1;
+	if (JobSystem::IsCreated())
+	{
+		// A job per source, a compilation is much longer than the overhead of a job
+		JobSystem& jobSystem = JobSystem::Get();
+		threadCount = std::min(jobSystem.GetThreadCount(), static_cast<uint32_t>(sources.size()));
+		jobSystem.ParallelFor(static_cast<uint32_t>(sources.size()), compileSource, 1);
+	}
+	else
+	{
+		for (uint32_t source = 0; source < sources.size(); source++)
+			compileSource(source);
+	}
+
+#ifndef NO_PROFILING
+	OV_LOG(LogVulkan, Verbose, "Got {:d} shaders with {:d} threads in {:.2f}ms",
+		sources.size(), threadCount, TO_DOUBLE_MILLISECONDS(TIMER_NAMED_ELAPSED(ShadersTimer))
+	);
+#endif
+
+	return (bSucceeded);
+}
+
+std::string VulkanShaderCompiler::MakeCacheKey(const VulkanShaderSource& source, const std::string& sourceContent) const
+{
+	uint64_t hash = HashOffsetBasis;
+	hash = HashString(m_Backend->GetVersion(), hash);
+	hash = HashBytes(&VulkanShaderCacheEntry::Version, sizeof(VulkanShaderCacheEntry::Version), hash);
+	hash = HashString(MakeSourceName(source.Name), hash);
+	hash = HashString(sourceContent, hash);
+
+	const uint32_t stage = static_cast<uint32_t>(source.Stage);
+	hash = HashBytes(&stage, sizeof(stage), hash);
+	hash = HashString(source.EntryPoint, hash);
+	for (const auto& [name, value] : source.Defines)
+	{
+		hash = HashString(name, hash);
+		hash = HashString(value, hash);
+	}
+
+	hash = HashBytes(&m_Settings.TargetVulkanVersion, sizeof(m_Settings.TargetVulkanVersion), hash);
+	hash = HashBytes(&m_Settings.bOptimize, sizeof(m_Settings.bOptimize), hash);
+
+	// The name of the source keep the entries readable when looking at the cache directory
+	return (std::format("{:s}.{:016x}", std::filesystem::path(source.Name).filename().string(), hash));
+}
+
+bool VulkanShaderCompiler::AreDependenciesUpToDate(const VulkanShaderCacheEntry& entry) const
+{
+	std::string content;
+	for (const VulkanShaderCacheEntry::Dependency& dependency : entry.Dependencies)
+	{
+		if (!ReadSource(dependency.Name, content) || HashBytes(content.data(), content.size()) != dependency.ContentHash)
+			return (false);
+	}
+	return (true);
+}
+
+bool VulkanShaderCompiler::ReadSource(const std::string& name, std::string& outContent) const
+{
+	return (ReadFile(m_Settings.SourceDirectory / name, outContent));
+}
@@ -0,0 +1,129 @@
+#include "Vulkan/VulkanShaderPermutation.h"
+
+#include <algorithm>
+#include <format>
+
+VulkanShaderPermutationDomain::VulkanShaderPermutationDomain(std::initializer_list<VulkanShaderPermutationDimension> dimensions)
+	: m_Dimensions(dimensions)
+{
+	uint64_t stride = 1;
+	for (const VulkanShaderPermutationDimension& dimension : m_Dimensions)
+	{
+		CHECK(dimension.ValueCount > 0 && FindDimension(dimension.Name) == static_cast<uint32_t>(m_Strides.size()));
+		m_Strides.push_back(static_cast<uint32_t>(stride));
+		stride *= dimension.ValueCount;
+		// The keys must fit in 32 bits
+		CHECK(stride <= UINT32_MAX);
+	}
+}
+
+uint32_t VulkanShaderPermutationDomain::FindDimension(std::string_view name) const
+{
+	for (uint32_t i = 0; i < m_Dimensions.size(); i++)
+	{
+		if (m_Dimensions[i].Name == name)
+			return (i);
+	}
+	return (UINT32_MAX);
+}
+
+uint32_t VulkanShaderPermutationDomain::GetPermutationCount() const
+{
+	return (m_Dimensions.empty() ? 1 : m_Strides.back() * m_Dimensions.back().ValueCount);
+}
+
+uint32_t VulkanShaderPermutationDomain::SetValue(uint32_t key, uint32_t dimension, uint32_t value) const
+{
+	CHECK(dimension < m_Dimensions.size() && value < m_Dimensions[dimension].ValueCount);
+	return (key - GetValue(key, dimension) * m_Strides[dimension] + value * m_Strides[dimension]);
+}
+
+uint32_t VulkanShaderPermutationDomain::SetValue(uint32_t key, std::string_view name, uint32_t value) const
+{
+	const uint32_t dimension = FindDimension(name);
+	return (dimension != UINT32_MAX ? SetValue(key, dimension, value) : key);
+}
+
+uint32_t VulkanShaderPermutationDomain::GetValue(uint32_t key, uint32_t dimension) const
+{
+	CHECK(dimension < m_Dimensions.size());
+	return ((key / m_Strides[dimension]) % m_Dimensions[dimension].ValueCount);
+}
+
+uint32_t VulkanShaderPermutationDomain::GetVariantKey(uint32_t key) const
+{
+	for (uint32_t i = 0; i < m_Dimensions.size(); i++)
+	{
+		if (m_Dimensions[i].Binding == VulkanShaderPermutationBinding::SpecializationConstant)
+			key = SetValue(key, i, 0);
+	}
+	return (key);
+}
+
+std::vector<uint32_t> VulkanShaderPermutationDomain::GetVariantKeys() const
+{
+	// Count through the define dimensions only, like an odometer
+	std::vector<uint32_t> variantKeys = { 0 };
+	for (uint32_t i = 0; i < m_Dimensions.size(); i++)
+	{
+		if (m_Dimensions[i].Binding != VulkanShaderPermutationBinding::Define)
+			continue;
+
+		const size_t previousCount = variantKeys.size();
+		for (uint32_t value = 1; value < m_Dimensions[i].ValueCount; value++)
+		{
+			for (size_t j = 0; j < previousCount; j++)
+				variantKeys.push_back(variantKeys[j] + value * m_Strides[i]);
+		}
+	}
+	std::sort(variantKeys.begin(), variantKeys.end());
+	return (variantKeys);
+}
+
+VulkanShaderSource VulkanShaderPermutationDomain::MakeVariantSource(const VulkanShaderSource& source, uint32_t key) const
+{
+	VulkanShaderSource variantSource = source;
+	for (uint32_t i = 0; i < m_Dimensions.size(); i++)
+	{
+		if (m_Dimensions[i].Binding == VulkanShaderPermutationBinding::Define)
+			variantSource.Defines.emplace_back(m_Dimensions[i].Name, std::to_string(GetValue(key, i)));
+	}
+	return (variantSource);
+}
+
+void VulkanShaderPermutationDomain::GetSpecialization(uint32_t key, std::vector<vk::SpecializationMapEntry>& outEntries, std::vector<uint32_t>& outData) const
+{
+	outEntries.clear();
+	outData.clear();
+	for (uint32_t i = 0; i < m_Dimensions.size(); i++)
+	{
+		if (m_Dimensions[i].Binding != VulkanShaderPermutationBinding::SpecializationConstant)
+			continue;
+
+		outEntries.push_back(vk::SpecializationMapEntry(m_Dimensions[i].ConstantId, static_cast<uint32_t>(outData.size() * sizeof(uint32_t)), sizeof(uint32_t)));
+		outData.push_back(GetValue(key, i));
+	}
+}
+
+std::string VulkanShaderPermutationDomain::ToString(uint32_t key) const
+{
+	std::string description;
+	for (uint32_t i = 0; i < m_Dimensions.size(); i++)
+		description += std::format("{:s}{:s}={:d}", i > 0 ? " " : "", m_Dimensions[i].Name, GetValue(key, i));
+	return (description);
+}
+
+/* VULKAN SHADER PERMUTATION BINDING NAMESPACE */
+
+const char* VulkanShaderPermutationBinding::ToString(Type binding)
+{
+	switch (binding)
+	{
+	case Type::Define:
+		return ("Define");
+	case Type::SpecializationConstant:
+		return ("SpecializationConstant");
+	default:
+		return ("Unknown");
+	}
+}
@@ -0,0 +1,482 @@
+#include "Vulkan/VulkanShaderReflection.h"
+#include "Vulkan/VulkanShaderCompiler.h"
+
+#include <algorithm>
+#include <format>
+#include <unordered_map>
+
+namespace
+{
+	/** The parts of the SPIR-V specification the reflection needs */
+	namespace Spirv
+	{
+		constexpr uint32_t Magic = 0x07230203;
+		constexpr size_t HeaderWordCount = 5;
+
+		enum Op : uint16_t
+		{
+			OpName = 5,
+			OpEntryPoint = 15,
+			OpTypeImage = 25,
+			OpTypeSampler = 26,
+			OpTypeSampledImage = 27,
+			OpTypeArray = 28,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpConstant = 43,
+			OpSpecConstant = 50,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpTypeAccelerationStructureKHR = 5341,
+		};
+
+		enum Decoration : uint32_t
+		{
+			Block = 2,
+			BufferBlock = 3,
+			Binding = 33,
+			DescriptorSet = 34,
+		};
+
+		enum StorageClass : uint32_t
+		{
+			UniformConstant = 0,
+			Uniform = 2,
+			StorageBuffer = 12,
+		};
+
+		enum Dim : uint32_t
+		{
+			DimBuffer = 5,
+			DimSubpassData = 6,
+		};
+
+		vk::ShaderStageFlags ToShaderStage(uint32_t executionModel)
+		{
+			switch (executionModel)
+			{
+			case 0: return (vk::ShaderStageFlagBits::eVertex);
+			case 1: return (vk::ShaderStageFlagBits::eTessellationControl);
+			case 2: return (vk::ShaderStageFlagBits::eTessellationEvaluation);
+			case 3: return (vk::ShaderStageFlagBits::eGeometry);
+			case 4: return (vk::ShaderStageFlagBits::eFragment);
+			case 5: return (vk::ShaderStageFlagBits::eCompute);
+			case 5313: return (vk::ShaderStageFlagBits::eRaygenKHR);
+			case 5314: return (vk::ShaderStageFlagBits::eIntersectionKHR);
+			case 5315: return (vk::ShaderStageFlagBits::eAnyHitKHR);
+			case 5316: return (vk::ShaderStageFlagBits::eClosestHitKHR);
+			case 5317: return (vk::ShaderStageFlagBits::eMissKHR);
+			case 5318: return (vk::ShaderStageFlagBits::eCallableKHR);
+			default: return (vk::ShaderStageFlags());
+			}
+		}
+	}
+
+	/** What an id is, as much as the reflection cares */
+	struct SpirvId
+	{
+		uint16_t Op = 0;
+		/** The words of the instruction after the opcode, the result id included */
+		const uint32_t* Operands = nullptr;
+		uint32_t OperandCount = 0;
+
+		std::string Name;
+		uint32_t Set = UINT32_MAX;
+		uint32_t Binding = UINT32_MAX;
+		bool bBlock = false;
+		bool bBufferBlock = false;
+	};
+
+	/** Decode a literal string, stored in the words with a null terminator */
+	std::string ReadString(const uint32_t* words, uint32_t wordCount)
+	{
+		const char* chars = reinterpret_cast<const char*>(words);
+		const size_t maxLength = wordCount * sizeof(uint32_t);
+		return (std::string(chars, std::find(chars, chars + maxLength, '\0')));
+	}
+}
+
+bool VulkanShaderReflection::Reflect(const std::vector<uint32_t>& spirv, VulkanShaderReflection& outReflection, std::string& outError)
+{
+	if (spirv.size() < Spirv::HeaderWordCount || spirv[0] != Spirv::Magic)
+	{
+		outError = "Not a SPIR-V module";
+		return (false);
+	}
+
+	// The id bound of the header limit the ids of the module
+	const uint32_t idBound = spirv[3];
+	std::vector<SpirvId> ids(idBound);
+	std::vector<uint32_t> variables;
+	VulkanShaderReflection reflection;
+
+	for (size_t offset = Spirv::HeaderWordCount; offset < spirv.size();)
+	{
+		const uint16_t op = static_cast<uint16_t>(spirv[offset] & 0xFFFF);
+		const uint32_t wordCount = spirv[offset] >> 16;
+		if (wordCount == 0 || offset + wordCount > spirv.size())
+		{
+			outError = std::format("Truncated instruction at word {:d}", offset);
+			return (false);
+		}
+		const uint32_t* operands = spirv.data() + offset + 1;
+		const uint32_t operandCount = wordCount - 1;
+		offset += wordCount;
+
+		// Every instruction the reflection look at start with an id (the result, or the target of the name/decoration)
+		auto getId = [&](uint32_t operand) -> SpirvId* { return (operand < operandCount && operands[operand] < idBound ? &ids[operands[operand]] : nullptr); };
+
+		switch (op)
+		{
+		case Spirv::OpEntryPoint:
+			if (operandCount > 0)
+				reflection.Stages |= Spirv::ToShaderStage(operands[0]);
+			break;
+		case Spirv::OpName:
+			if (SpirvId* id = getId(0))
+				id->Name = ReadString(operands + 1, operandCount - 1);
+			break;
+		case Spirv::OpDecorate:
+			if (SpirvId* id = getId(0); id && operandCount >= 2)
+			{
+				if (operands[1] == Spirv::DescriptorSet && operandCount >= 3)
+					id->Set = operands[2];
+				else if (operands[1] == Spirv::Binding && operandCount >= 3)
+					id->Binding = operands[2];
+				else if (operands[1] == Spirv::Block)
+					id->bBlock = true;
+				else if (operands[1] == Spirv::BufferBlock)
+					id->bBufferBlock = true;
+			}
+			break;
+		case Spirv::OpTypeImage:
+		case Spirv::OpTypeSampler:
+		case Spirv::OpTypeSampledImage:
+		case Spirv::OpTypeArray:
+		case Spirv::OpTypeRuntimeArray:
+		case Spirv::OpTypeStruct:
+		case Spirv::OpTypeAccelerationStructureKHR:
+		case Spirv::OpTypePointer:
+			if (SpirvId* id = getId(0))
+			{
+				id->Op = op;
+				id->Operands = operands;
+				id->OperandCount = operandCount;
+			}
+			break;
+		case Spirv::OpConstant:
+		case Spirv::OpSpecConstant:
+		case Spirv::OpVariable:
+			// The result id comes after the result type
+			if (SpirvId* id = getId(1))
+			{
+				id->Op = op;
+				id->Operands = operands;
+				id->OperandCount = operandCount;
+				if (op == Spirv::OpVariable)
+					variables.push_back(operands[1]);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	auto findId = [&](uint32_t id, uint16_t op) -> const SpirvId* { return (id < idBound && ids[id].Op == op ? &ids[id] : nullptr); };
+
+	for (uint32_t variableId : variables)
+	{
+		const SpirvId& variable = ids[variableId];
+		if (variable.Set == UINT32_MAX || variable.Binding == UINT32_MAX)
+			continue;
+
+		VulkanDescriptorBinding binding;
+		binding.Name = variable.Name;
+		binding.Set = variable.Set;
+		binding.Binding = variable.Binding;
+		binding.Stages = reflection.Stages;
+
+		// OpVariable: result type (a pointer), result id, storage class
+		const uint32_t storageClass = variable.OperandCount >= 3 ? variable.Operands[2] : UINT32_MAX;
+		const SpirvId* pointer = findId(variable.Operands[0], Spirv::OpTypePointer);
+		const SpirvId* type = pointer && pointer->OperandCount >= 3 && pointer->Operands[2] < idBound ? &ids[pointer->Operands[2]] : nullptr;
+
+		// Arrays of descriptors: OpTypeArray element type, length (a constant id)
+		if (type && type->Op == Spirv::OpTypeRuntimeArray)
+		{
+			outError = std::format("\"{:s}\" (set {:d}, binding {:d}) is an unbounded array of descriptors, which isn't supported", binding.Name, binding.Set, binding.Binding);
+			return (false);
+		}
+		while (type && type->Op == Spirv::OpTypeArray && type->OperandCount >= 3)
+		{
+			const SpirvId* length = findId(type->Operands[2], Spirv::OpConstant);
+			if (!length)
+				length = findId(type->Operands[2], Spirv::OpSpecConstant);
+			binding.Count *= length && length->OperandCount >= 3 ? length->Operands[2] : 1;
+			type = type->Operands[1] < idBound ? &ids[type->Operands[1]] : nullptr;
+		}
+		if (!type)
+		{
+			outError = std::format("\"{:s}\" (set {:d}, binding {:d}) has no type", binding.Name, binding.Set, binding.Binding);
+			return (false);
+		}
+
+		bool bSupported = true;
+		switch (type->Op)
+		{
+		case Spirv::OpTypeAccelerationStructureKHR:
+			binding.Type = vk::DescriptorType::eAccelerationStructureKHR;
+			break;
+		case Spirv::OpTypeSampler:
+			binding.Type = vk::DescriptorType::eSampler;
+			break;
+		case Spirv::OpTypeSampledImage:
+			binding.Type = vk::DescriptorType::eCombinedImageSampler;
+			break;
+		case Spirv::OpTypeImage:
+		{
+			// OpTypeImage: result id, sampled type, dim, depth, arrayed, multisampled, sampled (1 sampled, 2 storage), format
+			const uint32_t dim = type->OperandCount >= 3 ? type->Operands[2] : 0;
+			const bool bStorage = type->OperandCount >= 7 && type->Operands[6] == 2;
+			if (dim == Spirv::DimBuffer)
+				binding.Type = bStorage ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+			else if (dim == Spirv::DimSubpassData)
+				binding.Type = vk::DescriptorType::eInputAttachment;
+			else
+				binding.Type = bStorage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+			break;
+		}
+		case Spirv::OpTypeStruct:
+			// The blocks without an instance name are named after their block
+			if (binding.Name.empty())
+				binding.Name = type->Name;
+			if (storageClass == Spirv::StorageBuffer || (storageClass == Spirv::Uniform && type->bBufferBlock))
+				binding.Type = vk::DescriptorType::eStorageBuffer;
+			else if (storageClass == Spirv::Uniform && type->bBlock)
+				binding.Type = vk::DescriptorType::eUniformBuffer;
+			else
+				bSupported = false;
+			break;
+		default:
+			bSupported = false;
+			break;
+		}
+		if (!bSupported)
+		{
+			outError = std::format("\"{:s}\" (set {:d}, binding {:d}) has a type that isn't a descriptor", binding.Name, binding.Set, binding.Binding);
+			return (false);
+		}
+
+		reflection.Bindings.push_back(std::move(binding));
+	}
+
+	std::sort(reflection.Bindings.begin(), reflection.Bindings.end(), [](const VulkanDescriptorBinding& lhs, const VulkanDescriptorBinding& rhs)
+	{
+		return (lhs.Set != rhs.Set ? lhs.Set < rhs.Set : lhs.Binding < rhs.Binding);
+	});
+	outReflection = std::move(reflection);
+	return (true);
+}
+
+/* VULKAN DESCRIPTOR LAYOUT */
+
+bool VulkanDescriptorLayout::AddShader(const VulkanShaderReflection& reflection, std::string& outError)
+{
+	std::vector<VulkanDescriptorBinding> bindings = m_Bindings;
+	for (const VulkanDescriptorBinding& shaderBinding : reflection.Bindings)
+	{
+		auto bindingIt = std::find_if(bindings.begin(), bindings.end(), [&shaderBinding](const VulkanDescriptorBinding& binding)
+		{
+			return (binding.Set == shaderBinding.Set && binding.Binding == shaderBinding.Binding);
+		});
+
+		if (bindingIt == bindings.end())
+		{
+			// Two bindings with the same name couldn't be written by name
+			auto sameNameIt = std::find_if(bindings.begin(), bindings.end(), [&shaderBinding](const VulkanDescriptorBinding& binding) { return (binding.Name == shaderBinding.Name); });
+			if (shaderBinding.Name.empty() == false && sameNameIt != bindings.end())
+			{
+				outError = std::format("\"{:s}\" is the name of set {:d} binding {:d} and of set {:d} binding {:d}",
+					shaderBinding.Name, sameNameIt->Set, sameNameIt->Binding, shaderBinding.Set, shaderBinding.Binding);
+				return (false);
+			}
+			bindings.push_back(shaderBinding);
+			continue;
+		}
+
+		if (bindingIt->Type != shaderBinding.Type || bindingIt->Count != shaderBinding.Count)
+		{
+			outError = std::format("Set {:d} binding {:d} is declared as {:d} {:s} and as {:d} {:s}",
+				shaderBinding.Set, shaderBinding.Binding,
+				bindingIt->Count, vk::to_string(bindingIt->Type), shaderBinding.Count, vk::to_string(shaderBinding.Type));
+			return (false);
+		}
+		bindingIt->Stages |= shaderBinding.Stages;
+		if (bindingIt->Name.empty())
+			bindingIt->Name = shaderBinding.Name;
+	}
+
+	std::sort(bindings.begin(), bindings.end(), [](const VulkanDescriptorBinding& lhs, const VulkanDescriptorBinding& rhs)
+	{
+		return (lhs.Set != rhs.Set ? lhs.Set < rhs.Set : lhs.Binding < rhs.Binding);
+	});
+	m_Bindings = std::move(bindings);
+	return (true);
+}
+
+const VulkanDescriptorBinding* VulkanDescriptorLayout::FindBinding(std::string_view name) const
+{
+	auto bindingIt = std::find_if(m_Bindings.begin(), m_Bindings.end(), [name](const VulkanDescriptorBinding& binding) { return (binding.Name == name); });
+	return (bindingIt != m_Bindings.end() ? &*bindingIt : nullptr);
+}
+
+uint32_t VulkanDescriptorLayout::GetSetCount() const
+{
+	return (m_Bindings.empty() ? 0 : m_Bindings.back().Set + 1);
+}
+
+std::vector<vk::DescriptorSetLayoutBinding> VulkanDescriptorLayout::GetSetLayoutBindings(uint32_t set) const
+{
+	std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+	for (const VulkanDescriptorBinding& binding : m_Bindings)
+	{
+		if (binding.Set == set)
+			layoutBindings.push_back(vk::DescriptorSetLayoutBinding(binding.Binding, binding.Type, binding.Count, binding.Stages));
+	}
+	return (layoutBindings);
+}
+
+std::vector<vk::DescriptorPoolSize> VulkanDescriptorLayout::GetPoolSizes(uint32_t set, uint32_t setCount) const
+{
+	std::vector<vk::DescriptorPoolSize> poolSizes;
+	for (const VulkanDescriptorBinding& binding : m_Bindings)
+	{
+		if (binding.Set != set)
+			continue;
+
+		auto poolSizeIt = std::find_if(poolSizes.begin(), poolSizes.end(), [&binding](const vk::DescriptorPoolSize& poolSize) { return (poolSize.type == binding.Type); });
+		if (poolSizeIt == poolSizes.end())
+			poolSizes.push_back(vk::DescriptorPoolSize(binding.Type, binding.Count * setCount));
+		else
+			poolSizeIt->descriptorCount += binding.Count * setCount;
+	}
+	return (poolSizes);
+}
+
+/* SELF TEST */
+
+namespace
+{
+	/** A descriptor a compiled module must have */
+	struct ExpectedBinding
+	{
+		std::string_view Name;
+		uint32_t Set = 0;
+		uint32_t Binding = 0;
+		vk::DescriptorType Type = vk::DescriptorType::eStorageBuffer;
+		uint32_t Count = 1;
+	};
+
+	struct ExpectedModule
+	{
+		VulkanShaderSource Source;
+		std::vector<ExpectedBinding> Bindings;
+	};
+}
+
+bool VulkanShaderReflection::LogSelfTest(VulkanShaderCompiler& shaderCompiler)
+{
+	// The descriptors declared by the ray tracing shaders, they must be updated with them
+	const std::vector<ExpectedModule> expectedModules = {
+		{ { "raytrace.rgen", vk::ShaderStageFlagBits::eRaygenKHR }, {
+			{ "topLevelAS", 0, 0, vk::DescriptorType::eAccelerationStructureKHR },
+			{ "image", 0, 1, vk::DescriptorType::eStorageImage },
+		} },
+		{ { "raytrace.rint", vk::ShaderStageFlagBits::eIntersectionKHR }, {
+			// A block without instance name, named after the block
+			{ "ChunkAabbAddresses", 0, 2, vk::DescriptorType::eStorageBuffer },
+		} },
+		{ { "raytrace.rchit", vk::ShaderStageFlagBits::eClosestHitKHR }, {} },
+		{ { "raytrace.rmiss", vk::ShaderStageFlagBits::eMissKHR }, {} },
+	};
+
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view moduleName, const std::string& expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Shader reflection self test, {:s}: expected {:s}", moduleName, expectation);
+		failureCount++;
+	};
+
+	// The modules are compiled from the sources like the ones of the pipeline (the cache is used when they didn't change)
+	std::vector<VulkanShaderSource> sources;
+	for (const ExpectedModule& expectedModule : expectedModules)
+		sources.push_back(expectedModule.Source);
+	std::vector<std::vector<uint32_t>> spirvs;
+	shaderCompiler.GetSpirv(sources, spirvs);
+
+	VulkanDescriptorLayout descriptorLayout;
+	for (size_t moduleIndex = 0; moduleIndex < expectedModules.size(); moduleIndex++)
+	{
+		const ExpectedModule& expectedModule = expectedModules[moduleIndex];
+		const std::string_view moduleName = expectedModule.Source.Name;
+		const vk::ShaderStageFlagBits expectedStage = expectedModule.Source.Stage;
+		const std::vector<uint32_t>& spirv = spirvs[moduleIndex];
+		if (spirv.empty())
+		{
+			expect(false, moduleName, std::format("to compile from {:s}", shaderCompiler.GetSettings().SourceDirectory.string()));
+			continue;
+		}
+
+		VulkanShaderReflection reflection;
+		std::string error;
+		if (!Reflect(spirv, reflection, error))
+		{
+			expect(false, moduleName, std::format("a module that can be reflected ({:s})", error));
+			continue;
+		}
+
+		expect(reflection.Stages == expectedStage, moduleName, std::format("the stage {:s}, not {:s}", vk::to_string(expectedStage), vk::to_string(reflection.Stages)));
+		expect(reflection.Bindings.size() == expectedModule.Bindings.size(), moduleName, std::format("{:d} bindings, not {:d}", expectedModule.Bindings.size(), reflection.Bindings.size()));
+		for (size_t i = 0; i < std::min(reflection.Bindings.size(), expectedModule.Bindings.size()); i++)
+		{
+			const VulkanDescriptorBinding& binding = reflection.Bindings[i];
+			const ExpectedBinding& expectedBinding = expectedModule.Bindings[i];
+			expect(binding.Name == expectedBinding.Name && binding.Set == expectedBinding.Set && binding.Binding == expectedBinding.Binding
+				&& binding.Type == expectedBinding.Type && binding.Count == expectedBinding.Count && binding.Stages == expectedStage,
+				moduleName, std::format("\"{:s}\" as set {:d} binding {:d}, {:d} {:s}, not \"{:s}\" as set {:d} binding {:d}, {:d} {:s}",
+					expectedBinding.Name, expectedBinding.Set, expectedBinding.Binding, expectedBinding.Count, vk::to_string(expectedBinding.Type),
+					binding.Name, binding.Set, binding.Binding, binding.Count, vk::to_string(binding.Type)
+				)
+			);
+		}
+
+		// A module cut in the middle of its first instruction (OpCapability, 2 words) must be rejected, not read past its end
+		std::vector<uint32_t> truncatedSpirv = spirv;
+		truncatedSpirv.resize(std::min(truncatedSpirv.size(), Spirv::HeaderWordCount + 1));
+		VulkanShaderReflection truncatedReflection;
+		expect(!Reflect(truncatedSpirv, truncatedReflection, error), moduleName, "the truncated module to be rejected");
+
+		expect(descriptorLayout.AddShader(reflection, error), moduleName, std::format("to fit in the layout of the pipeline ({:s})", error));
+		OV_LOG(LogVulkan, Display, "{:s}: {:s}, {:d} bindings", moduleName, vk::to_string(reflection.Stages), reflection.Bindings.size());
+	}
+
+	// The layout the frame descriptor sets are made from
+	const std::string_view layoutName = "descriptor layout";
+	expect(descriptorLayout.GetSetCount() == 1 && descriptorLayout.GetBindings().size() == 3, layoutName, "the 3 bindings of the set 0");
+	for (const ExpectedModule& expectedModule : expectedModules)
+	{
+		for (const ExpectedBinding& expectedBinding : expectedModule.Bindings)
+		{
+			const VulkanDescriptorBinding* binding = descriptorLayout.FindBinding(expectedBinding.Name);
+			expect(binding != nullptr && binding->Binding == expectedBinding.Binding && binding->Stages == expectedModule.Source.Stage,
+				layoutName, std::format("\"{:s}\" at binding {:d}, only used by {:s}", expectedBinding.Name, expectedBinding.Binding, vk::to_string(expectedModule.Source.Stage))
+			);
+		}
+	}
+
+	OV_LOG(LogVulkan, Display, "Shader reflection self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
@@ -0,0 +1,151 @@
+#include "Vulkan/VulkanShaderCompiler.h"
+
+#include <shaderc/shaderc.hpp>
+#include <glslang/Public/ShaderLang.h>
+#include <format>
+
+namespace
+{
+	shaderc_shader_kind ToShaderKind(vk::ShaderStageFlagBits stage)
+	{
+		switch (stage)
+		{
+		case vk::ShaderStageFlagBits::eVertex:
+			return (shaderc_vertex_shader);
+		case vk::ShaderStageFlagBits::eTessellationControl:
+			return (shaderc_tess_control_shader);
+		case vk::ShaderStageFlagBits::eTessellationEvaluation:
+			return (shaderc_tess_evaluation_shader);
+		case vk::ShaderStageFlagBits::eGeometry:
+			return (shaderc_geometry_shader);
+		case vk::ShaderStageFlagBits::eFragment:
+			return (shaderc_fragment_shader);
+		case vk::ShaderStageFlagBits::eRaygenKHR:
+			return (shaderc_raygen_shader);
+		case vk::ShaderStageFlagBits::eAnyHitKHR:
+			return (shaderc_anyhit_shader);
+		case vk::ShaderStageFlagBits::eClosestHitKHR:
+			return (shaderc_closesthit_shader);
+		case vk::ShaderStageFlagBits::eMissKHR:
+			return (shaderc_miss_shader);
+		case vk::ShaderStageFlagBits::eIntersectionKHR:
+			return (shaderc_intersection_shader);
+		case vk::ShaderStageFlagBits::eCallableKHR:
+			return (shaderc_callable_shader);
+		case vk::ShaderStageFlagBits::eCompute:
+		default:
+			return (shaderc_compute_shader);
+		}
+	}
+
+	/** The SPIR-V version glslc use for a target environment */
+	shaderc_spirv_version ToSpirvVersion(uint32_t vulkanVersion)
+	{
+		if (vulkanVersion >= VK_API_VERSION_1_3)
+			return (shaderc_spirv_version_1_6);
+		if (vulkanVersion >= VK_API_VERSION_1_2)
+			return (shaderc_spirv_version_1_5);
+		if (vulkanVersion >= VK_API_VERSION_1_1)
+			return (shaderc_spirv_version_1_3);
+		return (shaderc_spirv_version_1_0);
+	}
+
+	/** Give the includes resolved by the compiler service to shaderc, the results live until shaderc release them */
+	class ShadercIncluder final : public shaderc::CompileOptions::IncluderInterface
+	{
+	public:
+		ShadercIncluder(const VulkanShaderCompileRequest& request)
+			: m_Request(request)
+		{}
+
+		virtual shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, size_t includeDepth) override
+		{
+			IncludeResult* result = new IncludeResult();
+			if (m_Request.ResolveInclude(requestedSource, requestingSource, type == shaderc_include_type_relative, result->Name, result->Content))
+			{
+				result->source_name = result->Name.data();
+				result->source_name_length = result->Name.size();
+			}
+			else
+			{
+				// An empty name tell shaderc the include failed, the content is the error
+				result->Content = std::format("Unable to find the include \"{:s}\"", requestedSource);
+				result->source_name = "";
+				result->source_name_length = 0;
+			}
+			result->content = result->Content.data();
+			result->content_length = result->Content.size();
+			result->user_data = nullptr;
+			return (result);
+		}
+
+		virtual void ReleaseInclude(shaderc_include_result* data) override
+		{
+			delete static_cast<IncludeResult*>(data);
+		}
+
+	private:
+		struct IncludeResult : public shaderc_include_result
+		{
+			std::string Name;
+			std::string Content;
+		};
+
+		const VulkanShaderCompileRequest& m_Request;
+	};
+
+	class ShadercBackend final : public VulkanShaderCompilerBackend
+	{
+	public:
+		virtual std::string GetVersion() const override
+		{
+			// The release of glslang linked in shaderc_combined (not the one of the headers), the SPIR-V it output change with it.
+			// The SDK headers version stand for shaderc itself, it ship with them
+			const glslang::Version glslangVersion = glslang::GetVersion();
+			unsigned int spirvVersion = 0;
+			unsigned int spirvRevision = 0;
+			shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+			return (std::format("shaderc-sdk{:d}.{:d}.{:d}-glslang{:d}.{:d}.{:d}{:s}-spv{:x}.{:d}",
+				VK_API_VERSION_MAJOR(VK_HEADER_VERSION_COMPLETE), VK_API_VERSION_MINOR(VK_HEADER_VERSION_COMPLETE), VK_HEADER_VERSION,
+				glslangVersion.major, glslangVersion.minor, glslangVersion.patch, glslangVersion.flavor != nullptr ? glslangVersion.flavor : "",
+				spirvVersion, spirvRevision
+			));
+		}
+
+		virtual bool Compile(const VulkanShaderCompileRequest& request, std::vector<uint32_t>& outSpirv, std::string& outLog) override
+		{
+			shaderc::CompileOptions options;
+			options.SetSourceLanguage(shaderc_source_language_glsl);
+			options.SetTargetEnvironment(shaderc_target_env_vulkan, request.TargetVulkanVersion);
+			options.SetTargetSpirv(ToSpirvVersion(request.TargetVulkanVersion));
+			options.SetOptimizationLevel(request.bOptimize ? shaderc_optimization_level_performance : shaderc_optimization_level_zero);
+			for (const auto& [name, value] : request.Defines)
+				options.AddMacroDefinition(name, value);
+			options.SetIncluder(std::make_unique<ShadercIncluder>(request));
+
+			const shaderc::SpvCompilationResult result = m_Compiler.CompileGlslToSpv(
+				request.Source.data(), request.Source.size(),
+				ToShaderKind(request.Stage),
+				request.Name.c_str(),
+				request.EntryPoint.c_str(),
+				options
+			);
+
+			outLog = result.GetErrorMessages();
+			if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+				return (false);
+
+			outSpirv.assign(result.cbegin(), result.cend());
+			return (true);
+		}
+
+	private:
+		/** Thread safe, and cheaper to keep than to create for each shader */
+		shaderc::Compiler m_Compiler;
+	};
+}
+
+std::unique_ptr<VulkanShaderCompilerBackend> VulkanShaderCompiler::CreateShadercBackend()
+{
+	return (std::make_unique<ShadercBackend>());
+}
@@ -0,0 +1,222 @@
+#include "Vulkan/VulkanStagingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+namespace
+{
+	/** Alignment of the regions in the ring, enough for any data copied */
+	constexpr vk::DeviceSize StagingAlignment = 16;
+}
+
+void VulkanStagingBuffer::CreateStagingBuffer(const VulkanDeviceHandler* device, VulkanQueueType::Type queueType, VulkanTimeline* timeline, vk::DeviceSize capacity)
+{
+	CHECK(device && timeline && !m_Buffer);
+	m_VkDevice = device;
+	m_Timeline = timeline;
+	m_QueueFamily = m_VkDevice->GetQueue(queueType).FamilyIndex;
+
+	CreateRingBuffer(capacity);
+}
+
+void VulkanStagingBuffer::DestroyStagingBuffer()
+{
+	if (!m_Buffer)
+		return;
+
+	OV_LOG_IF(m_QueuedCopies.empty() == false, LogVulkan, Warning, "{:d} staging copies have never been recorded", m_QueuedCopies.size());
+	m_QueuedCopies.clear();
+	OV_LOG_IF(m_PendingAcquires.empty() == false, LogVulkan, Warning, "{:d} staging destinations have never been acquired", m_PendingAcquires.size());
+	m_PendingAcquires.clear();
+
+	// The retired buffers without copies recorded aren't used by any submission
+	m_Timeline->Wait(m_LastSubmissionValue);
+	m_Ring.Retire(UINT64_MAX);
+	ReleaseRetiredBuffers(UINT64_MAX);
+
+	m_VkDevice->Raw().destroyBuffer(m_Buffer);
+	m_VkDevice->FreeMemory(m_Allocation);
+	m_Buffer = VK_NULL_HANDLE;
+	m_Ring = VulkanStagingRing();
+}
+
+void VulkanStagingBuffer::Upload(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset, uint32_t dstQueueFamily)
+{
+	CHECK(m_Buffer);
+	if (size == 0)
+		return;
+
+	START_NAMED_TIMER(UploadTimer);
+
+	RetireCompletedSubmissions();
+	const vk::DeviceSize offset = AllocateInRing(size);
+	memcpy(static_cast<uint8_t*>(m_Allocation.MappedData) + offset, data, size);
+
+	// No ownership transfer when the destination is read by the family of the copies
+	if (dstQueueFamily == m_QueueFamily)
+		dstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+	m_QueuedCopies.push_back(QueuedCopy{ m_Buffer, dstBuffer, vk::BufferCopy(offset, dstOffset, size), dstQueueFamily });
+
+	REPORT_PERFRAME_TIMER(ProfilingCategories::Upload, TIMER_NAMED_ELAPSED(UploadTimer));
+	REPORT_PERFRAME_COUNTER(ProfilingCategories::UploadedBytes, size);
+}
+
+bool VulkanStagingBuffer::RecordCopies(const vk::CommandBuffer& commandBuffer)
+{
+	if (m_QueuedCopies.empty())
+		return (false);
+
+	// One copyBuffer per source and destination pair
+	std::stable_sort(m_QueuedCopies.begin(), m_QueuedCopies.end(),
+		[](const QueuedCopy& a, const QueuedCopy& b) { return (std::tie(a.SrcBuffer, a.DstBuffer) < std::tie(b.SrcBuffer, b.DstBuffer)); }
+	);
+
+	std::vector<vk::BufferCopy> regions;
+	std::vector<vk::BufferMemoryBarrier> releases;
+	for (size_t first = 0; first < m_QueuedCopies.size();)
+	{
+		size_t last = first;
+		regions.clear();
+		while (last < m_QueuedCopies.size()
+			&& m_QueuedCopies[last].SrcBuffer == m_QueuedCopies[first].SrcBuffer
+			&& m_QueuedCopies[last].DstBuffer == m_QueuedCopies[first].DstBuffer)
+		{
+			regions.push_back(m_QueuedCopies[last].Region);
+			last++;
+		}
+
+		commandBuffer.copyBuffer(m_QueuedCopies[first].SrcBuffer, m_QueuedCopies[first].DstBuffer, regions);
+
+		// The whole buffer change owner, once even if it's copied from several ring buffers
+		const QueuedCopy& copy = m_QueuedCopies[first];
+		const auto isSameRelease = [&copy](const vk::BufferMemoryBarrier& release) { return (release.buffer == copy.DstBuffer && release.dstQueueFamilyIndex == copy.DstQueueFamily); };
+		if (copy.DstQueueFamily != VK_QUEUE_FAMILY_IGNORED && std::none_of(releases.begin(), releases.end(), isSameRelease))
+		{
+			releases.push_back(vk::BufferMemoryBarrier(
+				vk::AccessFlagBits::eTransferWrite,
+				vk::AccessFlags(), // Ignored by a release
+				m_QueueFamily,
+				copy.DstQueueFamily,
+				copy.DstBuffer,
+				0, VK_WHOLE_SIZE
+			));
+		}
+		first = last;
+	}
+	m_QueuedCopies.clear();
+
+	if (releases.empty() == false)
+	{
+		commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eBottomOfPipe,
+			vk::DependencyFlags(),
+			0, nullptr,
+			static_cast<uint32_t>(releases.size()), releases.data(),
+			0, nullptr
+		);
+		m_PendingAcquires.insert(m_PendingAcquires.end(), releases.begin(), releases.end());
+	}
+
+	// The timeline values are the submission ids of the ring
+	const uint64_t submissionValue = m_Timeline->GetNextSignalValue();
+	CHECK(submissionValue > m_LastSubmissionValue);
+	m_Ring.Submit(submissionValue);
+	for (RetiredBuffer& retiredBuffer : m_RetiredBuffers)
+	{
+		if (retiredBuffer.LastSubmissionValue == 0)
+			retiredBuffer.LastSubmissionValue = submissionValue;
+	}
+	m_LastSubmissionValue = submissionValue;
+	return (true);
+}
+
+bool VulkanStagingBuffer::RecordAcquires(const vk::CommandBuffer& commandBuffer, uint32_t queueFamily, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+{
+	std::vector<vk::BufferMemoryBarrier> acquires;
+	for (auto acquireIt = m_PendingAcquires.begin(); acquireIt != m_PendingAcquires.end();)
+	{
+		if (acquireIt->dstQueueFamilyIndex == queueFamily)
+		{
+			// Must match the release, apart from the access flags
+			vk::BufferMemoryBarrier acquire = *acquireIt;
+			acquire.srcAccessMask = vk::AccessFlags(); // Ignored by an acquire
+			acquire.dstAccessMask = dstAccess;
+			acquires.push_back(acquire);
+			acquireIt = m_PendingAcquires.erase(acquireIt);
+		}
+		else
+			++acquireIt;
+	}
+	if (acquires.empty())
+		return (false);
+
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTopOfPipe,
+		dstStage,
+		vk::DependencyFlags(),
+		0, nullptr,
+		static_cast<uint32_t>(acquires.size()), acquires.data(),
+		0, nullptr
+	);
+	return (true);
+}
+
+void VulkanStagingBuffer::RetireCompletedSubmissions()
+{
+	m_Ring.RetireCompleted(*m_Timeline);
+	ReleaseRetiredBuffers(m_Timeline->GetCompletedValue());
+}
+
+void VulkanStagingBuffer::CreateRingBuffer(vk::DeviceSize capacity)
+{
+	vk::BufferCreateInfo bufferInfo(
+		vk::BufferCreateFlags(),
+		capacity,
+		vk::BufferUsageFlagBits::eTransferSrc,
+		vk::SharingMode::eExclusive,
+		1, &m_QueueFamily
+	);
+	m_Buffer = m_VkDevice->Raw().createBuffer(bufferInfo);
+
+	// Stay mapped until the ring is destroyed
+	m_Allocation = m_VkDevice->AllocateBufferMemory(m_Buffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+	CHECK(m_Allocation.IsValid() && m_Allocation.MappedData);
+
+	m_Ring = VulkanStagingRing(capacity);
+}
+
+vk::DeviceSize VulkanStagingBuffer::AllocateInRing(vk::DeviceSize size)
+{
+	uint64_t offset;
+	while (m_Ring.AllocateOrWait(size, StagingAlignment, *m_Timeline, offset) == false)
+	{
+		// Everything in the ring is waiting to be recorded: replace it by a bigger one, the old one is still the source of the queued copies
+		const vk::DeviceSize capacity = VulkanStagingRing::GetGrownCapacity(m_Ring.GetCapacity(), size, StagingAlignment);
+		OV_LOG(LogVulkan, Verbose, "Staging ring full of unsubmitted copies, growing it to {:d}KB", capacity / 1024);
+
+		m_RetiredBuffers.push_back(RetiredBuffer{ m_Buffer, m_Allocation, 0 });
+		CreateRingBuffer(capacity);
+	}
+
+	// The waits for space in the ring may have completed the copies from the previous ones too
+	ReleaseRetiredBuffers(m_Timeline->GetCompletedValue());
+	return (offset);
+}
+
+void VulkanStagingBuffer::ReleaseRetiredBuffers(uint64_t completedValue)
+{
+	// A buffer whose copies are not recorded yet is only released by the destruction (completedValue is UINT64_MAX)
+	for (auto retiredBufferIt = m_RetiredBuffers.begin(); retiredBufferIt != m_RetiredBuffers.end();)
+	{
+		if (completedValue == UINT64_MAX || (retiredBufferIt->LastSubmissionValue != 0 && retiredBufferIt->LastSubmissionValue <= completedValue))
+		{
+			m_VkDevice->Raw().destroyBuffer(retiredBufferIt->Buffer);
+			m_VkDevice->FreeMemory(retiredBufferIt->Allocation);
+			retiredBufferIt = m_RetiredBuffers.erase(retiredBufferIt);
+		}
+		else
+			++retiredBufferIt;
+	}
+}
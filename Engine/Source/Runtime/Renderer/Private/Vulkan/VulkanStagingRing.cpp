@@ -0,0 +1,239 @@
+#include "Vulkan/VulkanStagingRing.h"
+#include "Vulkan/VulkanTimeline.h"
+#include "Vulkan/VulkanUtils.h"
+#include "MacrosHelper.h"
+
+#include <algorithm>
+#include <format>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+VulkanStagingRing::VulkanStagingRing(uint64_t capacity)
+	: m_Capacity(capacity)
+{
+	CHECK(capacity > 0);
+}
+
+bool VulkanStagingRing::Allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset)
+{
+	CHECK(alignment > 0 && (alignment & (alignment - 1)) == 0 && m_Capacity % alignment == 0);
+	if (size > m_Capacity)
+		return (false);
+
+	uint64_t start = (m_Head + alignment - 1) & ~(alignment - 1);
+
+	// Doesn't fit before the end of the ring, start again at the beginning
+	if (start % m_Capacity + size > m_Capacity)
+		start = (start / m_Capacity + 1) * m_Capacity;
+
+	if (start + size - m_Tail > m_Capacity)
+		return (false);
+
+	m_Head = start + size;
+	outOffset = start % m_Capacity;
+	return (true);
+}
+
+void VulkanStagingRing::Submit(uint64_t submissionId)
+{
+	CHECK(m_Submissions.empty() || m_Submissions.back().Id < submissionId);
+	if (HasUnsubmittedAllocations() == false)
+		return;
+
+	m_Submissions.push_back(Submission{ submissionId, m_Head });
+	m_SubmittedHead = m_Head;
+}
+
+void VulkanStagingRing::Retire(uint64_t completedSubmissionId)
+{
+	while (m_Submissions.empty() == false && m_Submissions.front().Id <= completedSubmissionId)
+	{
+		m_Tail = m_Submissions.front().End;
+		m_Submissions.pop_front();
+	}
+
+	// Nothing in use anymore, the next allocation can start at the beginning of the ring without losing its end
+	if (m_Submissions.empty() && HasUnsubmittedAllocations() == false)
+	{
+		m_Head = 0;
+		m_Tail = 0;
+		m_SubmittedHead = 0;
+	}
+}
+
+bool VulkanStagingRing::AllocateOrWait(uint64_t size, uint64_t alignment, VulkanTimeline& timeline, uint64_t& outOffset)
+{
+	while (Allocate(size, alignment, outOffset) == false)
+	{
+		if (HasPendingSubmissions() == false)
+			return (false);
+
+		timeline.Wait(GetOldestSubmission());
+		Retire(timeline.GetCompletedValue());
+	}
+	return (true);
+}
+
+void VulkanStagingRing::RetireCompleted(VulkanTimeline& timeline)
+{
+	// Only query the timeline when a submission may be complete
+	if (HasPendingSubmissions() && timeline.IsComplete(GetOldestSubmission()))
+		Retire(timeline.GetCompletedValue());
+}
+
+uint64_t VulkanStagingRing::GetGrownCapacity(uint64_t capacity, uint64_t size, uint64_t alignment)
+{
+	// Twice the capacity, or twice the allocation when it's bigger than that, still a multiple of the alignment
+	return (std::max(capacity * 2, ((size + alignment - 1) & ~(alignment - 1)) * 2));
+}
+
+bool VulkanStagingRing::LogSelfTest(uint32_t randomAllocationCount)
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Staging ring self test, {:s}: expected {:s}", scenario, expectation);
+		failureCount++;
+	};
+
+	/* ALIGNMENT */
+	{
+		const std::string_view scenario = "alignment";
+		VulkanStagingRing ring(256);
+		uint64_t offset = UINT64_MAX;
+
+		expect(ring.Allocate(1, 1, offset) && offset == 0, scenario, "the first allocation at offset 0");
+		expect(ring.Allocate(8, 64, offset) && offset == 64, scenario, "the next allocation aligned on 64");
+		expect(ring.Allocate(4, 16, offset) && offset == 80, scenario, "the padding to only be the alignment");
+		expect(ring.GetUsedSize() == 84, scenario, "the padding to be counted as used");
+		expect(ring.Allocate(257, 1, offset) == false, scenario, "an allocation bigger than the ring to fail");
+	}
+
+	/* WRAPAROUND */
+	{
+		const std::string_view scenario = "wraparound";
+		VulkanStagingRing ring(256);
+		uint64_t offset = UINT64_MAX;
+
+		expect(ring.Allocate(100, 16, offset) && offset == 0, scenario, "the first allocation at offset 0");
+		ring.Submit(1);
+		expect(ring.Allocate(100, 16, offset) && offset == 112, scenario, "the second allocation after the first one");
+		ring.Submit(2);
+		expect(ring.Allocate(100, 16, offset) == false, scenario, "no space before the first submission is retired");
+
+		ring.Retire(1);
+		expect(ring.HasPendingSubmissions() && ring.GetOldestSubmission() == 2, scenario, "only the first submission to be retired");
+		// Doesn't fit in the 32 bytes left at the end, start again at 0 where the first submission was
+		expect(ring.Allocate(100, 16, offset) && offset == 0, scenario, "the allocation to wrap around to offset 0");
+		expect(ring.GetUsedSize() == 256, scenario, "the end of the ring to be lost until the second submission is retired");
+		expect(ring.Allocate(16, 16, offset) == false, scenario, "the ring to be full");
+		ring.Submit(3);
+
+		ring.Retire(2);
+		expect(ring.Allocate(16, 16, offset) && offset == 112, scenario, "the space of the second submission to be free after the wrapped region");
+		ring.Submit(4);
+		ring.Retire(4);
+		expect(ring.HasPendingSubmissions() == false && ring.GetUsedSize() == 0, scenario, "an empty ring once every submission is retired");
+		expect(ring.Allocate(256, 16, offset) && offset == 0, scenario, "the empty ring to start again at offset 0 without losing its end");
+	}
+
+	/* RETIREMENT */
+	{
+		const std::string_view scenario = "retirement";
+		VulkanStagingRing ring(256);
+		uint64_t offset = UINT64_MAX;
+
+		ring.Submit(1);
+		expect(ring.HasPendingSubmissions() == false, scenario, "a submission without allocation to not be tracked");
+		ring.Allocate(64, 16, offset);
+		ring.Submit(5);
+		ring.Allocate(64, 16, offset);
+		ring.Submit(7);
+		ring.Allocate(64, 16, offset);
+		expect(ring.HasUnsubmittedAllocations(), scenario, "the last allocation to be unsubmitted");
+
+		ring.Retire(4);
+		expect(ring.GetOldestSubmission() == 5 && ring.GetUsedSize() == 192, scenario, "a submission to stay until its id is completed");
+		ring.Retire(7);
+		expect(ring.HasPendingSubmissions() == false && ring.GetUsedSize() == 64, scenario, "the completed id to retire every submission before it");
+		expect(ring.HasUnsubmittedAllocations(), scenario, "the unsubmitted allocation to stay in use");
+	}
+
+	/* GROWTH */
+	{
+		const std::string_view scenario = "growth";
+		VulkanStagingRing ring(256);
+		uint64_t offset = UINT64_MAX;
+
+		for (uint32_t i = 0; i < 16; i++)
+			ring.Allocate(16, 16, offset);
+		// What VulkanStagingBuffer::AllocateInRing check before growing: full, and nothing to wait for
+		expect(ring.Allocate(16, 16, offset) == false && ring.HasPendingSubmissions() == false, scenario, "a ring full of unsubmitted regions");
+
+		for (uint64_t size : { 16ull, 256ull, 300ull, 1000ull })
+		{
+			const uint64_t grownCapacity = GetGrownCapacity(ring.GetCapacity(), size, 16);
+			VulkanStagingRing grownRing(grownCapacity);
+			expect(grownCapacity >= ring.GetCapacity() * 2 && grownCapacity % 16 == 0, scenario, std::format("the ring grown for {:d} bytes to double and stay aligned", size));
+			expect(grownRing.Allocate(size, 16, offset) && grownRing.Allocate(size, 16, offset), scenario, std::format("two allocations of {:d} bytes to fit in the grown ring", size));
+		}
+	}
+
+	/* RANDOM ALLOCATIONS */
+	{
+		const std::string_view scenario = "random allocations";
+		std::mt19937 random(42);
+
+		/** A region in use, until its submission is retired */
+		struct LiveRegion
+		{
+			uint64_t Offset = 0;
+			uint64_t Size = 0;
+			/** 0 until it's submitted */
+			uint64_t SubmissionId = 0;
+		};
+		std::vector<LiveRegion> liveRegions;
+		VulkanStagingRing ring(4096);
+		uint64_t nextSubmissionId = 1;
+		uint64_t retiredSubmissionId = 0;
+
+		for (uint32_t i = 0; i < randomAllocationCount && failureCount == 0; i++)
+		{
+			const uint64_t size = 1 + random() % 1024;
+			const uint64_t alignment = 1ull << (random() % 7);
+			uint64_t offset = UINT64_MAX;
+			if (ring.Allocate(size, alignment, offset))
+			{
+				expect(offset % alignment == 0 && offset + size <= ring.GetCapacity(), scenario, "an aligned region inside the ring");
+				for (const LiveRegion& region : liveRegions)
+					expect(offset + size <= region.Offset || region.Offset + region.Size <= offset, scenario, "a region that doesn't overlap a region in use");
+				liveRegions.push_back(LiveRegion{ offset, size, 0 });
+			}
+			else
+				expect(ring.HasPendingSubmissions() || ring.HasUnsubmittedAllocations(), scenario, "an empty ring to fit any allocation");
+
+			if (random() % 4 == 0)
+			{
+				ring.Submit(nextSubmissionId);
+				for (LiveRegion& region : liveRegions)
+					region.SubmissionId = (region.SubmissionId == 0 ? nextSubmissionId : region.SubmissionId);
+				nextSubmissionId++;
+			}
+			// The fake GPU complete the submissions in order, some allocations later
+			if (random() % 3 == 0 && retiredSubmissionId + 1 < nextSubmissionId)
+			{
+				retiredSubmissionId += 1 + random() % (nextSubmissionId - retiredSubmissionId - 1);
+				ring.Retire(retiredSubmissionId);
+				std::erase_if(liveRegions, [retiredSubmissionId](const LiveRegion& region) { return (region.SubmissionId != 0 && region.SubmissionId <= retiredSubmissionId); });
+			}
+		}
+	}
+
+	OV_LOG(LogVulkan, Display, "Staging ring self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
@@ -5,9 +5,9 @@ VulkanSwapChainHandler::VulkanSwapChainHandler(const VulkanDeviceHandler* vkDevi
 	: m_VkDevice(vkDevice), m_Surface(surface)
 {}
 
-void VulkanSwapChainHandler::CreateSwapChain(vk::PresentModeKHR preferredPresentMode)
+void VulkanSwapChainHandler::CreateSwapChain(vk::PresentModeKHR preferredPresentMode, uint32_t framesInFlight)
 {
-	CHECK(m_VkDevice && m_Surface);
+	CHECK(m_VkDevice && m_Surface && m_Timeline && m_FrameDescriptorLayout && framesInFlight > 0);
 
 	VulkanSwapChainSupportProperties supportProperties = RequestSwapchainProperties();
 
@@ -55,33 +55,41 @@ void VulkanSwapChainHandler::CreateSwapChain(vk::PresentModeKHR preferredPresent
 	std::vector<vk::Image> images = m_VkDevice->Raw().getSwapchainImagesKHR(m_Swapchain);
 	m_ImageCount = static_cast<uint32_t>(images.size());
 
+	OV_LOG(LogVulkan, Verbose, "\tImages: {:d}, frames in flight: {:d}", m_ImageCount, framesInFlight);
+
+	// The frames only have one descriptor set, made from the descriptors the shaders declare
+	CHECK(m_FrameDescriptorLayout->GetSetCount() <= 1);
+
 	/* create descriptor pool  */
-	std::vector<vk::DescriptorPoolSize> poolSizes;
-	poolSizes.push_back(
-		vk::DescriptorPoolSize(
-			vk::DescriptorType::eAccelerationStructureKHR,
-			m_ImageCount
-		)
-	);
-	poolSizes.push_back(
-		vk::DescriptorPoolSize(
-			vk::DescriptorType::eStorageImage,
-			m_ImageCount
-		)
-	);
+	const std::vector<vk::DescriptorPoolSize> poolSizes = m_FrameDescriptorLayout->GetPoolSizes(0, framesInFlight);
 	m_DescriptorPool = m_VkDevice->Raw().createDescriptorPool(
 		vk::DescriptorPoolCreateInfo(
-			vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-			m_ImageCount,
+			vk::DescriptorPoolCreateFlags(),
+			framesInFlight,
 			static_cast<uint32_t>(poolSizes.size()),
 			poolSizes.data()
 		)
 	);
 
-	/* Create all the frames */
-	m_Frames.reserve(m_ImageCount);
+	/* Create the descriptor set layout shared by the frames, each binding is visible to the stages of the shaders that use it */
+	const std::vector<vk::DescriptorSetLayoutBinding> layoutBinding = m_FrameDescriptorLayout->GetSetLayoutBindings(0);
+	vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo(
+		vk::DescriptorSetLayoutCreateFlags(),
+		layoutBinding.size(), layoutBinding.data()
+	);
+	m_DescriptorSetLayout = m_VkDevice->Raw().createDescriptorSetLayout(descriptorSetLayoutCreateInfo);
+
+	/* Create all the images */
+	m_Images.reserve(m_ImageCount);
 	for (uint32_t i = 0; i < m_ImageCount; ++i)
-		m_Frames.push_back(CreateFrame(images[i]));
+		m_Images.push_back(CreateImage(images[i]));
+
+	/* Create all the frames in flight */
+	m_InFlightFrames.reserve(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; ++i)
+		m_InFlightFrames.push_back(CreateInFlightFrame());
+
+	m_FrameRing = VulkanFrameRing(framesInFlight, m_ImageCount);
 
 	m_IsSwapChainCreated = true;
 }
@@ -90,76 +98,105 @@ void VulkanSwapChainHandler::DestroySwapChain()
 {
 	CHECK(m_IsSwapChainCreated);
 
-	// destroy every allocated command buffer
-	for (auto& frame : m_Frames)
+	for (auto& frame : m_InFlightFrames)
+		DestroyInFlightFrame(frame);
+	m_InFlightFrames.clear();
+
+	for (auto& image : m_Images)
 	{
-		/* Syncro */
-		m_VkDevice->Raw().destroySemaphore(frame.RenderedSemaphore);
-		m_VkDevice->Raw().destroySemaphore(frame.AcquiredSemaphore);
-		m_VkDevice->Raw().destroyFence(frame.RenderedFence);
-
-		/* Image */
-		m_VkDevice->Raw().destroyImageView(frame.ImageView);
-		m_VkDevice->Raw().freeCommandBuffers(*m_CommandPool, frame.CommandBuffer);
-
-		/* Descriptorsets */
-		m_VkDevice->Raw().destroyDescriptorSetLayout(frame.DescriptorSetLayout);
-		m_VkDevice->Raw().freeDescriptorSets(m_DescriptorPool, frame.DescriptorSet);
+		m_VkDevice->Raw().destroySemaphore(image.RenderedSemaphore);
+		m_VkDevice->Raw().destroyImageView(image.ImageView);
 	}
+	m_Images.clear();
 
+	// Free the descriptor sets of the frames
 	m_VkDevice->Raw().destroyDescriptorPool(m_DescriptorPool);
+	m_VkDevice->Raw().destroyDescriptorSetLayout(m_DescriptorSetLayout);
 	m_VkDevice->Raw().destroySwapchainKHR(m_Swapchain);
 
+	m_FrameRing = VulkanFrameRing();
 	m_VkDevice = nullptr;
 	m_Surface = nullptr;
 
 	m_IsSwapChainCreated = false;
 }
 
-uint8_t VulkanSwapChainHandler::AcquireNextFrameIndex()
+void VulkanSwapChainHandler::AcquireNextFrame()
 {
 	CHECK(m_IsSwapChainCreated);
 
-	m_CurrentFrameIndex =
-		static_cast <uint8_t>(m_VkDevice->Raw().acquireNextImageKHR(m_Swapchain, UINT64_MAX, m_Frames[m_CurrentSemaphoreIndex].AcquiredSemaphore, nullptr).value);
+	// Block until the frame that used this slot N frames ago has finish rendering (not presenting), the other ones keep running
+	const uint32_t frameIndex = m_FrameRing.BeginFrame();
+	m_FrameRing.WaitForFrame(frameIndex, *m_Timeline);
+
+	VulkanInFlightFrame& frame = m_InFlightFrames[frameIndex];
+	m_VkDevice->Raw().resetCommandPool(frame.CommandPool);
 
-	// block until the previous frame has finish rendering (not presenting)
-	m_VkDevice->Raw().waitForFences(m_Frames[m_CurrentFrameIndex].RenderedFence, VK_TRUE, UINT64_MAX);
-	m_VkDevice->Raw().resetFences(m_Frames[m_CurrentFrameIndex].RenderedFence);
+	// The acquire semaphore of the slot is free: the submission that waited on it is complete
+	const uint32_t imageIndex = m_VkDevice->Raw().acquireNextImageKHR(m_Swapchain, UINT64_MAX, frame.AcquiredSemaphore, nullptr).value;
 
-	return (m_CurrentFrameIndex);
+	// The images can be acquired in any order, another slot may still be rendering into this one
+	const uint32_t previousOwner = m_FrameRing.AcquireImage(imageIndex);
+	if (previousOwner != VulkanFrameRing::InvalidIndex)
+		m_FrameRing.WaitForFrame(previousOwner, *m_Timeline);
 }
 
-void VulkanSwapChainHandler::SubmitWork(uint8_t frameIndex) const
+void VulkanSwapChainHandler::AddFrameWait(const VulkanTimelineWait& wait)
 {
 	CHECK(m_IsSwapChainCreated);
+	m_FrameWaits.push_back(wait);
+}
 
-	vk::PipelineStageFlags stageToWait = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+void VulkanSwapChainHandler::SubmitWork()
+{
+	CHECK(m_IsSwapChainCreated);
 
-	vk::SubmitInfo infoToSubmit(
-		1, &m_Frames[m_CurrentSemaphoreIndex].AcquiredSemaphore,
-		&stageToWait,
-		1, &m_Frames[frameIndex].CommandBuffer,
-		1, &m_Frames[m_CurrentSemaphoreIndex].RenderedSemaphore
-	);
+	VulkanInFlightFrame& frame = m_InFlightFrames[m_FrameRing.GetCurrentFrame()];
+	const VulkanSwapChainImage& image = m_Images[m_FrameRing.GetCurrentImage()];
 
-	m_VkDevice->GetQueue(VulkanQueueType::Graphic).submit(infoToSubmit, m_Frames[m_CurrentSemaphoreIndex].RenderedFence);
+	// The swap chain only use binary semaphores, the timeline tell when the frame is rendered
+	VulkanTimelineSubmitInfo infoToSubmit;
+	infoToSubmit.CommandBuffers.push_back(frame.CommandBuffer);
+	infoToSubmit.WaitSemaphores.push_back(frame.AcquiredSemaphore);
+	infoToSubmit.WaitStages.push_back(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+	infoToSubmit.SignalSemaphores.push_back(image.RenderedSemaphore);
+	infoToSubmit.TimelineWaits = std::move(m_FrameWaits);
+	m_FrameWaits.clear();
+
+	m_FrameRing.SubmitFrame(m_Timeline->Submit(m_VkDevice->GetQueue(VulkanQueueType::Graphic), infoToSubmit));
 }
 
-void VulkanSwapChainHandler::PresentFrame(uint8_t frameIndex)
+void VulkanSwapChainHandler::PresentFrame()
 {
 	CHECK(m_IsSwapChainCreated);
 
-	uint32_t frameIndex32bit = frameIndex;
+	const uint32_t frameIndex = m_FrameRing.GetFrameImage(m_FrameRing.GetCurrentFrame());
 	vk::Result result;
 	vk::PresentInfoKHR presentInfos(
-		1, &m_Frames[m_CurrentSemaphoreIndex].RenderedSemaphore,
+		1, &m_Images[frameIndex].RenderedSemaphore,
 		1, &m_Swapchain,
-		&frameIndex32bit,
+		&frameIndex,
 		&result
 	);
 	m_VkDevice->GetQueue(VulkanQueueType::Graphic).presentKHR(presentInfos);
-	m_CurrentSemaphoreIndex = (m_CurrentSemaphoreIndex + 1) % m_ImageCount;
+}
+
+VulkanSwapChainFrame VulkanSwapChainHandler::GetCurrentFrame() const
+{
+	CHECK(m_IsSwapChainCreated);
+
+	const uint32_t frameIndex = m_FrameRing.GetCurrentFrame();
+	const uint32_t imageIndex = m_FrameRing.GetCurrentImage();
+	CHECK(frameIndex != VulkanFrameRing::InvalidIndex && imageIndex != VulkanFrameRing::InvalidIndex);
+
+	VulkanSwapChainFrame currentFrame;
+	currentFrame.FrameIndex = frameIndex;
+	currentFrame.ImageIndex = imageIndex;
+	currentFrame.Image = m_Images[imageIndex].Image;
+	currentFrame.ImageView = m_Images[imageIndex].ImageView;
+	currentFrame.CommandBuffer = m_InFlightFrames[frameIndex].CommandBuffer;
+	currentFrame.DescriptorSet = m_InFlightFrames[frameIndex].DescriptorSet;
+	return (currentFrame);
 }
 
 VulkanSwapChainSupportProperties VulkanSwapChainHandler::RequestSwapchainProperties() const
@@ -210,20 +247,10 @@ vk::Extent2D VulkanSwapChainHandler::SelectExtent(const vk::SurfaceCapabilitiesK
 	return (capabilities.currentExtent);
 }
 
-VulkanSwapChainFrame VulkanSwapChainHandler::CreateFrame(const vk::Image& image)
+VulkanSwapChainImage VulkanSwapChainHandler::CreateImage(const vk::Image& image)
 {
-	CHECK(m_CommandPool);
-
-	VulkanSwapChainFrame newFrame;
-
-	vk::CommandBufferAllocateInfo commandBufferAllocateInfo(
-		*m_CommandPool,
-		vk::CommandBufferLevel::ePrimary,
-		1
-	);
-
-	newFrame.CommandBuffer = m_VkDevice->Raw().allocateCommandBuffers(commandBufferAllocateInfo)[0];
-	newFrame.Image = image;
+	VulkanSwapChainImage newImage;
+	newImage.Image = image;
 
 	/* Create Image view */
 	vk::ImageViewCreateInfo imageViewCreateInfo(
@@ -234,52 +261,54 @@ VulkanSwapChainFrame VulkanSwapChainHandler::CreateFrame(const vk::Image& image)
 		vk::ComponentMapping(),
 		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
 	);
-	newFrame.ImageView = m_VkDevice->Raw().createImageView(imageViewCreateInfo);
+	newImage.ImageView = m_VkDevice->Raw().createImageView(imageViewCreateInfo);
 
-	/* Create semaphores */
-	vk::SemaphoreCreateInfo semaphoreCreateInfo;
-	semaphoreCreateInfo.flags = vk::SemaphoreCreateFlags();
-	newFrame.AcquiredSemaphore = m_VkDevice->Raw().createSemaphore(semaphoreCreateInfo);
-	newFrame.RenderedSemaphore = m_VkDevice->Raw().createSemaphore(semaphoreCreateInfo);
+	/* Create semaphore */
+	newImage.RenderedSemaphore = m_VkDevice->Raw().createSemaphore(vk::SemaphoreCreateInfo());
 
-	/* Create fence */
-	vk::FenceCreateInfo fenceCreateInfo;
-	fenceCreateInfo.flags = vk::FenceCreateFlagBits::eSignaled;
-	newFrame.RenderedFence = m_VkDevice->Raw().createFence(fenceCreateInfo);
+	return (newImage);
+}
 
-	/* Create Descriptor set */
-	std::vector<vk::DescriptorSetLayoutBinding> layoutBinding;
-	// Which shader got access to the AS (raygen)
-	layoutBinding.push_back(
-		vk::DescriptorSetLayoutBinding(
-			0,
-			vk::DescriptorType::eAccelerationStructureKHR,
-			1,
-			vk::ShaderStageFlagBits::eRaygenKHR
-		)
-	);
+VulkanInFlightFrame VulkanSwapChainHandler::CreateInFlightFrame()
+{
+	VulkanInFlightFrame newFrame;
 
-	// Which shader got access to the image (raygen), meaning only raygen can write to the image
-	layoutBinding.push_back(
-		vk::DescriptorSetLayoutBinding(
-			1,
-			vk::DescriptorType::eStorageImage,
-			1,
-			vk::ShaderStageFlagBits::eRaygenKHR
-		)
+	/* Create command pool and buffer */
+	vk::CommandPoolCreateInfo commandPoolCreateInfo(
+		vk::CommandPoolCreateFlagBits::eTransient,
+		m_VkDevice->GetQueue(VulkanQueueType::Graphic).FamilyIndex
 	);
-	vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo(
-		vk::DescriptorSetLayoutCreateFlags(),
-		layoutBinding.size(), layoutBinding.data()
+	newFrame.CommandPool = m_VkDevice->Raw().createCommandPool(commandPoolCreateInfo);
+
+	vk::CommandBufferAllocateInfo commandBufferAllocateInfo(
+		newFrame.CommandPool,
+		vk::CommandBufferLevel::ePrimary,
+		1
 	);
-	newFrame.DescriptorSetLayout = m_VkDevice->Raw().createDescriptorSetLayout(descriptorSetLayoutCreateInfo);
+	newFrame.CommandBuffer = m_VkDevice->Raw().allocateCommandBuffers(commandBufferAllocateInfo)[0];
+
+	/* Create semaphore */
+	newFrame.AcquiredSemaphore = m_VkDevice->Raw().createSemaphore(vk::SemaphoreCreateInfo());
+
+	/* Create Descriptor set */
 	newFrame.DescriptorSet = m_VkDevice->Raw().allocateDescriptorSets(
 		vk::DescriptorSetAllocateInfo(
 			m_DescriptorPool,
 			1,
-			&newFrame.DescriptorSetLayout
+			&m_DescriptorSetLayout
 		)
 	)[0];
 
 	return (newFrame);
 }
+
+void VulkanSwapChainHandler::DestroyInFlightFrame(VulkanInFlightFrame& frame)
+{
+	/* Syncro */
+	m_VkDevice->Raw().destroySemaphore(frame.AcquiredSemaphore);
+
+	/* Command pool, free its command buffer */
+	m_VkDevice->Raw().destroyCommandPool(frame.CommandPool);
+
+	frame = VulkanInFlightFrame();
+}
@@ -0,0 +1,308 @@
+#include "Vulkan/VulkanTimeline.h"
+#include "Vulkan/VulkanDeviceHandler.h"
+#include "Vulkan/VulkanStagingRing.h"
+#include "Vulkan/VulkanFrameRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+	/** GPU of the self test: reach the submitted values in order, a random delay later, on its own thread */
+	class FakeGpu
+	{
+	public:
+		FakeGpu(VulkanCpuTimeline& timeline)
+			: m_Timeline(timeline), m_Thread([this]() { Run(); })
+		{
+		}
+
+		~FakeGpu()
+		{
+			m_bStop = true;
+			m_Thread.join();
+		}
+
+		/** The submissions up to value are queued */
+		void Submit(uint64_t value) { m_SubmittedValue = value; }
+
+	private:
+		void Run()
+		{
+			std::mt19937 random(7);
+			uint64_t signaledValue = 0;
+			while (m_bStop == false)
+			{
+				if (signaledValue == m_SubmittedValue)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				// The sleeps are too coarse on some platforms, a few yields are long enough to let the CPU get ahead
+				for (uint32_t i = random() % 64; i > 0; i--)
+					std::this_thread::yield();
+				m_Timeline.Signal(++signaledValue);
+			}
+		}
+
+	private:
+		VulkanCpuTimeline& m_Timeline;
+		std::atomic<uint64_t> m_SubmittedValue = 0;
+		std::atomic<bool> m_bStop = false;
+		std::thread m_Thread;
+	};
+}
+
+bool VulkanTimeline::IsComplete(uint64_t value)
+{
+	return (value <= m_CompletedValue || value <= Poll());
+}
+
+uint64_t VulkanTimeline::Poll()
+{
+	m_CompletedValue = std::max(m_CompletedValue, QueryCompletedValue());
+	return (m_CompletedValue);
+}
+
+void VulkanTimeline::Wait(uint64_t value)
+{
+	CHECK(value <= m_LastSignalValue);
+	if (IsComplete(value))
+		return;
+
+	WaitForValue(value);
+	m_CompletedValue = std::max(m_CompletedValue, value);
+}
+
+void VulkanDeviceTimeline::CreateTimeline(const VulkanDeviceHandler* device)
+{
+	CHECK(device && !m_Semaphore);
+	m_VkDevice = device;
+
+	vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo(vk::SemaphoreType::eTimeline, GetLastSignalValue());
+	vk::SemaphoreCreateInfo semaphoreCreateInfo;
+	semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+	m_Semaphore = m_VkDevice->Raw().createSemaphore(semaphoreCreateInfo);
+}
+
+void VulkanDeviceTimeline::DestroyTimeline()
+{
+	if (!m_Semaphore)
+		return;
+
+	m_VkDevice->Raw().destroySemaphore(m_Semaphore);
+	m_Semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t VulkanDeviceTimeline::Submit(const vk::Queue& queue, const VulkanTimelineSubmitInfo& submitInfo)
+{
+	CHECK(m_Semaphore && submitInfo.WaitSemaphores.size() == submitInfo.WaitStages.size());
+
+	// The binary semaphores first, their values are ignored
+	std::vector<vk::Semaphore> waitSemaphores = submitInfo.WaitSemaphores;
+	std::vector<vk::PipelineStageFlags> waitStages = submitInfo.WaitStages;
+	std::vector<uint64_t> waitValues(waitSemaphores.size(), 0);
+	for (const VulkanTimelineWait& wait : submitInfo.TimelineWaits)
+	{
+		CHECK(wait.Timeline);
+		// Even when it's already reached the wait is kept: it's what make the writes of the other queue visible to this one
+		if (wait.Value == 0)
+			continue;
+
+		waitSemaphores.push_back(wait.Timeline->Raw());
+		waitStages.push_back(wait.Stage);
+		waitValues.push_back(wait.Value);
+	}
+
+	const uint64_t signalValue = ReserveSignalValue();
+	std::vector<vk::Semaphore> signalSemaphores = submitInfo.SignalSemaphores;
+	std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+	signalSemaphores.push_back(m_Semaphore);
+	signalValues.push_back(signalValue);
+
+	vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo(
+		static_cast<uint32_t>(waitValues.size()), waitValues.data(),
+		static_cast<uint32_t>(signalValues.size()), signalValues.data()
+	);
+	vk::SubmitInfo vkSubmitInfo(
+		static_cast<uint32_t>(waitSemaphores.size()), waitSemaphores.data(), waitStages.data(),
+		static_cast<uint32_t>(submitInfo.CommandBuffers.size()), submitInfo.CommandBuffers.data(),
+		static_cast<uint32_t>(signalSemaphores.size()), signalSemaphores.data()
+	);
+	vkSubmitInfo.pNext = &timelineSubmitInfo;
+
+	queue.submit(vkSubmitInfo);
+	return (signalValue);
+}
+
+uint64_t VulkanDeviceTimeline::QueryCompletedValue() const
+{
+	return (m_VkDevice->Raw().getSemaphoreCounterValue(m_Semaphore));
+}
+
+void VulkanDeviceTimeline::WaitForValue(uint64_t value) const
+{
+	vk::SemaphoreWaitInfo waitInfo(vk::SemaphoreWaitFlags(), 1, &m_Semaphore, &value);
+	CHECK_VULKAN_RESULT(m_VkDevice->Raw().waitSemaphores(waitInfo, UINT64_MAX), "Unable to wait for the timeline");
+}
+
+void VulkanCpuTimeline::Signal(uint64_t value)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		CHECK(value >= m_SignaledValue);
+		m_SignaledValue = value;
+	}
+	m_Signaled.notify_all();
+}
+
+uint64_t VulkanCpuTimeline::QueryCompletedValue() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return (m_SignaledValue);
+}
+
+void VulkanCpuTimeline::WaitForValue(uint64_t value) const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Signaled.wait(lock, [this, value]() { return (m_SignaledValue >= value); });
+}
+
+bool VulkanCpuTimeline::LogSelfTest(uint32_t randomSubmissionCount)
+{
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount](bool bCondition, std::string_view scenario, std::string_view expectation)
+	{
+		if (bCondition)
+			return;
+		OV_LOG(LogVulkan, Error, "Timeline self test, {:s}: expected {:s}", scenario, expectation);
+		failureCount++;
+	};
+
+	/* TIMELINE */
+	{
+		const std::string_view scenario = "timeline";
+		VulkanCpuTimeline timeline;
+
+		expect(timeline.ReserveSignalValue() == 1 && timeline.ReserveSignalValue() == 2, scenario, "the values to be reserved in order");
+		expect(timeline.IsComplete(1) == false && timeline.GetCompletedValue() == 0, scenario, "nothing complete before a signal");
+		timeline.Signal(1);
+		expect(timeline.GetCompletedValue() == 0, scenario, "the cached value to only follow the timeline when it's queried");
+		expect(timeline.IsComplete(1) && timeline.IsComplete(2) == false, scenario, "only the signaled value to be complete");
+		{
+			FakeGpu gpu(timeline);
+			gpu.Submit(2);
+			timeline.WaitIdle();
+		}
+		expect(timeline.GetCompletedValue() == 2 && timeline.Poll() == 2, scenario, "the wait to return once the last value is reached");
+	}
+
+	/* STAGING RING */
+	{
+		const std::string_view scenario = "staging ring";
+		std::mt19937 random(42);
+		VulkanCpuTimeline timeline;
+		VulkanStagingRing ring(4096);
+
+		/** A region in use, until the timeline reach its value */
+		struct LiveRegion
+		{
+			uint64_t Offset = 0;
+			uint64_t Size = 0;
+			/** 0 until it's submitted */
+			uint64_t Value = 0;
+		};
+		std::vector<LiveRegion> liveRegions;
+
+		FakeGpu gpu(timeline);
+		auto submit = [&]()
+		{
+			const uint64_t value = timeline.ReserveSignalValue();
+			ring.Submit(value);
+			for (LiveRegion& region : liveRegions)
+				region.Value = (region.Value == 0 ? value : region.Value);
+			gpu.Submit(value);
+		};
+
+		for (uint32_t i = 0; i < randomSubmissionCount * 4 && failureCount == 0; i++)
+		{
+			ring.RetireCompleted(timeline);
+
+			const uint64_t size = 1 + random() % 1024;
+			uint64_t offset = UINT64_MAX;
+			if (ring.AllocateOrWait(size, 16, timeline, offset) == false)
+			{
+				// Where VulkanStagingBuffer grow the ring, submit instead to keep the same ring
+				expect(ring.HasUnsubmittedAllocations() && ring.HasPendingSubmissions() == false, scenario, "a failed allocation only when the ring is full of unsubmitted regions");
+				submit();
+				expect(ring.AllocateOrWait(size, 16, timeline, offset), scenario, "the allocation to fit once the ring has been submitted and waited for");
+			}
+
+			// What the timeline reached is free, the other regions are still read by the fake GPU
+			std::erase_if(liveRegions, [&timeline](const LiveRegion& region) { return (region.Value != 0 && region.Value <= timeline.GetCompletedValue()); });
+			for (const LiveRegion& region : liveRegions)
+				expect(offset + size <= region.Offset || region.Offset + region.Size <= offset, scenario, "a region that doesn't overlap a region the timeline didn't reach");
+			liveRegions.push_back(LiveRegion{ offset, size, 0 });
+
+			if (random() % 4 == 0)
+				submit();
+		}
+		submit();
+		timeline.WaitIdle();
+		ring.RetireCompleted(timeline);
+		expect(ring.HasPendingSubmissions() == false && ring.GetUsedSize() == 0, scenario, "an empty ring once the timeline is idle");
+	}
+
+	/* FRAME RING */
+	{
+		std::mt19937 random(42);
+
+		for (uint32_t frameCount = 1; frameCount <= 3; frameCount++)
+		{
+			const std::string scenario = std::format("frame ring with {:d} slots", frameCount);
+			VulkanCpuTimeline timeline;
+			VulkanFrameRing ring(frameCount, 3);
+			FakeGpu gpu(timeline);
+			// The next frames would break the same expectations, only the first broken frame is logged
+			const uint32_t previousFailureCount = failureCount;
+
+			for (uint32_t frameNumber = 0; frameNumber < randomSubmissionCount / 3 && failureCount == previousFailureCount; frameNumber++)
+			{
+				// As VulkanSwapChainHandler::AcquireNextFrame: wait for the slot, then for the previous owner of the image
+				const uint32_t frameIndex = ring.BeginFrame();
+				ring.WaitForFrame(frameIndex, timeline);
+				expect(ring.IsFrameInFlight(frameIndex) == false && timeline.Poll() >= ring.GetFrameTimelineValue(frameIndex), scenario, "the slot to be reused once the timeline reached its value");
+
+				const uint32_t previousOwner = ring.AcquireImage(random() % ring.GetImageCount());
+				if (previousOwner != VulkanFrameRing::InvalidIndex)
+				{
+					ring.WaitForFrame(previousOwner, timeline);
+					expect(ring.IsFrameInFlight(previousOwner) == false && timeline.Poll() >= ring.GetFrameTimelineValue(previousOwner), scenario, "the image to be reused once the timeline reached the value of its previous owner");
+				}
+
+				// The other slots are only waited for when they are reused
+				for (uint32_t otherFrame = 0; otherFrame < frameCount; otherFrame++)
+				{
+					if (otherFrame != frameIndex && ring.IsFrameInFlight(otherFrame))
+						expect(ring.GetFrameTimelineValue(otherFrame) > ring.GetFrameTimelineValue(frameIndex), scenario, "the slots in flight to be the ones submitted after this one");
+				}
+
+				const uint64_t value = timeline.ReserveSignalValue();
+				ring.SubmitFrame(value);
+				expect(ring.GetFrameTimelineValue(frameIndex) == value, scenario, "the slot to be in flight until the value of its submission");
+				gpu.Submit(value);
+			}
+			timeline.WaitIdle();
+		}
+	}
+
+	OV_LOG(LogVulkan, Display, "Timeline self test: {:s} ({:d} failed expectations)", failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
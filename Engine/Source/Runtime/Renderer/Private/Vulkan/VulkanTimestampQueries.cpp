@@ -0,0 +1,50 @@
+#include "Vulkan/VulkanTimestampQueries.h"
+#include "Vulkan/VulkanDeviceHandler.h"
+
+VulkanDeviceTimestampQueries::VulkanDeviceTimestampQueries(vk::Device device, uint32_t queryCount)
+	: m_Device(device), m_QueryCount(queryCount)
+{
+	vk::QueryPoolCreateInfo queryPoolCreateInfo(
+		vk::QueryPoolCreateFlags(),
+		vk::QueryType::eTimestamp,
+		queryCount
+	);
+	m_QueryPool = m_Device.createQueryPool(queryPoolCreateInfo);
+}
+
+VulkanDeviceTimestampQueries::~VulkanDeviceTimestampQueries()
+{
+	m_Device.destroyQueryPool(m_QueryPool);
+}
+
+VulkanTimestampConversion VulkanDeviceTimestampQueries::GetConversion(const VulkanDeviceHandler& device, VulkanQueueType::Type queueType)
+{
+	const std::vector<vk::QueueFamilyProperties> queueFamilies = device.GetPhysicalDevice().getQueueFamilyProperties();
+
+	VulkanTimestampConversion conversion;
+	conversion.Period = device.GetPhysicalDeviceProperties().limits.timestampPeriod;
+	conversion.ValidBits = queueFamilies[device.GetQueue(queueType).FamilyIndex].timestampValidBits;
+	return (conversion);
+}
+
+void VulkanDeviceTimestampQueries::ResetQueries(const vk::CommandBuffer& commandBuffer, uint32_t firstQuery, uint32_t count)
+{
+	commandBuffer.resetQueryPool(m_QueryPool, firstQuery, count);
+}
+
+void VulkanDeviceTimestampQueries::WriteTimestamp(const vk::CommandBuffer& commandBuffer, vk::PipelineStageFlagBits stage, uint32_t query)
+{
+	commandBuffer.writeTimestamp(stage, m_QueryPool, query);
+}
+
+bool VulkanDeviceTimestampQueries::ReadTimestamps(uint32_t firstQuery, uint32_t count, uint64_t* outTicks)
+{
+	// Never wait, eNotReady when a query isn't written yet
+	const vk::Result result = m_Device.getQueryPoolResults(
+		m_QueryPool,
+		firstQuery, count,
+		sizeof(uint64_t) * count, outTicks, sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64
+	);
+	return (result == vk::Result::eSuccess);
+}
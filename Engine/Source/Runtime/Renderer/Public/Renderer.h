@@ -7,6 +7,9 @@
 #include "Vulkan/VulkanRayTracingPipeline.h"
 #include "Vulkan/VulkanAccelerationStructure.h"
 #include "Vulkan/VulkanShaderBindingTable.h"
+#include "Vulkan/VulkanTimeline.h"
+#include "Vulkan/VulkanGpuProfiler.h"
+#include "VoxelWorld.h"
 
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
@@ -17,6 +20,18 @@
  */
 class RENDERER_API Renderer final
 {
+public:
+	/** Name of the PerFrameProfilerStorage categories the GPU scopes of the frames are reported to */
+	struct ProfilingCategories
+	{
+		/** The ray tracing of the frame image */
+		static constexpr const char* GpuTraceRays = "Renderer_GpuTraceRays";
+		/** The UI drawn over the frame image */
+		static constexpr const char* GpuUI = "Renderer_GpuUI";
+	};
+
+	/** Half the width of the terrain the world is made of, in voxels (@see VoxelTerrain::Generate) */
+	static constexpr int32_t WorldRadius = 16;
 
 public:
 	/* DO NOT CALL DIRECTLY, use the Get/Initialize method */
@@ -40,21 +55,38 @@ public:
 	/** Cleanup the renderer to make sure the engine exit properly */
 	static void Shutdown();
 
+	/** Where the shaders of the renderer are compiled from and cached */
+	static VulkanShaderCompiler::Settings GetShaderCompilerSettings();
+
 public:
-	/** Prepare a new frame to be renderer */
+	/**
+	 * Prepare a new frame to be renderer.
+	 * Can run on any thread: it never call GLFW (the window isn't resizable, the swap chain is never recreated), but the swap chain,
+	 * the queues and the descriptor set of the frame must be externally synchronized, nothing else can use them until it return.
+	 */
 	void PrepareNewFrame();
-	/** Render a new frame on the window */
+	/** Render a new frame on the window, on the main thread (the present can block on the window system) */
 	void RenderNewFrame();
 
-	/** Called every frame */
+	/** Called every frame, on the main thread (GLFW events) */
 	void Tick();
 
 	__forceinline bool IsWindowClosed() const { return (glfwWindowShouldClose(s_Window) == GLFW_TRUE); }
 	__forceinline static GLFWwindow* GetWindow() { return s_Window; }
 
 public:
-	__forceinline const VulkanSwapChainFrame& GetCurrentFrame() const { return m_VkSwapChain.GetFrame(m_CurrentFrameIndex); }
-	__forceinline uint8_t GetCurrentFrameIndex() const { return m_CurrentFrameIndex; }
+	/** Get the frame being recorded, between PrepareNewFrame and RenderNewFrame */
+	__forceinline VulkanSwapChainFrame GetCurrentFrame() const { return m_VkSwapChain.GetCurrentFrame(); }
+	/** Get the GPU scopes of the frame being recorded, nullptr if the graphic queue has no timestamps */
+	__forceinline VulkanGpuScopes* GetFrameGpuScopes() const { return m_GpuProfiler.GetFrameScopes(); }
+
+	/** Get the voxel world that is being rendered */
+	__forceinline const VoxelWorld& GetVoxelWorld() const { return m_VoxelWorld; }
+	/**
+	 * Get the voxel world to edit it, the BLAS of the edited chunks are rebuilt (or refit) from the next PrepareNewFrame.
+	 * PrepareNewFrame read the world, the edits must not run at the same time (e.g. a frame task that write the VoxelWorld resource).
+	 */
+	__forceinline VoxelWorld& GetVoxelWorld() { return m_VoxelWorld; }
 
 private:
 	/** Create, initialize and setup the vulkan instance */
@@ -65,6 +97,17 @@ private:
 	void InitVulkanDevice();
 	/** Create, initialize and setup the vulkan swap chain */
 	void InitSwapChain();
+	/** Create the timestamp queries of each frame in flight, if the graphic queue support them */
+	void InitGpuProfiler();
+	/** Create the pipeline cache from the one saved by the previous launch, if it has been saved for this device */
+	void InitPipelineCache();
+	/** Write the pipeline cache in the saved directory, for the next launch */
+	void SavePipelineCache() const;
+
+	/** Write the resources of the frame on its descriptor set, they may have changed since the last time its slot was used */
+	void UpdateFrameDescriptorSet(const VulkanSwapChainFrame& frame);
+	/** Record the command buffer of the frame: trace rays into its image and prepare it to be presented */
+	void RecordFrameCmdBuffer(const VulkanSwapChainFrame& frame);
 
 	/** Record a memory barrier that will put the image in mode that allow shader to write onto it */
 	void ShaderWriteBarrier(const vk::CommandBuffer& cmdBuffer, const vk::Image& image, vk::AccessFlagBits previousAccessFlag, vk::ImageLayout previousImageLayout);
@@ -79,17 +122,27 @@ private:
 
 	VulkanInstanceHandler m_VkInstance;
 	VulkanDeviceHandler m_VkDevice;
+	/** Timeline of each queue, signaled by each of its submissions */
+	VulkanDeviceTimeline m_GraphicTimeline;
+	VulkanDeviceTimeline m_ComputeTimeline;
+	VulkanDeviceTimeline m_TransferTimeline;
 	vk::CommandPool m_CommandPool;
 	VulkanSwapChainHandler m_VkSwapChain;
+	/** GPU scopes of the frames in flight, read back when their slot is reused */
+	VulkanGpuProfiler m_GpuProfiler;
 	vk::SurfaceKHR m_Surface;
+	/** Compile the shaders of the pipelines, or get them from the shader cache of the saved directory */
+	std::unique_ptr<VulkanShaderCompiler> m_ShaderCompiler;
 	VulkanRayTracingPipeline m_Pipeline;
 	VulkanAccelerationStructure m_AccelerationStructure;
 	VulkanShaderBindingTable m_ShaderBindingTable;
+	/** Saved on shutdown and loaded on startup, the pipelines are only compiled on the first launch */
 	vk::PipelineCache m_PipelineCache;
 
-	vk::DispatchLoaderDynamic m_Dldi;
+	/** The voxels that are rendered, the acceleration structure is built from it */
+	VoxelWorld m_VoxelWorld;
 
-	uint8_t m_CurrentFrameIndex;
+	vk::DispatchLoaderDynamic m_Dldi;
 
 	vk::Image m_RayTracingImage;
 	vk::DeviceMemory m_RayTracingImageMemory;
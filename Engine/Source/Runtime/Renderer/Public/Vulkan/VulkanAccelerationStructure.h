@@ -4,8 +4,39 @@
 #include "Vulkan/VulkanUtils.h"
 #include "Vulkan/VulkanInstanceHandler.h"
 #include "Vulkan/VulkanDeviceHandler.h"
+#include "Vulkan/VulkanStagingBuffer.h"
+#include "Vulkan/VulkanTimeline.h"
+#include "Vulkan/VulkanGpuProfiler.h"
+#include "Vulkan/VulkanAccelerationStructureBuildPlanner.h"
+#include "Vulkan/VulkanBlasRefitHeuristic.h"
+#include "Vulkan/VulkanChunkInstanceTracker.h"
+#include "VoxelWorld.h"
 
 #include <vulkan/vulkan.hpp>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
+
+/** Memory given back by the compaction of the BLAS (@see VulkanAccelerationStructure::SetBlasCompaction) */
+struct VulkanBlasCompactionStatistics
+{
+	uint32_t ChunkCount = 0;
+	/** Size of the BLAS before and after their compaction */
+	vk::DeviceSize OriginalSize = 0;
+	vk::DeviceSize CompactedSize = 0;
+
+	__forceinline vk::DeviceSize GetSavedSize() const { return (OriginalSize - CompactedSize); }
+	__forceinline double GetSavedSizePerChunk() const { return (ChunkCount > 0 ? static_cast<double>(GetSavedSize()) / ChunkCount : 0.0); }
+
+	VulkanBlasCompactionStatistics& operator+=(const VulkanBlasCompactionStatistics& rhs)
+	{
+		ChunkCount += rhs.ChunkCount;
+		OriginalSize += rhs.OriginalSize;
+		CompactedSize += rhs.CompactedSize;
+		return (*this);
+	}
+};
 
 struct alignas(8) MiddlePosition {
 	float x;
@@ -13,8 +44,41 @@ struct alignas(8) MiddlePosition {
 	float z;
 };
 
+/**
+ * The acceleration structures of a voxel world: one BLAS per chunk (built from the AABBs of the chunk in local space),
+ * and a TLAS with one instance per chunk. Editing a chunk only rebuild the BLAS of this chunk, and the TLAS.
+ *
+ * The builds never block the renderer: the modified chunks are queued in a VulkanAccelerationStructureBuildPlanner,
+ * each update submit the next batch of BLAS builds (sharing one scratch buffer) followed by the TLAS build, and the timeline value
+ * of the batch tell when the resources it replaced can be destroyed.
+ *
+ * The batches are submitted on the compute queue and their uploads on the transfer queue (the graphic one when the device has no dedicated family).
+ * The TLAS, the refit BLAS and their AABBs are updated in place, so the uploads and the builds wait for the frames submitted before them,
+ * and the frames wait for the last batch (@see GetBuildWait). The buffers read by the frames are shared by the families,
+ * the TLAS instances are exclusive to the compute family and change owner after each upload.
+ *
+ * With the compaction enabled, the BLAS are built with eAllowCompaction and each batch query their compacted size.
+ * Once the batch is complete, the next one copy them into right-sized buffers (and rebuild the TLAS with their new addresses),
+ * the originals are retired with it.
+ *
+ * The chunks edited after they were loaded are rebuilt with eAllowUpdate and a slack of degenerate AABBs,
+ * so the next small edits refit their BLAS in place (eUpdate) until VulkanBlasRefitHeuristic decide a full build is better.
+ */
 class RENDERER_API VulkanAccelerationStructure final
 {
+public:
+	/** Name of the PerFrameProfilerStorage categories the GPU scopes of the batches are reported to, once they are complete */
+	struct ProfilingCategories
+	{
+		/** The compacted copies and the BLAS builds of a batch */
+		static constexpr const char* GpuBlasBuild = "VulkanAccelerationStructure_GpuBlasBuild";
+		/** The TLAS build of a batch */
+		static constexpr const char* GpuTlasBuild = "VulkanAccelerationStructure_GpuTlasBuild";
+	};
+
+	/** How many batches can be in flight, the updates stop submitting (the builds stay queued) until the oldest one is complete */
+	static constexpr uint32_t MaxSubmissionsInFlight = 3;
+
 public:
 	VulkanAccelerationStructure() = default;
 	VulkanAccelerationStructure(const VulkanDeviceHandler* device)
@@ -23,32 +87,247 @@ public:
 	~VulkanAccelerationStructure() = default;
 
 public:
-	void CreateAccelerationStructure(const vk::CommandBuffer& commandBuffer);
+	/** Queue the BLAS of every chunk of the world and submit all of them, only wait for the GPU when too many batches are in flight */
+	void CreateAccelerationStructure(const VoxelWorld& world);
+	/**
+	 * Queue the BLAS of the chunks modified since the last update, retire the ones of the removed chunks,
+	 * then submit the next batch of BLAS builds and the TLAS build. Never wait for the GPU: the builds that don't fit
+	 * in the batch (or all of them while too many batches are in flight) stay queued for the next update.
+	 * The replaced BLAS are destroyed once the batch is complete, the frames submitted after it use the new TLAS.
+	 *
+	 * \return true when the TLAS or the AABB addresses buffer has been recreated (the descriptor sets must be written again)
+	 */
+	bool UpdateAccelerationStructure(const VoxelWorld& world);
+	/** Destroy the resources replaced by the batches that are complete on the GPU */
+	void RetireCompletedBuilds();
+	/** Block until every submitted batch is complete */
+	void WaitForBuilds();
 	void DestroyAccelerationStructure();
 
 public:
-	vk::AccelerationStructureKHR GetBlas() const { return m_Blas; }
 	vk::AccelerationStructureKHR GetTlas() const { return m_Tlas; }
+	/** Get the buffer that contain the address of the AABBs of each TLAS instance (read by the intersection shader, indexed by the instance custom index) */
+	vk::Buffer GetAabbAddressBuffer() const { return m_AabbAddressBuffer; }
+	/** Get how many AABBs are stored in the BLAS of all the chunks */
+	uint32_t GetAabbCount() const { return m_AabbCount; }
+	/** Get how many instances there is in the TLAS */
+	uint32_t GetInstanceCount() const { return m_InstanceCount; }
+	/** Get how many chunks are waiting for their BLAS to be submitted */
+	size_t GetQueuedBuildCount() const { return m_BuildPlanner.GetQueuedCount(); }
+	/** Get how many compacted copies are waiting for the next batch */
+	size_t GetQueuedCompactionCount() const { return m_QueuedCompactions.size(); }
+	/** Get the memory saved by the compaction of every BLAS since the creation */
+	const VulkanBlasCompactionStatistics& GetCompactionStatistics() const { return m_CompactionStatistics; }
+	/** Get how many batches are submitted and not complete yet */
+	size_t GetSubmissionInFlightCount() const { return m_PendingSubmissions.size(); }
+	/** Get the CPU side bookkeeping of the chunks */
+	const VulkanChunkInstanceTracker& GetInstanceTracker() const { return m_InstanceTracker; }
+
+	/** Enable or disable the compaction of the BLAS built from now on (enabled by default) */
+	void SetBlasCompaction(bool bEnabled) { m_bCompactBlas = bEnabled; }
+	bool IsBlasCompactionEnabled() const { return m_bCompactBlas; }
+	/** Set when the BLAS are refit instead of rebuilt, must be called before CreateAccelerationStructure */
+	void SetBlasRefitSettings(const VulkanBlasRefitSettings& settings) { CHECK(!m_CommandPool); m_RefitHeuristic.SetSettings(settings); }
+	const VulkanBlasRefitHeuristic& GetBlasRefitHeuristic() const { return m_RefitHeuristic; }
 
 	void SetVulkanDevice(const VulkanDeviceHandler* device) { m_VkDevice = device; }
 	void SetDispatchLoaderDynamic(const vk::DispatchLoaderDynamic* dldi) { m_Dldi = dldi; }
+	/**
+	 * Set the timelines of the queues, must be called before CreateAccelerationStructure.
+	 *
+	 * \param buildTimeline the timeline of the compute queue, the batches are submitted on
+	 * \param uploadTimeline the timeline of the transfer queue, the uploads are submitted on
+	 * \param frameTimeline the timeline of the graphic queue, the frames that trace rays are submitted on
+	 */
+	void SetTimelines(VulkanDeviceTimeline* buildTimeline, VulkanDeviceTimeline* uploadTimeline, const VulkanDeviceTimeline* frameTimeline)
+	{
+		m_BuildTimeline = buildTimeline;
+		m_UploadTimeline = uploadTimeline;
+		m_FrameTimeline = frameTimeline;
+	}
+	/** Get what the next frame that trace rays must wait for: the last batch submitted */
+	VulkanTimelineWait GetBuildWait() const { return VulkanTimelineWait{ m_BuildTimeline, m_BuildTimeline->GetLastSignalValue(), vk::PipelineStageFlagBits::eRayTracingShaderKHR }; }
+
+private:
+	/** Everything owned by the BLAS of a chunk */
+	struct ChunkBlas
+	{
+		/** The AABBs of the chunk, in local space */
+		vk::Buffer AabbBuffer;
+		VulkanMemoryAllocation AabbBufferAllocation;
+		uint32_t AabbCount = 0;
+
+		vk::Buffer BlasBuffer;
+		VulkanMemoryAllocation BlasBufferAllocation;
+		vk::AccelerationStructureKHR Blas;
+		/** Size of the BLAS, smaller than the one given by the build sizes once it's compacted */
+		vk::DeviceSize BlasSize = 0;
+		bool bCompacted = false;
+
+		/** A refit must use the flags of the build */
+		vk::BuildAccelerationStructureFlagsKHR BuildFlags;
+		VulkanBlasRefitCounters RefitCounters;
+		/** The AABBs of the last build or refit, only kept by the BLAS that allow update, to count the primitives the next edit change */
+		std::vector<VoxelAabb> RefitAabbs;
+	};
+
+	/** A BLAS whose compacted size is known, copied into a right-sized buffer by the next batch */
+	struct QueuedCompaction
+	{
+		ChunkCoordinate Coordinate;
+		/** The BLAS the size was queried from, the compaction is skipped if the chunk has been rebuilt since */
+		vk::AccelerationStructureKHR Blas;
+		vk::DeviceSize CompactedSize = 0;
+	};
+
+	/** A chunk waiting in the planner, its AABBs are generated when it's queued */
+	struct QueuedChunkBuild
+	{
+		/** Revision of the chunk the AABBs were generated from */
+		uint64_t Revision = 0;
+		std::vector<VoxelAabb> Aabbs;
+		VulkanBlasBuildKind::Type Kind = VulkanBlasBuildKind::Build;
+		/** How many primitives of the current BLAS the AABBs change, only counted for a refit (@see VulkanBlasRefitHeuristic::CountChangedPrimitives) */
+		uint32_t ChangedPrimitiveCount = 0;
+		/** The sizes depend on the flags: eAllowUpdate for the edited chunks, eAllowCompaction for the others when the compaction is enabled */
+		vk::BuildAccelerationStructureFlagsKHR BuildFlags;
+		/** The AABBs are padded with degenerate ones up to this count (@see VulkanBlasRefitHeuristic::GetPrimitiveCapacity) */
+		uint32_t PrimitiveCapacity = 0;
+		vk::AccelerationStructureBuildSizesInfoKHR BuildSizes;
+	};
+
+	struct RetiredBuffer
+	{
+		vk::Buffer Buffer;
+		VulkanMemoryAllocation Allocation;
+	};
+
+	/** What has been replaced while recording a batch, the previous submissions may still use it */
+	struct RetiredResources
+	{
+		std::vector<ChunkBlas> Blases;
+		std::vector<vk::AccelerationStructureKHR> AccelerationStructures;
+		std::vector<RetiredBuffer> Buffers;
+	};
+
+	struct BuildSubmission
+	{
+		vk::CommandBuffer CommandBuffer;
+		/** Copies of the staging ring, submitted on the transfer queue before the batch */
+		vk::CommandBuffer UploadCommandBuffer;
+		/** Value of the timeline signaled once the batch is complete */
+		uint64_t SignalValue = 0;
+		/** The compacted size of the BLAS built by the batch, in the order of the candidates */
+		vk::QueryPool CompactionQueryPool;
+		std::vector<QueuedCompaction> CompactionCandidates;
+		/** GPU scopes of the batch, nullptr if the compute queue has no timestamps */
+		std::unique_ptr<VulkanGpuScopes> GpuScopes;
+		/** Destroyed once the timeline reach the value of the batch */
+		RetiredResources Retired;
+	};
+
+	/** Sync the tracker with the world, queue the dirty chunks and retire the removed ones */
+	void QueueWorldChanges(const VoxelWorld& world);
+	/**
+	 * Record and submit the next batch of the planner and the TLAS build.
+	 *
+	 * \return true if the TLAS has been recreated
+	 */
+	bool SubmitBuildBatch();
+	/** Get the command buffer and the query pools of a new submission, reusing the ones of a retired submission when possible */
+	BuildSubmission AcquireSubmission();
+	/** Read the compacted sizes queried by a complete batch, and queue the BLAS that are worth compacting */
+	void QueueCompactions(BuildSubmission& submission);
+	/** Create the right-sized BLAS of the queued compactions and give their copies to record, the original BLAS are retired */
+	void PrepareCompactions(std::vector<vk::CopyAccelerationStructureInfoKHR>& outCopies);
+	/** Wait for the oldest batch in flight and retire it */
+	void WaitForOldestSubmission();
+
+	/**
+	 * Create a buffer bound to memory of the pooled allocator of the device.
+	 *
+	 * \param queueTypes the queues that use the buffer, it's shared concurrently when they are on different families
+	 * \param minAlignment alignment of the buffer address on top of the one required by the buffer (e.g. for the scratch buffers)
+	 */
+	void CreateBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperty, std::initializer_list<VulkanQueueType::Type> queueTypes, vk::Buffer& outBuffer, VulkanMemoryAllocation& outAllocation, vk::DeviceSize minAlignment = 0) const;
+	void DestroyBuffer(vk::Buffer& buffer, VulkanMemoryAllocation& allocation) const;
+	/**
+	 * Queue the copy of data to a device local buffer through the staging ring, submitted on the transfer queue before the batch.
+	 *
+	 * \param bExclusiveToCompute whether or not the buffer has been created for the compute queue only, it's released to it after the copy
+	 */
+	void UploadToBuffer(vk::Buffer buffer, const void* data, vk::DeviceSize size, bool bExclusiveToCompute = false);
+	void DestroyChunkBlas(ChunkBlas& chunkBlas) const;
+	/** Move a buffer to the resources destroyed with the batch being recorded */
+	void RetireBuffer(vk::Buffer& buffer, VulkanMemoryAllocation& allocation);
+	void DestroyRetiredResources(RetiredResources& resources) const;
+
+	/**
+	 * Make sure the TLAS (and the buffers of its instances) can hold at least instanceCount instances,
+	 * they are recreated with a bigger capacity when needed.
+	 *
+	 * \return true if the TLAS has been recreated
+	 */
+	bool ReserveTlas(uint32_t instanceCount);
+	/** Move the TLAS and its buffers to the resources destroyed with the batch being recorded */
+	void RetireTlas();
+	/** Make sure the shared scratch buffer is at least size bytes */
+	void ReserveScratchBuffer(vk::DeviceSize size);
 
 private:
 	const VulkanDeviceHandler* m_VkDevice = nullptr;
 	const vk::DispatchLoaderDynamic* m_Dldi = nullptr;
+	VulkanDeviceTimeline* m_BuildTimeline = nullptr;
+	VulkanDeviceTimeline* m_UploadTimeline = nullptr;
+	const VulkanDeviceTimeline* m_FrameTimeline = nullptr;
 
-	vk::Buffer m_AabbBuffer;
-	vk::DeviceMemory m_AabbBufferMemory;
+	/** The AABBs and the TLAS instances are uploaded through it, the buffers they go to stay in device local memory */
+	VulkanStagingBuffer m_StagingBuffer;
 
-	vk::Buffer m_BlasBuffer;
-	vk::DeviceMemory m_BlasBufferMemory;
+	VulkanChunkInstanceTracker m_InstanceTracker;
+	std::unordered_map<ChunkCoordinate, ChunkBlas, ChunkCoordinateHash> m_ChunkBlases;
+	uint32_t m_AabbCount = 0;
+
+	VulkanAccelerationStructureBuildPlanner m_BuildPlanner;
+	std::unordered_map<ChunkCoordinate, QueuedChunkBuild, ChunkCoordinateHash> m_QueuedChunkBuilds;
+	bool m_bCompactBlas = true;
+	VulkanBlasRefitHeuristic m_RefitHeuristic;
+	std::vector<QueuedCompaction> m_QueuedCompactions;
+	VulkanBlasCompactionStatistics m_CompactionStatistics;
+
+	/** The instances changed since the last batch (a chunk has been removed, or the TLAS doesn't exist yet) */
+	bool m_bTlasDirty = true;
+
+	/** On the compute family for the batches, and on the transfer family for their uploads */
+	vk::CommandPool m_CommandPool;
+	vk::CommandPool m_UploadCommandPool;
+	/** Timestamps of the compute queue, the GPU scopes are disabled when it doesn't support them */
+	VulkanTimestampConversion m_GpuTimestampConversion;
+	/** Oldest first */
+	std::deque<BuildSubmission> m_PendingSubmissions;
+	std::vector<BuildSubmission> m_FreeSubmissions;
+	/** Replaced while recording the next batch */
+	RetiredResources m_RetiringResources;
+
+	/** Shared by the BLAS builds of a batch (each one has its own range) then by the TLAS build */
+	vk::Buffer m_ScratchBuffer;
+	VulkanMemoryAllocation m_ScratchBufferAllocation;
+	vk::DeviceSize m_ScratchBufferSize = 0;
+
+	/** How many instances the TLAS and its buffers can hold */
+	uint32_t m_TlasCapacity = 0;
+	uint32_t m_InstanceCount = 0;
+	/** Scratch size of the TLAS build at its capacity */
+	vk::DeviceSize m_TlasScratchSize = 0;
 
 	vk::Buffer m_TlasInstanceBuffer;
-	vk::DeviceMemory m_TlasInstanceBufferMemory;
+	VulkanMemoryAllocation m_TlasInstanceBufferAllocation;
+
+	vk::Buffer m_AabbAddressBuffer;
+	VulkanMemoryAllocation m_AabbAddressBufferAllocation;
 
 	vk::Buffer m_TlasBuffer;
-	vk::DeviceMemory m_TlasBufferMemory;
+	VulkanMemoryAllocation m_TlasBufferAllocation;
 
-	vk::AccelerationStructureKHR m_Blas;
 	vk::AccelerationStructureKHR m_Tlas;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "VoxelTypes.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+struct VulkanAccelerationStructureBuildPlannerSettings
+{
+	/** How many builds at most are recorded in a single buildAccelerationStructuresKHR */
+	uint32_t MaxBuildsPerBatch = 256;
+	/** Size of the scratch memory shared by the builds of a batch, a build bigger than that alone get a batch for itself */
+	uint64_t ScratchBudget = 32ull * 1024 * 1024;
+	/** vk::PhysicalDeviceAccelerationStructurePropertiesKHR::minAccelerationStructureScratchOffsetAlignment */
+	uint64_t ScratchAlignment = 128;
+};
+
+/**
+ * Queue of the BLAS builds waiting for the GPU, and which of them go in the next batch.
+ * The builds of a batch run in a single buildAccelerationStructuresKHR and share one scratch buffer, where each of them
+ * has its own aligned range. The batches are serialized on the queue, so the next batch reuse the same scratch buffer:
+ * the budget bound its size, whatever the amount of queued builds.
+ * It only deals with coordinates and sizes, so it can be tested without a GPU.
+ */
+class RENDERER_API VulkanAccelerationStructureBuildPlanner final
+{
+public:
+	/** A build of a batch, and its range in the scratch buffer */
+	struct PlannedBuild
+	{
+		ChunkCoordinate Coordinate;
+		uint64_t ScratchOffset = 0;
+		uint64_t ScratchSize = 0;
+	};
+
+	struct Batch
+	{
+		/** In the order they were queued */
+		std::vector<PlannedBuild> Builds;
+		/** Size of the scratch buffer the batch need */
+		uint64_t ScratchSize = 0;
+	};
+
+public:
+	VulkanAccelerationStructureBuildPlanner(const VulkanAccelerationStructureBuildPlannerSettings& settings = {});
+
+#pragma region API
+public:
+	/** Queue the build of a chunk, a chunk already queued keep its place with the new scratch size */
+	void Enqueue(const ChunkCoordinate& coordinate, uint64_t scratchSize);
+	/** Remove a chunk from the queue, return false if it wasn't queued */
+	bool Cancel(const ChunkCoordinate& coordinate);
+	/**
+	 * Take the builds of the next batch out of the queue: the oldest builds that fit in the scratch budget (first fit),
+	 * the oldest one is always taken so a build can't wait forever.
+	 */
+	void PlanBatch(Batch& outBatch);
+	void Clear();
+
+	__forceinline bool IsQueued(const ChunkCoordinate& coordinate) const { return (m_QueuedBuildsIndex.contains(coordinate)); }
+	__forceinline bool HasQueuedBuilds() const { return (m_QueuedBuilds.empty() == false); }
+	__forceinline size_t GetQueuedCount() const { return (m_QueuedBuilds.size()); }
+
+	__forceinline const VulkanAccelerationStructureBuildPlannerSettings& GetSettings() const { return (m_Settings); }
+	void SetSettings(const VulkanAccelerationStructureBuildPlannerSettings& settings);
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Self test, no GPU needed: plan scripted batches (oversized first build, aligned offsets, builds over the budget skipped,
+	 * MaxBuildsPerBatch, Enqueue and Cancel of queued chunks) then random ones, and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest(uint32_t randomOperationCount = 100000);
+#pragma endregion
+
+private:
+	struct QueuedBuild
+	{
+		ChunkCoordinate Coordinate;
+		uint64_t ScratchSize = 0;
+	};
+
+private:
+	VulkanAccelerationStructureBuildPlannerSettings m_Settings;
+
+	/** Oldest first */
+	std::list<QueuedBuild> m_QueuedBuilds;
+	std::unordered_map<ChunkCoordinate, std::list<QueuedBuild>::iterator, ChunkCoordinateHash> m_QueuedBuildsIndex;
+};
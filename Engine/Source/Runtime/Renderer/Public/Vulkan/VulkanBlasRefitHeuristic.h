@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "VoxelTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+struct VulkanBlasRefitSettings
+{
+	/** Refit the BLAS of the chunks edited after they were loaded, instead of rebuilding them */
+	bool bEnabled = true;
+	/** Refits in a row before a full rebuild, the BLAS get slower to trace with each of them */
+	uint32_t MaxRefitCount = 16;
+	/** An edit that change more primitives than this ratio of the AABB count of the last full build is rebuilt */
+	float MaxEditRatio = 0.1f;
+	/** Once the primitives changed by the refits are over this ratio of the last full build, the next edit is rebuilt */
+	float MaxAccumulatedEditRatio = 0.5f;
+	/** Degenerate AABBs added to the BLAS that can be refit, so an edit can add boxes (ratio of the AABB count, at least MinPrimitiveSlack) */
+	float PrimitiveSlackRatio = 0.25f;
+	uint32_t MinPrimitiveSlack = 8;
+};
+
+/** What is known about the BLAS of a chunk, to choose between a refit and a rebuild */
+struct VulkanBlasRefitCounters
+{
+	/** How many full builds, the first one is the loading of the chunk */
+	uint32_t BuildCount = 0;
+	/** The BLAS has been built with eAllowUpdate */
+	bool bAllowUpdate = false;
+	/** How many primitives the BLAS has (the AABBs and their degenerate padding), a refit must keep the same count */
+	uint32_t PrimitiveCapacity = 0;
+	/** AABB count of the last full build */
+	uint32_t BuiltAabbCount = 0;
+	/** AABB count of the last build or refit */
+	uint32_t AabbCount = 0;
+	/** How many refits since the last full build */
+	uint32_t RefitCount = 0;
+	/** Sum of the primitives changed by the refits since the last full build */
+	uint64_t AccumulatedPrimitiveChange = 0;
+};
+
+namespace VulkanBlasBuildKind
+{
+	enum Type : uint8_t
+	{
+		/** Full build (eBuild), a new BLAS is created */
+		Build,
+		/** Update of the existing BLAS in place (eUpdate), the primitive count and the flags can't change */
+		Refit,
+	};
+}
+
+/**
+ * Decide between refitting and rebuilding the BLAS of an edited chunk.
+ * The chunks are built for fast tracing when they are loaded, the ones edited afterwards are rebuilt with eAllowUpdate
+ * and a slack of degenerate AABBs: the next small edits refit them, until the edits add up or too many refits happened in a row.
+ * It only deals with counters, so it can be tested without a GPU.
+ */
+class RENDERER_API VulkanBlasRefitHeuristic final
+{
+public:
+	VulkanBlasRefitHeuristic(const VulkanBlasRefitSettings& settings = {})
+		: m_Settings(settings)
+	{}
+
+#pragma region API
+public:
+	/**
+	 * Decide how the BLAS of a chunk must be built.
+	 *
+	 * \param counters the counters of the current BLAS of the chunk, nullptr if it has never been built
+	 * \param aabbCount how many AABBs the chunk has now
+	 * \param changedPrimitiveCount how many primitives of the BLAS the edit change (@see CountChangedPrimitives)
+	 */
+	VulkanBlasBuildKind::Type Decide(const VulkanBlasRefitCounters* counters, uint32_t aabbCount, uint32_t changedPrimitiveCount) const;
+	/** Tell whether or not a full build must allow the updates: only the chunks edited after they were loaded (the others are compacted) */
+	bool ShouldAllowUpdate(const VulkanBlasRefitCounters* counters) const;
+	/** Get how many primitives a full build has, the AABBs and the slack of the BLAS that allow update */
+	uint32_t GetPrimitiveCapacity(uint32_t aabbCount, bool bAllowUpdate) const;
+
+	/** Get the counters of a BLAS after a full build (previous is nullptr for the first build of a chunk) */
+	VulkanBlasRefitCounters OnBuilt(const VulkanBlasRefitCounters* previous, uint32_t aabbCount, bool bAllowUpdate) const;
+	/** Get the counters of a BLAS after a refit that changed changedPrimitiveCount of its primitives */
+	VulkanBlasRefitCounters OnRefit(const VulkanBlasRefitCounters& previous, uint32_t aabbCount, uint32_t changedPrimitiveCount) const;
+
+	/**
+	 * Count the primitives a refit would change: the AABBs that differ at the same index, and the ones only one of the lists has.
+	 * A refit move each primitive in place, so a voxel that split a merged box count for every box that moved, not for one AABB.
+	 */
+	static uint32_t CountChangedPrimitives(const std::vector<VoxelAabb>& previous, const std::vector<VoxelAabb>& current);
+
+	__forceinline const VulkanBlasRefitSettings& GetSettings() const { return (m_Settings); }
+	__forceinline void SetSettings(const VulkanBlasRefitSettings& settings) { m_Settings = settings; }
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Self test, no GPU needed: replay the builds and the edits of chunks against the default settings (thresholds of Decide,
+	 * ShouldAllowUpdate, the slack of GetPrimitiveCapacity, CountChangedPrimitives) and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest();
+#pragma endregion
+
+private:
+	VulkanBlasRefitSettings m_Settings;
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "VoxelWorld.h"
+#include "VoxelAabbMerger.h"
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * CPU side bookkeeping of the per chunk acceleration structures: which chunks must have their BLAS (re)built or destroyed,
+ * and the TLAS instances of the visible chunks.
+ * It never touch the device, the BLAS built by VulkanAccelerationStructure are given back through OnChunkBuilt.
+ *
+ * Each chunk has its own BLAS built from its AABBs in local space (the first voxel of the chunk is at 0, 0, 0),
+ * the TLAS instance of a chunk translate it to its position in the world.
+ */
+class RENDERER_API VulkanChunkInstanceTracker final
+{
+public:
+	/** What is known about the acceleration structure of a chunk */
+	struct ChunkState
+	{
+		/** Revision of the chunk when its BLAS was built (@see TVoxelChunk::GetRevision) */
+		uint64_t BuiltRevision = 0;
+		/** Device address of the BLAS, 0 while the chunk has never been built */
+		vk::DeviceAddress BlasAddress = 0;
+		/** Device address of the AABBs the BLAS was built from, the intersection shader read them */
+		vk::DeviceAddress AabbBufferAddress = 0;
+		/** The BLAS must be (re)built before the chunk can be rendered correctly */
+		bool bDirty = true;
+	};
+
+	/** The instances of the TLAS, and for each of them the address of the AABBs of its chunk (indexed by the instance custom index) */
+	struct InstanceList
+	{
+		std::vector<vk::AccelerationStructureInstanceKHR> Instances;
+		std::vector<vk::DeviceAddress> AabbBufferAddresses;
+		/** Coordinate of the chunk of each instance */
+		std::vector<ChunkCoordinate> Coordinates;
+	};
+
+	/** The custom index of an instance is only 24 bits */
+	static constexpr uint32_t MaxInstanceCount = 1 << 24;
+
+public:
+	VulkanChunkInstanceTracker() = default;
+
+#pragma region API
+public:
+	/**
+	 * Compare the tracked chunks with the chunks of a world:
+	 * the new chunks and the ones with a different revision are marked dirty,
+	 * the chunks that don't exist anymore are forgotten and added to the removed chunks (@see TakeRemovedChunks).
+	 */
+	template<typename TStorage>
+	void SyncWithWorld(const TVoxelWorld<TStorage>& world)
+	{
+		for (auto chunkIt = m_Chunks.begin(); chunkIt != m_Chunks.end();)
+		{
+			if (world.FindChunk(chunkIt->first) == nullptr)
+			{
+				if (chunkIt->second.BlasAddress != 0)
+					m_RemovedChunks.push_back(chunkIt->first);
+				chunkIt = m_Chunks.erase(chunkIt);
+			}
+			else
+				++chunkIt;
+		}
+
+		for (const auto& [coordinate, chunk] : world.GetChunks())
+		{
+			ChunkState& state = m_Chunks[coordinate];
+			if (state.BuiltRevision != chunk->GetRevision())
+				state.bDirty = true;
+		}
+	}
+
+	/** Force the BLAS of a chunk to be rebuilt, even if its revision didn't change */
+	void MarkChunkDirty(const ChunkCoordinate& coordinate);
+	/** Force the BLAS of every chunks to be rebuilt */
+	void MarkAllChunksDirty();
+
+	/** Get the chunks that must be (re)built, sorted so the order doesn't depend on the hash map */
+	std::vector<ChunkCoordinate> GetDirtyChunks() const;
+	/** Tell whether or not at least one chunk must be (re)built */
+	bool HasDirtyChunks() const;
+	/** Register the BLAS built for a chunk, the chunk isn't dirty anymore */
+	void OnChunkBuilt(const ChunkCoordinate& coordinate, uint64_t revision, vk::DeviceAddress blasAddress, vk::DeviceAddress aabbBufferAddress);
+	/** Get the chunks removed from the world since the last call, their BLAS can be destroyed */
+	std::vector<ChunkCoordinate> TakeRemovedChunks();
+
+	/** Create the TLAS instances of every built chunks */
+	void GenerateInstances(InstanceList& outInstances) const
+	{
+		GenerateInstances(outInstances, [](const ChunkCoordinate&) { return (true); });
+	}
+
+	/**
+	 * Create the TLAS instances of the built chunks that pass a visibility test, sorted by coordinate so the result is deterministic.
+	 * The function signature must be: bool(const ChunkCoordinate& coordinate)
+	 */
+	template<typename F>
+	void GenerateInstances(InstanceList& outInstances, F&& isVisible) const
+	{
+		outInstances.Instances.clear();
+		outInstances.AabbBufferAddresses.clear();
+		outInstances.Coordinates.clear();
+
+		for (const auto& [coordinate, state] : m_Chunks)
+		{
+			if (state.BlasAddress != 0 && isVisible(coordinate))
+				outInstances.Coordinates.push_back(coordinate);
+		}
+		SortCoordinates(outInstances.Coordinates);
+		CHECK(outInstances.Coordinates.size() <= MaxInstanceCount);
+
+		outInstances.Instances.reserve(outInstances.Coordinates.size());
+		outInstances.AabbBufferAddresses.reserve(outInstances.Coordinates.size());
+		for (const ChunkCoordinate& coordinate : outInstances.Coordinates)
+		{
+			const ChunkState& state = m_Chunks.at(coordinate);
+			const uint32_t customIndex = static_cast<uint32_t>(outInstances.Instances.size());
+			outInstances.Instances.push_back(MakeInstance(MakeChunkTransform(coordinate), customIndex, state.BlasAddress));
+			outInstances.AabbBufferAddresses.push_back(state.AabbBufferAddress);
+		}
+	}
+
+	/** Find the state of a chunk, return nullptr if the chunk isn't tracked */
+	const ChunkState* FindChunk(const ChunkCoordinate& coordinate) const;
+	/** Return how many chunks are tracked */
+	__forceinline size_t GetChunkCount() const { return (m_Chunks.size()); }
+	/** Forget every chunks (without adding them to the removed chunks) */
+	void Clear();
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/** Get the transform of the instance of a chunk: a translation to the position of its first voxel */
+	static glm::mat4 MakeChunkTransform(const ChunkCoordinate& coordinate);
+	/** Convert an affine transform into the row major 3x4 matrix of Vulkan (the last row of the glm matrix is dropped) */
+	static vk::TransformMatrixKHR PackTransform(const glm::mat4& transform);
+	/** Create a TLAS instance of a BLAS (visible to every rays, no culling, hit group 0) */
+	static vk::AccelerationStructureInstanceKHR MakeInstance(const glm::mat4& transform, uint32_t customIndex, vk::DeviceAddress blasAddress);
+	/**
+	 * Create the AABBs of a chunk in its local space, the solid voxels are merged into boxes (@see VoxelAabbMerger).
+	 * This is the input of the BLAS build, the output is always the same for the same chunk.
+	 */
+	template<typename TStorage>
+	static std::vector<VoxelAabb> GenerateChunkAabbs(const TVoxelChunk<TStorage>& chunk, VoxelAabbMergeStatistics* outStatistics = nullptr)
+	{
+		std::vector<VoxelAabb> aabbs;
+		VoxelAabbMerger::AppendMergedAabbs(chunk, glm::ivec3(0), aabbs, outStatistics);
+		return (aabbs);
+	}
+
+	/**
+	 * Self test, no GPU needed: sync with a world whose chunks are added, edited and removed, build them with fake addresses,
+	 * check the dirty and removed chunks, the packed transforms and that the custom indices of the instances stay dense
+	 * and follow the AABBs of their chunk after a removal, and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest();
+#pragma endregion
+
+private:
+	/** Sort coordinates by z, then y, then x */
+	static void SortCoordinates(std::vector<ChunkCoordinate>& coordinates);
+
+private:
+	std::unordered_map<ChunkCoordinate, ChunkState, ChunkCoordinateHash> m_Chunks;
+	/** The chunks that had a BLAS and have been removed from the world */
+	std::vector<ChunkCoordinate> m_RemovedChunks;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "Vulkan/VulkanUtils.h"
+#include "Vulkan/VulkanShaderReflection.h"
+
+#include <vulkan/vulkan.hpp>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+/**
+ * Write the descriptors of a descriptor set by the name the shaders give them, the binding and the type come from the layout.
+ * The writes are kept until Update, so a descriptor set is updated in a single call.
+ */
+class RENDERER_API VulkanDescriptorWriter final
+{
+public:
+	VulkanDescriptorWriter(const VulkanDescriptorLayout& layout, vk::DescriptorSet descriptorSet, uint32_t set = 0);
+	~VulkanDescriptorWriter() = default;
+
+	VulkanDescriptorWriter(const VulkanDescriptorWriter& rhs) = delete;
+	VulkanDescriptorWriter operator=(const VulkanDescriptorWriter& rhs) = delete;
+
+#pragma region API
+public:
+	/** Write an acceleration structure, \return false if no shader use the name (or with another type) */
+	bool WriteAccelerationStructure(std::string_view name, vk::AccelerationStructureKHR accelerationStructure);
+	/** Write an image (storage, sampled or combined with its sampler), \return false if no shader use the name (or with another type) */
+	bool WriteImage(std::string_view name, vk::ImageView imageView, vk::ImageLayout imageLayout, vk::Sampler sampler = vk::Sampler());
+	/** Write a buffer (storage or uniform), \return false if no shader use the name (or with another type) */
+	bool WriteBuffer(std::string_view name, vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+
+	/** Update the descriptor set with the writes, the descriptor set must not be used by a pending submission */
+	void Update(vk::Device device);
+#pragma endregion
+
+private:
+	/** Find the binding of a name in the set, and check it has one of the expected types */
+	const VulkanDescriptorBinding* FindBinding(std::string_view name, std::initializer_list<vk::DescriptorType> types) const;
+
+private:
+	const VulkanDescriptorLayout& m_Layout;
+	vk::DescriptorSet m_DescriptorSet;
+	uint32_t m_Set = 0;
+
+	std::vector<vk::WriteDescriptorSet> m_Writes;
+	/** The infos the writes point to, a deque doesn't move them when it grows */
+	std::deque<vk::AccelerationStructureKHR> m_AccelerationStructures;
+	std::deque<vk::WriteDescriptorSetAccelerationStructureKHR> m_AccelerationStructureInfos;
+	std::deque<vk::DescriptorImageInfo> m_ImageInfos;
+	std::deque<vk::DescriptorBufferInfo> m_BufferInfos;
+};
@@ -2,6 +2,8 @@
 
 #include "Renderer_API.h"
 #include "VulkanNextChain.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanQueueFamilies.h"
 #include "Version.h"
 
 #include <vulkan/vulkan.hpp>
@@ -9,21 +11,6 @@
 
 class VulkanInstanceHandler;
 
-namespace VulkanQueueType
-{
-	enum Type : uint8_t
-	{
-		Graphic = 0,
-		Present = 1,
-		// Compute = 1, // Not using compute nor transfer yet
-		// Transfer = 2,
-
-		COUNT = 2
-	};
-
-	const char* ToString(Type vulkanQueueType);
-}
-
 struct VulkanMemoryRequirementsExtended : public vk::MemoryRequirements
 {
 	uint32_t MemoryTypeIndex = -1;
@@ -76,6 +63,17 @@ public:
 	VulkanMemoryRequirementsExtended FindMemoryRequirement(const vk::Buffer& buffer, vk::MemoryPropertyFlags memoryProperty) const;
 	VulkanMemoryRequirementsExtended FindMemoryRequirement(const vk::Image& image, vk::MemoryPropertyFlags memoryProperty) const;
 
+	/**
+	 * Allocate memory for a buffer from the pooled allocator, and bind it.
+	 *
+	 * \param minAlignment alignment of the memory on top of the one required by the buffer (e.g. for a device address that must be aligned)
+	 */
+	VulkanMemoryAllocation AllocateBufferMemory(const vk::Buffer& buffer, vk::MemoryPropertyFlags memoryProperty, vk::DeviceSize minAlignment = 0) const;
+	/** Allocate memory for an image with an optimal tiling from the pooled allocator, and bind it */
+	VulkanMemoryAllocation AllocateImageMemory(const vk::Image& image, vk::MemoryPropertyFlags memoryProperty) const;
+	/** Give back memory of AllocateBufferMemory or AllocateImageMemory, the resource must be destroyed */
+	void FreeMemory(VulkanMemoryAllocation& allocation) const;
+
 private:
 	uint32_t FindMemoryTypeIndex(const VulkanMemoryRequirementsExtended& memoryRequirements, vk::MemoryPropertyFlags memoryProperty) const;
 	/**
@@ -94,8 +92,9 @@ private:
 	/** Tell whether or not all the vulkan device layers in m_Layers are supported */
 	bool allLayersAreSupported() const;
 
-	std::array<uint32_t, VulkanQueueType::COUNT> FindQueueFamilyIndices(const vk::SurfaceKHR& surface) const;
-	std::vector<vk::DeviceQueueCreateInfo> SetupQueuesCreateInfo(const std::array<uint32_t, VulkanQueueType::COUNT>& queueFamilyIndices) const;
+	VulkanQueueFamilyIndices FindQueueFamilyIndices(const vk::SurfaceKHR& surface) const;
+	/** One queue per distinct family, the queue types on the same family share it */
+	std::vector<vk::DeviceQueueCreateInfo> SetupQueuesCreateInfo(const VulkanQueueFamilyIndices& queueFamilyIndices) const;
 
 public:
 	/** Set the reference to the vulkan instance */
@@ -110,10 +109,15 @@ public:
 	__forceinline const VulkanQueue& GetQueue(VulkanQueueType::Type type) const { return (m_Queues[type]); }
 	/** Get all the queues */
 	__forceinline const std::array<VulkanQueue, VulkanQueueType::COUNT>& GetQueues() const { return (m_Queues); }
+	/** Get the family of each queue type */
+	__forceinline const VulkanQueueFamilyIndices& GetQueueFamilies() const { return (m_QueueFamilies); }
 
 	__forceinline const vk::PhysicalDeviceProperties& GetPhysicalDeviceProperties() const { return (m_PhysicalDeviceProperties); }
 	__forceinline const vk::PhysicalDeviceProperties2& GetPhysicalDeviceProperties2() const { return (m_PhysicalDeviceProperties2); }
 	__forceinline const vk::PhysicalDeviceRayTracingPipelinePropertiesKHR& GetRaytracingProperties() const { return (m_RaytracingProperties); }
+	__forceinline const vk::PhysicalDeviceAccelerationStructurePropertiesKHR& GetAccelerationStructureProperties() const { return (m_AccelerationStructureProperties); }
+	/** Get the allocator of every device memory, only valid while the device exists */
+	__forceinline VulkanMemoryAllocator& GetMemoryAllocator() const { return (*m_MemoryAllocator); }
 
 	vk::PhysicalDeviceMemoryProperties GetPhysicalDeviceMemoryProperties() const { return (m_PhysicalDevice.getMemoryProperties()); }
 
@@ -134,9 +138,14 @@ private:
 	// The physical device that correspond to one of your GPU
 	vk::PhysicalDevice m_PhysicalDevice;
 	std::array<VulkanQueue, VulkanQueueType::COUNT> m_Queues;
+	VulkanQueueFamilyIndices m_QueueFamilies;
 
 	vk::PhysicalDeviceRayTracingPipelinePropertiesKHR m_RaytracingProperties;
+	vk::PhysicalDeviceAccelerationStructurePropertiesKHR m_AccelerationStructureProperties;
 	vk::PhysicalDeviceProperties m_PhysicalDeviceProperties;
 	vk::PhysicalDeviceProperties2 m_PhysicalDeviceProperties2;
 
+	// Pools of device memory, so the buffers don't each need their own allocation
+	std::unique_ptr<VulkanMemoryAllocator> m_MemoryAllocator;
+
 };
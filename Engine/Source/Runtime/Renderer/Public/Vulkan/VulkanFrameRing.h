@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Renderer_API.h"
+
+#include <cstdint>
+#include <vector>
+
+class VulkanTimeline;
+
+/**
+ * Ring of the frames in flight, and which swap chain image each of them render into.
+ * A frame slot own its resources (command pool, semaphore) until its submission is complete on the GPU:
+ * BeginFrame move to the next slot, that must be completed first if it's still in flight. The swap chain images are acquired
+ * in any order, so an image can still be rendered by another slot: AcquireImage tell which one must be completed before using it.
+ * It only deals with indices and timeline values, so it can be tested without a GPU (@see VulkanCpuTimeline).
+ */
+class RENDERER_API VulkanFrameRing final
+{
+public:
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+public:
+	VulkanFrameRing() = default;
+	VulkanFrameRing(uint32_t frameCount, uint32_t imageCount);
+
+#pragma region API
+public:
+	/** Move to the next frame slot and return it, if it's still in flight it must be completed (@see CompleteFrame) before AcquireImage */
+	uint32_t BeginFrame();
+	/**
+	 * Give the image acquired for the current frame, it's owned by the current frame until it's completed.
+	 *
+	 * \return the frame slot still rendering into the image, that must be completed before recording (InvalidIndex if none)
+	 */
+	uint32_t AcquireImage(uint32_t imageIndex);
+	/** The current frame has been submitted, its slot is in flight until the timeline reach timelineValue (@see WaitForFrame) */
+	void SubmitFrame(uint64_t timelineValue = 0);
+	/** The submission of a frame slot is complete on the GPU (e.g. the timeline reached its value), its resources and its image are released */
+	void CompleteFrame(uint32_t frameIndex);
+	/** Block until the timeline reach the value of a frame slot in flight, then complete it */
+	void WaitForFrame(uint32_t frameIndex, VulkanTimeline& timeline);
+
+	__forceinline bool IsFrameInFlight(uint32_t frameIndex) const { return (m_Frames[frameIndex].bInFlight); }
+	/** Get the frame slot that render into an image (InvalidIndex if none) */
+	__forceinline uint32_t GetImageOwner(uint32_t imageIndex) const { return (m_ImageOwners[imageIndex]); }
+	/** Get the image of a frame slot (InvalidIndex if it has none) */
+	__forceinline uint32_t GetFrameImage(uint32_t frameIndex) const { return (m_Frames[frameIndex].ImageIndex); }
+	/** Get the timeline value signaled once the last submission of a frame slot is complete */
+	__forceinline uint64_t GetFrameTimelineValue(uint32_t frameIndex) const { return (m_Frames[frameIndex].TimelineValue); }
+
+	__forceinline uint32_t GetCurrentFrame() const { return (m_CurrentFrame); }
+	__forceinline uint32_t GetCurrentImage() const { return (m_CurrentFrame != InvalidIndex ? m_Frames[m_CurrentFrame].ImageIndex : InvalidIndex); }
+	/** Get how many frames have begun since the creation of the ring */
+	__forceinline uint64_t GetFrameNumber() const { return (m_FrameNumber); }
+
+	__forceinline uint32_t GetFrameCount() const { return (static_cast<uint32_t>(m_Frames.size())); }
+	__forceinline uint32_t GetImageCount() const { return (static_cast<uint32_t>(m_ImageOwners.size())); }
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Self test, no GPU needed: replay scripted frames (slot reuse, images acquired out of order, more slots than images)
+	 * then random ones against a fake GPU that complete the submissions late, and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest(uint32_t randomFrameCount = 100000);
+#pragma endregion
+
+private:
+	struct FrameSlot
+	{
+		bool bInFlight = false;
+		uint32_t ImageIndex = InvalidIndex;
+		uint64_t TimelineValue = 0;
+	};
+
+private:
+	std::vector<FrameSlot> m_Frames;
+	/** Frame slot of each image */
+	std::vector<uint32_t> m_ImageOwners;
+
+	uint32_t m_CurrentFrame = InvalidIndex;
+	/** Between BeginFrame and SubmitFrame */
+	bool m_bFrameBegun = false;
+	uint64_t m_FrameNumber = 0;
+};
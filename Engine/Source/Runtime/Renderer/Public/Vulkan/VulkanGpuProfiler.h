@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "Vulkan/VulkanUtils.h"
+#include "Vulkan/VulkanTimestampQueries.h"
+
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/** The duration of a GPU scope read back, and how deep it's nested in the other scopes of its submission */
+struct VulkanGpuScopeTiming
+{
+	const char* CategoryName = nullptr;
+	/** 0 for a scope that began outside of any other scope */
+	uint32_t Depth = 0;
+	std::chrono::nanoseconds Duration{ 0 };
+
+	__forceinline double GetMilliseconds() const { return (std::chrono::duration<double, std::milli>(Duration).count()); }
+};
+
+/**
+ * GPU scopes of a submission: each scope write a timestamp at its beginning and its end, in a pair of queries.
+ * The queries of a scope are reset in the command buffer right before it begins, so a scope must begin outside of a render pass.
+ * The scopes nest: a scope is the child of the one that was open when it began, and must end before it.
+ * Once the submission is done on the GPU, Collect resolve the timing of each scope and report its duration to the PerFrameProfilerStorage,
+ * in the same categories as the CPU timers.
+ */
+class RENDERER_API VulkanGpuScopes final
+{
+public:
+	static constexpr uint32_t InvalidScope = UINT32_MAX;
+
+public:
+	VulkanGpuScopes(std::unique_ptr<VulkanTimestampQueries> queries, const VulkanTimestampConversion& conversion);
+	~VulkanGpuScopes() = default;
+
+	VulkanGpuScopes(const VulkanGpuScopes& rhs) = delete;
+	VulkanGpuScopes operator=(const VulkanGpuScopes& rhs) = delete;
+
+#pragma region API
+public:
+	/**
+	 * Record the beginning of a scope.
+	 *
+	 * \param categoryName the category its duration is reported to, it must outlive the scope (e.g. a string literal)
+	 * \return the scope to end, InvalidScope if there is no query left (the scope is dropped)
+	 */
+	uint32_t BeginScope(const vk::CommandBuffer& commandBuffer, const char* categoryName, vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eTopOfPipe);
+	/** Record the end of a scope, after all the commands recorded since its beginning (the scopes it contains must be ended) */
+	void EndScope(const vk::CommandBuffer& commandBuffer, uint32_t scope, vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eBottomOfPipe);
+
+	/**
+	 * Resolve the timings of the scopes recorded so far, report their duration and forget them, the submission must be done on the GPU.
+	 *
+	 * \return false if some of the timestamps were not available or some scopes can't be resolved (they are dropped anyway)
+	 */
+	bool Collect();
+	/** Forget the scopes recorded so far without reading them (e.g. their submission has been dropped) */
+	void Discard();
+
+	__forceinline uint32_t GetScopeCount() const { return (static_cast<uint32_t>(m_Scopes.size())); }
+	__forceinline uint32_t GetMaxScopeCount() const { return (m_Queries->GetQueryCount() / 2); }
+	/** Get the timings resolved by the last Collect, in the order their scopes began */
+	__forceinline const std::vector<VulkanGpuScopeTiming>& GetLastTimings() const { return (m_Timings); }
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Self test, no GPU needed: record nested scopes on fake queries written by a scripted GPU clock, and check their depth
+	 * and their duration in milliseconds (timestamp periods, wrapped around ticks), the scopes dropped when they are never ended,
+	 * not written, outside of their parent or past the query count, and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest();
+#pragma endregion
+
+private:
+	struct Scope
+	{
+		const char* CategoryName = nullptr;
+		/** The scope that was open when it began, InvalidScope if none */
+		uint32_t Parent = InvalidScope;
+		bool bEnded = false;
+	};
+
+	/**
+	 * Resolve the timings of scopes from the ticks of their queries (begin and end of scope i at 2 * i and 2 * i + 1).
+	 * A scope is dropped if it never ended, or if it doesn't fit inside its parent (its queries were not written by this submission).
+	 *
+	 * \return false if a scope has been dropped
+	 */
+	static bool ResolveTimings(const std::vector<Scope>& scopes, const uint64_t* ticks, const VulkanTimestampConversion& conversion, std::vector<VulkanGpuScopeTiming>& outTimings);
+
+private:
+	std::unique_ptr<VulkanTimestampQueries> m_Queries;
+	VulkanTimestampConversion m_Conversion;
+	/** Scope i use the queries 2 * i and 2 * i + 1 */
+	std::vector<Scope> m_Scopes;
+	/** The innermost scope not ended yet, InvalidScope if none */
+	uint32_t m_OpenScope = InvalidScope;
+	std::vector<uint64_t> m_Ticks;
+	std::vector<VulkanGpuScopeTiming> m_Timings;
+#if WITH_LOGGING
+	bool m_bOverflowLogged = false;
+#endif
+};
+
+/**
+ * GPU scopes of the frames in flight, a VulkanGpuScopes per frame slot.
+ * The scopes of a frame are read when its slot is reused: the frame is done on the GPU by then, so the readback never stall
+ * and its durations are reported framesInFlight frames later.
+ */
+class RENDERER_API VulkanGpuProfiler final
+{
+public:
+	static constexpr uint32_t DefaultScopesPerFrame = 32;
+
+public:
+	VulkanGpuProfiler() = default;
+	~VulkanGpuProfiler() = default;
+
+	VulkanGpuProfiler(const VulkanGpuProfiler& rhs) = delete;
+	VulkanGpuProfiler operator=(const VulkanGpuProfiler& rhs) = delete;
+
+#pragma region API
+public:
+	/** \param frameQueries the queries of each frame slot (at least 2 per scope), written on the queue described by conversion */
+	void Create(std::vector<std::unique_ptr<VulkanTimestampQueries>> frameQueries, const VulkanTimestampConversion& conversion);
+	/** Destroy the queries, the frames in flight must be complete */
+	void Destroy();
+
+	/** Collect the scopes of the previous frame of the slot (its submission must be complete) and record the new frame in it */
+	void BeginFrame(uint32_t frameIndex);
+	/** Get the scopes of the current frame, nullptr if the profiler isn't created (e.g. the queue has no timestamps) */
+	VulkanGpuScopes* GetFrameScopes() const;
+
+	__forceinline bool IsCreated() const { return (m_Frames.empty() == false); }
+#pragma endregion
+
+private:
+	std::vector<std::unique_ptr<VulkanGpuScopes>> m_Frames;
+	uint32_t m_CurrentFrame = UINT32_MAX;
+};
+
+/** Record a GPU scope around the commands recorded during the lifetime of the object, nothing is recorded without scopes */
+class RENDERER_API VulkanGpuScope final
+{
+public:
+	VulkanGpuScope(VulkanGpuScopes* scopes, const vk::CommandBuffer& commandBuffer, const char* categoryName)
+		: m_Scopes(scopes), m_CommandBuffer(commandBuffer)
+	{
+		if (m_Scopes)
+			m_Scope = m_Scopes->BeginScope(m_CommandBuffer, categoryName);
+	}
+	~VulkanGpuScope()
+	{
+		if (m_Scopes)
+			m_Scopes->EndScope(m_CommandBuffer, m_Scope);
+	}
+
+	VulkanGpuScope(const VulkanGpuScope& rhs) = delete;
+	VulkanGpuScope operator=(const VulkanGpuScope& rhs) = delete;
+
+private:
+	VulkanGpuScopes* m_Scopes = nullptr;
+	vk::CommandBuffer m_CommandBuffer;
+	uint32_t m_Scope = VulkanGpuScopes::InvalidScope;
+};
+
+#ifdef NO_PROFILING
+# define CREATE_GPU_SCOPE_NAMED_TIMER(Name, Scopes, CommandBuffer, Category) EMPTY_MACRO
+# define CREATE_GPU_SCOPE_TIMER(Scopes, CommandBuffer, Category) EMPTY_MACRO
+#else
+/** Create a GPU scope timer, the duration of the commands recorded until the end of the scope is reported to the PerFrameProfiler once read back */
+# define CREATE_GPU_SCOPE_NAMED_TIMER(Name, Scopes, CommandBuffer, Category) VulkanGpuScope Name{Scopes, CommandBuffer, Category}
+/** Create a GPU scope timer, the duration of the commands recorded until the end of the scope is reported to the PerFrameProfiler once read back */
+# define CREATE_GPU_SCOPE_TIMER(Scopes, CommandBuffer, Category) CREATE_GPU_SCOPE_NAMED_TIMER(__GpuScopeTimer, Scopes, CommandBuffer, Category)
+#endif
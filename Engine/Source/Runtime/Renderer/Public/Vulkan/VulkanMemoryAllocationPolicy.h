@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Renderer_API.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/** A range given by a VulkanMemoryAllocationPolicy */
+struct VulkanSubAllocation
+{
+	static constexpr uint32_t InvalidHandle = UINT32_MAX;
+
+	/** Offset of the range in the block, aligned as requested */
+	uint64_t Offset = 0;
+	uint64_t Size = 0;
+	/** Give it back to VulkanMemoryAllocationPolicy::Free */
+	uint32_t Handle = InvalidHandle;
+};
+
+/** How full and how fragmented is a block */
+struct VulkanSubAllocationStatistics
+{
+	uint64_t Capacity = 0;
+	uint64_t UsedSize = 0;
+	uint32_t AllocationCount = 0;
+	/** How many free ranges there is between the allocations */
+	uint32_t FreeRangeCount = 0;
+	/** Biggest allocation that could be done without alignment */
+	uint64_t LargestFreeRange = 0;
+
+	__forceinline uint64_t GetFreeSize() const { return (Capacity - UsedSize); }
+	/** 0 when the free memory is a single range, close to 1 when it's split in a lot of small ranges */
+	__forceinline float GetFragmentation() const { return (GetFreeSize() == 0 ? 0.0f : 1.0f - static_cast<float>(LargestFreeRange) / static_cast<float>(GetFreeSize())); }
+
+	VulkanSubAllocationStatistics& operator+=(const VulkanSubAllocationStatistics& rhs)
+	{
+		Capacity += rhs.Capacity;
+		UsedSize += rhs.UsedSize;
+		AllocationCount += rhs.AllocationCount;
+		FreeRangeCount += rhs.FreeRangeCount;
+		LargestFreeRange = LargestFreeRange > rhs.LargestFreeRange ? LargestFreeRange : rhs.LargestFreeRange;
+		return (*this);
+	}
+};
+
+/**
+ * Decide where the allocations go inside a block of device memory.
+ * It only deals with offsets and never touch the device, so it can be tested and benchmarked without a GPU.
+ */
+class RENDERER_API VulkanMemoryAllocationPolicy
+{
+public:
+	virtual ~VulkanMemoryAllocationPolicy() = default;
+
+	/** Find a free range of size bytes aligned on alignment (a power of two), return false when the block is too full */
+	virtual bool Allocate(uint64_t size, uint64_t alignment, VulkanSubAllocation& outAllocation) = 0;
+	/** Give back a range returned by Allocate */
+	virtual void Free(uint32_t handle) = 0;
+
+	virtual VulkanSubAllocationStatistics GetStatistics() const = 0;
+	virtual uint64_t GetCapacity() const = 0;
+	/** Tell whether or not there is no allocation in the block */
+	virtual bool IsEmpty() const = 0;
+};
+
+/**
+ * Two Level Segregated Fit: the free ranges are sorted in lists by size class (a power of two, then 32 linear subdivisions),
+ * and two levels of bitmaps tell which lists aren't empty. Allocate and Free are O(1), the neighbour free ranges are merged on Free.
+ */
+class RENDERER_API VulkanTlsfAllocationPolicy final : public VulkanMemoryAllocationPolicy
+{
+public:
+	VulkanTlsfAllocationPolicy(uint64_t capacity);
+
+	virtual bool Allocate(uint64_t size, uint64_t alignment, VulkanSubAllocation& outAllocation) override;
+	virtual void Free(uint32_t handle) override;
+
+	virtual VulkanSubAllocationStatistics GetStatistics() const override;
+	virtual uint64_t GetCapacity() const override { return (m_Capacity); }
+	virtual bool IsEmpty() const override { return (m_AllocationCount == 0); }
+
+	/** Create the default policy of VulkanMemoryAllocator */
+	static std::unique_ptr<VulkanMemoryAllocationPolicy> Create(uint64_t capacity) { return (std::make_unique<VulkanTlsfAllocationPolicy>(capacity)); }
+
+private:
+	static constexpr uint32_t SecondLevelLog2 = 5;
+	static constexpr uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+	static constexpr uint32_t FirstLevelCount = 64 - SecondLevelLog2 + 1;
+	static constexpr uint32_t NullRange = UINT32_MAX;
+
+	/** A contiguous part of the block, free or allocated */
+	struct Range
+	{
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		/** Neighbours in the block */
+		uint32_t PreviousPhysical = NullRange;
+		uint32_t NextPhysical = NullRange;
+		/** Neighbours in the free list of its size class (only while free) */
+		uint32_t PreviousFree = NullRange;
+		uint32_t NextFree = NullRange;
+		bool bFree = false;
+	};
+
+	/** Get the list where a free range of this size is stored */
+	static void MapInsert(uint64_t size, uint32_t& outFirstLevel, uint32_t& outSecondLevel);
+	/** Get the first list whose ranges are all at least this size */
+	static void MapSearch(uint64_t size, uint32_t& outFirstLevel, uint32_t& outSecondLevel);
+
+	/** Find a free range of at least size bytes, return NullRange if there is none */
+	uint32_t FindFreeRange(uint64_t size) const;
+	void InsertFreeRange(uint32_t rangeIndex);
+	void RemoveFreeRange(uint32_t rangeIndex);
+
+	/** Split the range, the second part start at offset (relative to the block) and is returned */
+	uint32_t SplitRange(uint32_t rangeIndex, uint64_t offset);
+	/** Merge the next physical range into the range, the next one is released */
+	void MergeWithNext(uint32_t rangeIndex);
+
+	uint32_t CreateRange();
+	void ReleaseRange(uint32_t rangeIndex);
+
+private:
+	uint64_t m_Capacity = 0;
+	uint64_t m_UsedSize = 0;
+	uint32_t m_AllocationCount = 0;
+	uint32_t m_FreeRangeCount = 0;
+
+	std::vector<Range> m_Ranges;
+	/** Indices of the unused entries of m_Ranges */
+	std::vector<uint32_t> m_UnusedRanges;
+
+	/** Bit i is set when at least one second level list of the first level i isn't empty */
+	uint64_t m_FirstLevelBitmap = 0;
+	std::array<uint32_t, FirstLevelCount> m_SecondLevelBitmaps = {};
+	std::array<std::array<uint32_t, SecondLevelCount>, FirstLevelCount> m_FreeLists;
+};
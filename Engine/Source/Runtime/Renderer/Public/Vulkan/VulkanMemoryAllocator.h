@@ -0,0 +1,195 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "Vulkan/VulkanMemoryAllocationPolicy.h"
+
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct VulkanMemoryType
+{
+	vk::MemoryPropertyFlags PropertyFlags;
+	uint32_t HeapIndex = 0;
+};
+
+/** The memory types and heaps of a physical device, or fake ones to test the allocator without a GPU */
+struct RENDERER_API VulkanMemoryTypeTable
+{
+	std::vector<VulkanMemoryType> Types;
+	std::vector<vk::DeviceSize> HeapSizes;
+
+	static VulkanMemoryTypeTable FromProperties(const vk::PhysicalDeviceMemoryProperties& memoryProperties);
+
+	/** Find the first memory type allowed by memoryTypeBits that has all the properties, return UINT32_MAX if there is none */
+	uint32_t FindMemoryTypeIndex(uint32_t memoryTypeBits, vk::MemoryPropertyFlags memoryProperty) const;
+	__forceinline bool IsHostVisible(uint32_t memoryTypeIndex) const { return (static_cast<bool>(Types[memoryTypeIndex].PropertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)); }
+};
+
+/** Where the blocks of device memory come from, the device itself or a fake one */
+class RENDERER_API VulkanMemoryBlockSource
+{
+public:
+	virtual ~VulkanMemoryBlockSource() = default;
+
+	/** Allocate a block of device memory, return a null handle when the heap is full */
+	virtual vk::DeviceMemory AllocateBlock(uint32_t memoryTypeIndex, vk::DeviceSize size) = 0;
+	virtual void FreeBlock(vk::DeviceMemory memory) = 0;
+	/** Map the whole block (it stays mapped until it's freed), can return nullptr */
+	virtual void* MapBlock(vk::DeviceMemory memory, vk::DeviceSize size) = 0;
+};
+
+/** Allocate the blocks on a logical device */
+class RENDERER_API VulkanDeviceMemoryBlockSource final : public VulkanMemoryBlockSource
+{
+public:
+	/** \param bDeviceAddress allocate the blocks with vk::MemoryAllocateFlagBits::eDeviceAddress, so the buffers can have a device address */
+	VulkanDeviceMemoryBlockSource(vk::Device device, bool bDeviceAddress)
+		: m_Device(device), m_bDeviceAddress(bDeviceAddress)
+	{}
+
+	virtual vk::DeviceMemory AllocateBlock(uint32_t memoryTypeIndex, vk::DeviceSize size) override;
+	virtual void FreeBlock(vk::DeviceMemory memory) override;
+	virtual void* MapBlock(vk::DeviceMemory memory, vk::DeviceSize size) override;
+
+private:
+	vk::Device m_Device;
+	bool m_bDeviceAddress = false;
+};
+
+/** A part of a block of device memory, given by VulkanMemoryAllocator */
+struct VulkanMemoryAllocation
+{
+	vk::DeviceMemory Memory;
+	/** Offset of the allocation in Memory, bind the resource at this offset */
+	vk::DeviceSize Offset = 0;
+	vk::DeviceSize Size = 0;
+	/** Pointer to the allocation when the memory is host visible (the blocks stay mapped), nullptr otherwise */
+	void* MappedData = nullptr;
+
+	uint32_t MemoryTypeIndex = UINT32_MAX;
+	/** Index of the block in its pool, UINT32_MAX for a dedicated allocation */
+	uint32_t BlockIndex = UINT32_MAX;
+	uint32_t Handle = VulkanSubAllocation::InvalidHandle;
+
+	__forceinline bool IsValid() const { return (static_cast<bool>(Memory)); }
+	__forceinline bool IsDedicated() const { return (BlockIndex == UINT32_MAX); }
+};
+
+struct VulkanMemoryAllocatorSettings
+{
+	/** Size of the blocks, smaller on the small heaps (at most 1/8 of the heap) */
+	vk::DeviceSize BlockSize = 64ull * 1024 * 1024;
+	/** The allocations bigger than that get their own device allocation (0 = half of the block size) */
+	vk::DeviceSize DedicatedThreshold = 0;
+	/** vk::PhysicalDeviceLimits::bufferImageGranularity, so buffers and optimal images never share a page */
+	vk::DeviceSize BufferImageGranularity = 1;
+	/** vk::PhysicalDeviceLimits::maxMemoryAllocationCount, a warning is logged when it's reached */
+	uint32_t MaxDeviceAllocationCount = 4096;
+	/** How the allocations are placed inside a block */
+	std::function<std::unique_ptr<VulkanMemoryAllocationPolicy>(vk::DeviceSize)> CreatePolicy = &VulkanTlsfAllocationPolicy::Create;
+};
+
+struct VulkanMemoryAllocatorStatistics
+{
+	/** Sum of every block (the largest free range is the one of the best block) */
+	VulkanSubAllocationStatistics Blocks;
+	uint32_t BlockCount = 0;
+	uint32_t DedicatedAllocationCount = 0;
+	vk::DeviceSize DedicatedSize = 0;
+	/** How many Allocate since the creation of the allocator */
+	uint64_t TotalAllocationCount = 0;
+
+	/** How many allocateMemory are alive on the device */
+	__forceinline uint32_t GetDeviceAllocationCount() const { return (BlockCount + DedicatedAllocationCount); }
+};
+
+/**
+ * Pooled device memory: each memory type has a pool of big blocks, and the allocations are placed inside them by a VulkanMemoryAllocationPolicy.
+ * Thousands of buffers only use a few device allocations (the drivers can have a maxMemoryAllocationCount as low as 4096).
+ * The host visible blocks are mapped once, when they are created. Thread safe.
+ */
+class RENDERER_API VulkanMemoryAllocator final
+{
+public:
+	VulkanMemoryAllocator(VulkanMemoryTypeTable memoryTypes, std::unique_ptr<VulkanMemoryBlockSource> blockSource, VulkanMemoryAllocatorSettings settings = {});
+	~VulkanMemoryAllocator();
+
+	VulkanMemoryAllocator(const VulkanMemoryAllocator& rhs) = delete;
+	VulkanMemoryAllocator operator=(const VulkanMemoryAllocator& rhs) = delete;
+
+#pragma region API
+public:
+	/**
+	 * Allocate memory for a resource.
+	 *
+	 * \param bLinear false for the images with an optimal tiling (their size and alignment are rounded to the buffer image granularity)
+	 * \return an invalid allocation if the device is out of memory
+	 */
+	VulkanMemoryAllocation Allocate(const vk::MemoryRequirements& requirements, uint32_t memoryTypeIndex, bool bLinear = true);
+	/** Give back an allocation, it's reset */
+	void Free(VulkanMemoryAllocation& allocation);
+	/** Free every block, the allocations still alive are reported as leaks */
+	void Release();
+
+	VulkanMemoryAllocatorStatistics GetStatistics() const;
+	VulkanMemoryAllocatorStatistics GetStatistics(uint32_t memoryTypeIndex) const;
+	/** Log the statistics of each memory type used */
+	void LogStatistics() const;
+
+	__forceinline const VulkanMemoryTypeTable& GetMemoryTypes() const { return (m_MemoryTypes); }
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Benchmark: allocate and free random sizes (from 256B to 4MB, like the chunk buffers) on a fake memory type table,
+	 * and log the throughput, the device allocation count and the fragmentation.
+	 * Then check the allocator: no live allocations overlap, the free ranges of each block are merged back into one once everything
+	 * is freed, and the usage of each heap is back to 0 once it's released. Every broken invariant is logged.
+	 *
+	 * \return true if every invariant held
+	 */
+	static bool LogBenchmark(uint32_t operationCount = 1000000);
+#pragma endregion
+
+private:
+	struct Block
+	{
+		/** Null when the slot isn't used */
+		vk::DeviceMemory Memory;
+		std::unique_ptr<VulkanMemoryAllocationPolicy> Policy;
+		uint8_t* MappedData = nullptr;
+	};
+
+	struct Pool
+	{
+		std::vector<Block> Blocks;
+		/** Size of a new block */
+		vk::DeviceSize BlockSize = 0;
+		/** The allocations too big for a block */
+		std::vector<vk::DeviceMemory> DedicatedAllocations;
+		vk::DeviceSize DedicatedSize = 0;
+	};
+
+	/** Allocate a block that can hold at least minSize, smaller than the pool block size if the heap is too full. Return the block index or UINT32_MAX */
+	uint32_t CreateBlock(uint32_t memoryTypeIndex, vk::DeviceSize minSize);
+	VulkanMemoryAllocation AllocateDedicated(vk::DeviceSize size, uint32_t memoryTypeIndex);
+	void OnDeviceAllocation();
+
+	VulkanMemoryAllocatorStatistics GetPoolStatistics(const Pool& pool) const;
+
+private:
+	VulkanMemoryTypeTable m_MemoryTypes;
+	std::unique_ptr<VulkanMemoryBlockSource> m_BlockSource;
+	VulkanMemoryAllocatorSettings m_Settings;
+
+	/** One pool per memory type */
+	std::vector<Pool> m_Pools;
+	uint32_t m_DeviceAllocationCount = 0;
+	uint64_t m_TotalAllocationCount = 0;
+
+	mutable std::mutex m_Mutex;
+};
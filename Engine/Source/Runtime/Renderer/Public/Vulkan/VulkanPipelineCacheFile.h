@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Renderer_API.h"
+
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace VulkanPipelineCacheValidity
+{
+	enum Type : uint8_t
+	{
+		Valid = 0,
+		/** The file is smaller than its header, or than the data it announces */
+		Truncated,
+		/** The file isn't a pipeline cache file, or has been written by another version */
+		InvalidFileHeader,
+		/** The data doesn't match the hash of the file header (e.g. a partial write) */
+		Corrupted,
+		/** The Vulkan header of the data has an unknown size or version */
+		InvalidCacheHeader,
+		/** The data has been written by another driver or GPU */
+		VendorMismatch,
+		DeviceMismatch,
+		UUIDMismatch,
+
+		COUNT
+	};
+
+	const char* ToString(Type validity);
+}
+
+/** What the Vulkan header of a pipeline cache must match to be used by a device */
+struct RENDERER_API VulkanPipelineCacheDeviceInfo
+{
+	uint32_t VendorID = 0;
+	uint32_t DeviceID = 0;
+	std::array<uint8_t, VK_UUID_SIZE> PipelineCacheUUID = {};
+
+	static VulkanPipelineCacheDeviceInfo FromProperties(const vk::PhysicalDeviceProperties& properties);
+};
+
+/**
+ * The data of a vk::PipelineCache saved on disk between two launches.
+ * The file is a small header (magic, version, size and hash of the data) followed by the data given by the driver,
+ * it's written to a temporary file then renamed over the previous one, so a crash while saving never leave a partial cache.
+ * The data is only given back to the driver when its Vulkan header match the device (vendor, device and cache UUID),
+ * a driver update change the UUID and so drop the cache. Everything but the file access work on blobs, to be tested without a device.
+ */
+class RENDERER_API VulkanPipelineCacheFile final
+{
+public:
+	static constexpr uint32_t Magic = 0x4350564F; // "OVPC"
+	static constexpr uint32_t Version = 1;
+
+	struct FileHeader
+	{
+		uint32_t Magic = VulkanPipelineCacheFile::Magic;
+		uint32_t Version = VulkanPipelineCacheFile::Version;
+		uint64_t DataSize = 0;
+		uint64_t DataHash = 0;
+	};
+
+public:
+	VulkanPipelineCacheFile() = delete;
+
+#pragma region API
+public:
+	/** Tell whether or not the data of a pipeline cache (as given by vkGetPipelineCacheData) can be used by the device */
+	static VulkanPipelineCacheValidity::Type ValidateCacheData(const uint8_t* data, size_t size, const VulkanPipelineCacheDeviceInfo& device);
+	/** Tell whether or not the content of a file written by Serialize is intact and can be used by the device */
+	static VulkanPipelineCacheValidity::Type ValidateFile(const std::vector<uint8_t>& fileContent, const VulkanPipelineCacheDeviceInfo& device);
+
+	/** Get the content of the file for the data of a pipeline cache */
+	static std::vector<uint8_t> Serialize(const std::vector<uint8_t>& cacheData);
+	/** Get the data of a pipeline cache from the content of a valid file */
+	static std::vector<uint8_t> Deserialize(const std::vector<uint8_t>& fileContent);
+
+	/**
+	 * Read the data of the pipeline cache saved for the device.
+	 *
+	 * \return the initial data of the pipeline cache, empty if there is no file or it can't be used (the reason is logged)
+	 */
+	static std::vector<uint8_t> Load(const std::filesystem::path& filePath, const VulkanPipelineCacheDeviceInfo& device);
+	/**
+	 * Write the data of a pipeline cache atomically: the previous file is only replaced once the new one is complete.
+	 *
+	 * \return false if the file couldn't be written (the previous one is kept)
+	 */
+	static bool Save(const std::filesystem::path& filePath, const std::vector<uint8_t>& cacheData);
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Self test, no GPU needed: validate synthetic blobs (truncated files, bad magic or hash, vendor, device or UUID mismatch,
+	 * short Vulkan header) then save and load them in a temporary directory, and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest();
+#pragma endregion
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Renderer_API.h"
+
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+namespace VulkanQueueType
+{
+	enum Type : uint8_t
+	{
+		Graphic = 0,
+		Present = 1,
+		/** Acceleration structure builds, on a family without graphics when there is one (async compute) */
+		Compute = 2,
+		/** Staging uploads, on a family with neither graphics nor compute when there is one (DMA) */
+		Transfer = 3,
+
+		COUNT = 4
+	};
+
+	const char* ToString(Type vulkanQueueType);
+}
+
+/**
+ * The queue family of each VulkanQueueType, picked from the families of a physical device:
+ * - Graphic: the first family with graphics
+ * - Present: the graphic family if it can present, the first family that can otherwise
+ * - Compute: the first family with compute but not graphics, the graphic family otherwise
+ * - Transfer: the first family with transfer but neither graphics nor compute, the compute family otherwise
+ * A single queue is created per family: the types that fall back on the same family share its queue.
+ * It only deals with the properties of the families, so it can be tested without a GPU.
+ */
+struct RENDERER_API VulkanQueueFamilyIndices
+{
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+	std::array<uint32_t, VulkanQueueType::COUNT> Indices;
+
+	VulkanQueueFamilyIndices() { Indices.fill(InvalidIndex); }
+
+	/** \param canPresent tell whether or not a family can present on the surface */
+	static VulkanQueueFamilyIndices Select(const std::vector<vk::QueueFamilyProperties>& families, const std::function<bool(uint32_t)>& canPresent);
+
+	__forceinline uint32_t operator[](VulkanQueueType::Type type) const { return (Indices[type]); }
+	/** Tell whether or not every type has a family */
+	bool IsComplete() const;
+	/** Tell whether or not a type has its own family, instead of sharing the one of the graphic queue */
+	__forceinline bool IsDedicated(VulkanQueueType::Type type) const { return (Indices[type] != Indices[VulkanQueueType::Graphic]); }
+	/** Get the distinct families of the types (sorted), a resource used by several of them is shared concurrently */
+	std::vector<uint32_t> GetUniqueFamilies(std::initializer_list<VulkanQueueType::Type> types) const;
+	/** Get the distinct families of every type */
+	std::vector<uint32_t> GetUniqueFamilies() const;
+
+	/**
+	 * Self test, no GPU needed: select the families of synthetic devices (a single universal family, dedicated compute and transfer
+	 * families, present only on a family without graphics, no dedicated transfer family, no graphic family) and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest();
+};
@@ -2,8 +2,12 @@
 
 #include "Renderer_API.h"
 #include "Vulkan/VulkanUtils.h"
+#include "Vulkan/VulkanShaderCompiler.h"
+#include "Vulkan/VulkanShaderReflection.h"
+#include "Vulkan/VulkanShaderPermutation.h"
 
 #include <vulkan/vulkan.hpp>
+#include <array>
 #include <vector>
 
 class VulkanDeviceHandler;
@@ -23,6 +27,24 @@ namespace RayTracingShaderType
 	vk::ShaderStageFlagBits ToShaderStageFlagBits(Type rayTracingShaderType);
 }
 
+namespace RayTracingDebugView
+{
+	/** What the ray generation shader write in the image, the DEBUG_VIEW permutation of raytrace.rgen */
+	enum Type : uint8_t
+	{
+		/** The shaded voxels */
+		None = 0,
+		/** The distance to the hit, in grayscale */
+		HitDistance = 1,
+		/** White where a voxel is hit, black elsewhere */
+		HitMask = 2,
+
+		COUNT = 3
+	};
+
+	const char* ToString(Type debugView);
+}
+
 class RENDERER_API VulkanRayTracingPipeline final
 {
 
@@ -37,29 +59,60 @@ public:
 	operator vk::PipelineLayout() const { return GetPipelineLayout(); }
 
 public:
+	/**
+	 * Compile the shaders and reflect their descriptors, must be called before CreateRayTracingPipeline.
+	 * The layout of the descriptor set is made from GetDescriptorLayout.
+	 *
+	 * \return false if a shader doesn't compile or its descriptors conflict with the ones of another shader (the errors are logged)
+	 */
+	bool LoadShaders();
+	/**
+	 * Create the pipeline with the permutation chosen for each shader.
+	 * The specialization constants of the permutations are part of the pipeline, so each one has its own pipeline cache entry.
+	 */
 	void CreateRayTracingPipeline(const vk::DescriptorSetLayout& vkDescriptorLayout, const vk::PipelineCache& pipelineCache = VK_NULL_HANDLE);
 	void DestroyRayTracingPipeline();
 
 private:
-	vk::ShaderModule CreateShaderModule(const char* path) const;
+	/** Create the module of a shader variant and add its descriptors to the layout, a null handle if they can't be reflected */
+	vk::ShaderModule CreateShaderModule(const VulkanShaderSource& source, const std::vector<uint32_t>& spirv);
+	/** Get the module of the variant of the permutation chosen for a shader */
+	vk::ShaderModule GetShaderModule(RayTracingShaderType::Type rayTracingShaderType) const;
 
 public:
 	__forceinline vk::Pipeline Raw() const { return m_Pipeline; }
 	__forceinline vk::PipelineLayout GetPipelineLayout() const { return m_PipelineLayout; }
 
+	/** The descriptors used by the shaders, merged from their reflection */
+	__forceinline const VulkanDescriptorLayout& GetDescriptorLayout() const { return m_DescriptorLayout; }
+
+	/** Get the permutation dimensions a shader declares */
+	static const VulkanShaderPermutationDomain& GetPermutationDomain(RayTracingShaderType::Type rayTracingShaderType);
+	/** Choose the permutation of a shader (a key of its permutation domain), used by the next CreateRayTracingPipeline */
+	void SetPermutation(RayTracingShaderType::Type rayTracingShaderType, uint32_t permutationKey) { m_PermutationKeys[rayTracingShaderType] = permutationKey; }
+	uint32_t GetPermutation(RayTracingShaderType::Type rayTracingShaderType) const { return m_PermutationKeys[rayTracingShaderType]; }
+
 	uint32_t GetShaderGroupCount() const { return static_cast<uint32_t>(m_ShaderGroups.size()); }
 
 	void SetVulkanDevice(const VulkanDeviceHandler* vkDevice) { m_VkDevice = vkDevice; }
 	void SetDispatchLoaderDynamic(const vk::DispatchLoaderDynamic* dldi) { m_Dldi = dldi; }
+	/** Set where the shaders come from, must be called before LoadShaders */
+	void SetShaderCompiler(VulkanShaderCompiler* shaderCompiler) { m_ShaderCompiler = shaderCompiler; }
 
 private:
 	const VulkanDeviceHandler* m_VkDevice = nullptr;
 	const vk::DispatchLoaderDynamic* m_Dldi = nullptr;
+	VulkanShaderCompiler* m_ShaderCompiler = nullptr;
 
 	vk::PipelineLayout m_PipelineLayout;
 	vk::Pipeline m_Pipeline;
 
-	/* Store all the loaded shaders */
+	/* Store all the loaded shaders, a module for each variant */
 	std::array<std::vector<vk::ShaderModule>, RayTracingShaderType::COUNT> m_ShaderModules;
+	/** The variant key of each module */
+	std::array<std::vector<uint32_t>, RayTracingShaderType::COUNT> m_VariantKeys;
+	/** The permutation chosen for each shader, all dimensions at 0 by default */
+	std::array<uint32_t, RayTracingShaderType::COUNT> m_PermutationKeys = {};
 	std::vector<vk::RayTracingShaderGroupCreateInfoKHR> m_ShaderGroups;
+	VulkanDescriptorLayout m_DescriptorLayout;
 };
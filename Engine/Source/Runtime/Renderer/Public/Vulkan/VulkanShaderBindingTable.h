@@ -2,6 +2,7 @@
 
 #include "Renderer_API.h"
 #include "VulkanUtils.h"
+#include "VulkanMemoryAllocator.h"
 
 #include <vulkan/vulkan.hpp>
 #include <vector>
@@ -41,7 +42,7 @@ private:
 	const vk::DispatchLoaderDynamic* m_Dldi;
 
 	vk::Buffer m_SbtBuffer;
-	vk::DeviceMemory m_SbtBufferMemory;
+	VulkanMemoryAllocation m_SbtBufferAllocation;
 
 	vk::StridedDeviceAddressRegionKHR m_RaygenShaderBindingTable;
 	vk::StridedDeviceAddressRegionKHR m_MissShaderBindingTable;
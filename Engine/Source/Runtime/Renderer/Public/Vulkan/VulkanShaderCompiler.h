@@ -0,0 +1,167 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "Vulkan/VulkanUtils.h"
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** A shader to compile, its source is a file of the source directory of the VulkanShaderCompiler */
+struct VulkanShaderSource
+{
+	/** Path of the source, relative to the source directory (e.g. "raytrace.rgen") */
+	std::string Name;
+	vk::ShaderStageFlagBits Stage = vk::ShaderStageFlagBits::eCompute;
+	/** Macros defined before the source (name, value), in this order */
+	std::vector<std::pair<std::string, std::string>> Defines;
+	std::string EntryPoint = "main";
+};
+
+/** What the backend is asked to compile, with everything that changes its output */
+struct VulkanShaderCompileRequest
+{
+	/** Name of the source, as given to the include resolver for the includes of the main source */
+	std::string Name;
+	std::string Source;
+	vk::ShaderStageFlagBits Stage = vk::ShaderStageFlagBits::eCompute;
+	std::vector<std::pair<std::string, std::string>> Defines;
+	std::string EntryPoint = "main";
+	/** Vulkan version the SPIR-V target (e.g. VK_API_VERSION_1_3) */
+	uint32_t TargetVulkanVersion = 0;
+	bool bOptimize = true;
+
+	/**
+	 * Find the file included by a source.
+	 *
+	 * \param requestedName the name written in the #include
+	 * \param includerName the name of the source that include it
+	 * \param bRelative #include "..." (true) or #include <...> (false)
+	 * \param outName the name of the included source, given back as includerName for its own includes
+	 * \return false if the file doesn't exist
+	 */
+	std::function<bool(const std::string& requestedName, const std::string& includerName, bool bRelative, std::string& outName, std::string& outContent)> ResolveInclude;
+};
+
+/** Turn GLSL into SPIR-V, shaderc or a fake one */
+class RENDERER_API VulkanShaderCompilerBackend
+{
+public:
+	virtual ~VulkanShaderCompilerBackend() = default;
+
+	/** Identify the compiler and its release (not only the SPIR-V version it target), the cache is dropped when it changes */
+	virtual std::string GetVersion() const = 0;
+	/**
+	 * Compile a shader, the includes are resolved through request.ResolveInclude.
+	 * May be called from several threads at once.
+	 *
+	 * \param outLog the errors and warnings of the compilation
+	 * \return false if the shader doesn't compile
+	 */
+	virtual bool Compile(const VulkanShaderCompileRequest& request, std::vector<uint32_t>& outSpirv, std::string& outLog) = 0;
+};
+
+/**
+ * A compiled shader in the cache: the SPIR-V and the files it has been compiled from.
+ * The key of the entry already hash the main source, so only the includes are stored (with the hash of their content),
+ * the entry is stale when one of them changed since.
+ */
+struct RENDERER_API VulkanShaderCacheEntry
+{
+	static constexpr uint32_t Magic = 0x4353564F; // "OVSC"
+	static constexpr uint32_t Version = 1;
+
+	struct Dependency
+	{
+		/** Path of the file, relative to the source directory */
+		std::string Name;
+		uint64_t ContentHash = 0;
+
+		bool operator==(const Dependency& rhs) const { return (Name == rhs.Name && ContentHash == rhs.ContentHash); }
+	};
+
+	std::vector<Dependency> Dependencies;
+	std::vector<uint32_t> Spirv;
+
+	std::vector<uint8_t> Serialize() const;
+	/** \return false if the data isn't a complete entry of this version */
+	static bool Deserialize(const std::vector<uint8_t>& data, VulkanShaderCacheEntry& outEntry);
+};
+
+/**
+ * Compile the shaders of the engine on demand, and keep their SPIR-V in a cache on disk.
+ * An entry of the cache is named after the hash of the source, the defines, the stage, the entry point, the target environment
+ * and the version of the compiler; it also store the hash of each include, so GetSpirv only call the compiler
+ * (and rewrite the entry) when one of them changed. Editing a shader only recompile the shaders that use it.
+ */
+class RENDERER_API VulkanShaderCompiler final
+{
+public:
+	struct Settings
+	{
+		/** Where the sources are, the includes are searched relatively to their includer then from there */
+		std::filesystem::path SourceDirectory;
+		/** Where the compiled shaders are stored */
+		std::filesystem::path CacheDirectory;
+		uint32_t TargetVulkanVersion = VK_API_VERSION_1_3;
+		bool bOptimize = true;
+	};
+
+	struct Statistics
+	{
+		std::atomic<uint32_t> CacheHits = 0;
+		std::atomic<uint32_t> CacheMisses = 0;
+		std::atomic<uint32_t> Failures = 0;
+	};
+
+public:
+	VulkanShaderCompiler(std::unique_ptr<VulkanShaderCompilerBackend> backend, const Settings& settings);
+	~VulkanShaderCompiler() = default;
+
+	VulkanShaderCompiler(const VulkanShaderCompiler& rhs) = delete;
+	VulkanShaderCompiler operator=(const VulkanShaderCompiler& rhs) = delete;
+
+	/** Create the backend that compile with shaderc (linked from the Vulkan SDK) */
+	static std::unique_ptr<VulkanShaderCompilerBackend> CreateShadercBackend();
+
+#pragma region API
+public:
+	/**
+	 * Get the SPIR-V of a shader, from the cache or compiled if it changed since.
+	 *
+	 * \return false if the source can't be read or doesn't compile (the errors are logged)
+	 */
+	bool GetSpirv(const VulkanShaderSource& source, std::vector<uint32_t>& outSpirv);
+	/**
+	 * Get the SPIR-V of several shaders (e.g. the variants of a shader), the ones not in the cache are compiled in parallel
+	 * on the job system of the engine (on the calling thread when it isn't created yet, e.g. the self tests).
+	 * The sources must be different, two identical sources would write the same cache entry.
+	 *
+	 * \return false if one of the sources can't be read or doesn't compile, the SPIR-V of the others is still in outSpirvs
+	 */
+	bool GetSpirv(const std::vector<VulkanShaderSource>& sources, std::vector<std::vector<uint32_t>>& outSpirvs);
+
+	/** Get the name of the cache entry of a shader, the hash of everything that make its output but its includes */
+	std::string MakeCacheKey(const VulkanShaderSource& source, const std::string& sourceContent) const;
+
+	__forceinline const Settings& GetSettings() const { return (m_Settings); }
+	__forceinline const Statistics& GetStatistics() const { return (m_Statistics); }
+#pragma endregion
+
+private:
+	/** Tell whether or not the includes of a cache entry still have the content it has been compiled with */
+	bool AreDependenciesUpToDate(const VulkanShaderCacheEntry& entry) const;
+	/** Read a file of the source directory */
+	bool ReadSource(const std::string& name, std::string& outContent) const;
+
+private:
+	std::unique_ptr<VulkanShaderCompilerBackend> m_Backend;
+	Settings m_Settings;
+	Statistics m_Statistics;
+};
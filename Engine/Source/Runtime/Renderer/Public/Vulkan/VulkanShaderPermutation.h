@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "Vulkan/VulkanUtils.h"
+#include "Vulkan/VulkanShaderCompiler.h"
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace VulkanShaderPermutationBinding
+{
+	/** How the value of a dimension reach the shader */
+	enum Type : uint8_t
+	{
+		/** A macro defined when compiling, each value is a SPIR-V variant of its own */
+		Define = 0,
+		/** A constant given when creating the pipeline (layout(constant_id = ...)), all the values share the SPIR-V */
+		SpecializationConstant = 1,
+
+		COUNT = 2
+	};
+
+	const char* ToString(Type binding);
+}
+
+/** An axis along which a shader varies (e.g. a debug view, AO on or off), its values are 0 to ValueCount - 1 */
+struct VulkanShaderPermutationDimension
+{
+	/** Name of the macro, or of the specialization constant in the logs */
+	std::string Name;
+	uint32_t ValueCount = 2;
+	VulkanShaderPermutationBinding::Type Binding = VulkanShaderPermutationBinding::Define;
+	/** The constant_id of the specialization constant */
+	uint32_t ConstantId = 0;
+};
+
+/**
+ * The dimensions a shader declares. A permutation (a value for each dimension) is packed in a key, each dimension
+ * taking the digits of its value count, so the key 0 is the permutation where every dimension is 0.
+ * Only the define dimensions change the SPIR-V: they make the variants to compile (and the key of their SPIR-V cache entry),
+ * the specialization constants are picked when creating the pipeline (and end in its pipeline cache entry).
+ */
+class RENDERER_API VulkanShaderPermutationDomain final
+{
+public:
+	VulkanShaderPermutationDomain() = default;
+	VulkanShaderPermutationDomain(std::initializer_list<VulkanShaderPermutationDimension> dimensions);
+	~VulkanShaderPermutationDomain() = default;
+
+#pragma region API
+public:
+	/** Get the index of a dimension by its name, UINT32_MAX if the shader doesn't have it */
+	uint32_t FindDimension(std::string_view name) const;
+	/** Get how many permutations the dimensions make */
+	uint32_t GetPermutationCount() const;
+
+	/** Set the value of a dimension in a permutation key */
+	uint32_t SetValue(uint32_t key, uint32_t dimension, uint32_t value) const;
+	/** Set the value of a dimension by its name, the key is unchanged if the shader doesn't have it */
+	uint32_t SetValue(uint32_t key, std::string_view name, uint32_t value) const;
+	/** Get the value of a dimension in a permutation key */
+	uint32_t GetValue(uint32_t key, uint32_t dimension) const;
+
+	/** Get the key of the SPIR-V variant of a permutation: the permutation with its specialization constants at 0 */
+	uint32_t GetVariantKey(uint32_t key) const;
+	/** Get the keys of all the SPIR-V variants to compile, in ascending order */
+	std::vector<uint32_t> GetVariantKeys() const;
+
+	/** Get the source of the variant of a permutation: the source with a define for each define dimension */
+	VulkanShaderSource MakeVariantSource(const VulkanShaderSource& source, uint32_t key) const;
+	/**
+	 * Get the specialization constants of a permutation, each one is a uint32_t (also the size of a VkBool32).
+	 * outEntries point into outData, which must live as long as the vk::SpecializationInfo made from them.
+	 */
+	void GetSpecialization(uint32_t key, std::vector<vk::SpecializationMapEntry>& outEntries, std::vector<uint32_t>& outData) const;
+
+	/** Describe a permutation (e.g. "DEBUG_VIEW=1 INSIDE_HITS=0"), for the logs */
+	std::string ToString(uint32_t key) const;
+
+	__forceinline const std::vector<VulkanShaderPermutationDimension>& GetDimensions() const { return (m_Dimensions); }
+	__forceinline bool IsEmpty() const { return (m_Dimensions.empty()); }
+#pragma endregion
+
+private:
+	std::vector<VulkanShaderPermutationDimension> m_Dimensions;
+	/** What a value of each dimension weight in the key */
+	std::vector<uint32_t> m_Strides;
+};
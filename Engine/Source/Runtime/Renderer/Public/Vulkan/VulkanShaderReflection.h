@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "Vulkan/VulkanUtils.h"
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class VulkanShaderCompiler;
+
+/** A descriptor used by shaders, as declared by their layout(set = ..., binding = ...) */
+struct VulkanDescriptorBinding
+{
+	/** Name of the variable, or of the block when the variable has no name (e.g. "topLevelAS", "ChunkAabbAddresses") */
+	std::string Name;
+	uint32_t Set = 0;
+	uint32_t Binding = 0;
+	vk::DescriptorType Type = vk::DescriptorType::eStorageBuffer;
+	/** Number of descriptors, more than 1 for the arrays */
+	uint32_t Count = 1;
+	/** The stages of the shaders that use it */
+	vk::ShaderStageFlags Stages;
+};
+
+/**
+ * The descriptors used by a SPIR-V module, read from its decorations and types (no external library).
+ * Only the variables decorated with a set and a binding are reported, so the ones removed by the optimizer are not.
+ */
+struct RENDERER_API VulkanShaderReflection
+{
+	/** Stages of the entry points of the module */
+	vk::ShaderStageFlags Stages;
+	/** Sorted by set then binding */
+	std::vector<VulkanDescriptorBinding> Bindings;
+
+	/**
+	 * Reflect a SPIR-V module.
+	 *
+	 * \param outError why the module can't be reflected (e.g. not SPIR-V, or a descriptor of an unsupported type)
+	 * \return false if the module can't be reflected
+	 */
+	static bool Reflect(const std::vector<uint32_t>& spirv, VulkanShaderReflection& outReflection, std::string& outError);
+
+	/**
+	 * Self test, no GPU needed: compile the ray tracing shaders, reflect their modules, compare them to the bindings
+	 * the shaders declare, merge them into a VulkanDescriptorLayout, and log every mismatch.
+	 *
+	 * \param shaderCompiler compile the shaders, from the sources of the pipeline
+	 * \return true if every module has the expected bindings
+	 */
+	static bool LogSelfTest(VulkanShaderCompiler& shaderCompiler);
+};
+
+/**
+ * The descriptors of all the shaders of a pipeline, merged from their reflection: the layouts and the pool sizes are made from it,
+ * and the descriptors are written by name (@see VulkanDescriptorWriter), so a new binding only has to be declared in the shaders.
+ */
+class RENDERER_API VulkanDescriptorLayout final
+{
+public:
+	VulkanDescriptorLayout() = default;
+	~VulkanDescriptorLayout() = default;
+
+#pragma region API
+public:
+	/**
+	 * Add the descriptors of a shader, the stages of a binding used by several shaders are merged.
+	 *
+	 * \param outError why the shader doesn't fit (a binding declared with another type or count, or a name used by two bindings)
+	 * \return false if the shader doesn't fit, nothing is added then
+	 */
+	bool AddShader(const VulkanShaderReflection& reflection, std::string& outError);
+	void Clear() { m_Bindings.clear(); }
+
+	/** Get a binding by the name of its variable, nullptr if no shader use it */
+	const VulkanDescriptorBinding* FindBinding(std::string_view name) const;
+	/** Get how many sets the shaders use (the highest set + 1) */
+	uint32_t GetSetCount() const;
+	/** Get the bindings of the layout of a set */
+	std::vector<vk::DescriptorSetLayoutBinding> GetSetLayoutBindings(uint32_t set) const;
+	/** Get the sizes of a pool able to allocate setCount descriptor sets of a set */
+	std::vector<vk::DescriptorPoolSize> GetPoolSizes(uint32_t set, uint32_t setCount) const;
+
+	/** Sorted by set then binding */
+	__forceinline const std::vector<VulkanDescriptorBinding>& GetBindings() const { return (m_Bindings); }
+#pragma endregion
+
+private:
+	std::vector<VulkanDescriptorBinding> m_Bindings;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "Vulkan/VulkanUtils.h"
+#include "Vulkan/VulkanDeviceHandler.h"
+#include "Vulkan/VulkanStagingRing.h"
+#include "Vulkan/VulkanTimeline.h"
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+/**
+ * Host to device uploads through a persistently mapped ring buffer (@see VulkanStagingRing).
+ * Upload copy the data in the ring and queue a copy to the destination buffer, RecordCopies record all the queued copies
+ * (one copyBuffer per destination) for the next submission of the timeline: the regions of the ring are reused once it reach its value.
+ * When the ring is full of unsubmitted data it's replaced by a bigger one, the old one is destroyed once its copies are done.
+ *
+ * The copies are submitted on their own queue (e.g. a transfer queue), the submissions that read the destinations wait for their value.
+ * A destination exclusive to another queue family is released to it after the copy, RecordAcquires record the matching acquire.
+ */
+class RENDERER_API VulkanStagingBuffer final
+{
+public:
+	/** Name of the PerFrameProfilerStorage categories the uploads are reported to */
+	struct ProfilingCategories
+	{
+		/** Time spent copying the data into the ring (and waiting for space) */
+		static constexpr const char* Upload = "VulkanStaging_Upload";
+		/** Counter of the bytes uploaded */
+		static constexpr const char* UploadedBytes = "VulkanStaging_UploadedBytes";
+	};
+
+	static constexpr vk::DeviceSize DefaultCapacity = 8ull * 1024 * 1024;
+
+public:
+	VulkanStagingBuffer() = default;
+	~VulkanStagingBuffer() = default;
+
+	VulkanStagingBuffer(const VulkanStagingBuffer& rhs) = delete;
+	VulkanStagingBuffer operator=(const VulkanStagingBuffer& rhs) = delete;
+
+#pragma region API
+public:
+	/**
+	 * \param queueType the queue the command buffers given to RecordCopies are submitted on
+	 * \param timeline the timeline of that queue
+	 */
+	void CreateStagingBuffer(const VulkanDeviceHandler* device, VulkanQueueType::Type queueType, VulkanTimeline* timeline, vk::DeviceSize capacity = DefaultCapacity);
+	/** Wait for the pending copies and destroy the ring */
+	void DestroyStagingBuffer();
+
+	/**
+	 * Copy data into the ring, and queue its copy to dstBuffer (that must have the eTransferDst usage).
+	 *
+	 * \param dstQueueFamily the family dstBuffer is exclusive to, it's released to it after the copy (VK_QUEUE_FAMILY_IGNORED if it's shared)
+	 */
+	void Upload(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset = 0, uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+	/**
+	 * Record the queued copies, followed by the release of the destinations exclusive to another family.
+	 * The command buffer must be the next submission of the timeline (@see VulkanTimeline::GetNextSignalValue),
+	 * the submissions that read the destinations must wait for its value: the wait make the copies visible to them.
+	 *
+	 * \return false if there was nothing to copy
+	 */
+	bool RecordCopies(const vk::CommandBuffer& commandBuffer);
+	/**
+	 * Record the acquire of the destinations released to queueFamily by the copies recorded so far,
+	 * in a command buffer of that family submitted after the copies.
+	 *
+	 * \return false if there was nothing to acquire
+	 */
+	bool RecordAcquires(const vk::CommandBuffer& commandBuffer, uint32_t queueFamily, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+	/** Release the regions of the ring whose copies are done on the GPU (the timeline reached their value) */
+	void RetireCompletedSubmissions();
+
+	__forceinline bool HasQueuedCopies() const { return (m_QueuedCopies.empty() == false); }
+	__forceinline vk::DeviceSize GetCapacity() const { return (m_Ring.GetCapacity()); }
+#pragma endregion
+
+private:
+	struct QueuedCopy
+	{
+		vk::Buffer SrcBuffer;
+		vk::Buffer DstBuffer;
+		vk::BufferCopy Region;
+		uint32_t DstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+	};
+
+	/** A ring buffer replaced by a bigger one, destroyed once the submission that copy from it is retired */
+	struct RetiredBuffer
+	{
+		vk::Buffer Buffer;
+		VulkanMemoryAllocation Allocation;
+		/** Timeline value of the submission of its last copies, 0 until they are recorded */
+		uint64_t LastSubmissionValue = 0;
+	};
+
+	void CreateRingBuffer(vk::DeviceSize capacity);
+	/** Reserve space in the ring: wait for the oldest submission while it's full, grow it if it's full of unsubmitted data */
+	vk::DeviceSize AllocateInRing(vk::DeviceSize size);
+	/** Destroy the ring buffers replaced by a bigger one whose copies are complete up to completedValue of the timeline */
+	void ReleaseRetiredBuffers(uint64_t completedValue);
+
+private:
+	const VulkanDeviceHandler* m_VkDevice = nullptr;
+	VulkanTimeline* m_Timeline = nullptr;
+	/** Family of the queue the copies are submitted on */
+	uint32_t m_QueueFamily = VK_QUEUE_FAMILY_IGNORED;
+
+	vk::Buffer m_Buffer;
+	VulkanMemoryAllocation m_Allocation;
+	VulkanStagingRing m_Ring;
+
+	std::vector<QueuedCopy> m_QueuedCopies;
+	/** Destinations released by the recorded copies, acquired by the family that read them */
+	std::vector<vk::BufferMemoryBarrier> m_PendingAcquires;
+	std::vector<RetiredBuffer> m_RetiredBuffers;
+	/** Timeline value of the last submission with copies */
+	uint64_t m_LastSubmissionValue = 0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Renderer_API.h"
+
+#include <cstdint>
+#include <deque>
+
+class VulkanTimeline;
+
+/**
+ * Allocation logic of a ring buffer whose regions are reused once the GPU is done with them.
+ * The allocations are grouped in batches, a batch is closed by Submit and its regions are released by Retire,
+ * once the submission is complete on the GPU (e.g. the timeline reached its value, the value is then the submission id).
+ * It only deals with offsets and submission ids, so it can be tested without a GPU (@see VulkanCpuTimeline).
+ *
+ * The positions grow forever (the offset in the ring is position % capacity), an allocation that doesn't fit before the end
+ * of the ring start again at offset 0 and the end of the ring is lost until the batch is retired.
+ */
+class RENDERER_API VulkanStagingRing final
+{
+public:
+	VulkanStagingRing() = default;
+	/** \param capacity must be a multiple of every alignment used */
+	VulkanStagingRing(uint64_t capacity);
+
+#pragma region API
+public:
+	/** Reserve size bytes aligned on alignment (a power of two), return false when there is not enough space until a submission is retired */
+	bool Allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset);
+	/** Close the current batch: the regions allocated since the last call are in use until submissionId is retired */
+	void Submit(uint64_t submissionId);
+	/** Release the regions of every submission up to completedSubmissionId (the ids must be submitted in increasing order) */
+	void Retire(uint64_t completedSubmissionId);
+
+	/**
+	 * Allocate, waiting for the oldest submission and retiring it while there is not enough space (the submission ids are values of timeline).
+	 *
+	 * \return false if the ring is full of unsubmitted regions, only a bigger ring can fit the allocation (@see GetGrownCapacity)
+	 */
+	bool AllocateOrWait(uint64_t size, uint64_t alignment, VulkanTimeline& timeline, uint64_t& outOffset);
+	/** Retire the submissions the timeline reached, it's only queried when the oldest one may be complete */
+	void RetireCompleted(VulkanTimeline& timeline);
+
+	/** Tell whether or not some regions have been allocated since the last Submit */
+	__forceinline bool HasUnsubmittedAllocations() const { return (m_Head != m_SubmittedHead); }
+	/** Tell whether or not some submissions are not retired yet */
+	__forceinline bool HasPendingSubmissions() const { return (m_Submissions.empty() == false); }
+	/** Get the oldest submission that isn't retired, only valid if HasPendingSubmissions */
+	__forceinline uint64_t GetOldestSubmission() const { return (m_Submissions.front().Id); }
+
+	__forceinline uint64_t GetCapacity() const { return (m_Capacity); }
+	/** Get how many bytes are in use (including the padding and the end of the ring lost by a wraparound) */
+	__forceinline uint64_t GetUsedSize() const { return (m_Head - m_Tail); }
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/** Get the capacity of the ring that replace a ring full of unsubmitted regions, so an allocation of size fit in it */
+	static uint64_t GetGrownCapacity(uint64_t capacity, uint64_t size, uint64_t alignment);
+
+	/**
+	 * Self test, no GPU needed: replay scripted allocations (alignment, wraparound, retirement, growth of a ring full of
+	 * unsubmitted regions) then random ones, checking that no region overlap another one still in use, and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest(uint32_t randomAllocationCount = 100000);
+#pragma endregion
+
+private:
+	struct Submission
+	{
+		uint64_t Id = 0;
+		/** Position of the end of the last region of the submission */
+		uint64_t End = 0;
+	};
+
+private:
+	uint64_t m_Capacity = 0;
+	/** Position of the next allocation */
+	uint64_t m_Head = 0;
+	/** Position of the oldest region still in use */
+	uint64_t m_Tail = 0;
+	/** Value of m_Head at the last Submit */
+	uint64_t m_SubmittedHead = 0;
+
+	std::deque<Submission> m_Submissions;
+};
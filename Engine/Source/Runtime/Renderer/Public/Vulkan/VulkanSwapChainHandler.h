@@ -2,6 +2,9 @@
 
 #include "Renderer_API.h"
 #include "vulkan/VulkanUtils.h"
+#include "Vulkan/VulkanFrameRing.h"
+#include "Vulkan/VulkanTimeline.h"
+#include "Vulkan/VulkanShaderReflection.h"
 
 #include <vulkan/vulkan.hpp>
 
@@ -14,20 +17,46 @@ struct VulkanSwapChainSupportProperties
 	std::vector<vk::PresentModeKHR> PresentModes;
 };
 
-struct VulkanSwapChainFrame
+/** An image of the swap chain, whatever the frame that render into it */
+struct VulkanSwapChainImage
 {
 	vk::Image Image;
 	vk::ImageView ImageView;
+	/** Waited by the present, an image is only acquired again once its previous present is done with it */
+	vk::Semaphore RenderedSemaphore;
+};
+
+/** The resources of a frame in flight, reused once the GPU is done with its previous submission */
+struct VulkanInFlightFrame
+{
+	/** Reset as a whole when the frame is reused */
+	vk::CommandPool CommandPool;
 	vk::CommandBuffer CommandBuffer;
-	vk::DescriptorSetLayout DescriptorSetLayout;
 	vk::DescriptorSet DescriptorSet;
-	vk::Fence RenderedFence;
-	vk::Semaphore RenderedSemaphore;
 	vk::Semaphore AcquiredSemaphore;
 };
 
+/** What is needed to record the current frame: its resources and the image it render into */
+struct VulkanSwapChainFrame
+{
+	uint32_t FrameIndex = 0;
+	uint32_t ImageIndex = 0;
+	vk::Image Image;
+	vk::ImageView ImageView;
+	vk::CommandBuffer CommandBuffer;
+	vk::DescriptorSet DescriptorSet;
+};
+
+/**
+ * Swap chain and the frames in flight rendering into it.
+ * The resources of a frame (command pool, semaphore, descriptor set) belong to a frame slot instead of an image:
+ * with N frames in flight the CPU record a frame while the GPU render the N - 1 previous ones, and only wait for the frame
+ * that used the slot N frames ago (@see VulkanFrameRing), through the value of the timeline its submission signaled.
+ */
 class RENDERER_API VulkanSwapChainHandler final
 {
+public:
+	static constexpr uint32_t DefaultFramesInFlight = 2;
 
 public:
 	VulkanSwapChainHandler() = default;
@@ -46,17 +75,20 @@ public:
 	 * Create the swap chain.
 	 *
 	 * \param prefferedPresentMode The preferred present mode to use (may not be available)
+	 * \param framesInFlight How many frames the CPU can record ahead of the GPU
 	 */
-	void CreateSwapChain(vk::PresentModeKHR preferredPresentMode = vk::PresentModeKHR::eFifo);
-	/** Destroy/cleanup the swap chain */
+	void CreateSwapChain(vk::PresentModeKHR preferredPresentMode = vk::PresentModeKHR::eFifo, uint32_t framesInFlight = DefaultFramesInFlight);
+	/** Destroy/cleanup the swap chain, the frames in flight must be complete (e.g. the device is idle) */
 	void DestroySwapChain();
 
-	/** Acquire the next image in the swap chain. */
-	uint8_t AcquireNextFrameIndex();
-	/** Render frame */
-	void SubmitWork(uint8_t frameIndex) const;
-	/** Present frame */
-	void PresentFrame(uint8_t frameIndex);
+	/** Move to the next frame slot (waiting for its previous submission if needed) and acquire the next image in the swap chain */
+	void AcquireNextFrame();
+	/** Make the submission of the current frame wait for a value of another timeline (e.g. the build of what it reads) */
+	void AddFrameWait(const VulkanTimelineWait& wait);
+	/** Submit the command buffer of the current frame */
+	void SubmitWork();
+	/** Present the image of the current frame */
+	void PresentFrame();
 
 private:
 	VulkanSwapChainSupportProperties RequestSwapchainProperties() const;
@@ -92,7 +124,9 @@ private:
 	 */
 	vk::Extent2D SelectExtent(const vk::SurfaceCapabilitiesKHR& capabilities) const;
 
-	VulkanSwapChainFrame CreateFrame(const vk::Image& image);
+	VulkanSwapChainImage CreateImage(const vk::Image& image);
+	VulkanInFlightFrame CreateInFlightFrame();
+	void DestroyInFlightFrame(VulkanInFlightFrame& frame);
 
 public:
 	/** Get the vulkan swap chain */
@@ -104,28 +138,38 @@ public:
 	vk::Format GetFormat() const { return m_SurfaceFormat.format; }
 	/** Get the number of image that the swap chain use */
 	uint32_t GetImageCount() const { return m_ImageCount; }
+	/** Get how many frames the CPU can record ahead of the GPU */
+	uint32_t GetFramesInFlight() const { return m_FrameRing.GetFrameCount(); }
 
 	/** Connect the swap chain to a device */
 	void SetVulkanDevice(const VulkanDeviceHandler* vkDevice) { m_VkDevice = vkDevice; }
 	/** Connect the swap chain to a surface */
 	void SetSurface(const vk::SurfaceKHR* surface) { m_Surface = surface; }
-	/** Connect the swap chain to a command pool */
-	void SetCommandPool(const vk::CommandPool* commandPool) { m_CommandPool = commandPool; }
+	/** Set the timeline the frames are submitted on */
+	void SetTimeline(VulkanDeviceTimeline* timeline) { m_Timeline = timeline; }
+	/** Set the descriptors of the frames (reflected from the shaders), the descriptor set layout and pool are made from it */
+	void SetFrameDescriptorLayout(const VulkanDescriptorLayout* descriptorLayout) { m_FrameDescriptorLayout = descriptorLayout; }
+
+	/** Get the frame being recorded, only valid between AcquireNextFrame and SubmitWork */
+	VulkanSwapChainFrame GetCurrentFrame() const;
+	/** Layout of the descriptor set of every frame */
+	vk::DescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
 
-	const VulkanSwapChainFrame& GetFrame(uint8_t frameIndex) const { return m_Frames[frameIndex]; }
-	const std::vector<VulkanSwapChainFrame>& GetFrames() const { return m_Frames; }
+	const VulkanSwapChainImage& GetImage(uint32_t imageIndex) const { return m_Images[imageIndex]; }
+	const std::vector<VulkanSwapChainImage>& GetImages() const { return m_Images; }
+	const std::vector<VulkanInFlightFrame>& GetInFlightFrames() const { return m_InFlightFrames; }
 
 private:
 	const VulkanDeviceHandler* m_VkDevice = nullptr;
 	const vk::SurfaceKHR* m_Surface = nullptr;
-	const vk::CommandPool* m_CommandPool = nullptr;
+	VulkanDeviceTimeline* m_Timeline = nullptr;
+	const VulkanDescriptorLayout* m_FrameDescriptorLayout = nullptr;
 	/* Whether or not the swap chain has been created */
 	bool m_IsSwapChainCreated = false;
 
-	/** An index that keep track of which frame is the next to be rendered */
-	uint8_t m_CurrentFrameIndex;
-	uint8_t m_CurrentSemaphoreIndex = 0;
-	uint8_t m_ImageCount;
+	uint32_t m_ImageCount = 0;
+	/** Which frame slot is recorded, and which image each of them render into */
+	VulkanFrameRing m_FrameRing;
 
 	/** The vulkan swap chain */
 	vk::SwapchainKHR m_Swapchain;
@@ -135,8 +179,13 @@ private:
 	vk::SurfaceFormatKHR m_SurfaceFormat;
 	/** The present mode of the swap chain */
 	vk::PresentModeKHR m_PresentMode = vk::PresentModeKHR::eFifo;
-	/** All the frame in the swap chain */
-	std::vector<VulkanSwapChainFrame> m_Frames;
+	/** All the images in the swap chain */
+	std::vector<VulkanSwapChainImage> m_Images;
+	/** The resources of each frame slot */
+	std::vector<VulkanInFlightFrame> m_InFlightFrames;
+	/** What the submission of the current frame wait for, on top of its image */
+	std::vector<VulkanTimelineWait> m_FrameWaits;
 	/** Descriptor pool for all the descriptor set in each frame */
 	vk::DescriptorPool m_DescriptorPool;
+	vk::DescriptorSetLayout m_DescriptorSetLayout;
 };
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Renderer_API.h"
+
+#include <vulkan/vulkan.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class VulkanDeviceHandler;
+
+/**
+ * Monotonically increasing counter signaled by the GPU: each submission signal the next value, and a value is reached
+ * once its submission and every one before it are complete. What a submission use is tagged with its value
+ * and released once the timeline reach it, instead of each submission having its own fence.
+ * The reached value is cached, the timeline is only queried when the cache is behind.
+ */
+class RENDERER_API VulkanTimeline
+{
+public:
+	virtual ~VulkanTimeline() = default;
+
+#pragma region API
+public:
+	/** Reserve the value the next submission signal, the submissions must be done in the order of their values */
+	uint64_t ReserveSignalValue() { return (++m_LastSignalValue); }
+	/** Get the value the next ReserveSignalValue give, to tag what is recorded for the next submission */
+	__forceinline uint64_t GetNextSignalValue() const { return (m_LastSignalValue + 1); }
+	/** Get the last reserved value, reached once everything submitted so far is complete */
+	__forceinline uint64_t GetLastSignalValue() const { return (m_LastSignalValue); }
+
+	/** Tell whether or not value has been reached */
+	bool IsComplete(uint64_t value);
+	/** Query the timeline and get the last value reached */
+	uint64_t Poll();
+	/** Block until value has been reached */
+	void Wait(uint64_t value);
+	/** Block until everything submitted so far is complete */
+	__forceinline void WaitIdle() { Wait(m_LastSignalValue); }
+
+	/** Get the last value known to be reached, without querying the timeline */
+	__forceinline uint64_t GetCompletedValue() const { return (m_CompletedValue); }
+#pragma endregion
+
+protected:
+	virtual uint64_t QueryCompletedValue() const = 0;
+	virtual void WaitForValue(uint64_t value) const = 0;
+
+private:
+	uint64_t m_LastSignalValue = 0;
+	uint64_t m_CompletedValue = 0;
+};
+
+class VulkanDeviceTimeline;
+
+/** A wait of a submission on a timeline, that can be signaled by another queue (the value must have been submitted) */
+struct VulkanTimelineWait
+{
+	const VulkanDeviceTimeline* Timeline = nullptr;
+	uint64_t Value = 0;
+	vk::PipelineStageFlags Stage = vk::PipelineStageFlagBits::eAllCommands;
+};
+
+struct VulkanTimelineSubmitInfo
+{
+	std::vector<vk::CommandBuffer> CommandBuffers;
+	std::vector<VulkanTimelineWait> TimelineWaits;
+
+	/** Binary semaphores, for the swap chain that can't use a timeline */
+	std::vector<vk::Semaphore> WaitSemaphores;
+	std::vector<vk::PipelineStageFlags> WaitStages;
+	std::vector<vk::Semaphore> SignalSemaphores;
+};
+
+/** Timeline on a timeline semaphore (VK_KHR_timeline_semaphore) */
+class RENDERER_API VulkanDeviceTimeline final : public VulkanTimeline
+{
+public:
+	VulkanDeviceTimeline() = default;
+
+	VulkanDeviceTimeline(const VulkanDeviceTimeline& rhs) = delete;
+	VulkanDeviceTimeline operator=(const VulkanDeviceTimeline& rhs) = delete;
+
+#pragma region API
+public:
+	void CreateTimeline(const VulkanDeviceHandler* device);
+	/** The submissions must be complete (e.g. the device is idle) */
+	void DestroyTimeline();
+
+	/** Submit the commands on queue, signaling the next value of the timeline once they are complete, and return that value */
+	uint64_t Submit(const vk::Queue& queue, const VulkanTimelineSubmitInfo& submitInfo);
+
+	__forceinline vk::Semaphore Raw() const { return (m_Semaphore); }
+#pragma endregion
+
+protected:
+	virtual uint64_t QueryCompletedValue() const override;
+	virtual void WaitForValue(uint64_t value) const override;
+
+private:
+	const VulkanDeviceHandler* m_VkDevice = nullptr;
+	vk::Semaphore m_Semaphore;
+};
+
+/** Timeline signaled by the CPU, to test what rely on a timeline without a GPU */
+class RENDERER_API VulkanCpuTimeline final : public VulkanTimeline
+{
+#pragma region API
+public:
+	/** Reach value, as the GPU would once the submission that signal it is complete (from any thread) */
+	void Signal(uint64_t value);
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Self test, no GPU needed: run the wait and retire logic of the staging ring and of the frame ring on a timeline signaled late
+	 * by a fake GPU thread, checking that a region or a frame slot is only reused once the timeline reached its value,
+	 * and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest(uint32_t randomSubmissionCount = 20000);
+#pragma endregion
+
+protected:
+	virtual uint64_t QueryCompletedValue() const override;
+	virtual void WaitForValue(uint64_t value) const override;
+
+private:
+	mutable std::mutex m_Mutex;
+	mutable std::condition_variable m_Signaled;
+	uint64_t m_SignaledValue = 0;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Renderer_API.h"
+#include "Vulkan/VulkanQueueFamilies.h"
+
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <cstdint>
+
+class VulkanDeviceHandler;
+
+/** Turn the ticks of the timestamps of a queue family into durations */
+struct RENDERER_API VulkanTimestampConversion
+{
+	/** Nanoseconds per tick (vk::PhysicalDeviceLimits::timestampPeriod) */
+	float Period = 1.0f;
+	/** Valid bits of the timestamps of the queue family, the ticks wrap around past them (0 when the family has no timestamps) */
+	uint32_t ValidBits = 64;
+
+	__forceinline bool IsSupported() const { return (ValidBits > 0); }
+	/** Get the ticks between two timestamps, endTicks may have wrapped around */
+	__forceinline uint64_t GetElapsedTicks(uint64_t beginTicks, uint64_t endTicks) const
+	{
+		const uint64_t mask = ValidBits >= 64 ? UINT64_MAX : (1ull << ValidBits) - 1;
+		return ((endTicks - beginTicks) & mask);
+	}
+	/** Get the time between two timestamps, endTicks may have wrapped around */
+	std::chrono::nanoseconds ToDuration(uint64_t beginTicks, uint64_t endTicks) const
+	{
+		return (std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(GetElapsedTicks(beginTicks, endTicks)) * Period)));
+	}
+};
+
+/** Where the GPU timestamps are written and read back from, a query pool of the device or fake one */
+class RENDERER_API VulkanTimestampQueries
+{
+public:
+	virtual ~VulkanTimestampQueries() = default;
+
+	virtual uint32_t GetQueryCount() const = 0;
+	/** Record the reset of count queries from firstQuery, it must be outside of a render pass */
+	virtual void ResetQueries(const vk::CommandBuffer& commandBuffer, uint32_t firstQuery, uint32_t count) = 0;
+	/** Record the write of the timestamp of query once the previous commands reach stage */
+	virtual void WriteTimestamp(const vk::CommandBuffer& commandBuffer, vk::PipelineStageFlagBits stage, uint32_t query) = 0;
+	/** Read the ticks of count queries from firstQuery, return false if they are not all available */
+	virtual bool ReadTimestamps(uint32_t firstQuery, uint32_t count, uint64_t* outTicks) = 0;
+};
+
+/** Timestamps of a query pool, destroyed with it */
+class RENDERER_API VulkanDeviceTimestampQueries final : public VulkanTimestampQueries
+{
+public:
+	VulkanDeviceTimestampQueries(vk::Device device, uint32_t queryCount);
+	virtual ~VulkanDeviceTimestampQueries() override;
+
+	VulkanDeviceTimestampQueries(const VulkanDeviceTimestampQueries& rhs) = delete;
+	VulkanDeviceTimestampQueries operator=(const VulkanDeviceTimestampQueries& rhs) = delete;
+
+	/** Get the conversion of the timestamps written on a queue of the device */
+	static VulkanTimestampConversion GetConversion(const VulkanDeviceHandler& device, VulkanQueueType::Type queueType);
+
+	virtual uint32_t GetQueryCount() const override { return (m_QueryCount); }
+	virtual void ResetQueries(const vk::CommandBuffer& commandBuffer, uint32_t firstQuery, uint32_t count) override;
+	virtual void WriteTimestamp(const vk::CommandBuffer& commandBuffer, vk::PipelineStageFlagBits stage, uint32_t query) override;
+	virtual bool ReadTimestamps(uint32_t firstQuery, uint32_t count, uint64_t* outTicks) override;
+
+private:
+	vk::Device m_Device;
+	vk::QueryPool m_QueryPool;
+	uint32_t m_QueryCount = 0;
+};
@@ -11,9 +11,11 @@ function RendererModule(config)
 
 	Renderer.ModuleDependency = {
 		"Core",
+		"Voxel",
 	}
 	Renderer.ThirdPartyDependency = {
 		"Vulkan",
+		"Shaderc",
 		"GLFW",
 		"glm",
 	}
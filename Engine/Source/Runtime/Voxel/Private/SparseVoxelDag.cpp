@@ -0,0 +1,315 @@
+#include "SparseVoxelDag.h"
+#include "VoxelGlobals.h"
+#include "VoxelTerrain.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <array>
+#include <bit>
+#include <unordered_map>
+
+size_t SparseVoxelDag::NodeWordsHash::operator()(const std::vector<uint32_t>& words) const
+{
+	// FNV-1a on the whole words, nodes are at most 9 words long
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t word : words)
+	{
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+	return (static_cast<size_t>(hash));
+}
+
+void SparseVoxelDag::Build(const SparseVoxelOctree& octree)
+{
+	Clear();
+	if (octree.IsEmpty())
+		return;
+
+	m_Origin = octree.GetOrigin();
+	m_Depth = octree.GetDepth();
+	const std::vector<SvoNode>& nodes = octree.GetNodes();
+
+	// The root is directly a voxel, nothing to share
+	if (m_Depth == 0)
+	{
+		m_Words.push_back(nodes[0].FirstChild);
+		m_LevelStatistics.push_back(SvoDagLevelStatistics{ 1, 1, sizeof(SvoNode), sizeof(uint32_t) });
+		return;
+	}
+
+	// Unique nodes of each level, their children are the unique index of the child in the level below
+	std::vector<std::vector<uint32_t>> levelWords(m_Depth);
+	std::vector<std::vector<uint32_t>> levelNodeOffsets(m_Depth);
+	m_LevelStatistics.resize(m_Depth);
+
+	// Octree index (relative to the level) -> unique index, for the level below the one being processed
+	std::vector<uint32_t> childRemap;
+	std::vector<uint32_t> remap;
+	std::vector<uint32_t> key;
+
+	for (int32_t level = static_cast<int32_t>(m_Depth) - 1; level >= 0; level--)
+	{
+		const bool bIsLastLevel = (level == static_cast<int32_t>(m_Depth) - 1);
+		const uint32_t levelOffset = octree.GetLevelOffset(level);
+		const uint32_t childLevelOffset = octree.GetLevelOffset(level + 1);
+		const uint32_t nodeCount = octree.GetLevelNodeCount(level);
+
+		std::unordered_map<std::vector<uint32_t>, uint32_t, NodeWordsHash> uniqueNodes;
+		uniqueNodes.reserve(nodeCount);
+		remap.resize(nodeCount);
+
+		for (uint32_t i = 0; i < nodeCount; i++)
+		{
+			const SvoNode& node = nodes[levelOffset + i];
+			const uint32_t childCount = std::popcount(node.ChildMask);
+
+			// Two nodes are identical when they have the same children, the children being already deduplicated
+			key.clear();
+			key.push_back(node.ChildMask);
+			for (uint32_t child = node.FirstChild; child < node.FirstChild + childCount; child++)
+				key.push_back(bIsLastLevel ? nodes[child].FirstChild : childRemap[child - childLevelOffset]);
+
+			auto [uniqueIt, bInserted] = uniqueNodes.try_emplace(key, static_cast<uint32_t>(levelNodeOffsets[level].size()));
+			if (bInserted)
+			{
+				levelNodeOffsets[level].push_back(static_cast<uint32_t>(levelWords[level].size()));
+				levelWords[level].insert(levelWords[level].end(), key.begin(), key.end());
+			}
+			remap[i] = uniqueIt->second;
+		}
+		childRemap.swap(remap);
+
+		m_LevelStatistics[level] = SvoDagLevelStatistics{
+			nodeCount,
+			static_cast<uint32_t>(levelNodeOffsets[level].size()),
+			// The DAG store the leaves in their parent, so count them with the last level
+			(nodeCount + (bIsLastLevel ? octree.GetLevelNodeCount(m_Depth) : 0)) * sizeof(SvoNode),
+			levelWords[level].size() * sizeof(uint32_t)
+		};
+	}
+
+	// Put the levels one after the other, and turn the children into absolute word indices
+	std::vector<uint32_t> levelWordOffsets(m_Depth + 1, 0);
+	for (uint32_t level = 0; level < m_Depth; level++)
+		levelWordOffsets[level + 1] = levelWordOffsets[level] + static_cast<uint32_t>(levelWords[level].size());
+	m_Words.reserve(levelWordOffsets[m_Depth]);
+
+	for (uint32_t level = 0; level < m_Depth; level++)
+	{
+		const std::vector<uint32_t>& words = levelWords[level];
+		for (uint32_t nodeOffset : levelNodeOffsets[level])
+		{
+			const uint32_t childMask = words[nodeOffset];
+			const uint32_t childCount = std::popcount(childMask);
+
+			m_Words.push_back(childMask);
+			for (uint32_t child = 0; child < childCount; child++)
+			{
+				const uint32_t childWord = words[nodeOffset + 1 + child];
+				if (level + 1 == m_Depth)
+					m_Words.push_back(childWord);
+				else
+					m_Words.push_back(levelWordOffsets[level + 1] + levelNodeOffsets[level + 1][childWord]);
+			}
+		}
+	}
+}
+
+void SparseVoxelDag::Clear()
+{
+	m_Words.clear();
+	m_LevelStatistics.clear();
+	m_Origin = glm::ivec3(0);
+	m_Depth = 0;
+}
+
+VoxelId SparseVoxelDag::GetVoxel(const glm::ivec3& position) const
+{
+	if (IsEmpty())
+		return (EmptyVoxel);
+
+	const glm::ivec3 local = position - m_Origin;
+	if (glm::any(glm::lessThan(local, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(local, glm::ivec3(GetSize()))))
+		return (EmptyVoxel);
+
+	// With the last level, nodeIndex become the VoxelId of the leaf
+	uint32_t nodeIndex = (m_Depth == 0 ? m_Words[0] : 0);
+	for (uint32_t level = 0; level < m_Depth; level++)
+	{
+		const uint32_t shift = m_Depth - level - 1;
+		const uint32_t octant = ((local.x >> shift) & 1) | (((local.y >> shift) & 1) << 1) | (((local.z >> shift) & 1) << 2);
+
+		const uint32_t childMask = m_Words[nodeIndex];
+		if ((childMask & (1u << octant)) == 0)
+			return (EmptyVoxel);
+		nodeIndex = m_Words[nodeIndex + 1 + std::popcount(childMask & ((1u << octant) - 1))];
+	}
+	return (static_cast<VoxelId>(nodeIndex));
+}
+
+bool SparseVoxelDag::Raycast(const VoxelRay& ray, VoxelRayHit& outHit, float minDistance, float maxDistance) const
+{
+	if (IsEmpty())
+		return (false);
+
+	struct StackEntry
+	{
+		/** Index of the node word, or the VoxelId for a leaf */
+		uint32_t NodeIndex;
+		uint32_t Level;
+		/** Lower corner of the node, in voxel unit relative to the origin */
+		glm::ivec3 Cell;
+		float Distance;
+	};
+
+	const glm::vec3 inverseDirection = ComputeInverseDirection(ray.Direction);
+	// The voxels are centered on integer positions
+	const glm::vec3 origin = ray.Origin - glm::vec3(m_Origin) + 0.5f;
+
+	float distance;
+	if (IntersectRayAabb(origin, inverseDirection, glm::vec3(0.0f), glm::vec3(static_cast<float>(GetSize())), maxDistance, distance) == false)
+		return (false);
+
+	// Same front-to-back order as SparseVoxelOctree::Raycast
+	const uint32_t directionMask = (ray.Direction.x < 0.0f ? 1 : 0) | (ray.Direction.y < 0.0f ? 2 : 0) | (ray.Direction.z < 0.0f ? 4 : 0);
+
+	std::array<StackEntry, SparseVoxelOctree::MaxDepth * 8 + 1> stack;
+	uint32_t stackSize = 0;
+	stack[stackSize++] = StackEntry{ (m_Depth == 0 ? m_Words[0] : 0), 0, glm::ivec3(0), distance };
+
+	while (stackSize > 0)
+	{
+		const StackEntry entry = stack[--stackSize];
+
+		if (entry.Level == m_Depth)
+		{
+			// A voxel that contains the origin, or is too close, doesn't stop the ray
+			if (entry.Distance < minDistance)
+				continue;
+
+			outHit.Distance = entry.Distance;
+			outHit.Position = m_Origin + entry.Cell;
+			outHit.Voxel = static_cast<VoxelId>(entry.NodeIndex);
+			return (true);
+		}
+
+		const uint32_t childMask = m_Words[entry.NodeIndex];
+		const int32_t childSize = 1 << (m_Depth - entry.Level - 1);
+
+		// Pushed in reverse order, so they are popped front-to-back
+		for (int32_t i = 7; i >= 0; i--)
+		{
+			const uint32_t octant = static_cast<uint32_t>(i) ^ directionMask;
+			if ((childMask & (1u << octant)) == 0)
+				continue;
+
+			const glm::ivec3 childCell = entry.Cell + glm::ivec3(octant & 1, (octant >> 1) & 1, (octant >> 2) & 1) * childSize;
+			const glm::vec3 childMin(childCell);
+			if (IntersectRayAabb(origin, inverseDirection, childMin, childMin + static_cast<float>(childSize), maxDistance, distance) == false)
+				continue;
+
+			stack[stackSize++] = StackEntry{
+				m_Words[entry.NodeIndex + 1 + std::popcount(childMask & ((1u << octant) - 1))],
+				entry.Level + 1,
+				childCell,
+				distance
+			};
+		}
+	}
+	return (false);
+}
+
+void SparseVoxelDag::LogStatistics() const
+{
+	size_t octreeMemoryUsage = 0;
+	for (uint32_t level = 0; level < m_LevelStatistics.size(); level++)
+	{
+		const SvoDagLevelStatistics& statistics = m_LevelStatistics[level];
+		VOXEL_LOG(Display, "DAG level {:d}: {:d} -> {:d} nodes, {:d} -> {:d} bytes (x{:.2f})",
+			level,
+			statistics.OctreeNodeCount, statistics.DagNodeCount,
+			statistics.OctreeMemoryUsage, statistics.DagMemoryUsage,
+			statistics.GetCompressionRatio()
+		);
+		octreeMemoryUsage += statistics.OctreeMemoryUsage;
+	}
+
+	VOXEL_LOG(Display, "DAG total: {:d} -> {:d} bytes (x{:.2f})",
+		octreeMemoryUsage, GetMemoryUsage(),
+		GetMemoryUsage() == 0 ? 0.0f : static_cast<float>(octreeMemoryUsage) / static_cast<float>(GetMemoryUsage())
+	);
+}
+
+void SparseVoxelDag::LogBenchmark(const std::vector<int32_t>& chunkRadii)
+{
+	constexpr uint32_t rayCount = 1'000'000;
+
+	auto benchmarkWorld = [](const char* worldName, const VoxelWorld& world, const std::vector<VoxelRay>& rays)
+		{
+			SparseVoxelOctree octree;
+			octree.Build(world);
+			SparseVoxelDag dag;
+			START_NAMED_TIMER(BuildTimer);
+			dag.Build(octree);
+			STOP_NAMED_TIMER(BuildTimer);
+			VOXEL_LOG(Display, "{:s} DAG:", worldName);
+			dag.LogStatistics();
+
+			std::vector<VoxelRayHit> octreeHits(rays.size());
+			std::vector<uint8_t> octreeDidHit(rays.size());
+			START_NAMED_TIMER(OctreeTimer);
+			for (size_t i = 0; i < rays.size(); i++)
+				octreeDidHit[i] = octree.Raycast(rays[i], octreeHits[i]);
+			STOP_NAMED_TIMER(OctreeTimer);
+
+			std::vector<VoxelRayHit> dagHits(rays.size());
+			std::vector<uint8_t> dagDidHit(rays.size());
+			START_NAMED_TIMER(DagTimer);
+			for (size_t i = 0; i < rays.size(); i++)
+				dagDidHit[i] = dag.Raycast(rays[i], dagHits[i]);
+			STOP_NAMED_TIMER(DagTimer);
+
+			// The DAG must find the same voxels, compared after the timers so it doesn't slow down the traversals
+			size_t hitCount = 0;
+			size_t mismatchCount = 0;
+			for (size_t i = 0; i < rays.size(); i++)
+			{
+				hitCount += octreeDidHit[i];
+				if (octreeDidHit[i] != dagDidHit[i] || (octreeDidHit[i] && (octreeHits[i].Position != dagHits[i].Position || octreeHits[i].Voxel != dagHits[i].Voxel)))
+					mismatchCount++;
+			}
+
+			const double octreeMs = TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(OctreeTimer));
+			const double dagMs = TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(DagTimer));
+			VOXEL_LOG(Display, "{:s} {:d} voxels: SVO {:.2f}MB, DAG {:.3f}MB (x{:.1f} smaller, built in {:.1f}ms), SVO {:.2f} Mrays/s, DAG {:.2f} Mrays/s (x{:.2f} the SVO time), {:d}/{:d} hits, {:d} mismatches",
+				worldName, world.GetSolidCount(), octree.GetMemoryUsage() / (1024.0 * 1024.0), dag.GetMemoryUsage() / (1024.0 * 1024.0),
+				dag.GetMemoryUsage() > 0 ? static_cast<double>(octree.GetMemoryUsage()) / dag.GetMemoryUsage() : 0.0,
+				TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(BuildTimer)),
+				octreeMs > 0.0 ? rays.size() / (octreeMs * 1000.0) : 0.0, dagMs > 0.0 ? rays.size() / (dagMs * 1000.0) : 0.0,
+				octreeMs > 0.0 ? dagMs / octreeMs : 0.0,
+				hitCount, rays.size(), mismatchCount
+			);
+		};
+
+	for (int32_t chunkRadius : chunkRadii)
+	{
+		const int32_t radius = chunkRadius * VoxelChunkDimension::Size;
+		const std::vector<VoxelRay> rays = VoxelTerrain::GenerateRays(radius, rayCount);
+
+		// The hills repeat, and their layers are flat: the best case of the deduplication
+		VoxelWorld world;
+		VoxelTerrain::Generate(world, radius);
+		benchmarkWorld("Terrain", world, rays);
+
+		// The same hills with a pseudo random material per voxel (hashed from the position), the leaves barely repeat
+		VoxelWorld noiseWorld;
+		world.ForEachSolidVoxel(
+			[&noiseWorld](const glm::ivec3& position, VoxelId voxel)
+			{
+				const size_t hash = ChunkCoordinateHash()(position);
+				noiseWorld.SetVoxel(position, static_cast<VoxelId>(1 + (hash >> 4) % 4));
+			}
+		);
+		benchmarkWorld("Noise", noiseWorld, rays);
+	}
+}
@@ -0,0 +1,226 @@
+#include "SparseVoxelOctree.h"
+#include "Morton.h"
+#include "VoxelGlobals.h"
+#include "VoxelTerrain.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+void SparseVoxelOctree::Build(const std::vector<std::pair<glm::ivec3, VoxelId>>& voxels)
+{
+	Clear();
+	if (voxels.empty())
+		return;
+
+	// Find the smallest power of 2 cube containing every voxels
+	glm::ivec3 boundsMin = voxels[0].first;
+	glm::ivec3 boundsMax = voxels[0].first;
+	for (const auto& [position, voxel] : voxels)
+	{
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+	const glm::ivec3 extent = boundsMax - boundsMin + 1;
+	const uint32_t largestExtent = static_cast<uint32_t>(glm::max(glm::max(extent.x, extent.y), extent.z));
+	m_Depth = static_cast<uint32_t>(std::bit_width(largestExtent - 1));
+	m_Origin = boundsMin;
+	CHECK(m_Depth <= MaxDepth);
+
+	// Sorting the voxels in Morton order put the children of a node next to each other, at every level
+	std::vector<std::pair<uint64_t, VoxelId>> leaves;
+	leaves.reserve(voxels.size());
+	for (const auto& [position, voxel] : voxels)
+	{
+		CHECK(voxel != EmptyVoxel);
+		leaves.emplace_back(Morton::Encode(glm::uvec3(position - m_Origin)), voxel);
+	}
+	std::sort(leaves.begin(), leaves.end(),
+		[](const auto& a, const auto& b) { return (a.first < b.first); }
+	);
+
+	// Morton codes of the nodes of each level (bottom-up), the parent of a node is its code >> 3
+	std::vector<std::vector<uint64_t>> levelCodes(m_Depth + 1);
+	levelCodes[m_Depth].reserve(leaves.size());
+	for (const auto& [code, voxel] : leaves)
+		levelCodes[m_Depth].push_back(code);
+	for (int32_t level = static_cast<int32_t>(m_Depth) - 1; level >= 0; level--)
+	{
+		std::vector<uint64_t>& codes = levelCodes[level];
+		for (uint64_t childCode : levelCodes[level + 1])
+		{
+			if (codes.empty() || codes.back() != (childCode >> 3))
+				codes.push_back(childCode >> 3);
+		}
+	}
+
+	// Breadth-first layout: the levels are simply put one after the other
+	m_LevelOffsets.resize(m_Depth + 2);
+	m_LevelOffsets[0] = 0;
+	for (uint32_t level = 0; level <= m_Depth; level++)
+		m_LevelOffsets[level + 1] = m_LevelOffsets[level] + static_cast<uint32_t>(levelCodes[level].size());
+	m_Nodes.resize(m_LevelOffsets[m_Depth + 1]);
+
+	for (uint32_t level = 0; level < m_Depth; level++)
+	{
+		const std::vector<uint64_t>& codes = levelCodes[level];
+		const std::vector<uint64_t>& childCodes = levelCodes[level + 1];
+
+		size_t childIndex = 0;
+		for (size_t i = 0; i < codes.size(); i++)
+		{
+			SvoNode& node = m_Nodes[m_LevelOffsets[level] + i];
+			node.ChildMask = 0;
+			node.FirstChild = m_LevelOffsets[level + 1] + static_cast<uint32_t>(childIndex);
+
+			while (childIndex < childCodes.size() && (childCodes[childIndex] >> 3) == codes[i])
+			{
+				node.ChildMask |= 1u << (childCodes[childIndex] & 7);
+				childIndex++;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < leaves.size(); i++)
+		m_Nodes[m_LevelOffsets[m_Depth] + i] = SvoNode{ 0, leaves[i].second };
+}
+
+void SparseVoxelOctree::Clear()
+{
+	m_Nodes.clear();
+	m_LevelOffsets.assign(1, 0);
+	m_Origin = glm::ivec3(0);
+	m_Depth = 0;
+}
+
+VoxelId SparseVoxelOctree::GetVoxel(const glm::ivec3& position) const
+{
+	if (IsEmpty())
+		return (EmptyVoxel);
+
+	const glm::ivec3 local = position - m_Origin;
+	if (glm::any(glm::lessThan(local, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(local, glm::ivec3(GetSize()))))
+		return (EmptyVoxel);
+
+	uint32_t nodeIndex = 0;
+	for (uint32_t level = 0; level < m_Depth; level++)
+	{
+		const uint32_t shift = m_Depth - level - 1;
+		const uint32_t octant = ((local.x >> shift) & 1) | (((local.y >> shift) & 1) << 1) | (((local.z >> shift) & 1) << 2);
+
+		const SvoNode& node = m_Nodes[nodeIndex];
+		if ((node.ChildMask & (1u << octant)) == 0)
+			return (EmptyVoxel);
+		nodeIndex = node.FirstChild + std::popcount(node.ChildMask & ((1u << octant) - 1));
+	}
+	return (static_cast<VoxelId>(m_Nodes[nodeIndex].FirstChild));
+}
+
+bool SparseVoxelOctree::Raycast(const VoxelRay& ray, VoxelRayHit& outHit, float minDistance, float maxDistance) const
+{
+	if (IsEmpty())
+		return (false);
+
+	struct StackEntry
+	{
+		uint32_t NodeIndex;
+		uint32_t Level;
+		/** Lower corner of the node, in voxel unit relative to the origin */
+		glm::ivec3 Cell;
+		float Distance;
+	};
+
+	const glm::vec3 inverseDirection = ComputeInverseDirection(ray.Direction);
+	// The voxels are centered on integer positions
+	const glm::vec3 origin = ray.Origin - glm::vec3(m_Origin) + 0.5f;
+
+	float distance;
+	if (IntersectRayAabb(origin, inverseDirection, glm::vec3(0.0f), glm::vec3(static_cast<float>(GetSize())), maxDistance, distance) == false)
+		return (false);
+
+	// Visiting the octants in the order i ^ directionMask is a valid front-to-back order:
+	// the children crossed by a ray are always visited in the order the ray cross them,
+	// so the first leaf reached is the closest hit
+	const uint32_t directionMask = (ray.Direction.x < 0.0f ? 1 : 0) | (ray.Direction.y < 0.0f ? 2 : 0) | (ray.Direction.z < 0.0f ? 4 : 0);
+
+	// A ray cross at most 4 children of a node, 8 per level is a safe upper bound
+	std::array<StackEntry, MaxDepth * 8 + 1> stack;
+	uint32_t stackSize = 0;
+	stack[stackSize++] = StackEntry{ 0, 0, glm::ivec3(0), distance };
+
+	while (stackSize > 0)
+	{
+		const StackEntry entry = stack[--stackSize];
+		const SvoNode& node = m_Nodes[entry.NodeIndex];
+
+		if (entry.Level == m_Depth)
+		{
+			// A voxel that contains the origin, or is too close, doesn't stop the ray
+			if (entry.Distance < minDistance)
+				continue;
+
+			outHit.Distance = entry.Distance;
+			outHit.Position = m_Origin + entry.Cell;
+			outHit.Voxel = static_cast<VoxelId>(node.FirstChild);
+			return (true);
+		}
+
+		const int32_t childSize = 1 << (m_Depth - entry.Level - 1);
+
+		// Pushed in reverse order, so they are popped front-to-back
+		for (int32_t i = 7; i >= 0; i--)
+		{
+			const uint32_t octant = static_cast<uint32_t>(i) ^ directionMask;
+			if ((node.ChildMask & (1u << octant)) == 0)
+				continue;
+
+			const glm::ivec3 childCell = entry.Cell + glm::ivec3(octant & 1, (octant >> 1) & 1, (octant >> 2) & 1) * childSize;
+			const glm::vec3 childMin(childCell);
+			if (IntersectRayAabb(origin, inverseDirection, childMin, childMin + static_cast<float>(childSize), maxDistance, distance) == false)
+				continue;
+
+			stack[stackSize++] = StackEntry{
+				node.FirstChild + std::popcount(node.ChildMask & ((1u << octant) - 1)),
+				entry.Level + 1,
+				childCell,
+				distance
+			};
+		}
+	}
+	return (false);
+}
+
+void SparseVoxelOctree::LogBenchmark(const std::vector<int32_t>& chunkRadii)
+{
+	constexpr uint32_t rayCount = 1'000'000;
+
+	for (int32_t chunkRadius : chunkRadii)
+	{
+		const int32_t radius = chunkRadius * VoxelChunkDimension::Size;
+		VoxelWorld world;
+		VoxelTerrain::Generate(world, radius);
+
+		SparseVoxelOctree octree;
+		START_NAMED_TIMER(BuildTimer);
+		octree.Build(world);
+		STOP_NAMED_TIMER(BuildTimer);
+
+		const std::vector<VoxelRay> rays = VoxelTerrain::GenerateRays(radius, rayCount);
+		uint32_t hitCount = 0;
+		START_NAMED_TIMER(TraversalTimer);
+		for (const VoxelRay& ray : rays)
+		{
+			VoxelRayHit hit;
+			hitCount += (octree.Raycast(ray, hit) ? 1 : 0);
+		}
+		STOP_NAMED_TIMER(TraversalTimer);
+
+		const double buildMs = TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(BuildTimer));
+		const double traversalMs = TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(TraversalTimer));
+		VOXEL_LOG(Display, "SVO {:d} voxels: build {:.1f}ms, depth {:d}, {:d} nodes, {:.2f}MB, traversal {:.2f} Mrays/s ({:d}/{:d} hits)",
+			world.GetSolidCount(), buildMs, octree.GetDepth(), octree.GetNodeCount(), octree.GetMemoryUsage() / (1024.0 * 1024.0),
+			traversalMs > 0.0 ? static_cast<double>(rayCount) / (traversalMs * 1000.0) : 0.0, hitCount, rayCount
+		);
+	}
+}
@@ -0,0 +1,140 @@
+#include "VoxelAabbMerger.h"
+#include "VoxelGlobals.h"
+#include "VoxelWorld.h"
+#include "VoxelTerrain.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <algorithm>
+#include <cstring>
+
+void VoxelAabbMerger::AppendMergedAabbs(ChunkVoxels& voxels, const glm::ivec3& offset, std::vector<VoxelAabb>& aabbs, VoxelAabbMergeStatistics* outStatistics)
+{
+	constexpr int32_t size = VoxelChunkDimension::Size;
+	constexpr int32_t rowStride = size;
+	constexpr int32_t sliceStride = size * size;
+
+	Timer timer;
+	const size_t firstAabb = aabbs.size();
+	size_t voxelCount = 0;
+
+	int32_t index = 0;
+	for (int32_t z = 0; z < size; z++)
+	{
+		for (int32_t y = 0; y < size; y++)
+		{
+			for (int32_t x = 0; x < size; x++, index++)
+			{
+				const VoxelId voxel = voxels[index];
+				if (voxel == EmptyVoxel)
+					continue;
+
+				// Grow along x while the voxels are the same
+				int32_t width = 1;
+				while (x + width < size && voxels[index + width] == voxel)
+					width++;
+
+				// Grow along y while the whole row is the same
+				auto isRowMergeable = [&](int32_t rowIndex)
+					{
+						for (int32_t i = 0; i < width; i++)
+						{
+							if (voxels[rowIndex + i] != voxel)
+								return (false);
+						}
+						return (true);
+					};
+				int32_t height = 1;
+				while (y + height < size && isRowMergeable(index + height * rowStride))
+					height++;
+
+				// Grow along z while the whole rectangle is the same
+				int32_t depth = 1;
+				for (; z + depth < size; depth++)
+				{
+					bool bSliceMergeable = true;
+					for (int32_t row = 0; row < height && bSliceMergeable; row++)
+						bSliceMergeable = isRowMergeable(index + depth * sliceStride + row * rowStride);
+					if (bSliceMergeable == false)
+						break;
+				}
+
+				// Consume the voxels of the box, so they don't start or join another box
+				for (int32_t slice = 0; slice < depth; slice++)
+				{
+					for (int32_t row = 0; row < height; row++)
+					{
+						VoxelId* rowVoxels = voxels.data() + index + slice * sliceStride + row * rowStride;
+						std::fill(rowVoxels, rowVoxels + width, EmptyVoxel);
+					}
+				}
+				voxelCount += static_cast<size_t>(width) * height * depth;
+
+				// A voxel at P covers [P - 0.5, P + 0.5]
+				const glm::vec3 first = glm::vec3(offset + glm::ivec3(x, y, z));
+				const glm::vec3 last = glm::vec3(offset + glm::ivec3(x + width - 1, y + height - 1, z + depth - 1));
+				aabbs.push_back(VoxelAabb{ first - 0.5f, last + 0.5f });
+			}
+		}
+	}
+
+	if (outStatistics)
+	{
+		outStatistics->VoxelCount = voxelCount;
+		outStatistics->AabbCount = aabbs.size() - firstAabb;
+		outStatistics->Duration = timer.Elapsed();
+	}
+}
+
+uint64_t VoxelAabbMerger::HashAabbs(const std::vector<VoxelAabb>& aabbs)
+{
+	// FNV-1a on the bits of each float
+	uint64_t hash = 14695981039346656037ull;
+	for (const VoxelAabb& aabb : aabbs)
+	{
+		const float values[6] = { aabb.Min.x, aabb.Min.y, aabb.Min.z, aabb.Max.x, aabb.Max.y, aabb.Max.z };
+		for (float value : values)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			hash ^= bits;
+			hash *= 1099511628211ull;
+		}
+	}
+	return (hash);
+}
+
+void VoxelAabbMerger::LogBenchmark(int32_t chunkRadius)
+{
+	VoxelWorld world;
+	VoxelTerrain::Generate(world, chunkRadius * VoxelChunkDimension::Size);
+
+	std::vector<VoxelAabb> aabbs;
+	VoxelAabbMergeStatistics statistics;
+	for (const auto& [coordinate, chunk] : world.GetChunks())
+	{
+		VoxelAabbMergeStatistics chunkStatistics;
+		AppendMergedAabbs(*chunk, VoxelWorld::ToChunkOrigin(coordinate), aabbs, &chunkStatistics);
+		statistics += chunkStatistics;
+	}
+
+	// The chunks are visited in hash map order, sort the boxes so the hash doesn't depend on it
+	std::sort(aabbs.begin(), aabbs.end(),
+		[](const VoxelAabb& a, const VoxelAabb& b)
+		{
+			if (a.Min.z != b.Min.z)
+				return (a.Min.z < b.Min.z);
+			if (a.Min.y != b.Min.y)
+				return (a.Min.y < b.Min.y);
+			return (a.Min.x < b.Min.x);
+		}
+	);
+
+	const uint64_t hash = HashAabbs(aabbs);
+	VOXEL_LOG(Display, "AABB merge {:d} chunks: {:d} voxels -> {:d} AABBs (x{:.1f} less primitives) in {:.2f}ms ({:.1f}us per chunk), hash {:016x}",
+		world.GetChunkCount(), statistics.VoxelCount, statistics.AabbCount, statistics.GetReductionRatio(),
+		TO_DOUBLE_MILLISECONDS(statistics.Duration), TO_DOUBLE_MICROSECONDS(statistics.Duration) / glm::max<size_t>(world.GetChunkCount(), 1),
+		hash
+	);
+	if (chunkRadius == GoldenBenchmarkChunkRadius && hash != GoldenBenchmarkHash)
+		VOXEL_LOG(Error, "AABB merge hash {:016x} doesn't match the golden hash {:016x}, the merge output changed", hash, GoldenBenchmarkHash);
+}
@@ -0,0 +1,451 @@
+#include "VoxelBvh.h"
+#include "VoxelGlobals.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <random>
+#include <thread>
+
+/** Everything shared by the threads during a build */
+struct VoxelBvh::BuildContext
+{
+	const VoxelBvhSettings& Settings;
+	const std::vector<VoxelAabb>& Aabbs;
+	/** Center of each primitive, indexed like Aabbs */
+	std::vector<glm::vec3> Centroids;
+	/** How many nodes are used in m_Nodes (allocated by pair) */
+	std::atomic<uint32_t> NodeCount = 0;
+	/** How many more threads can be started to build subtrees */
+	std::atomic<int32_t> AvailableThreadCount = 0;
+
+	bool TryAcquireThread()
+	{
+		int32_t availableThreadCount = AvailableThreadCount.load();
+		while (availableThreadCount > 0)
+		{
+			if (AvailableThreadCount.compare_exchange_weak(availableThreadCount, availableThreadCount - 1))
+				return (true);
+		}
+		return (false);
+	}
+};
+
+__forceinline static float CalculateSurfaceArea(const glm::vec3& min, const glm::vec3& max)
+{
+	const glm::vec3 extent = glm::max(max - min, glm::vec3(0.0f));
+	return (2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x));
+}
+
+void VoxelBvh::Build(const std::vector<VoxelAabb>& aabbs, const VoxelBvhSettings& settings)
+{
+	CHECK(settings.BinCount >= 2 && settings.BinCount <= VoxelBvhSettings::MaxBinCount && settings.MaxLeafSize >= 1);
+
+	Clear();
+	if (aabbs.empty())
+		return;
+
+	BuildContext context{ settings, aabbs };
+	context.Centroids.resize(aabbs.size());
+	for (size_t i = 0; i < aabbs.size(); i++)
+		context.Centroids[i] = (aabbs[i].Min + aabbs[i].Max) * 0.5f;
+
+	const uint32_t threadCount = (settings.ThreadCount == 0 ? std::thread::hardware_concurrency() : settings.ThreadCount);
+	context.AvailableThreadCount = static_cast<int32_t>(glm::max(threadCount, 1u)) - 1;
+
+	// A binary tree with N leaves has 2N - 1 nodes, allocate them upfront so the threads never resize the array
+	const uint32_t primitiveCount = static_cast<uint32_t>(aabbs.size());
+	m_Nodes.resize(static_cast<size_t>(primitiveCount) * 2 - 1);
+	m_PrimitiveIndices.resize(primitiveCount);
+	for (uint32_t i = 0; i < primitiveCount; i++)
+		m_PrimitiveIndices[i] = i;
+	m_TraversalCost = settings.TraversalCost;
+
+	// The root is alone, then the nodes are allocated by pair (the two children of a node)
+	context.NodeCount = 1;
+	BuildNode(context, 0, 0, primitiveCount, 0);
+	m_Nodes.resize(context.NodeCount);
+
+	// Copy the AABBs in leaf order, so a leaf read contiguous memory
+	m_Aabbs.resize(primitiveCount);
+	for (uint32_t i = 0; i < primitiveCount; i++)
+		m_Aabbs[i] = aabbs[m_PrimitiveIndices[i]];
+}
+
+void VoxelBvh::Clear()
+{
+	m_Nodes.clear();
+	m_PrimitiveIndices.clear();
+	m_Aabbs.clear();
+}
+
+void VoxelBvh::BuildNode(BuildContext& context, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+{
+	const VoxelBvhSettings& settings = context.Settings;
+	uint32_t* primitives = m_PrimitiveIndices.data() + first;
+
+	// Bounds of the primitives, and of their centroids
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const VoxelAabb& aabb = context.Aabbs[primitives[i]];
+		boundsMin = glm::min(boundsMin, aabb.Min);
+		boundsMax = glm::max(boundsMax, aabb.Max);
+		centroidMin = glm::min(centroidMin, context.Centroids[primitives[i]]);
+		centroidMax = glm::max(centroidMax, context.Centroids[primitives[i]]);
+	}
+
+	VoxelBvhNode& node = m_Nodes[nodeIndex];
+	node.Min = boundsMin;
+	node.Max = boundsMax;
+	node.LeftOrFirst = first;
+	node.PrimitiveCount = count;
+	if (count == 1)
+		return;
+
+	// Find the best split plane with binned SAH, the planes are between the bins of each axis
+	struct Bin
+	{
+		glm::vec3 Min = glm::vec3(FLT_MAX);
+		glm::vec3 Max = glm::vec3(-FLT_MAX);
+		uint32_t Count = 0;
+	};
+	std::array<Bin, VoxelBvhSettings::MaxBinCount> bins;
+	std::array<float, VoxelBvhSettings::MaxBinCount> rightCosts;
+
+	const glm::vec3 centroidExtent = centroidMax - centroidMin;
+	const float parentArea = glm::max(CalculateSurfaceArea(boundsMin, boundsMax), FLT_MIN);
+	int32_t bestAxis = -1;
+	uint32_t bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	for (int32_t axis = 0; axis < 3; axis++)
+	{
+		if (centroidExtent[axis] <= 0.0f)
+			continue;
+
+		std::fill(bins.begin(), bins.begin() + settings.BinCount, Bin());
+		const float scale = static_cast<float>(settings.BinCount) / centroidExtent[axis];
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint32_t binIndex = glm::min(settings.BinCount - 1, static_cast<uint32_t>((context.Centroids[primitives[i]][axis] - centroidMin[axis]) * scale));
+			Bin& bin = bins[binIndex];
+			bin.Min = glm::min(bin.Min, context.Aabbs[primitives[i]].Min);
+			bin.Max = glm::max(bin.Max, context.Aabbs[primitives[i]].Max);
+			bin.Count++;
+		}
+
+		// Sweep from the right to get the cost of the right side of each plane, then from the left to evaluate the planes
+		Bin right;
+		for (uint32_t split = settings.BinCount - 1; split > 0; split--)
+		{
+			right.Min = glm::min(right.Min, bins[split].Min);
+			right.Max = glm::max(right.Max, bins[split].Max);
+			right.Count += bins[split].Count;
+			rightCosts[split] = (right.Count == 0 ? -1.0f : CalculateSurfaceArea(right.Min, right.Max) * static_cast<float>(right.Count));
+		}
+
+		Bin left;
+		for (uint32_t split = 1; split < settings.BinCount; split++)
+		{
+			left.Min = glm::min(left.Min, bins[split - 1].Min);
+			left.Max = glm::max(left.Max, bins[split - 1].Max);
+			left.Count += bins[split - 1].Count;
+			if (left.Count == 0 || rightCosts[split] < 0.0f)
+				continue;
+
+			const float cost = settings.TraversalCost + (CalculateSurfaceArea(left.Min, left.Max) * static_cast<float>(left.Count) + rightCosts[split]) / parentArea;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	// Splitting cost more than testing every primitive
+	if (count <= settings.MaxLeafSize && bestCost >= static_cast<float>(count))
+		return;
+
+	uint32_t leftCount;
+	if (bestAxis >= 0 && depth < MaxDepth / 2)
+	{
+		const float scale = static_cast<float>(settings.BinCount) / centroidExtent[bestAxis];
+		uint32_t* middle = std::partition(primitives, primitives + count,
+			[&](uint32_t primitive)
+			{
+				const uint32_t binIndex = glm::min(settings.BinCount - 1, static_cast<uint32_t>((context.Centroids[primitive][bestAxis] - centroidMin[bestAxis]) * scale));
+				return (binIndex < bestSplit);
+			}
+		);
+		leftCount = static_cast<uint32_t>(middle - primitives);
+	}
+	else
+	{
+		// Every centroids are at the same place, or the tree is getting too deep: median split on the largest axis,
+		// which add at most log2(count) levels, so the depth can't go over MaxDepth
+		const glm::vec3 extent = (bestAxis >= 0 ? centroidExtent : boundsMax - boundsMin);
+		const int32_t axis = (extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2);
+		leftCount = count / 2;
+		std::nth_element(primitives, primitives + leftCount, primitives + count,
+			[&](uint32_t a, uint32_t b) { return (context.Centroids[a][axis] < context.Centroids[b][axis]); }
+		);
+	}
+	CHECK(leftCount > 0 && leftCount < count);
+
+	const uint32_t leftIndex = context.NodeCount.fetch_add(2);
+	node.LeftOrFirst = leftIndex;
+	node.PrimitiveCount = 0;
+
+	const uint32_t rightCount = count - leftCount;
+	if (glm::min(leftCount, rightCount) >= settings.ParallelThreshold && context.TryAcquireThread())
+	{
+		std::thread leftThread([this, &context, leftIndex, first, leftCount, depth]()
+			{
+				BuildNode(context, leftIndex, first, leftCount, depth + 1);
+			}
+		);
+		BuildNode(context, leftIndex + 1, first + leftCount, rightCount, depth + 1);
+		leftThread.join();
+		context.AvailableThreadCount++;
+	}
+	else
+	{
+		BuildNode(context, leftIndex, first, leftCount, depth + 1);
+		BuildNode(context, leftIndex + 1, first + leftCount, rightCount, depth + 1);
+	}
+}
+
+bool VoxelBvh::Raycast(const VoxelRay& ray, VoxelBvhHit& outHit, float minDistance, float maxDistance) const
+{
+	if (IsEmpty())
+		return (false);
+
+	struct StackEntry
+	{
+		uint32_t NodeIndex;
+		float Distance;
+	};
+
+	const glm::vec3 inverseDirection = ComputeInverseDirection(ray.Direction);
+	float closestDistance = maxDistance;
+	bool bHit = false;
+
+	float distance;
+	if (IntersectRayAabb(ray.Origin, inverseDirection, m_Nodes[0].Min, m_Nodes[0].Max, closestDistance, distance) == false)
+		return (false);
+
+	// The nearest child is always visited first, the other one is on the stack: one entry per level at most
+	StackEntry stack[MaxDepth + 1];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = StackEntry{ 0, distance };
+
+	while (stackSize > 0)
+	{
+		const StackEntry entry = stack[--stackSize];
+		// Something closer has been found since this node was pushed
+		if (entry.Distance > closestDistance)
+			continue;
+
+		const VoxelBvhNode& node = m_Nodes[entry.NodeIndex];
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.LeftOrFirst; i < node.LeftOrFirst + node.PrimitiveCount; i++)
+			{
+				if (IntersectRayAabb(ray.Origin, inverseDirection, m_Aabbs[i].Min, m_Aabbs[i].Max, closestDistance, distance) == false)
+					continue;
+				if (distance < minDistance || (bHit && distance >= closestDistance))
+					continue;
+
+				bHit = true;
+				closestDistance = distance;
+				outHit.Distance = distance;
+				outHit.PrimitiveIndex = m_PrimitiveIndices[i];
+			}
+			continue;
+		}
+
+		float leftDistance, rightDistance;
+		const VoxelBvhNode& left = m_Nodes[node.LeftOrFirst];
+		const VoxelBvhNode& right = m_Nodes[node.LeftOrFirst + 1];
+		const bool bHitLeft = IntersectRayAabb(ray.Origin, inverseDirection, left.Min, left.Max, closestDistance, leftDistance);
+		const bool bHitRight = IntersectRayAabb(ray.Origin, inverseDirection, right.Min, right.Max, closestDistance, rightDistance);
+
+		if (bHitLeft && bHitRight)
+		{
+			// Push the far one first, so the near one is popped first
+			if (leftDistance <= rightDistance)
+			{
+				stack[stackSize++] = StackEntry{ node.LeftOrFirst + 1, rightDistance };
+				stack[stackSize++] = StackEntry{ node.LeftOrFirst, leftDistance };
+			}
+			else
+			{
+				stack[stackSize++] = StackEntry{ node.LeftOrFirst, leftDistance };
+				stack[stackSize++] = StackEntry{ node.LeftOrFirst + 1, rightDistance };
+			}
+		}
+		else if (bHitLeft)
+			stack[stackSize++] = StackEntry{ node.LeftOrFirst, leftDistance };
+		else if (bHitRight)
+			stack[stackSize++] = StackEntry{ node.LeftOrFirst + 1, rightDistance };
+	}
+	return (bHit);
+}
+
+bool VoxelBvh::Validate() const
+{
+	if (IsEmpty())
+		return (m_PrimitiveIndices.empty() && m_Aabbs.empty());
+
+	auto contains = [](const VoxelBvhNode& node, const glm::vec3& min, const glm::vec3& max)
+		{
+			return (glm::all(glm::lessThanEqual(node.Min, min)) && glm::all(glm::lessThanEqual(max, node.Max)));
+		};
+
+	std::vector<uint32_t> nodeVisitCounts(m_Nodes.size(), 0);
+	std::vector<uint32_t> slotVisitCounts(m_PrimitiveIndices.size(), 0);
+	std::vector<uint32_t> primitiveVisitCounts(m_PrimitiveIndices.size(), 0);
+
+	struct StackEntry
+	{
+		uint32_t NodeIndex;
+		uint32_t Depth;
+	};
+	std::vector<StackEntry> stack = { StackEntry{ 0, 0 } };
+
+	while (stack.empty() == false)
+	{
+		const StackEntry entry = stack.back();
+		stack.pop_back();
+
+		if (entry.Depth >= MaxDepth)
+		{
+			VOXEL_LOG(Error, "BVH node {:d} is deeper than the maximum depth ({:d})", entry.NodeIndex, MaxDepth);
+			return (false);
+		}
+		if (nodeVisitCounts[entry.NodeIndex]++ > 0)
+		{
+			VOXEL_LOG(Error, "BVH node {:d} is referenced several times", entry.NodeIndex);
+			return (false);
+		}
+
+		const VoxelBvhNode& node = m_Nodes[entry.NodeIndex];
+		if (node.IsLeaf())
+		{
+			if (static_cast<size_t>(node.LeftOrFirst) + node.PrimitiveCount > m_PrimitiveIndices.size())
+			{
+				VOXEL_LOG(Error, "BVH leaf {:d} reference primitives out of range", entry.NodeIndex);
+				return (false);
+			}
+			for (uint32_t i = node.LeftOrFirst; i < node.LeftOrFirst + node.PrimitiveCount; i++)
+			{
+				if (contains(node, m_Aabbs[i].Min, m_Aabbs[i].Max) == false)
+				{
+					VOXEL_LOG(Error, "BVH leaf {:d} doesn't contain its primitive {:d}", entry.NodeIndex, m_PrimitiveIndices[i]);
+					return (false);
+				}
+				slotVisitCounts[i]++;
+				if (m_PrimitiveIndices[i] < primitiveVisitCounts.size())
+					primitiveVisitCounts[m_PrimitiveIndices[i]]++;
+			}
+			continue;
+		}
+
+		// The children can be stored before their parent (LBVH), a cycle is caught by the visit counts
+		if (static_cast<size_t>(node.LeftOrFirst) + 1 >= m_Nodes.size() || node.LeftOrFirst == 0)
+		{
+			VOXEL_LOG(Error, "BVH node {:d} has invalid children ({:d})", entry.NodeIndex, node.LeftOrFirst);
+			return (false);
+		}
+		for (uint32_t child = node.LeftOrFirst; child <= node.LeftOrFirst + 1; child++)
+		{
+			if (contains(node, m_Nodes[child].Min, m_Nodes[child].Max) == false)
+			{
+				VOXEL_LOG(Error, "BVH node {:d} doesn't contain its child {:d}", entry.NodeIndex, child);
+				return (false);
+			}
+			stack.push_back(StackEntry{ child, entry.Depth + 1 });
+		}
+	}
+
+	if (std::find(nodeVisitCounts.begin(), nodeVisitCounts.end(), 0u) != nodeVisitCounts.end())
+	{
+		VOXEL_LOG(Error, "BVH has unreachable nodes");
+		return (false);
+	}
+	auto isNotOne = [](uint32_t visitCount) { return (visitCount != 1); };
+	if (std::any_of(slotVisitCounts.begin(), slotVisitCounts.end(), isNotOne) || std::any_of(primitiveVisitCounts.begin(), primitiveVisitCounts.end(), isNotOne))
+	{
+		VOXEL_LOG(Error, "BVH doesn't reference every primitive exactly once");
+		return (false);
+	}
+	return (true);
+}
+
+float VoxelBvh::CalculateSahCost() const
+{
+	if (IsEmpty())
+		return (0.0f);
+
+	float cost = 0.0f;
+	for (const VoxelBvhNode& node : m_Nodes)
+	{
+		const float area = CalculateSurfaceArea(node.Min, node.Max);
+		cost += area * (node.IsLeaf() ? static_cast<float>(node.PrimitiveCount) : m_TraversalCost);
+	}
+	return (cost / glm::max(CalculateSurfaceArea(m_Nodes[0].Min, m_Nodes[0].Max), FLT_MIN));
+}
+
+void VoxelBvh::LogBenchmark(const std::vector<uint32_t>& primitiveCounts)
+{
+	constexpr uint32_t rayCount = 1'000'000;
+
+	for (uint32_t primitiveCount : primitiveCounts)
+	{
+		// Random voxels in a cube 4 times bigger than their count (like a sparse voxel scene)
+		std::mt19937 random(primitiveCount);
+		const int32_t worldSize = glm::max(1, static_cast<int32_t>(std::cbrt(static_cast<double>(primitiveCount) * 4.0)));
+		std::uniform_int_distribution<int32_t> positionDistribution(0, worldSize - 1);
+		std::uniform_real_distribution<float> directionDistribution(-1.0f, 1.0f);
+
+		std::vector<VoxelAabb> aabbs(primitiveCount);
+		for (VoxelAabb& aabb : aabbs)
+		{
+			const glm::vec3 center(positionDistribution(random), positionDistribution(random), positionDistribution(random));
+			aabb = VoxelAabb{ center - 0.5f, center + 0.5f };
+		}
+
+		VoxelBvh bvh;
+		START_NAMED_TIMER(BuildTimer);
+		bvh.Build(aabbs);
+		STOP_NAMED_TIMER(BuildTimer);
+
+		std::vector<VoxelRay> rays(rayCount);
+		for (VoxelRay& ray : rays)
+		{
+			ray.Origin = glm::vec3(positionDistribution(random), positionDistribution(random), positionDistribution(random));
+			ray.Direction = glm::vec3(directionDistribution(random), directionDistribution(random), directionDistribution(random));
+		}
+
+		uint32_t hitCount = 0;
+		START_NAMED_TIMER(TraversalTimer);
+		for (const VoxelRay& ray : rays)
+		{
+			VoxelBvhHit hit;
+			hitCount += (bvh.Raycast(ray, hit) ? 1 : 0);
+		}
+		STOP_NAMED_TIMER(TraversalTimer);
+
+		const double buildMs = TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(BuildTimer));
+		const double traversalMs = TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(TraversalTimer));
+		VOXEL_LOG(Display, "BVH {:d} boxes: build {:.1f}ms, {:d} nodes, {:d}MB, SAH cost {:.1f}, {:s}, traversal {:.2f} Mrays/s ({:d}/{:d} hits)",
+			primitiveCount, buildMs, bvh.GetNodes().size(), bvh.GetMemoryUsage() >> 20, bvh.CalculateSahCost(),
+			bvh.Validate() ? "valid" : "INVALID",
+			traversalMs > 0.0 ? static_cast<double>(rayCount) / (traversalMs * 1000.0) : 0.0, hitCount, rayCount
+		);
+	}
+}
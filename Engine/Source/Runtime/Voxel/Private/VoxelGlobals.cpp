@@ -0,0 +1,3 @@
+#include "VoxelGlobals.h"
+
+DEFINE_LOG_CATEGORY(LogVoxel);
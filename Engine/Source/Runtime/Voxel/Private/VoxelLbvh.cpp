@@ -0,0 +1,432 @@
+#include "VoxelLbvh.h"
+#include "VoxelGlobals.h"
+#include "Morton.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <atomic>
+#include <barrier>
+#include <bit>
+#include <random>
+#include <thread>
+
+/** The radix sort handle the codes 8 bits at a time */
+static constexpr uint32_t RadixBitCount = 8;
+static constexpr uint32_t RadixBucketCount = 1 << RadixBitCount;
+/** Mark the parent of the root */
+static constexpr uint32_t InvalidNode = UINT32_MAX;
+
+/** Everything shared by the threads during a build */
+struct VoxelLbvhBuilder::BuildContext
+{
+	const std::vector<VoxelAabb>& Aabbs;
+	const uint32_t PrimitiveCount;
+	const uint32_t ThreadCount;
+	std::barrier<> Barrier;
+
+	/** Bounds of the centroids, and size of the smallest primitive, found by each thread */
+	std::vector<glm::vec3> CentroidMins;
+	std::vector<glm::vec3> CentroidMaxs;
+	std::vector<float> MinPrimitiveSizes;
+	/** AND and OR of the codes found by each thread, to know which digits are worth sorting */
+	std::vector<uint64_t> CodeAndMasks;
+	std::vector<uint64_t> CodeOrMasks;
+
+	/** Timings of the phases, written by the thread 0 */
+	VoxelLbvhTimings Timings;
+
+	BuildContext(const std::vector<VoxelAabb>& aabbs, uint32_t threadCount)
+		: Aabbs(aabbs)
+		, PrimitiveCount(static_cast<uint32_t>(aabbs.size()))
+		, ThreadCount(threadCount)
+		, Barrier(threadCount)
+		, CentroidMins(threadCount)
+		, CentroidMaxs(threadCount)
+		, MinPrimitiveSizes(threadCount)
+		, CodeAndMasks(threadCount)
+		, CodeOrMasks(threadCount)
+	{}
+
+	/** Get the part of [0, count[ processed by a thread */
+	__forceinline void GetRange(uint32_t count, uint32_t threadIndex, uint32_t& outBegin, uint32_t& outEnd) const
+	{
+		outBegin = static_cast<uint32_t>(static_cast<uint64_t>(count) * threadIndex / ThreadCount);
+		outEnd = static_cast<uint32_t>(static_cast<uint64_t>(count) * (threadIndex + 1) / ThreadCount);
+	}
+};
+
+void VoxelLbvhBuilder::Build(const std::vector<VoxelAabb>& aabbs, VoxelBvh& outBvh, const VoxelLbvhSettings& settings)
+{
+	outBvh.Clear();
+	m_LastTimings = VoxelLbvhTimings();
+	if (aabbs.empty())
+		return;
+
+	const uint32_t primitiveCount = static_cast<uint32_t>(aabbs.size());
+	uint32_t threadCount = (settings.ThreadCount == 0 ? std::thread::hardware_concurrency() : settings.ThreadCount);
+	if (primitiveCount < settings.ParallelThreshold)
+		threadCount = 1;
+	threadCount = glm::clamp(threadCount, 1u, primitiveCount);
+
+	// A binary tree with N leaves has 2N - 1 nodes, the root is alone then the nodes are stored by pair (the two children of an internal node)
+	outBvh.m_Nodes.resize(static_cast<size_t>(primitiveCount) * 2 - 1);
+	outBvh.m_PrimitiveIndices.resize(primitiveCount);
+	outBvh.m_Aabbs.resize(primitiveCount);
+	outBvh.m_TraversalCost = 1.0f;
+
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		m_Codes[i].resize(primitiveCount);
+		m_Indices[i].resize(primitiveCount);
+	}
+	m_Histograms.resize(static_cast<size_t>(threadCount) * RadixBucketCount);
+	m_InternalSlots.resize(primitiveCount - 1);
+	m_InternalParents.resize(primitiveCount - 1);
+	m_RefitCounters.resize(primitiveCount - 1);
+	m_LeafSlots.resize(primitiveCount);
+	m_LeafParents.resize(primitiveCount);
+
+	// Start the threads once, the phases are separated by barriers
+	BuildContext context(aabbs, threadCount);
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; i++)
+		workers.emplace_back([this, &context, &outBvh, i]() { BuildTask(context, outBvh, i); });
+	BuildTask(context, outBvh, 0);
+	for (std::thread& worker : workers)
+		worker.join();
+
+	m_LastTimings = context.Timings;
+
+	if (settings.bReportToProfiler)
+	{
+		REPORT_PERFRAME_TIMER(ProfilingCategories::MortonCodes, m_LastTimings.MortonCodes);
+		REPORT_PERFRAME_TIMER(ProfilingCategories::Sort, m_LastTimings.Sort);
+		REPORT_PERFRAME_TIMER(ProfilingCategories::Hierarchy, m_LastTimings.Hierarchy);
+		REPORT_PERFRAME_TIMER(ProfilingCategories::Refit, m_LastTimings.Refit);
+	}
+}
+
+void VoxelLbvhBuilder::ReleaseScratchMemory()
+{
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		m_Codes[i] = std::vector<uint64_t>();
+		m_Indices[i] = std::vector<uint32_t>();
+	}
+	m_Histograms = std::vector<uint32_t>();
+	m_InternalSlots = std::vector<uint32_t>();
+	m_LeafSlots = std::vector<uint32_t>();
+	m_InternalParents = std::vector<uint32_t>();
+	m_LeafParents = std::vector<uint32_t>();
+	m_RefitCounters = std::vector<uint32_t>();
+}
+
+void VoxelLbvhBuilder::BuildTask(BuildContext& context, VoxelBvh& outBvh, uint32_t threadIndex)
+{
+	const std::vector<VoxelAabb>& aabbs = context.Aabbs;
+	const uint32_t primitiveCount = context.PrimitiveCount;
+	const bool bMainThread = (threadIndex == 0);
+	Timer phaseTimer;
+
+	uint32_t begin, end;
+	context.GetRange(primitiveCount, threadIndex, begin, end);
+
+	/* MORTON CODES */
+
+	// Bounds of the centroids (twice the centroids actually, the division is useless)
+	glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+	float minPrimitiveSize = FLT_MAX;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const glm::vec3 centroid = aabbs[i].Min + aabbs[i].Max;
+		const glm::vec3 size = aabbs[i].Max - aabbs[i].Min;
+		centroidMin = glm::min(centroidMin, centroid);
+		centroidMax = glm::max(centroidMax, centroid);
+		minPrimitiveSize = glm::min(minPrimitiveSize, glm::max(size.x, glm::max(size.y, size.z)));
+	}
+	context.CentroidMins[threadIndex] = centroidMin;
+	context.CentroidMaxs[threadIndex] = centroidMax;
+	context.MinPrimitiveSizes[threadIndex] = minPrimitiveSize;
+	context.Barrier.arrive_and_wait();
+
+	for (uint32_t i = 0; i < context.ThreadCount; i++)
+	{
+		centroidMin = glm::min(centroidMin, context.CentroidMins[i]);
+		centroidMax = glm::max(centroidMax, context.CentroidMaxs[i]);
+		minPrimitiveSize = glm::min(minPrimitiveSize, context.MinPrimitiveSizes[i]);
+	}
+
+	// Cells smaller than the smallest primitive don't separate anything more (e.g. voxels on a grid),
+	// but every extra bit per axis can cost a pass of the radix sort. The same scale is used on every axis, so the cells stay cubes.
+	const glm::vec3 extent = centroidMax - centroidMin;
+	const float largestExtent = glm::max(extent.x, glm::max(extent.y, extent.z));
+	uint32_t bitsPerAxis = Morton::MaxBitsPerAxis;
+	if (minPrimitiveSize > 0.0f && largestExtent / (2.0f * minPrimitiveSize) < static_cast<float>(1u << Morton::MaxBitsPerAxis))
+		bitsPerAxis = glm::max(1u, static_cast<uint32_t>(std::bit_width(static_cast<uint32_t>(std::ceil(largestExtent / (2.0f * minPrimitiveSize))))));
+	const uint32_t maxCell = (1u << bitsPerAxis) - 1;
+	const float scale = (largestExtent > 0.0f ? static_cast<float>(maxCell) / largestExtent : 0.0f);
+
+	uint64_t* codes = m_Codes[0].data();
+	uint32_t* indices = m_Indices[0].data();
+	uint64_t codeAndMask = UINT64_MAX;
+	uint64_t codeOrMask = 0;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const glm::vec3 centroid = aabbs[i].Min + aabbs[i].Max;
+		const glm::uvec3 cell = glm::uvec3(glm::clamp((centroid - centroidMin) * scale, glm::vec3(0.0f), glm::vec3(maxCell)));
+		codes[i] = Morton::Encode(cell);
+		indices[i] = i;
+		codeAndMask &= codes[i];
+		codeOrMask |= codes[i];
+	}
+	context.CodeAndMasks[threadIndex] = codeAndMask;
+	context.CodeOrMasks[threadIndex] = codeOrMask;
+	context.Barrier.arrive_and_wait();
+
+	if (bMainThread)
+	{
+		context.Timings.MortonCodes = phaseTimer.Elapsed();
+		phaseTimer.Reset();
+	}
+
+	/* RADIX SORT */
+
+	// The bits that are the same for every code don't change the order, skip the digits made only of them
+	for (uint32_t i = 0; i < context.ThreadCount; i++)
+	{
+		codeAndMask &= context.CodeAndMasks[i];
+		codeOrMask |= context.CodeOrMasks[i];
+	}
+	const uint64_t varyingBits = codeAndMask ^ codeOrMask;
+
+	uint64_t* otherCodes = m_Codes[1].data();
+	uint32_t* otherIndices = m_Indices[1].data();
+	uint32_t* histogram = m_Histograms.data() + static_cast<size_t>(threadIndex) * RadixBucketCount;
+	for (uint32_t shift = 0; shift < 64; shift += RadixBitCount)
+	{
+		if (((varyingBits >> shift) & (RadixBucketCount - 1)) == 0)
+			continue;
+
+		std::fill(histogram, histogram + RadixBucketCount, 0u);
+		for (uint32_t i = begin; i < end; i++)
+			histogram[(codes[i] >> shift) & (RadixBucketCount - 1)]++;
+		context.Barrier.arrive_and_wait();
+
+		// Turn the histograms into the first output position of each (digit, thread), in this order so the sort is stable
+		if (bMainThread)
+		{
+			uint32_t offset = 0;
+			for (uint32_t digit = 0; digit < RadixBucketCount; digit++)
+			{
+				for (uint32_t thread = 0; thread < context.ThreadCount; thread++)
+				{
+					uint32_t& count = m_Histograms[static_cast<size_t>(thread) * RadixBucketCount + digit];
+					const uint32_t threadDigitCount = count;
+					count = offset;
+					offset += threadDigitCount;
+				}
+			}
+		}
+		context.Barrier.arrive_and_wait();
+
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const uint32_t position = histogram[(codes[i] >> shift) & (RadixBucketCount - 1)]++;
+			otherCodes[position] = codes[i];
+			otherIndices[position] = indices[i];
+		}
+		context.Barrier.arrive_and_wait();
+
+		std::swap(codes, otherCodes);
+		std::swap(indices, otherIndices);
+	}
+
+	if (bMainThread)
+	{
+		context.Timings.Sort = phaseTimer.Elapsed();
+		phaseTimer.Reset();
+	}
+
+	/* HIERARCHY */
+
+	// Length of the common prefix of the keys i and j, the keys are the code followed by the position
+	// so they are all different. -1 when j is out of range.
+	auto delta = [codes, primitiveCount](uint32_t i, int64_t j) -> int32_t
+		{
+			if (j < 0 || j >= primitiveCount)
+				return (-1);
+			const uint64_t difference = codes[i] ^ codes[j];
+			if (difference == 0)
+				return (64 + std::countl_zero(i ^ static_cast<uint32_t>(j)));
+			return (std::countl_zero(difference));
+		};
+
+	// Internal node i is stored in m_InternalSlots[i], its children always in 1 + 2i and 2 + 2i
+	if (primitiveCount == 1)
+	{
+		m_LeafSlots[0] = 0;
+		m_LeafParents[0] = InvalidNode;
+	}
+	else if (bMainThread)
+	{
+		m_InternalSlots[0] = 0;
+		m_InternalParents[0] = InvalidNode;
+	}
+
+	uint32_t internalBegin, internalEnd;
+	context.GetRange(primitiveCount - 1, threadIndex, internalBegin, internalEnd);
+	for (uint32_t i = internalBegin; i < internalEnd; i++)
+	{
+		// Direction of the range of the node (toward the neighbor sharing the longest prefix)
+		const int64_t direction = (delta(i, static_cast<int64_t>(i) + 1) > delta(i, static_cast<int64_t>(i) - 1) ? 1 : -1);
+
+		// Find the other end of the range: an upper bound, then a binary search
+		const int32_t minDelta = delta(i, i - direction);
+		int64_t maxLength = 2;
+		while (delta(i, i + maxLength * direction) > minDelta)
+			maxLength *= 2;
+		int64_t length = 0;
+		for (int64_t step = maxLength / 2; step >= 1; step /= 2)
+		{
+			if (delta(i, i + (length + step) * direction) > minDelta)
+				length += step;
+		}
+		const int64_t j = i + length * direction;
+
+		// Find the split position: the last key sharing more than the node prefix with i
+		const int32_t nodeDelta = delta(i, j);
+		int64_t split = 0;
+		int64_t step = length;
+		do
+		{
+			step = (step + 1) / 2;
+			if (delta(i, i + (split + step) * direction) > nodeDelta)
+				split += step;
+		} while (step > 1);
+		const uint32_t gamma = static_cast<uint32_t>(i + split * direction + glm::min<int64_t>(direction, 0));
+
+		// The left child cover [min(i, j), gamma], the right one [gamma + 1, max(i, j)], a child covering a single key is a leaf
+		const uint32_t childSlot = 1 + 2 * i;
+		if (glm::min<int64_t>(i, j) == gamma)
+		{
+			m_LeafSlots[gamma] = childSlot;
+			m_LeafParents[gamma] = i;
+		}
+		else
+		{
+			m_InternalSlots[gamma] = childSlot;
+			m_InternalParents[gamma] = i;
+		}
+		if (glm::max<int64_t>(i, j) == gamma + 1)
+		{
+			m_LeafSlots[gamma + 1] = childSlot + 1;
+			m_LeafParents[gamma + 1] = i;
+		}
+		else
+		{
+			m_InternalSlots[gamma + 1] = childSlot + 1;
+			m_InternalParents[gamma + 1] = i;
+		}
+		m_RefitCounters[i] = 0;
+	}
+	context.Barrier.arrive_and_wait();
+
+	if (bMainThread)
+	{
+		context.Timings.Hierarchy = phaseTimer.Elapsed();
+		phaseTimer.Reset();
+	}
+
+	/* REFIT */
+
+	// Each thread write its leaves, then go up: the second child reaching a node compute its bounds, the first one stop there
+	VoxelBvhNode* nodes = outBvh.m_Nodes.data();
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const VoxelAabb& aabb = aabbs[indices[i]];
+		outBvh.m_PrimitiveIndices[i] = indices[i];
+		outBvh.m_Aabbs[i] = aabb;
+
+		VoxelBvhNode& leaf = nodes[m_LeafSlots[i]];
+		leaf.Min = aabb.Min;
+		leaf.Max = aabb.Max;
+		leaf.LeftOrFirst = i;
+		leaf.PrimitiveCount = 1;
+
+		for (uint32_t parent = m_LeafParents[i]; parent != InvalidNode; parent = m_InternalParents[parent])
+		{
+			// acq_rel: the bounds written by the other child are visible, and ours will be visible to it
+			if (std::atomic_ref<uint32_t>(m_RefitCounters[parent]).fetch_add(1, std::memory_order_acq_rel) == 0)
+				break;
+
+			const VoxelBvhNode& left = nodes[1 + 2 * parent];
+			const VoxelBvhNode& right = nodes[2 + 2 * parent];
+			VoxelBvhNode& node = nodes[m_InternalSlots[parent]];
+			node.Min = glm::min(left.Min, right.Min);
+			node.Max = glm::max(left.Max, right.Max);
+			node.LeftOrFirst = 1 + 2 * parent;
+			node.PrimitiveCount = 0;
+		}
+	}
+
+	context.Barrier.arrive_and_wait();
+
+	if (bMainThread)
+		context.Timings.Refit = phaseTimer.Elapsed();
+}
+
+void VoxelLbvhBuilder::LogBenchmark(const std::vector<uint32_t>& primitiveCounts)
+{
+	constexpr uint32_t rayCount = 1'000'000;
+	VoxelLbvhBuilder builder;
+
+	VoxelLbvhSettings settings;
+	settings.bReportToProfiler = false;
+
+	for (uint32_t primitiveCount : primitiveCounts)
+	{
+		// Same scene than VoxelBvh::LogBenchmark, so the results can be compared
+		std::mt19937 random(primitiveCount);
+		const int32_t worldSize = glm::max(1, static_cast<int32_t>(std::cbrt(static_cast<double>(primitiveCount) * 4.0)));
+		std::uniform_int_distribution<int32_t> positionDistribution(0, worldSize - 1);
+		std::uniform_real_distribution<float> directionDistribution(-1.0f, 1.0f);
+
+		std::vector<VoxelAabb> aabbs(primitiveCount);
+		for (VoxelAabb& aabb : aabbs)
+		{
+			const glm::vec3 center(positionDistribution(random), positionDistribution(random), positionDistribution(random));
+			aabb = VoxelAabb{ center - 0.5f, center + 0.5f };
+		}
+
+		// The first build allocate the scratch memory, only the second one is measured (like a rebuild every frame)
+		VoxelBvh bvh;
+		builder.Build(aabbs, bvh, settings);
+		builder.Build(aabbs, bvh, settings);
+		const VoxelLbvhTimings& timings = builder.GetLastTimings();
+
+		std::vector<VoxelRay> rays(rayCount);
+		for (VoxelRay& ray : rays)
+		{
+			ray.Origin = glm::vec3(positionDistribution(random), positionDistribution(random), positionDistribution(random));
+			ray.Direction = glm::vec3(directionDistribution(random), directionDistribution(random), directionDistribution(random));
+		}
+
+		uint32_t hitCount = 0;
+		START_NAMED_TIMER(TraversalTimer);
+		for (const VoxelRay& ray : rays)
+		{
+			VoxelBvhHit hit;
+			hitCount += (bvh.Raycast(ray, hit) ? 1 : 0);
+		}
+		STOP_NAMED_TIMER(TraversalTimer);
+
+		const double traversalMs = TO_DOUBLE_MILLISECONDS(TIMER_NAMED_RESULT(TraversalTimer));
+		VOXEL_LOG(Display, "LBVH {:d} boxes: build {:.2f}ms (morton {:.2f}ms, sort {:.2f}ms, hierarchy {:.2f}ms, refit {:.2f}ms), SAH cost {:.1f}, {:s}, traversal {:.2f} Mrays/s ({:d}/{:d} hits)",
+			primitiveCount, TO_DOUBLE_MILLISECONDS(timings.GetTotal()),
+			TO_DOUBLE_MILLISECONDS(timings.MortonCodes), TO_DOUBLE_MILLISECONDS(timings.Sort),
+			TO_DOUBLE_MILLISECONDS(timings.Hierarchy), TO_DOUBLE_MILLISECONDS(timings.Refit),
+			bvh.CalculateSahCost(), bvh.Validate() ? "valid" : "INVALID",
+			traversalMs > 0.0 ? static_cast<double>(rayCount) / (traversalMs * 1000.0) : 0.0, hitCount, rayCount
+		);
+	}
+}
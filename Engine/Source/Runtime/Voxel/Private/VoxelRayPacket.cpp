@@ -0,0 +1,382 @@
+#include "VoxelRayPacket.h"
+#include "VoxelGlobals.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <array>
+#include <bit>
+#include <random>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+# define WITH_X86_SIMD 1
+# include <immintrin.h>
+# if defined(_MSC_VER)
+#  include <intrin.h>
+// MSVC can emit any intrinsic without changing the compiler flags
+#  define TARGET_SSE41
+#  define TARGET_AVX2
+# else
+#  include <cpuid.h>
+// GCC and Clang only allow the intrinsics of the instruction sets enabled for the function
+#  define TARGET_SSE41 __attribute__((target("sse4.1")))
+#  define TARGET_AVX2 __attribute__((target("avx2")))
+# endif
+#else
+# define WITH_X86_SIMD 0
+#endif
+
+const char* SimdIsa::ToString(Type isa)
+{
+	switch (isa)
+	{
+	case Scalar: return ("Scalar");
+	case Sse41: return ("SSE4.1");
+	case Avx2: return ("AVX2");
+	default: return ("Unknown");
+	}
+}
+
+/** Reference implementation, one slab test after the other */
+struct ScalarRayPacketKernels
+{
+	template<uint32_t Width>
+	static uint32_t IntersectRays(const TVoxelRayPacket<Width>& rays, const VoxelAabb& aabb, float* outDistances)
+	{
+		uint32_t hitMask = 0;
+		for (uint32_t i = 0; i < Width; i++)
+		{
+			const glm::vec3 origin(rays.OriginX[i], rays.OriginY[i], rays.OriginZ[i]);
+			const glm::vec3 inverseDirection(rays.InverseDirectionX[i], rays.InverseDirectionY[i], rays.InverseDirectionZ[i]);
+
+			float distance;
+			const bool bHit = IntersectRayAabb(origin, inverseDirection, aabb.Min, aabb.Max, rays.MaxDistance[i], distance);
+			hitMask |= (bHit ? 1u : 0u) << i;
+			outDistances[i] = (bHit ? distance : FLT_MAX);
+		}
+		return (hitMask);
+	}
+
+	template<uint32_t Width>
+	static uint32_t IntersectAabbs(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const TVoxelAabbPacket<Width>& aabbs, float* outDistances)
+	{
+		uint32_t hitMask = 0;
+		for (uint32_t i = 0; i < Width; i++)
+		{
+			const glm::vec3 aabbMin(aabbs.MinX[i], aabbs.MinY[i], aabbs.MinZ[i]);
+			const glm::vec3 aabbMax(aabbs.MaxX[i], aabbs.MaxY[i], aabbs.MaxZ[i]);
+
+			float distance;
+			const bool bHit = IntersectRayAabb(origin, inverseDirection, aabbMin, aabbMax, maxDistance, distance);
+			hitMask |= (bHit ? 1u : 0u) << i;
+			outDistances[i] = (bHit ? distance : FLT_MAX);
+		}
+		return (hitMask);
+	}
+};
+
+#if WITH_X86_SIMD
+
+/**
+ * 4 slab tests at once. The operations are done in the same order as IntersectRayAabb,
+ * so the distances are exactly the same as the scalar version.
+ */
+struct Sse41RayPacketKernels
+{
+	TARGET_SSE41 static __forceinline uint32_t SlabTest(
+		__m128 originX, __m128 originY, __m128 originZ,
+		__m128 inverseDirectionX, __m128 inverseDirectionY, __m128 inverseDirectionZ, __m128 maxDistance,
+		__m128 minX, __m128 minY, __m128 minZ, __m128 maxX, __m128 maxY, __m128 maxZ,
+		float* outDistances)
+	{
+		const __m128 t0X = _mm_mul_ps(_mm_sub_ps(minX, originX), inverseDirectionX);
+		const __m128 t0Y = _mm_mul_ps(_mm_sub_ps(minY, originY), inverseDirectionY);
+		const __m128 t0Z = _mm_mul_ps(_mm_sub_ps(minZ, originZ), inverseDirectionZ);
+		const __m128 t1X = _mm_mul_ps(_mm_sub_ps(maxX, originX), inverseDirectionX);
+		const __m128 t1Y = _mm_mul_ps(_mm_sub_ps(maxY, originY), inverseDirectionY);
+		const __m128 t1Z = _mm_mul_ps(_mm_sub_ps(maxZ, originZ), inverseDirectionZ);
+
+		const __m128 tEnter = _mm_max_ps(
+			_mm_max_ps(_mm_min_ps(t0X, t1X), _mm_min_ps(t0Y, t1Y)),
+			_mm_max_ps(_mm_min_ps(t0Z, t1Z), _mm_setzero_ps())
+		);
+		const __m128 tExit = _mm_min_ps(
+			_mm_min_ps(_mm_max_ps(t0X, t1X), _mm_max_ps(t0Y, t1Y)),
+			_mm_min_ps(_mm_max_ps(t0Z, t1Z), maxDistance)
+		);
+
+		const __m128 hit = _mm_cmple_ps(tEnter, tExit);
+		_mm_storeu_ps(outDistances, _mm_blendv_ps(_mm_set1_ps(FLT_MAX), tEnter, hit));
+		return (static_cast<uint32_t>(_mm_movemask_ps(hit)));
+	}
+
+	TARGET_SSE41 static uint32_t IntersectRays4(const VoxelRayPacket4& rays, const VoxelAabb& aabb, float* outDistances)
+	{
+		return (SlabTest(
+			_mm_load_ps(rays.OriginX), _mm_load_ps(rays.OriginY), _mm_load_ps(rays.OriginZ),
+			_mm_load_ps(rays.InverseDirectionX), _mm_load_ps(rays.InverseDirectionY), _mm_load_ps(rays.InverseDirectionZ),
+			_mm_load_ps(rays.MaxDistance),
+			_mm_set1_ps(aabb.Min.x), _mm_set1_ps(aabb.Min.y), _mm_set1_ps(aabb.Min.z),
+			_mm_set1_ps(aabb.Max.x), _mm_set1_ps(aabb.Max.y), _mm_set1_ps(aabb.Max.z),
+			outDistances
+		));
+	}
+
+	TARGET_SSE41 static uint32_t IntersectRays8(const VoxelRayPacket8& rays, const VoxelAabb& aabb, float* outDistances)
+	{
+		// Two halves of 4 rays
+		uint32_t hitMask = 0;
+		for (uint32_t half = 0; half < 8; half += 4)
+		{
+			hitMask |= SlabTest(
+				_mm_load_ps(rays.OriginX + half), _mm_load_ps(rays.OriginY + half), _mm_load_ps(rays.OriginZ + half),
+				_mm_load_ps(rays.InverseDirectionX + half), _mm_load_ps(rays.InverseDirectionY + half), _mm_load_ps(rays.InverseDirectionZ + half),
+				_mm_load_ps(rays.MaxDistance + half),
+				_mm_set1_ps(aabb.Min.x), _mm_set1_ps(aabb.Min.y), _mm_set1_ps(aabb.Min.z),
+				_mm_set1_ps(aabb.Max.x), _mm_set1_ps(aabb.Max.y), _mm_set1_ps(aabb.Max.z),
+				outDistances + half
+			) << half;
+		}
+		return (hitMask);
+	}
+
+	TARGET_SSE41 static uint32_t IntersectAabbs4(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const VoxelAabbPacket4& aabbs, float* outDistances)
+	{
+		return (SlabTest(
+			_mm_set1_ps(origin.x), _mm_set1_ps(origin.y), _mm_set1_ps(origin.z),
+			_mm_set1_ps(inverseDirection.x), _mm_set1_ps(inverseDirection.y), _mm_set1_ps(inverseDirection.z),
+			_mm_set1_ps(maxDistance),
+			_mm_load_ps(aabbs.MinX), _mm_load_ps(aabbs.MinY), _mm_load_ps(aabbs.MinZ),
+			_mm_load_ps(aabbs.MaxX), _mm_load_ps(aabbs.MaxY), _mm_load_ps(aabbs.MaxZ),
+			outDistances
+		));
+	}
+
+	TARGET_SSE41 static uint32_t IntersectAabbs8(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const VoxelAabbPacket8& aabbs, float* outDistances)
+	{
+		uint32_t hitMask = 0;
+		for (uint32_t half = 0; half < 8; half += 4)
+		{
+			hitMask |= SlabTest(
+				_mm_set1_ps(origin.x), _mm_set1_ps(origin.y), _mm_set1_ps(origin.z),
+				_mm_set1_ps(inverseDirection.x), _mm_set1_ps(inverseDirection.y), _mm_set1_ps(inverseDirection.z),
+				_mm_set1_ps(maxDistance),
+				_mm_load_ps(aabbs.MinX + half), _mm_load_ps(aabbs.MinY + half), _mm_load_ps(aabbs.MinZ + half),
+				_mm_load_ps(aabbs.MaxX + half), _mm_load_ps(aabbs.MaxY + half), _mm_load_ps(aabbs.MaxZ + half),
+				outDistances + half
+			) << half;
+		}
+		return (hitMask);
+	}
+};
+
+/** 8 slab tests at once, the 4 wide kernels are the SSE4.1 ones (an AVX2 CPU always support SSE4.1) */
+struct Avx2RayPacketKernels
+{
+	TARGET_AVX2 static __forceinline uint32_t SlabTest(
+		__m256 originX, __m256 originY, __m256 originZ,
+		__m256 inverseDirectionX, __m256 inverseDirectionY, __m256 inverseDirectionZ, __m256 maxDistance,
+		__m256 minX, __m256 minY, __m256 minZ, __m256 maxX, __m256 maxY, __m256 maxZ,
+		float* outDistances)
+	{
+		const __m256 t0X = _mm256_mul_ps(_mm256_sub_ps(minX, originX), inverseDirectionX);
+		const __m256 t0Y = _mm256_mul_ps(_mm256_sub_ps(minY, originY), inverseDirectionY);
+		const __m256 t0Z = _mm256_mul_ps(_mm256_sub_ps(minZ, originZ), inverseDirectionZ);
+		const __m256 t1X = _mm256_mul_ps(_mm256_sub_ps(maxX, originX), inverseDirectionX);
+		const __m256 t1Y = _mm256_mul_ps(_mm256_sub_ps(maxY, originY), inverseDirectionY);
+		const __m256 t1Z = _mm256_mul_ps(_mm256_sub_ps(maxZ, originZ), inverseDirectionZ);
+
+		const __m256 tEnter = _mm256_max_ps(
+			_mm256_max_ps(_mm256_min_ps(t0X, t1X), _mm256_min_ps(t0Y, t1Y)),
+			_mm256_max_ps(_mm256_min_ps(t0Z, t1Z), _mm256_setzero_ps())
+		);
+		const __m256 tExit = _mm256_min_ps(
+			_mm256_min_ps(_mm256_max_ps(t0X, t1X), _mm256_max_ps(t0Y, t1Y)),
+			_mm256_min_ps(_mm256_max_ps(t0Z, t1Z), maxDistance)
+		);
+
+		const __m256 hit = _mm256_cmp_ps(tEnter, tExit, _CMP_LE_OQ);
+		_mm256_storeu_ps(outDistances, _mm256_blendv_ps(_mm256_set1_ps(FLT_MAX), tEnter, hit));
+		return (static_cast<uint32_t>(_mm256_movemask_ps(hit)));
+	}
+
+	TARGET_AVX2 static uint32_t IntersectRays8(const VoxelRayPacket8& rays, const VoxelAabb& aabb, float* outDistances)
+	{
+		return (SlabTest(
+			_mm256_load_ps(rays.OriginX), _mm256_load_ps(rays.OriginY), _mm256_load_ps(rays.OriginZ),
+			_mm256_load_ps(rays.InverseDirectionX), _mm256_load_ps(rays.InverseDirectionY), _mm256_load_ps(rays.InverseDirectionZ),
+			_mm256_load_ps(rays.MaxDistance),
+			_mm256_set1_ps(aabb.Min.x), _mm256_set1_ps(aabb.Min.y), _mm256_set1_ps(aabb.Min.z),
+			_mm256_set1_ps(aabb.Max.x), _mm256_set1_ps(aabb.Max.y), _mm256_set1_ps(aabb.Max.z),
+			outDistances
+		));
+	}
+
+	TARGET_AVX2 static uint32_t IntersectAabbs8(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const VoxelAabbPacket8& aabbs, float* outDistances)
+	{
+		return (SlabTest(
+			_mm256_set1_ps(origin.x), _mm256_set1_ps(origin.y), _mm256_set1_ps(origin.z),
+			_mm256_set1_ps(inverseDirection.x), _mm256_set1_ps(inverseDirection.y), _mm256_set1_ps(inverseDirection.z),
+			_mm256_set1_ps(maxDistance),
+			_mm256_load_ps(aabbs.MinX), _mm256_load_ps(aabbs.MinY), _mm256_load_ps(aabbs.MinZ),
+			_mm256_load_ps(aabbs.MaxX), _mm256_load_ps(aabbs.MaxY), _mm256_load_ps(aabbs.MaxZ),
+			outDistances
+		));
+	}
+};
+
+#endif // WITH_X86_SIMD
+
+#pragma region API - Static
+const VoxelRayPacketKernels& VoxelRayPacketKernels::Get()
+{
+	static const VoxelRayPacketKernels& s_BestKernels = Get(GetBestIsa());
+	return (s_BestKernels);
+}
+
+const VoxelRayPacketKernels& VoxelRayPacketKernels::Get(SimdIsa::Type isa)
+{
+	static const std::array<VoxelRayPacketKernels, SimdIsa::Count> s_Kernels = {
+		VoxelRayPacketKernels{
+			&ScalarRayPacketKernels::IntersectRays<4>,
+			&ScalarRayPacketKernels::IntersectRays<8>,
+			&ScalarRayPacketKernels::IntersectAabbs<4>,
+			&ScalarRayPacketKernels::IntersectAabbs<8>,
+			SimdIsa::Scalar
+		},
+#if WITH_X86_SIMD
+		VoxelRayPacketKernels{
+			&Sse41RayPacketKernels::IntersectRays4,
+			&Sse41RayPacketKernels::IntersectRays8,
+			&Sse41RayPacketKernels::IntersectAabbs4,
+			&Sse41RayPacketKernels::IntersectAabbs8,
+			SimdIsa::Sse41
+		},
+		VoxelRayPacketKernels{
+			&Sse41RayPacketKernels::IntersectRays4,
+			&Avx2RayPacketKernels::IntersectRays8,
+			&Sse41RayPacketKernels::IntersectAabbs4,
+			&Avx2RayPacketKernels::IntersectAabbs8,
+			SimdIsa::Avx2
+		},
+#endif // WITH_X86_SIMD
+	};
+
+	CHECK(isa <= GetBestIsa());
+	return (s_Kernels[isa]);
+}
+
+SimdIsa::Type VoxelRayPacketKernels::GetBestIsa()
+{
+	static const SimdIsa::Type s_BestIsa = []()
+		{
+#if WITH_X86_SIMD
+			uint32_t registers[4] = { 0, 0, 0, 0 }; // eax, ebx, ecx, edx
+			uint32_t extendedRegisters[4] = { 0, 0, 0, 0 };
+# if defined(_MSC_VER)
+			__cpuid(reinterpret_cast<int*>(registers), 1);
+			__cpuidex(reinterpret_cast<int*>(extendedRegisters), 7, 0);
+# else
+			__get_cpuid(1, &registers[0], &registers[1], &registers[2], &registers[3]);
+			__get_cpuid_count(7, 0, &extendedRegisters[0], &extendedRegisters[1], &extendedRegisters[2], &extendedRegisters[3]);
+# endif
+			const bool bHasSse41 = (registers[2] & (1u << 19)) != 0;
+			const bool bHasOsxsave = (registers[2] & (1u << 27)) != 0;
+			const bool bHasAvx = (registers[2] & (1u << 28)) != 0;
+			const bool bHasAvx2 = (extendedRegisters[1] & (1u << 5)) != 0;
+
+			// The OS must save the YMM registers on context switch, otherwise AVX can't be used
+			bool bOsSupportAvx = false;
+			if (bHasOsxsave)
+			{
+# if defined(_MSC_VER)
+				const uint64_t xcr0 = _xgetbv(0);
+# else
+				uint32_t xcr0Low, xcr0High;
+				__asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+				const uint64_t xcr0 = (static_cast<uint64_t>(xcr0High) << 32) | xcr0Low;
+# endif
+				bOsSupportAvx = (xcr0 & 0x6) == 0x6;
+			}
+
+			if (bHasAvx && bHasAvx2 && bOsSupportAvx && bHasSse41)
+				return (SimdIsa::Avx2);
+			if (bHasSse41)
+				return (SimdIsa::Sse41);
+#endif // WITH_X86_SIMD
+			return (SimdIsa::Scalar);
+		}();
+
+	return (s_BestIsa);
+}
+
+void VoxelRayPacketKernels::LogBenchmark(uint32_t iterationCount)
+{
+	// Random rays starting around the origin, and random boxes around them, so roughly half the tests are hits
+	constexpr uint32_t packetCount = 256;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+	auto randomVector = [&]() { return (glm::vec3(distribution(random), distribution(random), distribution(random))); };
+	auto randomAabb = [&]()
+		{
+			const glm::vec3 center = randomVector();
+			return (VoxelAabb{ center - 2.0f, center + 2.0f });
+		};
+
+	std::vector<VoxelRayPacket4> rayPackets4(packetCount);
+	std::vector<VoxelRayPacket8> rayPackets8(packetCount);
+	std::vector<VoxelAabbPacket4> aabbPackets4(packetCount);
+	std::vector<VoxelAabbPacket8> aabbPackets8(packetCount);
+	std::vector<VoxelAabb> aabbs(packetCount);
+	std::vector<VoxelRay> rays(packetCount);
+	std::vector<glm::vec3> inverseDirections(packetCount);
+	for (uint32_t packet = 0; packet < packetCount; packet++)
+	{
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			const VoxelRay ray{ randomVector() * 0.1f, randomVector() };
+			const VoxelAabb aabb = randomAabb();
+			if (i < 4)
+			{
+				rayPackets4[packet].SetRay(i, ray);
+				aabbPackets4[packet].SetAabb(i, aabb);
+			}
+			rayPackets8[packet].SetRay(i, ray);
+			aabbPackets8[packet].SetAabb(i, aabb);
+		}
+		aabbs[packet] = randomAabb();
+		rays[packet] = VoxelRay{ randomVector() * 0.1f, randomVector() };
+		inverseDirections[packet] = ComputeInverseDirection(rays[packet].Direction);
+	}
+
+	alignas(32) float distances[8];
+	for (uint32_t isa = 0; isa <= GetBestIsa(); isa++)
+	{
+		const VoxelRayPacketKernels& kernels = Get(static_cast<SimdIsa::Type>(isa));
+
+		// Run a kernel on all the packets iterationCount times, and log the number of ray-box tests per second
+		auto benchmark = [&](const char* kernelName, uint32_t width, auto&& kernel)
+			{
+				uint32_t hitCount = 0;
+				START_TIMER;
+				for (uint32_t iteration = 0; iteration < iterationCount; iteration++)
+				{
+					for (uint32_t packet = 0; packet < packetCount; packet++)
+						hitCount += std::popcount(kernel(packet));
+				}
+				STOP_TIMER;
+
+				const double elapsedSeconds = TO_DOUBLE_MILLISECONDS(TIMER_RESULT) * 0.001;
+				const double testCount = static_cast<double>(iterationCount) * packetCount * width;
+				VOXEL_LOG(Display, "[{:s}] {:s}: {:.1f} M tests/s ({:d} hits)",
+					SimdIsa::ToString(kernels.Isa), kernelName,
+					elapsedSeconds > 0.0 ? testCount / elapsedSeconds * 1e-6 : 0.0, hitCount
+				);
+			};
+
+		benchmark("4 rays x 1 AABB", 4, [&](uint32_t packet) { return (kernels.IntersectRays4(rayPackets4[packet], aabbs[packet], distances)); });
+		benchmark("8 rays x 1 AABB", 8, [&](uint32_t packet) { return (kernels.IntersectRays8(rayPackets8[packet], aabbs[packet], distances)); });
+		benchmark("1 ray x 4 AABBs", 4, [&](uint32_t packet) { return (kernels.IntersectAabbs4(rays[packet].Origin, inverseDirections[packet], FLT_MAX, aabbPackets4[packet], distances)); });
+		benchmark("1 ray x 8 AABBs", 8, [&](uint32_t packet) { return (kernels.IntersectAabbs8(rays[packet].Origin, inverseDirections[packet], FLT_MAX, aabbPackets8[packet], distances)); });
+	}
+}
+#pragma endregion
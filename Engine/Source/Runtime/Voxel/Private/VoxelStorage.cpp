@@ -0,0 +1,268 @@
+#include "VoxelStorage.h"
+#include "VoxelGlobals.h"
+#include "VoxelTerrain.h"
+#include "Profiling/ProfilingMacros.h"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+namespace
+{
+	/** Where a benchmark access happens: a chunk, and a position in it */
+	struct StorageBenchmarkAccess
+	{
+		uint32_t Chunk;
+		glm::ivec3 Position;
+	};
+
+	/** What StorageBenchmark measured on a storage, the times are per voxel */
+	struct StorageBenchmarkResult
+	{
+		size_t ChunkCount = 0;
+		size_t MemoryUsage = 0;
+		double RandomReadNs = 0.0;
+		double SequentialReadNs = 0.0;
+		double RandomWriteNs = 0.0;
+		/** Sum of the voxels read, the same for every storage of the same world */
+		uint64_t Checksum = 0;
+	};
+
+	template<typename TStorage>
+	StorageBenchmarkResult StorageBenchmark(const std::function<void(TVoxelWorld<TStorage>&)>& generate, const std::vector<StorageBenchmarkAccess>& accesses)
+	{
+		TVoxelWorld<TStorage> world;
+		generate(world);
+		world.Compact();
+
+		// Copy the chunks in an array, so only the storage is measured (not the lookup of the chunks)
+		std::vector<TVoxelChunk<TStorage>> chunks;
+		chunks.reserve(world.GetChunkCount());
+		for (const auto& [coordinate, chunk] : world.GetChunks())
+			chunks.push_back(*chunk);
+
+		StorageBenchmarkResult result;
+		result.ChunkCount = chunks.size();
+		for (const TVoxelChunk<TStorage>& chunk : chunks)
+			result.MemoryUsage += chunk.GetMemoryUsage();
+
+		START_NAMED_TIMER(RandomReadTimer);
+		for (const StorageBenchmarkAccess& access : accesses)
+			result.Checksum += chunks[access.Chunk % chunks.size()].GetVoxel(access.Position);
+		STOP_NAMED_TIMER(RandomReadTimer);
+
+		START_NAMED_TIMER(SequentialReadTimer);
+		for (const TVoxelChunk<TStorage>& chunk : chunks)
+		{
+			for (int32_t i = 0; i < VoxelChunkDimension::Volume; i++)
+				result.Checksum += chunk.GetStorage().Get(i);
+		}
+		STOP_NAMED_TIMER(SequentialReadTimer);
+
+		// Move voxels that are already in the chunk, so the palette doesn't grow during the measure
+		START_NAMED_TIMER(RandomWriteTimer);
+		for (size_t i = 1; i < accesses.size(); i++)
+		{
+			TVoxelChunk<TStorage>& chunk = chunks[accesses[i].Chunk % chunks.size()];
+			chunk.SetVoxel(accesses[i].Position, chunk.GetVoxel(accesses[i - 1].Position));
+		}
+		STOP_NAMED_TIMER(RandomWriteTimer);
+
+		const double sequentialCount = static_cast<double>(chunks.size()) * VoxelChunkDimension::Volume;
+		result.RandomReadNs = static_cast<double>(TO_NANOSECONDS(TIMER_NAMED_RESULT(RandomReadTimer))) / accesses.size();
+		result.SequentialReadNs = static_cast<double>(TO_NANOSECONDS(TIMER_NAMED_RESULT(SequentialReadTimer))) / sequentialCount;
+		result.RandomWriteNs = static_cast<double>(TO_NANOSECONDS(TIMER_NAMED_RESULT(RandomWriteTimer))) / accesses.size();
+		return (result);
+	}
+}
+
+void PaletteVoxelStorage::Set(int32_t index, VoxelId voxel)
+{
+	const uint32_t previousPaletteIndex = GetPaletteIndex(index);
+	if (m_Palette[previousPaletteIndex] == voxel)
+		return;
+
+	const uint32_t newPaletteIndex = FindOrAddPaletteEntry(voxel);
+
+	m_ReferenceCounts[previousPaletteIndex]--;
+	m_ReferenceCounts[newPaletteIndex]++;
+	SetPaletteIndex(index, newPaletteIndex);
+}
+
+void PaletteVoxelStorage::Fill(VoxelId voxel)
+{
+	m_Palette.assign(1, voxel);
+	m_ReferenceCounts.assign(1, VoxelChunkDimension::Volume);
+
+	// With a single entry in the palette we don't need any index at all
+	m_BitsPerIndex = 0;
+	m_Indices.clear();
+	m_Indices.shrink_to_fit();
+}
+
+void PaletteVoxelStorage::Compact()
+{
+	// Map each used entry to its new index, and build the new palette
+	std::vector<uint32_t> remap(m_Palette.size(), 0);
+	std::vector<VoxelId> newPalette;
+	std::vector<uint32_t> newReferenceCounts;
+	newPalette.reserve(m_Palette.size());
+	newReferenceCounts.reserve(m_Palette.size());
+
+	for (uint32_t i = 0; i < m_Palette.size(); i++)
+	{
+		if (m_ReferenceCounts[i] == 0)
+			continue;
+		remap[i] = static_cast<uint32_t>(newPalette.size());
+		newPalette.push_back(m_Palette[i]);
+		newReferenceCounts.push_back(m_ReferenceCounts[i]);
+	}
+
+	const uint8_t newBitsPerIndex = CalculateBitsPerIndex(newPalette.size());
+	if (newPalette.size() != m_Palette.size() || newBitsPerIndex != m_BitsPerIndex)
+		Repack(newBitsPerIndex, remap);
+
+	m_Palette = std::move(newPalette);
+	m_ReferenceCounts = std::move(newReferenceCounts);
+}
+
+size_t PaletteVoxelStorage::GetMemoryUsage() const
+{
+	return (
+		sizeof(*this)
+		+ m_Palette.capacity() * sizeof(VoxelId)
+		+ m_ReferenceCounts.capacity() * sizeof(uint32_t)
+		+ m_Indices.capacity() * sizeof(WordType)
+	);
+}
+
+void PaletteVoxelStorage::SetPaletteIndex(int32_t index, uint32_t paletteIndex)
+{
+	if (m_BitsPerIndex == 0)
+		return;
+
+	const uint32_t bitOffset = static_cast<uint32_t>(index) * m_BitsPerIndex;
+	const uint32_t shift = bitOffset % WordBitCount;
+	const WordType mask = ((WordType(1) << m_BitsPerIndex) - 1) << shift;
+
+	WordType& word = m_Indices[bitOffset / WordBitCount];
+	word = (word & ~mask) | ((static_cast<WordType>(paletteIndex) << shift) & mask);
+}
+
+uint32_t PaletteVoxelStorage::FindOrAddPaletteEntry(VoxelId voxel)
+{
+	// Palettes are expected to be small (most of the chunks have less than 16 materials)
+	// so a linear search is faster than a hash map here
+	auto paletteIt = std::find(m_Palette.begin(), m_Palette.end(), voxel);
+	if (paletteIt != m_Palette.end())
+		return (static_cast<uint32_t>(paletteIt - m_Palette.begin()));
+
+	// Reuse an entry that is not referenced anymore
+	auto unusedIt = std::find(m_ReferenceCounts.begin(), m_ReferenceCounts.end(), 0u);
+	if (unusedIt != m_ReferenceCounts.end())
+	{
+		const uint32_t paletteIndex = static_cast<uint32_t>(unusedIt - m_ReferenceCounts.begin());
+		m_Palette[paletteIndex] = voxel;
+		return (paletteIndex);
+	}
+
+	m_Palette.push_back(voxel);
+	m_ReferenceCounts.push_back(0);
+
+	const uint8_t requiredBitsPerIndex = CalculateBitsPerIndex(m_Palette.size());
+	if (requiredBitsPerIndex > m_BitsPerIndex)
+		Repack(requiredBitsPerIndex);
+
+	return (static_cast<uint32_t>(m_Palette.size() - 1));
+}
+
+void PaletteVoxelStorage::Repack(uint8_t newBitsPerIndex, const std::vector<uint32_t>& remap)
+{
+	CHECK(newBitsPerIndex <= MaxBitsPerIndex);
+
+	std::vector<WordType> newIndices(
+		(static_cast<size_t>(VoxelChunkDimension::Volume) * newBitsPerIndex + WordBitCount - 1) / WordBitCount,
+		0
+	);
+
+	if (newBitsPerIndex > 0)
+	{
+		for (int32_t i = 0; i < VoxelChunkDimension::Volume; i++)
+		{
+			uint32_t paletteIndex = GetPaletteIndex(i);
+			if (remap.empty() == false)
+				paletteIndex = remap[paletteIndex];
+
+			const uint32_t bitOffset = static_cast<uint32_t>(i) * newBitsPerIndex;
+			newIndices[bitOffset / WordBitCount] |= static_cast<WordType>(paletteIndex) << (bitOffset % WordBitCount);
+		}
+	}
+
+	m_Indices = std::move(newIndices);
+	m_BitsPerIndex = newBitsPerIndex;
+}
+
+uint8_t PaletteVoxelStorage::CalculateBitsPerIndex(size_t paletteSize)
+{
+	uint8_t bitsPerIndex = 0;
+	while ((size_t(1) << bitsPerIndex) < paletteSize)
+		bitsPerIndex = (bitsPerIndex == 0 ? 1 : bitsPerIndex * 2);
+	return (bitsPerIndex);
+}
+
+void PaletteVoxelStorage::LogBenchmark(int32_t chunkRadius)
+{
+	constexpr uint32_t accessCount = 1 << 22;
+
+	std::mt19937 random(42);
+	std::uniform_int_distribution<uint32_t> chunkDistribution;
+	std::uniform_int_distribution<int32_t> positionDistribution(0, VoxelChunkDimension::Size - 1);
+	std::vector<StorageBenchmarkAccess> accesses(accessCount);
+	for (StorageBenchmarkAccess& access : accesses)
+		access = StorageBenchmarkAccess{ chunkDistribution(random), glm::ivec3(positionDistribution(random), positionDistribution(random), positionDistribution(random)) };
+
+	const int32_t radius = chunkRadius * VoxelChunkDimension::Size;
+	auto logResults = [](const char* worldName, const StorageBenchmarkResult& dense, const StorageBenchmarkResult& palette)
+		{
+			VOXEL_LOG(Display, "{:s}, {:d} chunks: dense {:.2f}MB, palette {:.2f}MB ({:.1f}x less)",
+				worldName, dense.ChunkCount, dense.MemoryUsage / (1024.0 * 1024.0), palette.MemoryUsage / (1024.0 * 1024.0),
+				palette.MemoryUsage > 0 ? static_cast<double>(dense.MemoryUsage) / palette.MemoryUsage : 0.0
+			);
+			VOXEL_LOG(Display, "{:s}: random read {:.2f}ns / {:.2f}ns, sequential read {:.2f}ns / {:.2f}ns, random write {:.2f}ns / {:.2f}ns (dense / palette, per voxel){:s}",
+				worldName, dense.RandomReadNs, palette.RandomReadNs, dense.SequentialReadNs, palette.SequentialReadNs,
+				dense.RandomWriteNs, palette.RandomWriteNs,
+				dense.Checksum == palette.Checksum ? "" : ", the storages DON'T READ THE SAME VOXELS"
+			);
+		};
+
+	// Few materials, the palette indices are 2 bits wide
+	{
+		auto generateTerrain = [radius](auto& world) { VoxelTerrain::Generate(world, radius); };
+		logResults("Terrain",
+			StorageBenchmark<DenseVoxelStorage>(generateTerrain, accesses),
+			StorageBenchmark<PaletteVoxelStorage>(generateTerrain, accesses)
+		);
+	}
+
+	// The same hills made of 256 random materials, the palette indices are 16 bits wide (257 entries with the empty voxel)
+	{
+		auto generateNoise = [radius](auto& world)
+			{
+				std::mt19937 noiseRandom(7);
+				std::uniform_int_distribution<uint32_t> voxelDistribution(1, 256);
+				for (int32_t z = -radius; z < radius; z++)
+				{
+					for (int32_t x = -radius; x < radius; x++)
+					{
+						const int32_t height = VoxelTerrain::GetHeight(x, z);
+						for (int32_t y = 0; y <= height; y++)
+							world.SetVoxel(glm::ivec3(x, y, z), static_cast<VoxelId>(voxelDistribution(noiseRandom)));
+					}
+				}
+			};
+		logResults("Noise",
+			StorageBenchmark<DenseVoxelStorage>(generateNoise, accesses),
+			StorageBenchmark<PaletteVoxelStorage>(generateNoise, accesses)
+		);
+	}
+}
@@ -0,0 +1,45 @@
+#include "VoxelTerrain.h"
+
+#include <random>
+
+namespace
+{
+	int32_t TriangleWave(int32_t value, int32_t period)
+	{
+		const int32_t phase = ((value % period) + period) % period;
+		return (phase < period / 2 ? phase : period - phase);
+	}
+}
+
+int32_t VoxelTerrain::GetHeight(int32_t x, int32_t z)
+{
+	return (8 + TriangleWave(x, 48) / 2 + TriangleWave(z + 2 * x, 80) / 3);
+}
+
+std::vector<VoxelRay> VoxelTerrain::GenerateRays(int32_t radius, uint32_t rayCount, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> positionDistribution(static_cast<float>(-radius), static_cast<float>(radius));
+	std::uniform_real_distribution<float> directionDistribution(-1.0f, 1.0f);
+
+	// Above the highest hill, 8 + 24 / 2 + 40 / 3
+	constexpr float originHeight = 40.0f;
+
+	std::vector<VoxelRay> rays(rayCount);
+	for (VoxelRay& ray : rays)
+	{
+		ray.Origin = glm::vec3(positionDistribution(random), originHeight, positionDistribution(random));
+		ray.Direction = glm::normalize(glm::vec3(directionDistribution(random), -1.0f, directionDistribution(random)));
+	}
+	return (rays);
+}
+
+glm::ivec2 VoxelTerrain::GetEditColumn(int32_t radius, uint32_t editIndex)
+{
+	// Integer hash (Knuth multiplicative, then xorshift), the same columns on every platform
+	uint32_t hash = editIndex * 2654435761u;
+	hash ^= hash >> 16;
+
+	const uint32_t width = static_cast<uint32_t>(radius) * 2;
+	return (glm::ivec2(-radius + static_cast<int32_t>(hash % width), -radius + static_cast<int32_t>((hash / width) % width)));
+}
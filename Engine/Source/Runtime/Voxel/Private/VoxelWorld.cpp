@@ -0,0 +1,241 @@
+#include "VoxelWorld.h"
+#include "VoxelGlobals.h"
+
+#include <format>
+#include <string_view>
+#include <type_traits>
+
+template<typename TStorage>
+VoxelId TVoxelWorld<TStorage>::GetVoxel(const glm::ivec3& position) const
+{
+	const ChunkType* chunk = FindChunk(ToChunkCoordinate(position));
+	if (chunk == nullptr)
+		return (EmptyVoxel);
+	return (chunk->GetVoxel(ToLocalPosition(position)));
+}
+
+template<typename TStorage>
+VoxelId TVoxelWorld<TStorage>::SetVoxel(const glm::ivec3& position, VoxelId voxel)
+{
+	const ChunkCoordinate coordinate = ToChunkCoordinate(position);
+
+	auto chunkIt = m_Chunks.find(coordinate);
+	if (chunkIt == m_Chunks.end())
+	{
+		// No need to create a chunk to store air
+		if (voxel == EmptyVoxel)
+			return (EmptyVoxel);
+		chunkIt = m_Chunks.emplace(coordinate, std::make_unique<ChunkType>()).first;
+	}
+
+	const VoxelId previousVoxel = chunkIt->second->SetVoxel(ToLocalPosition(position), voxel);
+	if (previousVoxel != voxel)
+		chunkIt->second->SetRevision(++m_Revision);
+
+	if (chunkIt->second->IsEmpty())
+		m_Chunks.erase(chunkIt);
+
+	return (previousVoxel);
+}
+
+template<typename TStorage>
+const typename TVoxelWorld<TStorage>::ChunkType* TVoxelWorld<TStorage>::FindChunk(const ChunkCoordinate& coordinate) const
+{
+	auto chunkIt = m_Chunks.find(coordinate);
+	return (chunkIt == m_Chunks.end() ? nullptr : chunkIt->second.get());
+}
+
+template<typename TStorage>
+size_t TVoxelWorld<TStorage>::GetSolidCount() const
+{
+	size_t solidCount = 0;
+	for (const auto& [coordinate, chunk] : m_Chunks)
+		solidCount += chunk->GetSolidCount();
+	return (solidCount);
+}
+
+template<typename TStorage>
+size_t TVoxelWorld<TStorage>::GetMemoryUsage() const
+{
+	size_t memoryUsage = 0;
+	for (const auto& [coordinate, chunk] : m_Chunks)
+		memoryUsage += chunk->GetMemoryUsage();
+	return (memoryUsage);
+}
+
+template<typename TStorage>
+void TVoxelWorld<TStorage>::Compact()
+{
+	for (auto& [coordinate, chunk] : m_Chunks)
+		chunk->Compact();
+}
+
+template<typename TStorage>
+void TVoxelWorld<TStorage>::AppendAabbs(std::vector<VoxelAabb>& aabbs) const
+{
+	// Allocate the memory in one go, we already know exactly how many AABB we will add
+	aabbs.reserve(aabbs.size() + GetSolidCount());
+
+	ForEachSolidVoxel(
+		[&aabbs](const glm::ivec3& position, VoxelId voxel)
+		{
+			aabbs.push_back(MakeVoxelAabb(position));
+		}
+	);
+}
+
+template<typename TStorage>
+std::vector<VoxelAabb> TVoxelWorld<TStorage>::GenerateAabbs() const
+{
+	std::vector<VoxelAabb> aabbs;
+	AppendAabbs(aabbs);
+	return (aabbs);
+}
+
+template<typename TStorage>
+bool TVoxelWorld<TStorage>::LogSelfTest()
+{
+	constexpr bool bPaletteStorage = std::is_same_v<TStorage, PaletteVoxelStorage>;
+	constexpr std::string_view storageName = (bPaletteStorage ? "palette" : "dense");
+	constexpr int32_t size = VoxelChunkDimension::Size;
+
+	// CHECK is compiled out of the release builds, the expectations are logged instead
+	uint32_t failureCount = 0;
+	auto expect = [&failureCount, storageName](bool bCondition, std::string_view scenario, std::string_view expectation)
+		{
+			if (bCondition)
+				return;
+			VOXEL_LOG(Error, "Voxel world self test ({:s}), {:s}: expected {:s}", storageName, scenario, expectation);
+			failureCount++;
+		};
+
+	/* SET AND GET ACROSS THE CHUNK BORDERS */
+	{
+		const std::string_view scenario = "chunk borders";
+		TVoxelWorld world;
+
+		// The last and first voxels of the chunks around the origin and around -size, -1 is in the chunk -1 (not 0)
+		const int32_t coordinates[] = { -size - 1, -size, -1, 0, size - 1, size };
+		auto toVoxel = [](int32_t x, int32_t y, int32_t z) { return (static_cast<VoxelId>(1 + x + 6 * (y + 6 * z))); };
+		for (int32_t z = 0; z < 6; z++)
+			for (int32_t y = 0; y < 6; y++)
+				for (int32_t x = 0; x < 6; x++)
+				{
+					const glm::ivec3 position(coordinates[x], coordinates[y], coordinates[z]);
+					expect(world.SetVoxel(position, toVoxel(x, y, z)) == EmptyVoxel, scenario, "an empty voxel before the first write");
+				}
+
+		// The pairs (-size - 1, -size), (-1, 0) and (size - 1, size) straddle a border: the chunks -2, -1, 0 and 1 on each axis
+		expect(world.GetChunkCount() == 64, scenario, std::format("64 chunks (4 per axis), got {:d}", world.GetChunkCount()));
+		expect(world.GetSolidCount() == 216, scenario, std::format("216 solid voxels, got {:d}", world.GetSolidCount()));
+		for (int32_t z = 0; z < 6; z++)
+			for (int32_t y = 0; y < 6; y++)
+				for (int32_t x = 0; x < 6; x++)
+				{
+					const glm::ivec3 position(coordinates[x], coordinates[y], coordinates[z]);
+					const ChunkType* chunk = world.FindChunk(ToChunkCoordinate(position));
+					expect(world.GetVoxel(position) == toVoxel(x, y, z), scenario, std::format("the voxel written at ({:d}, {:d}, {:d})", position.x, position.y, position.z));
+					expect(chunk != nullptr && chunk->GetVoxel(ToLocalPosition(position)) == toVoxel(x, y, z), scenario,
+						std::format("the voxel at ({:d}, {:d}, {:d}) in its chunk", position.x, position.y, position.z));
+				}
+
+		// Only the written voxels are solid, their neighbours inside of the chunks are still empty
+		expect(ToChunkCoordinate(glm::ivec3(-1, 0, -size - 1)) == ChunkCoordinate(-1, 0, -2), scenario, "the chunk (-1, 0, -2) for the position (-1, 0, -33)");
+		expect(world.GetVoxel(glm::ivec3(-2, 0, 0)) == EmptyVoxel && world.GetVoxel(glm::ivec3(1, 0, 0)) == EmptyVoxel, scenario, "empty neighbours");
+		expect(world.GetVoxel(glm::ivec3(4 * size, 0, 0)) == EmptyVoxel, scenario, "an empty voxel in a chunk that doesn't exist");
+		expect(world.SetVoxel(glm::ivec3(0), 7) == toVoxel(3, 3, 3), scenario, "the previous voxel returned by an overwrite");
+	}
+
+	/* PALETTE GROWTH */
+	{
+		const std::string_view scenario = "palette growth";
+		TVoxelWorld world;
+
+		// A new material in each voxel, the indices widen from 1 to 16 bits and the voxels written before must survive each repack
+		constexpr int32_t materialCount = 300;
+		auto toPosition = [](int32_t i) { return (glm::ivec3(i % size, (i / size) % size, i / (size * size))); };
+		// Stop at the first broken step, the next ones would log the same voxels again
+		const uint32_t previousFailureCount = failureCount;
+		for (int32_t i = 0; i < materialCount && failureCount == previousFailureCount; i++)
+		{
+			world.SetVoxel(toPosition(i), static_cast<VoxelId>(i + 1));
+			for (int32_t j = 0; j <= i; j++)
+				expect(world.GetVoxel(toPosition(j)) == static_cast<VoxelId>(j + 1), scenario, std::format("the voxel {:d} after writing {:d} materials", j, i + 1));
+
+			if constexpr (bPaletteStorage)
+			{
+				// The palette has the materials and the empty voxel
+				const size_t paletteSize = static_cast<size_t>(i) + 2;
+				const uint8_t expectedBitsPerIndex = (paletteSize <= 2 ? 1 : paletteSize <= 4 ? 2 : paletteSize <= 16 ? 4 : paletteSize <= 256 ? 8 : 16);
+				const PaletteVoxelStorage& storage = world.FindChunk(ChunkCoordinate(0))->GetStorage();
+				expect(storage.GetBitsPerIndex() == expectedBitsPerIndex, scenario,
+					std::format("{:d} bits per index for {:d} palette entries, got {:d}", expectedBitsPerIndex, paletteSize, storage.GetBitsPerIndex()));
+			}
+		}
+
+		// Removing voxels only free the palette entries, compacting shrink the indices back to what the remaining materials need
+		constexpr int32_t keptCount = 10;
+		for (int32_t i = keptCount; i < materialCount; i++)
+			world.SetVoxel(toPosition(i), EmptyVoxel);
+		world.Compact();
+		for (int32_t i = 0; i < materialCount; i++)
+		{
+			const VoxelId expectedVoxel = (i < keptCount ? static_cast<VoxelId>(i + 1) : EmptyVoxel);
+			expect(world.GetVoxel(toPosition(i)) == expectedVoxel, scenario, std::format("the voxel {:d} after the compaction", i));
+		}
+		if constexpr (bPaletteStorage)
+		{
+			const PaletteVoxelStorage& storage = world.FindChunk(ChunkCoordinate(0))->GetStorage();
+			expect(storage.GetPaletteSize() == keptCount + 1 && storage.GetBitsPerIndex() == 4, scenario,
+				std::format("11 palette entries of 4 bits after the compaction, got {:d} of {:d} bits", storage.GetPaletteSize(), storage.GetBitsPerIndex()));
+		}
+	}
+
+	/* EMPTIED CHUNK REMOVAL */
+	{
+		const std::string_view scenario = "emptied chunk removal";
+		TVoxelWorld world;
+
+		// Writing air where there is no chunk doesn't create one
+		expect(world.SetVoxel(glm::ivec3(5), EmptyVoxel) == EmptyVoxel && world.GetChunkCount() == 0 && world.GetRevision() == 0, scenario,
+			"no chunk and no revision for air written outside of the chunks");
+
+		const glm::ivec3 positions[] = { glm::ivec3(-1, -1, -1), glm::ivec3(-size, -1, -1), glm::ivec3(-1, -size, -size), glm::ivec3(0, 0, 0) };
+		for (const glm::ivec3& position : positions)
+			world.SetVoxel(position, 3);
+		expect(world.GetChunkCount() == 2, scenario, std::format("2 chunks, got {:d}", world.GetChunkCount()));
+
+		// Writing the same voxel again isn't a modification
+		const uint64_t revision = world.GetRevision();
+		world.SetVoxel(positions[0], 3);
+		expect(world.GetRevision() == revision, scenario, "the same revision after writing the voxel already there");
+
+		// The chunk (-1, -1, -1) stay until its last solid voxel is removed, the chunk at the origin is untouched
+		const ChunkCoordinate coordinate(-1);
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			const uint64_t previousRevision = world.GetRevision();
+			expect(world.SetVoxel(positions[i], EmptyVoxel) == 3, scenario, "the removed voxel returned");
+			expect(world.GetRevision() > previousRevision, scenario, "a new revision for each removed voxel");
+
+			const bool bLastVoxel = (i == 2);
+			const ChunkType* chunk = world.FindChunk(coordinate);
+			expect(bLastVoxel ? chunk == nullptr : (chunk != nullptr && chunk->GetSolidCount() == 2 - i), scenario,
+				bLastVoxel ? "the chunk removed with its last solid voxel" : "the chunk kept while it has solid voxels");
+		}
+		expect(world.GetChunkCount() == 1 && world.GetVoxel(positions[3]) == 3, scenario, "the other chunk untouched");
+
+		// A chunk created again where one was removed get a revision newer than every previous one
+		const uint64_t revisionBeforeRecreation = world.GetRevision();
+		world.SetVoxel(positions[0], 4);
+		const ChunkType* recreatedChunk = world.FindChunk(coordinate);
+		expect(recreatedChunk != nullptr && recreatedChunk->GetRevision() > revisionBeforeRecreation && recreatedChunk->GetSolidCount() == 1, scenario,
+			"a new chunk with a newer revision and a single solid voxel");
+	}
+
+	VOXEL_LOG(Display, "Voxel world self test ({:s}): {:s} ({:d} failed expectations)", storageName, failureCount == 0 ? "passed" : "FAILED", failureCount);
+	return (failureCount == 0);
+}
+
+template class VOXEL_API TVoxelWorld<DenseVoxelStorage>;
+template class VOXEL_API TVoxelWorld<PaletteVoxelStorage>;
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+/**
+ * 3D Morton code (Z-order curve) helpers.
+ * The bits of x, y and z are interleaved as ...zyxzyx, so the 3 lowest bits of a code are the octant
+ * of the position in its parent cell: x | (y << 1) | (z << 2).
+ */
+namespace Morton
+{
+	/** How many bits per axis can be encoded in a 64 bits code */
+	constexpr uint32_t MaxBitsPerAxis = 21;
+
+	/** Insert two 0 bits between each of the 21 lowest bits of value */
+	__forceinline uint64_t SpreadBits(uint64_t value)
+	{
+		value &= 0x1FFFFF;
+		value = (value | (value << 32)) & 0x001F00000000FFFF;
+		value = (value | (value << 16)) & 0x001F0000FF0000FF;
+		value = (value | (value << 8)) & 0x100F00F00F00F00F;
+		value = (value | (value << 4)) & 0x10C30C30C30C30C3;
+		value = (value | (value << 2)) & 0x1249249249249249;
+		return (value);
+	}
+
+	/** Inverse of SpreadBits, keep one bit out of three */
+	__forceinline uint64_t CompactBits(uint64_t value)
+	{
+		value &= 0x1249249249249249;
+		value = (value | (value >> 2)) & 0x10C30C30C30C30C3;
+		value = (value | (value >> 4)) & 0x100F00F00F00F00F;
+		value = (value | (value >> 8)) & 0x001F0000FF0000FF;
+		value = (value | (value >> 16)) & 0x001F00000000FFFF;
+		value = (value | (value >> 32)) & 0x1FFFFF;
+		return (value);
+	}
+
+	/** Encode a position (each component must be in [0, 2^21[) */
+	__forceinline uint64_t Encode(const glm::uvec3& position)
+	{
+		return (SpreadBits(position.x) | (SpreadBits(position.y) << 1) | (SpreadBits(position.z) << 2));
+	}
+
+	/** Decode a code made by Encode */
+	__forceinline glm::uvec3 Decode(uint64_t code)
+	{
+		return (glm::uvec3(
+			static_cast<uint32_t>(CompactBits(code)),
+			static_cast<uint32_t>(CompactBits(code >> 1)),
+			static_cast<uint32_t>(CompactBits(code >> 2))
+		));
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+#include "SparseVoxelOctree.h"
+
+#include <cfloat>
+#include <vector>
+
+/** Compression statistics of one level of a SparseVoxelDag */
+struct SvoDagLevelStatistics
+{
+	/** How many nodes the octree has at this level */
+	uint32_t OctreeNodeCount;
+	/** How many unique nodes remain after deduplication */
+	uint32_t DagNodeCount;
+	/** How many bytes the level use in the octree */
+	size_t OctreeMemoryUsage;
+	/** How many bytes the level use in the DAG */
+	size_t DagMemoryUsage;
+
+	/** Octree size divided by DAG size (> 1 when the DAG is smaller) */
+	__forceinline float GetCompressionRatio() const { return (DagMemoryUsage == 0 ? 0.0f : static_cast<float>(OctreeMemoryUsage) / static_cast<float>(DagMemoryUsage)); }
+};
+
+/**
+ * Sparse voxel directed acyclic graph: a SparseVoxelOctree where the identical subtrees are stored only once.
+ * The subtrees are hashed bottom-up, so two nodes are merged when they have the same child mask and the same (already merged) children.
+ *
+ * Since a child can be shared by several parents, the children are not contiguous anymore and each node store explicit pointers.
+ * Everything is in a single uint32_t array (uploadable as is in a storage buffer), a node is:
+ *    [ChildMask, Child0, Child1, ...] with one child per bit set in ChildMask, in octant order
+ * A child is the index of the first word of the child node,
+ * except for the nodes of the last level (GetDepth() - 1) where the children are directly the VoxelId of the leaves.
+ * The root is at index 0, and the nodes are grouped by level (breadth-first), like in the octree.
+ */
+class VOXEL_API SparseVoxelDag final
+{
+public:
+	SparseVoxelDag() { Clear(); }
+
+#pragma region API
+public:
+	/** Build the DAG by deduplicating the subtrees of an octree (replace the previous content) */
+	void Build(const SparseVoxelOctree& octree);
+
+	/** Remove every nodes */
+	void Clear();
+
+	/** Get the voxel at a world position by walking down the DAG (EmptyVoxel when outside) */
+	VoxelId GetVoxel(const glm::ivec3& position) const;
+
+	/**
+	 * Find the first voxel hit by a ray, same result as SparseVoxelOctree::Raycast.
+	 *
+	 * \param minDistance the voxels entered before this distance are ignored (same as tMin in a ray tracing pipeline)
+	 * \param maxDistance the voxels further than this distance are ignored
+	 * \return true when a voxel is hit, outHit is only written in this case
+	 */
+	bool Raycast(const VoxelRay& ray, VoxelRayHit& outHit, float minDistance = 0.0f, float maxDistance = FLT_MAX) const;
+
+	/** Log the compression ratio of each level, and of the whole DAG */
+	void LogStatistics() const;
+
+	/** Tell whether or not the DAG doesn't contain any voxel */
+	__forceinline bool IsEmpty() const { return (m_Words.empty()); }
+	/** Return how many levels there is under the root (0 when the root is directly a voxel) */
+	__forceinline uint32_t GetDepth() const { return (m_Depth); }
+	/** Return the world position of the lower corner of the DAG */
+	__forceinline const glm::ivec3& GetOrigin() const { return (m_Origin); }
+	/** Return how many voxels the DAG covers on each axis */
+	__forceinline int32_t GetSize() const { return (1 << m_Depth); }
+
+	/** Access the word array, ready to be uploaded */
+	__forceinline const std::vector<uint32_t>& GetWords() const { return (m_Words); }
+	/** Return how many bytes are used by the word array */
+	__forceinline size_t GetMemoryUsage() const { return (m_Words.size() * sizeof(uint32_t)); }
+	/**
+	 * Compression statistics of each level (one entry per level that has children, or a single entry when the root is a voxel).
+	 * The leaves are stored in their parent by the DAG, so they are counted in the last level for both structures.
+	 */
+	__forceinline const std::vector<SvoDagLevelStatistics>& GetLevelStatistics() const { return (m_LevelStatistics); }
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Benchmark: build the octree and the DAG of a generated terrain for each radius (in chunks), trace the same rays through both,
+	 * and log the memory saved by the DAG against the traversal speed it costs (rays per second).
+	 */
+	static void LogBenchmark(const std::vector<int32_t>& chunkRadii = { 1, 2, 4, 8 });
+#pragma endregion
+
+private:
+	/** Hash the words of a node (child mask + children), used to find the identical nodes */
+	struct NodeWordsHash
+	{
+		size_t operator()(const std::vector<uint32_t>& words) const;
+	};
+
+private:
+	/** All the nodes, @see SparseVoxelDag */
+	std::vector<uint32_t> m_Words;
+	/** Compression statistics of each level, filled by Build */
+	std::vector<SvoDagLevelStatistics> m_LevelStatistics;
+	/** World position of the lower corner of the DAG */
+	glm::ivec3 m_Origin = glm::ivec3(0);
+	/** How many levels there is under the root */
+	uint32_t m_Depth = 0;
+};
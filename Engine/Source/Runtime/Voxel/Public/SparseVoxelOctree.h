@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+#include "VoxelWorld.h"
+
+#include <cfloat>
+#include <vector>
+
+/**
+ * A node of a SparseVoxelOctree, 8 bytes so an array of node can be uploaded as is in a storage buffer (uvec2 in std430).
+ *
+ * The children of a node are stored contiguously, in octant order, and only the children that exist are stored.
+ * The index of the child in the octant O is: FirstChild + bitCount(ChildMask & ((1 << O) - 1))
+ */
+struct SvoNode
+{
+	/** Bit O is set when the child in the octant O (x | y << 1 | z << 2) exist */
+	uint32_t ChildMask;
+	/** Index of the first child in the node array, for a leaf this is the VoxelId instead */
+	uint32_t FirstChild;
+};
+static_assert(sizeof(SvoNode) == sizeof(uint32_t) * 2, "SvoNode must be tightly packed to be uploaded on the GPU");
+
+/**
+ * Pointer-less sparse voxel octree, the nodes are stored in breadth-first order:
+ * the root is the node 0, followed by all the nodes of the level 1, then all the nodes of the level 2, etc...
+ * Each level is sorted in Morton order. The leaves (last level) are single voxels.
+ *
+ * The octree covers a cube of GetSize()^3 voxels, starting at the world position GetOrigin().
+ * As in the VoxelWorld, the voxel at the position P covers the box [P - 0.5, P + 0.5].
+ */
+class VOXEL_API SparseVoxelOctree final
+{
+public:
+	/** The deepest octree we can build, the leaves positions are encoded in 64 bits Morton codes */
+	static constexpr uint32_t MaxDepth = 21;
+
+public:
+	SparseVoxelOctree() { Clear(); }
+
+#pragma region API
+public:
+	/** Build the octree from all the solid voxels of a world (replace the previous content) */
+	template<typename TStorage>
+	void Build(const TVoxelWorld<TStorage>& world)
+	{
+		std::vector<std::pair<glm::ivec3, VoxelId>> voxels;
+		voxels.reserve(world.GetSolidCount());
+		world.ForEachSolidVoxel(
+			[&voxels](const glm::ivec3& position, VoxelId voxel)
+			{
+				voxels.emplace_back(position, voxel);
+			}
+		);
+		Build(voxels);
+	}
+	/** Build the octree from a list of solid voxels (replace the previous content), positions must be unique */
+	void Build(const std::vector<std::pair<glm::ivec3, VoxelId>>& voxels);
+
+	/** Remove every nodes */
+	void Clear();
+
+	/** Get the voxel at a world position by walking down the octree (EmptyVoxel when outside) */
+	VoxelId GetVoxel(const glm::ivec3& position) const;
+
+	/**
+	 * Find the first voxel hit by a ray.
+	 *
+	 * \param minDistance the voxels entered before this distance are ignored (same as tMin in a ray tracing pipeline)
+	 * \param maxDistance the voxels further than this distance are ignored
+	 * \return true when a voxel is hit, outHit is only written in this case
+	 */
+	bool Raycast(const VoxelRay& ray, VoxelRayHit& outHit, float minDistance = 0.0f, float maxDistance = FLT_MAX) const;
+
+	/** Tell whether or not the octree doesn't contain any voxel */
+	__forceinline bool IsEmpty() const { return (m_Nodes.empty()); }
+	/** Return how many levels there is under the root (0 when the root is directly a voxel) */
+	__forceinline uint32_t GetDepth() const { return (m_Depth); }
+	/** Return the world position of the lower corner of the octree */
+	__forceinline const glm::ivec3& GetOrigin() const { return (m_Origin); }
+	/** Return how many voxels the octree covers on each axis */
+	__forceinline int32_t GetSize() const { return (1 << m_Depth); }
+
+	/** Access the node array, ready to be uploaded */
+	__forceinline const std::vector<SvoNode>& GetNodes() const { return (m_Nodes); }
+	/** Return how many nodes there is in total */
+	__forceinline size_t GetNodeCount() const { return (m_Nodes.size()); }
+	/** Return the index of the first node of a level (GetDepth() + 1 is the end of the array) */
+	__forceinline uint32_t GetLevelOffset(uint32_t level) const { return (m_LevelOffsets[level]); }
+	/** Return how many nodes there is in a level */
+	__forceinline uint32_t GetLevelNodeCount(uint32_t level) const { return (m_LevelOffsets[level + 1] - m_LevelOffsets[level]); }
+	/** Return how many bytes are used by the node array */
+	__forceinline size_t GetMemoryUsage() const { return (m_Nodes.size() * sizeof(SvoNode)); }
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Benchmark: build an octree over a generated terrain for each radius (in chunks),
+	 * and log the build time, the memory used and the traversal speed (rays per second).
+	 */
+	static void LogBenchmark(const std::vector<int32_t>& chunkRadii = { 1, 2, 4, 8 });
+#pragma endregion
+
+private:
+	/** All the nodes in breadth-first order */
+	std::vector<SvoNode> m_Nodes;
+	/** Index of the first node of each level, plus the end of the array */
+	std::vector<uint32_t> m_LevelOffsets;
+	/** World position of the lower corner of the octree */
+	glm::ivec3 m_Origin = glm::ivec3(0);
+	/** How many levels there is under the root */
+	uint32_t m_Depth = 0;
+};
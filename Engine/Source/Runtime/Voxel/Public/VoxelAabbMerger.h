@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+#include "VoxelChunk.h"
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+/** What a VoxelAabbMerger did, to know how much it's worth it */
+struct VoxelAabbMergeStatistics
+{
+	/** How many solid voxels were merged */
+	size_t VoxelCount = 0;
+	/** How many AABBs were generated */
+	size_t AabbCount = 0;
+	/** How long the merge took */
+	std::chrono::nanoseconds Duration{ 0 };
+
+	/** How many voxels there is per AABB on average (1 = nothing has been merged) */
+	__forceinline float GetReductionRatio() const { return (AabbCount == 0 ? 1.0f : static_cast<float>(VoxelCount) / static_cast<float>(AabbCount)); }
+
+	VoxelAabbMergeStatistics& operator+=(const VoxelAabbMergeStatistics& rhs)
+	{
+		VoxelCount += rhs.VoxelCount;
+		AabbCount += rhs.AabbCount;
+		Duration += rhs.Duration;
+		return (*this);
+	}
+};
+
+/**
+ * Greedy 3D merging of the solid voxels of a chunk into boxes, so the BLAS has a lot less primitives than one AABB per voxel.
+ * Only the voxels with the same VoxelId are merged together, so each box is still made of a single material.
+ *
+ * The voxels are visited in memory order (x, then y, then z), each voxel not merged yet start a box that is grown as much as
+ * possible along x, then y, then z. The output only depend on the content of the chunk: it's always the same for the same chunk.
+ */
+class VOXEL_API VoxelAabbMerger final
+{
+public:
+	/** The voxels of a chunk, indexed like the chunk storage (@see TVoxelChunk::ToIndex) */
+	using ChunkVoxels = std::array<VoxelId, VoxelChunkDimension::Volume>;
+
+	/** Radius (in chunks) of the terrain GoldenBenchmarkHash has been computed on */
+	static constexpr int32_t GoldenBenchmarkChunkRadius = 8;
+	/** Hash of the merged AABBs of the benchmark terrain, must only be updated when the merge or VoxelTerrain change on purpose */
+	static constexpr uint64_t GoldenBenchmarkHash = 0x86db33b2c931bb7dull;
+
+#pragma region API - Static
+public:
+	/**
+	 * Merge the solid voxels of a chunk and add the boxes at the end of aabbs.
+	 *
+	 * \param offset added to the local positions of the voxels (e.g. the chunk origin to get world space boxes)
+	 * \param outStatistics (optional) statistics of this merge
+	 */
+	template<typename TStorage>
+	static void AppendMergedAabbs(const TVoxelChunk<TStorage>& chunk, const glm::ivec3& offset, std::vector<VoxelAabb>& aabbs, VoxelAabbMergeStatistics* outStatistics = nullptr)
+	{
+		// The merge consume the voxels, work on a copy (that is also faster to read than some storages)
+		ChunkVoxels voxels;
+		for (int32_t i = 0; i < VoxelChunkDimension::Volume; i++)
+			voxels[i] = chunk.GetStorage().Get(i);
+		AppendMergedAabbs(voxels, offset, aabbs, outStatistics);
+	}
+
+	/** Same as above, but directly from the voxels (which are all set to EmptyVoxel after the merge) */
+	static void AppendMergedAabbs(ChunkVoxels& voxels, const glm::ivec3& offset, std::vector<VoxelAabb>& aabbs, VoxelAabbMergeStatistics* outStatistics = nullptr);
+
+	/** Hash a list of AABBs (FNV-1a over the raw floats), to compare the output of a merge with a known good result */
+	static uint64_t HashAabbs(const std::vector<VoxelAabb>& aabbs);
+
+	/**
+	 * Benchmark: merge the chunks of a generated terrain, and log the reduction ratio, the time and the hash of the output.
+	 * With the default radius, the hash is compared with GoldenBenchmarkHash and an error is logged when the merge output changed.
+	 */
+	static void LogBenchmark(int32_t chunkRadius = GoldenBenchmarkChunkRadius);
+#pragma endregion
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+
+#include <cfloat>
+#include <vector>
+
+/**
+ * A node of a VoxelBvh, 32 bytes and aligned on 32 bytes, so two nodes fill exactly a cache line
+ * (the two children of a node are always next to each other and fetched together).
+ */
+struct alignas(32) VoxelBvhNode
+{
+	glm::vec3 Min;
+	/** Interior node: index of the left child (the right child is LeftOrFirst + 1). Leaf: first primitive in the primitive indices */
+	uint32_t LeftOrFirst;
+	glm::vec3 Max;
+	/** How many primitives there is in the leaf, 0 for an interior node */
+	uint32_t PrimitiveCount;
+
+	__forceinline bool IsLeaf() const { return (PrimitiveCount > 0); }
+};
+static_assert(sizeof(VoxelBvhNode) == 32, "VoxelBvhNode must be 32 bytes");
+
+/** Settings of a VoxelBvh build */
+struct VoxelBvhSettings
+{
+	/** The bins are allocated on the stack, BinCount can't be bigger than that */
+	static constexpr uint32_t MaxBinCount = 64;
+
+	/** How many bins are used on each axis to evaluate the SAH */
+	uint32_t BinCount = 16;
+	/** A node with more primitives than this is always split */
+	uint32_t MaxLeafSize = 4;
+	/** Cost of a ray-node test, relative to a ray-primitive test (which cost 1) */
+	float TraversalCost = 1.0f;
+	/** Subtrees with at least this many primitives are built on another thread */
+	uint32_t ParallelThreshold = 32 * 1024;
+	/** How many threads can build subtrees at the same time (0 = one per hardware thread) */
+	uint32_t ThreadCount = 0;
+};
+
+/** The result of a ray query against a VoxelBvh */
+struct VoxelBvhHit
+{
+	/** Distance along the ray to the entry point of the primitive */
+	float Distance;
+	/** Index of the primitive in the list given to Build */
+	uint32_t PrimitiveIndex;
+};
+
+/**
+ * Bounding volume hierarchy over a list of AABBs (e.g. the voxels AABBs sent to the BLAS), built with binned SAH.
+ * The node 0 is the root, the subtrees big enough are built in parallel.
+ */
+class VOXEL_API VoxelBvh final
+{
+public:
+	/**
+	 * A deeper tree is never built, so the traversal stack has a fixed size.
+	 * The SAH build switch to median splits past MaxDepth / 2, a LBVH can't be deeper than its 63 bits codes + 32 bits of index.
+	 */
+	static constexpr uint32_t MaxDepth = 96;
+
+public:
+	VoxelBvh() = default;
+
+#pragma region API
+public:
+	/** Build the BVH over a list of AABBs (replace the previous content), the AABBs are copied */
+	void Build(const std::vector<VoxelAabb>& aabbs, const VoxelBvhSettings& settings = VoxelBvhSettings());
+	/** Remove every nodes */
+	void Clear();
+
+	/**
+	 * Find the closest primitive hit by a ray.
+	 *
+	 * \param minDistance the primitives entered before this distance are ignored
+	 * \param maxDistance the primitives further than this distance are ignored
+	 * \return true when a primitive is hit, outHit is only written in this case
+	 */
+	bool Raycast(const VoxelRay& ray, VoxelBvhHit& outHit, float minDistance = 0.0f, float maxDistance = FLT_MAX) const;
+
+	/**
+	 * Call a function for every primitive overlapping an AABB (e.g. for culling).
+	 * The function signature must be: void(uint32_t primitiveIndex)
+	 */
+	template<typename F>
+	void QueryAabb(const VoxelAabb& aabb, F&& function) const
+	{
+		if (m_Nodes.empty())
+			return;
+
+		uint32_t stack[MaxDepth + 1];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			const VoxelBvhNode& node = m_Nodes[stack[--stackSize]];
+			if (Overlap(aabb, node.Min, node.Max) == false)
+				continue;
+
+			if (node.IsLeaf())
+			{
+				for (uint32_t i = node.LeftOrFirst; i < node.LeftOrFirst + node.PrimitiveCount; i++)
+				{
+					if (Overlap(aabb, m_Aabbs[i].Min, m_Aabbs[i].Max))
+						function(m_PrimitiveIndices[i]);
+				}
+				continue;
+			}
+			stack[stackSize++] = node.LeftOrFirst + 1;
+			stack[stackSize++] = node.LeftOrFirst;
+		}
+	}
+
+	/**
+	 * Check the structure of the tree: every node contains its children, every primitive is referenced exactly once, the depth limit is respected...
+	 * The errors are logged.
+	 *
+	 * \return true if the BVH is valid
+	 */
+	bool Validate() const;
+
+	/** Compute the SAH cost of the whole tree (the lower the better), using the costs of the last build */
+	float CalculateSahCost() const;
+
+	/** Tell whether or not the BVH doesn't contain any primitive */
+	__forceinline bool IsEmpty() const { return (m_Nodes.empty()); }
+	/** Access the node array (the root is the node 0) */
+	__forceinline const std::vector<VoxelBvhNode>& GetNodes() const { return (m_Nodes); }
+	/** Index of the original primitive for each slot referenced by the leaves */
+	__forceinline const std::vector<uint32_t>& GetPrimitiveIndices() const { return (m_PrimitiveIndices); }
+	/** Return how many bytes are used by the nodes, the primitive indices and the AABBs */
+	__forceinline size_t GetMemoryUsage() const
+	{
+		return (m_Nodes.size() * sizeof(VoxelBvhNode) + m_PrimitiveIndices.size() * sizeof(uint32_t) + m_Aabbs.size() * sizeof(VoxelAabb));
+	}
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Benchmark: build a BVH over random voxels AABBs for each primitive count,
+	 * and log the build time, the SAH cost and the traversal speed (rays per second).
+	 */
+	static void LogBenchmark(const std::vector<uint32_t>& primitiveCounts = { 10'000, 100'000, 1'000'000, 10'000'000 });
+
+	/** Tell whether or not two AABBs overlap (touching counts as overlapping) */
+	__forceinline static bool Overlap(const VoxelAabb& aabb, const glm::vec3& min, const glm::vec3& max)
+	{
+		return (glm::all(glm::lessThanEqual(aabb.Min, max)) && glm::all(glm::lessThanEqual(min, aabb.Max)));
+	}
+#pragma endregion
+
+private:
+	friend class VoxelLbvhBuilder;
+	struct BuildContext;
+
+	/** Split the node (or make it a leaf), then build its children, maybe on other threads */
+	void BuildNode(BuildContext& context, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth);
+
+private:
+	/** All the nodes, the root is the node 0 */
+	std::vector<VoxelBvhNode> m_Nodes;
+	/** Original index of the primitives, in leaf order */
+	std::vector<uint32_t> m_PrimitiveIndices;
+	/** The AABBs of the primitives, in leaf order (same order as m_PrimitiveIndices) */
+	std::vector<VoxelAabb> m_Aabbs;
+	/** Costs used for the last build, kept to compute the SAH cost */
+	float m_TraversalCost = 1.0f;
+};
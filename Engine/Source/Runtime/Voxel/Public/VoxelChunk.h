@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+#include "VoxelStorage.h"
+
+/**
+ * A cube of VoxelChunkDimension::Size^3 voxels (x first, then y, then z).
+ * Positions used by this class are local to the chunk, in the range [0, Size[.
+ *
+ * How the voxels are stored is up to the storage policy (@see VoxelStorage.h),
+ * the get/set API is the same whatever the policy is.
+ */
+template<typename TStorage>
+class TVoxelChunk final
+{
+public:
+	using StorageType = TStorage;
+
+	/** How many voxels there is on each axis of a chunk (must be a power of 2) */
+	static constexpr int32_t Size = VoxelChunkDimension::Size;
+	/** log2(Size), use to convert world positions into chunk positions with a shift */
+	static constexpr int32_t SizeShift = VoxelChunkDimension::SizeShift;
+	/** How many voxels there is in a chunk */
+	static constexpr int32_t Volume = VoxelChunkDimension::Volume;
+
+public:
+	TVoxelChunk() = default;
+
+	TVoxelChunk(const TVoxelChunk&) = default;
+	TVoxelChunk& operator=(const TVoxelChunk&) = default;
+
+#pragma region API
+public:
+	/** Get the voxel at a local position */
+	__forceinline VoxelId GetVoxel(const glm::ivec3& localPosition) const { return (m_Storage.Get(ToIndex(localPosition))); }
+	/**
+	 * Set the voxel at a local position.
+	 *
+	 * \return the voxel that was previously at this position
+	 */
+	VoxelId SetVoxel(const glm::ivec3& localPosition, VoxelId voxel)
+	{
+		CHECK(IsInside(localPosition));
+
+		const int32_t index = ToIndex(localPosition);
+		const VoxelId previousVoxel = m_Storage.Get(index);
+
+		m_SolidCount += (voxel != EmptyVoxel) - (previousVoxel != EmptyVoxel);
+		m_Storage.Set(index, voxel);
+
+		return (previousVoxel);
+	}
+	/** Set every voxels of the chunk to the same value */
+	void Fill(VoxelId voxel)
+	{
+		m_Storage.Fill(voxel);
+		m_SolidCount = (voxel != EmptyVoxel ? Volume : 0);
+	}
+	/** Release the memory the storage doesn't need anymore (e.g. after removing a lot of voxels) */
+	__forceinline void Compact() { m_Storage.Compact(); }
+
+	/** Return how many voxels are not empty */
+	__forceinline uint32_t GetSolidCount() const { return (m_SolidCount); }
+	/** Tell whether or not all the voxels of the chunk are empty */
+	__forceinline bool IsEmpty() const { return (m_SolidCount == 0); }
+
+	/**
+	 * Return the revision of the chunk, it changes every time a voxel is modified through the world
+	 * (used to know which chunks must be uploaded to the GPU again, @see TVoxelWorld::SetVoxel).
+	 */
+	__forceinline uint64_t GetRevision() const { return (m_Revision); }
+	/** Set the revision of the chunk, called by the world (the revisions are unique across the world) */
+	__forceinline void SetRevision(uint64_t revision) { m_Revision = revision; }
+
+	/** Return how many bytes this chunk use */
+	__forceinline size_t GetMemoryUsage() const { return (sizeof(*this) - sizeof(TStorage) + m_Storage.GetMemoryUsage()); }
+	/** Access the storage, for policy specific features */
+	__forceinline const TStorage& GetStorage() const { return (m_Storage); }
+
+	/**
+	 * Call a function for every solid voxel of the chunk, in memory order.
+	 * The function signature must be: void(const glm::ivec3& localPosition, VoxelId voxel)
+	 */
+	template<typename F>
+	void ForEachSolidVoxel(F&& function) const
+	{
+		if (IsEmpty())
+			return;
+
+		int32_t index = 0;
+		for (int32_t z = 0; z < Size; z++)
+		{
+			for (int32_t y = 0; y < Size; y++)
+			{
+				for (int32_t x = 0; x < Size; x++, index++)
+				{
+					const VoxelId voxel = m_Storage.Get(index);
+					if (voxel != EmptyVoxel)
+						function(glm::ivec3(x, y, z), voxel);
+				}
+			}
+		}
+	}
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/** Convert a local position into an index of the voxel storage */
+	__forceinline static int32_t ToIndex(const glm::ivec3& localPosition)
+	{
+		return (localPosition.x + (localPosition.y << SizeShift) + (localPosition.z << (SizeShift * 2)));
+	}
+	/** Tell whether or not a local position is inside the chunk */
+	__forceinline static bool IsInside(const glm::ivec3& localPosition)
+	{
+		return (
+			localPosition.x >= 0 && localPosition.x < Size
+			&& localPosition.y >= 0 && localPosition.y < Size
+			&& localPosition.z >= 0 && localPosition.z < Size
+		);
+	}
+#pragma endregion
+
+private:
+	/** All the voxels of the chunk, @see ToIndex */
+	TStorage m_Storage;
+	/** How many voxels are not empty, allow to skip empty chunks without looking at them */
+	uint32_t m_SolidCount = 0;
+	/** @see GetRevision */
+	uint64_t m_Revision = 0;
+};
+
+/** Chunk storing a full VoxelId per voxel (fast, but 64KB per chunk) */
+using VoxelChunk = TVoxelChunk<DenseVoxelStorage>;
+/** Chunk storing a palette + bit packed indices (slower random access, but a lot smaller) */
+using PaletteVoxelChunk = TVoxelChunk<PaletteVoxelStorage>;
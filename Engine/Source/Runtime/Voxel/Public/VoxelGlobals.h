@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "Logging/LoggingMacros.h"
+
+VOXEL_API DECLARE_LOG_CATEGORY(LogVoxel);
+
+#define VOXEL_LOG(Verbosity, Format, ...) \
+	OV_LOG(LogVoxel, Verbosity, Format, __VA_ARGS__);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+#include "VoxelBvh.h"
+
+#include <chrono>
+#include <vector>
+
+/** Settings of a VoxelLbvhBuilder build */
+struct VoxelLbvhSettings
+{
+	/** How many threads are used by each phase of the build (0 = one per hardware thread) */
+	uint32_t ThreadCount = 0;
+	/** Below this many primitives the whole build run on the calling thread (starting threads would cost more than the build) */
+	uint32_t ParallelThreshold = 16 * 1024;
+	/**
+	 * Report the time of each phase to the PerFrameProfilerStorage (@see VoxelLbvhBuilder::ProfilingCategories).
+	 * The storage isn't thread safe, so only enable it when building from the game thread.
+	 */
+	bool bReportToProfiler = true;
+};
+
+/** Time spent in each phase of the last VoxelLbvhBuilder build */
+struct VoxelLbvhTimings
+{
+	/** Bounds of the centroids, and Morton code of each centroid */
+	std::chrono::nanoseconds MortonCodes{ 0 };
+	/** Radix sort of the Morton codes */
+	std::chrono::nanoseconds Sort{ 0 };
+	/** Emission of the hierarchy from the sorted codes */
+	std::chrono::nanoseconds Hierarchy{ 0 };
+	/** Bottom-up computation of the nodes bounds */
+	std::chrono::nanoseconds Refit{ 0 };
+
+	__forceinline std::chrono::nanoseconds GetTotal() const { return (MortonCodes + Sort + Hierarchy + Refit); }
+};
+
+/**
+ * Linear BVH builder (Karras 2012), much faster than the SAH build of VoxelBvh but the tree is of lower quality,
+ * made to rebuild the BVH of the edited chunks every frame.
+ * The build is done in 4 phases: Morton code of every centroid, parallel radix sort of the codes,
+ * emission of the hierarchy from the sorted codes (each internal node is built independently), then the bounds are refit bottom-up.
+ *
+ * The output is a regular VoxelBvh (one primitive per leaf), so it's queried the same way.
+ * The builder keep its scratch memory between the builds, keep it alive to avoid allocating every frame.
+ */
+class VOXEL_API VoxelLbvhBuilder final
+{
+public:
+	/** Name of the PerFrameProfilerStorage categories the phases are reported to */
+	struct ProfilingCategories
+	{
+		static constexpr const char* MortonCodes = "VoxelLbvh_MortonCodes";
+		static constexpr const char* Sort = "VoxelLbvh_Sort";
+		static constexpr const char* Hierarchy = "VoxelLbvh_Hierarchy";
+		static constexpr const char* Refit = "VoxelLbvh_Refit";
+	};
+
+public:
+	VoxelLbvhBuilder() = default;
+
+#pragma region API
+public:
+	/** Build a BVH over a list of AABBs, the previous content of outBvh is replaced */
+	void Build(const std::vector<VoxelAabb>& aabbs, VoxelBvh& outBvh, const VoxelLbvhSettings& settings = VoxelLbvhSettings());
+
+	/** Get the time spent in each phase of the last build */
+	__forceinline const VoxelLbvhTimings& GetLastTimings() const { return (m_LastTimings); }
+	/** Free the scratch memory kept between the builds */
+	void ReleaseScratchMemory();
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/**
+	 * Benchmark: build a LBVH over random voxels AABBs for each primitive count,
+	 * and log the time of each phase, the SAH cost and the traversal speed (rays per second).
+	 */
+	static void LogBenchmark(const std::vector<uint32_t>& primitiveCounts = { 10'000, 100'000, 1'000'000, 10'000'000 });
+#pragma endregion
+
+private:
+	struct BuildContext;
+
+	/** The part of the build run by each thread, the phases are separated by barriers */
+	void BuildTask(BuildContext& context, VoxelBvh& outBvh, uint32_t threadIndex);
+
+private:
+	/** Morton code of each primitive (the second one is used by the radix sort) */
+	std::vector<uint64_t> m_Codes[2];
+	/** Index of each primitive, sorted with the codes */
+	std::vector<uint32_t> m_Indices[2];
+	/** Histogram of the current digit of each thread */
+	std::vector<uint32_t> m_Histograms;
+	/** Slot of each internal/leaf node in the VoxelBvh node array */
+	std::vector<uint32_t> m_InternalSlots;
+	std::vector<uint32_t> m_LeafSlots;
+	/** Parent internal node of each internal/leaf node */
+	std::vector<uint32_t> m_InternalParents;
+	std::vector<uint32_t> m_LeafParents;
+	/** How many children of each internal node have been refit */
+	std::vector<uint32_t> m_RefitCounters;
+
+	VoxelLbvhTimings m_LastTimings;
+};
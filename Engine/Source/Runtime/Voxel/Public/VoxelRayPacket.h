@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+
+#include <cfloat>
+
+/** Instruction sets the ray packet kernels can be compiled for, from the slowest to the fastest */
+namespace SimdIsa
+{
+	enum Type : uint8_t
+	{
+		Scalar = 0,
+		Sse41 = 1,
+		Avx2 = 2,
+
+		Count
+	};
+
+	VOXEL_API const char* ToString(Type isa);
+}
+
+/**
+ * Width rays stored as structure of arrays, so each component can be loaded in a single SIMD register.
+ * The directions are stored inverted, ready for the slab test.
+ */
+template<uint32_t Width>
+struct alignas(32) TVoxelRayPacket
+{
+	float OriginX[Width];
+	float OriginY[Width];
+	float OriginZ[Width];
+	float InverseDirectionX[Width];
+	float InverseDirectionY[Width];
+	float InverseDirectionZ[Width];
+	/** The boxes further than this distance are ignored */
+	float MaxDistance[Width];
+
+	void SetRay(uint32_t index, const VoxelRay& ray, float maxDistance = FLT_MAX)
+	{
+		const glm::vec3 inverseDirection = ComputeInverseDirection(ray.Direction);
+		OriginX[index] = ray.Origin.x;
+		OriginY[index] = ray.Origin.y;
+		OriginZ[index] = ray.Origin.z;
+		InverseDirectionX[index] = inverseDirection.x;
+		InverseDirectionY[index] = inverseDirection.y;
+		InverseDirectionZ[index] = inverseDirection.z;
+		MaxDistance[index] = maxDistance;
+	}
+};
+
+/** Width AABBs stored as structure of arrays, @see TVoxelRayPacket */
+template<uint32_t Width>
+struct alignas(32) TVoxelAabbPacket
+{
+	float MinX[Width];
+	float MinY[Width];
+	float MinZ[Width];
+	float MaxX[Width];
+	float MaxY[Width];
+	float MaxZ[Width];
+
+	void SetAabb(uint32_t index, const VoxelAabb& aabb)
+	{
+		MinX[index] = aabb.Min.x;
+		MinY[index] = aabb.Min.y;
+		MinZ[index] = aabb.Min.z;
+		MaxX[index] = aabb.Max.x;
+		MaxY[index] = aabb.Max.y;
+		MaxZ[index] = aabb.Max.z;
+	}
+};
+
+using VoxelRayPacket4 = TVoxelRayPacket<4>;
+using VoxelRayPacket8 = TVoxelRayPacket<8>;
+using VoxelAabbPacket4 = TVoxelAabbPacket<4>;
+using VoxelAabbPacket8 = TVoxelAabbPacket<8>;
+
+/**
+ * SIMD versions of the slab test (@see IntersectRayAabb), the results are exactly the same as the scalar version.
+ * Every kernel return a bit mask of the hits (bit i = ray/box i),
+ * and write the entry distance of each hit in outDistances (FLT_MAX when there is no hit).
+ * All the slots of a packet are always tested, when a packet isn't full the bits of the unused slots must be ignored.
+ *
+ * One table of kernels exist per instruction set, Get() return the fastest one supported by the CPU (detected once at runtime).
+ */
+class VOXEL_API VoxelRayPacketKernels final
+{
+public:
+	/** Intersect 4 rays with one AABB */
+	uint32_t (*IntersectRays4)(const VoxelRayPacket4& rays, const VoxelAabb& aabb, float* outDistances);
+	/** Intersect 8 rays with one AABB */
+	uint32_t (*IntersectRays8)(const VoxelRayPacket8& rays, const VoxelAabb& aabb, float* outDistances);
+	/** Intersect one ray with 4 AABBs */
+	uint32_t (*IntersectAabbs4)(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const VoxelAabbPacket4& aabbs, float* outDistances);
+	/** Intersect one ray with 8 AABBs */
+	uint32_t (*IntersectAabbs8)(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const VoxelAabbPacket8& aabbs, float* outDistances);
+
+	/** The instruction set used by those kernels */
+	SimdIsa::Type Isa;
+
+#pragma region API - Static
+public:
+	/** Get the fastest kernels supported by this CPU */
+	static const VoxelRayPacketKernels& Get();
+	/** Get the kernels of a specific instruction set, it must be supported by this CPU (@see GetBestIsa) */
+	static const VoxelRayPacketKernels& Get(SimdIsa::Type isa);
+	/** Return the fastest instruction set supported by this CPU and the OS */
+	static SimdIsa::Type GetBestIsa();
+
+	/**
+	 * Micro benchmark: run every kernel of every supported instruction set on random rays and boxes,
+	 * and log how many ray-box tests per second each of them does.
+	 */
+	static void LogBenchmark(uint32_t iterationCount = 1000);
+#pragma endregion
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+
+#include <array>
+#include <vector>
+
+/**
+ * Dimensions shared by every chunk, whatever the storage policy is.
+ */
+namespace VoxelChunkDimension
+{
+	/** How many voxels there is on each axis of a chunk (must be a power of 2) */
+	constexpr int32_t Size = 32;
+	/** log2(Size), use to convert world positions into chunk positions with a shift */
+	constexpr int32_t SizeShift = 5;
+	/** How many voxels there is in a chunk */
+	constexpr int32_t Volume = Size * Size * Size;
+
+	static_assert((1 << SizeShift) == Size, "VoxelChunkDimension::SizeShift must be log2(VoxelChunkDimension::Size)");
+}
+
+/**
+ * Storage policies of a chunk.
+ * Every policy store VoxelChunkDimension::Volume voxels and must implement:
+ *    VoxelId Get(int32_t index) const;
+ *    void Set(int32_t index, VoxelId voxel);
+ *    void Fill(VoxelId voxel);
+ *    void Compact();
+ *    size_t GetMemoryUsage() const;
+ */
+
+/**
+ * Store a full VoxelId per voxel.
+ * Fastest random access, but always use Volume * sizeof(VoxelId) bytes.
+ */
+class VOXEL_API DenseVoxelStorage final
+{
+public:
+	DenseVoxelStorage() { Fill(EmptyVoxel); }
+
+public:
+	__forceinline VoxelId Get(int32_t index) const { return (m_Voxels[index]); }
+	__forceinline void Set(int32_t index, VoxelId voxel) { m_Voxels[index] = voxel; }
+	__forceinline void Fill(VoxelId voxel) { m_Voxels.fill(voxel); }
+	/** Nothing to compact, the size of a dense storage never change */
+	__forceinline void Compact() {}
+
+	/** Return how many bytes are used to store the voxels */
+	__forceinline size_t GetMemoryUsage() const { return (sizeof(*this)); }
+
+	/** Direct access to the contiguous voxel storage (Volume entries) */
+	__forceinline const VoxelId* GetData() const { return (m_Voxels.data()); }
+
+private:
+	std::array<VoxelId, VoxelChunkDimension::Volume> m_Voxels;
+};
+
+/**
+ * Store a palette of the voxels used in the chunk, and for each voxel the index of its entry in the palette.
+ * The indices are bit packed with the smallest width that can address the whole palette (0, 1, 2, 4, 8 or 16 bits).
+ * A power of 2 width guarantee that an index never straddle two words.
+ *
+ * Writing a new voxel in the chunk may widen the indices,
+ * removing voxels only free palette entries (they will be reused), use Compact() to shrink the indices again.
+ */
+class VOXEL_API PaletteVoxelStorage final
+{
+public:
+	/** The type used to store the packed indices */
+	using WordType = uint64_t;
+	static constexpr uint32_t WordBitCount = sizeof(WordType) * 8;
+	/** The widest index we could need (VoxelId is 16 bits, so the palette can't have more entries than that) */
+	static constexpr uint8_t MaxBitsPerIndex = 16;
+
+public:
+	PaletteVoxelStorage() { Fill(EmptyVoxel); }
+
+public:
+	__forceinline VoxelId Get(int32_t index) const { return (m_Palette[GetPaletteIndex(index)]); }
+	void Set(int32_t index, VoxelId voxel);
+	void Fill(VoxelId voxel);
+	/** Remove the unused entries of the palette, and shrink the indices to the smallest possible width */
+	void Compact();
+
+	/** Return how many bytes are used to store the voxels (including the palette) */
+	size_t GetMemoryUsage() const;
+
+	/** Return how many bits are used to store the palette index of each voxel */
+	__forceinline uint8_t GetBitsPerIndex() const { return (m_BitsPerIndex); }
+	/** Return how many entries there is in the palette (including the unused ones) */
+	__forceinline size_t GetPaletteSize() const { return (m_Palette.size()); }
+
+	/**
+	 * Benchmark: store the same worlds in palette and dense chunks, and log the memory used by each storage
+	 * and the speed of random reads, sequential reads and random writes.
+	 * The worlds are a generated terrain (3 materials) and a noise of 256 materials (the worst case of the palette).
+	 */
+	static void LogBenchmark(int32_t chunkRadius = 4);
+
+private:
+	__forceinline uint32_t GetPaletteIndex(int32_t index) const
+	{
+		if (m_BitsPerIndex == 0)
+			return (0);
+
+		const uint32_t bitOffset = static_cast<uint32_t>(index) * m_BitsPerIndex;
+		const WordType mask = (WordType(1) << m_BitsPerIndex) - 1;
+		return (static_cast<uint32_t>((m_Indices[bitOffset / WordBitCount] >> (bitOffset % WordBitCount)) & mask));
+	}
+	void SetPaletteIndex(int32_t index, uint32_t paletteIndex);
+
+	/** Find or create the palette entry of a voxel, widen the indices if needed */
+	uint32_t FindOrAddPaletteEntry(VoxelId voxel);
+	/** Repack all the indices using a new width, the palette is remapped with remap[oldIndex] (identity when empty) */
+	void Repack(uint8_t newBitsPerIndex, const std::vector<uint32_t>& remap = {});
+
+	/** Return the smallest supported width that can address paletteSize entries */
+	static uint8_t CalculateBitsPerIndex(size_t paletteSize);
+
+private:
+	/** The voxels used in this chunk */
+	std::vector<VoxelId> m_Palette;
+	/** How many voxels reference each palette entry, an entry with 0 reference can be reused */
+	std::vector<uint32_t> m_ReferenceCounts;
+	/** The bit packed palette index of each voxel */
+	std::vector<WordType> m_Indices;
+	/** The width of each index in m_Indices */
+	uint8_t m_BitsPerIndex = 0;
+};
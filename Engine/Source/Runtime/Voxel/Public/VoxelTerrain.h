@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+#include "VoxelWorld.h"
+
+#include <vector>
+
+/**
+ * Generate rolling hills made only with integers, so the terrain (and everything computed from it, e.g. the hash of the merged AABBs)
+ * is the same on every platform. Used as the world of the renderer and as the scene of the benchmarks.
+ */
+class VOXEL_API VoxelTerrain final
+{
+public:
+	/** Materials of the terrain */
+	static constexpr VoxelId Stone = 1;
+	static constexpr VoxelId Dirt = 2;
+	static constexpr VoxelId Grass = 3;
+
+#pragma region API - Static
+public:
+	/** Get the height of the top voxel of a column of the terrain */
+	static int32_t GetHeight(int32_t x, int32_t z);
+	/** Random rays going down from above the terrain generated with this radius, like cameras looking at it (always the same for the same seed) */
+	static std::vector<VoxelRay> GenerateRays(int32_t radius, uint32_t rayCount, uint32_t seed = 0);
+	/** Get the column (x, z) of the terrain generated with this radius an edit change (always the same for the same edit index) */
+	static glm::ivec2 GetEditColumn(int32_t radius, uint32_t editIndex);
+
+	/**
+	 * Fill the columns in [-radius, radius[ on x and z, from y = 0 to their height: stone, then dirt, then grass on top.
+	 *
+	 * \param radius in voxels
+	 */
+	template<typename TStorage>
+	static void Generate(TVoxelWorld<TStorage>& world, int32_t radius)
+	{
+		for (int32_t z = -radius; z < radius; z++)
+		{
+			for (int32_t x = -radius; x < radius; x++)
+			{
+				const int32_t height = GetHeight(x, z);
+				for (int32_t y = 0; y <= height; y++)
+					world.SetVoxel(glm::ivec3(x, y, z), y == height ? Grass : y + 3 >= height ? Dirt : Stone);
+			}
+		}
+	}
+
+	/**
+	 * Dig the top voxel of a column of the terrain, or put it back if it has already been dug: a single voxel edit,
+	 * spread over the chunks like the edits of a player (@see GetEditColumn).
+	 */
+	template<typename TStorage>
+	static void ToggleSurfaceVoxel(TVoxelWorld<TStorage>& world, int32_t radius, uint32_t editIndex)
+	{
+		const glm::ivec2 column = GetEditColumn(radius, editIndex);
+		const glm::ivec3 position(column.x, GetHeight(column.x, column.y), column.y);
+		world.SetVoxel(position, world.GetVoxel(position) == EmptyVoxel ? Grass : EmptyVoxel);
+	}
+#pragma endregion
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Voxel_API.h"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+
+/**
+ * Identify the material of a voxel.
+ * 0 is reserved for the empty voxel (air), everything else is considered solid.
+ */
+using VoxelId = uint16_t;
+
+/** The id of an empty voxel (air) */
+constexpr VoxelId EmptyVoxel = 0;
+
+/**
+ * Axis aligned bounding box of a voxel (or a group of voxels).
+ * @note The memory layout match vk::AabbPositionsKHR (6 tightly packed floats), so an array of VoxelAabb
+ * can be copied as is onto the AABB buffer used to build the BLAS.
+ */
+struct VoxelAabb
+{
+	glm::vec3 Min;
+	glm::vec3 Max;
+};
+static_assert(sizeof(VoxelAabb) == sizeof(float) * 6, "VoxelAabb must be tightly packed to match vk::AabbPositionsKHR");
+
+/** Position of a chunk in the world, in chunk unit (not in voxel unit) */
+using ChunkCoordinate = glm::ivec3;
+
+/** Hash a chunk coordinate, so it can be used as a key in an unordered container */
+struct ChunkCoordinateHash
+{
+	__forceinline size_t operator()(const ChunkCoordinate& coordinate) const
+	{
+		// Large primes from "Optimized Spatial Hashing for Collision Detection of Deformable Objects" (Teschner et al.)
+		return (
+			static_cast<size_t>(coordinate.x) * 73856093
+			^ static_cast<size_t>(coordinate.y) * 19349663
+			^ static_cast<size_t>(coordinate.z) * 83492791
+		);
+	}
+};
+
+/** A ray in world space, the direction doesn't have to be normalized (distances are in direction unit) */
+struct VoxelRay
+{
+	glm::vec3 Origin;
+	glm::vec3 Direction;
+};
+
+/** The result of a ray query against voxels */
+struct VoxelRayHit
+{
+	/** Distance along the ray to the entry point of the voxel (0 if the ray start inside of it) */
+	float Distance;
+	/** World position of the voxel that has been hit */
+	glm::ivec3 Position;
+	/** The voxel that has been hit */
+	VoxelId Voxel;
+};
+
+/**
+ * Compute 1 / direction for the slab test.
+ * Null components are replaced by a tiny value of the same sign, so the result is never NaN.
+ */
+__forceinline glm::vec3 ComputeInverseDirection(const glm::vec3& direction)
+{
+	constexpr float epsilon = 1e-20f;
+	return (glm::vec3(
+		1.0f / (glm::abs(direction.x) > epsilon ? direction.x : glm::sign(direction.x) >= 0.0f ? epsilon : -epsilon),
+		1.0f / (glm::abs(direction.y) > epsilon ? direction.y : glm::sign(direction.y) >= 0.0f ? epsilon : -epsilon),
+		1.0f / (glm::abs(direction.z) > epsilon ? direction.z : glm::sign(direction.z) >= 0.0f ? epsilon : -epsilon)
+	));
+}
+
+/**
+ * Slab test between a ray and an AABB.
+ *
+ * \param outDistance the distance to the entry point (clamped to 0 when the origin is inside the box)
+ * \return true if the ray hit the box between 0 and maxDistance
+ */
+__forceinline bool IntersectRayAabb(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& boxMin, const glm::vec3& boxMax, float maxDistance, float& outDistance)
+{
+	const glm::vec3 t0 = (boxMin - origin) * inverseDirection;
+	const glm::vec3 t1 = (boxMax - origin) * inverseDirection;
+	const glm::vec3 tNear = glm::min(t0, t1);
+	const glm::vec3 tFar = glm::max(t0, t1);
+
+	const float tEnter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+	const float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+
+	outDistance = tEnter;
+	return (tEnter <= tExit);
+}
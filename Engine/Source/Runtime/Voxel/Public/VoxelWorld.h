@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Voxel_API.h"
+#include "VoxelTypes.h"
+#include "VoxelChunk.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An infinite grid of voxels, split into chunks of VoxelChunkDimension::Size^3 voxels.
+ * Only the chunks that contain at least one solid voxel are allocated.
+ * The storage policy of the chunks is a template parameter (@see VoxelStorage.h).
+ *
+ * A voxel at the world position P covers the box [P - 0.5, P + 0.5].
+ */
+template<typename TStorage>
+class TVoxelWorld final
+{
+public:
+	using ChunkType = TVoxelChunk<TStorage>;
+	using ChunkMap = std::unordered_map<ChunkCoordinate, std::unique_ptr<ChunkType>, ChunkCoordinateHash>;
+
+public:
+	TVoxelWorld() = default;
+	~TVoxelWorld() = default;
+
+	// A world can hold a lot of memory, we don't want to copy it by accident
+	TVoxelWorld(const TVoxelWorld&) = delete;
+	TVoxelWorld& operator=(const TVoxelWorld&) = delete;
+	TVoxelWorld(TVoxelWorld&&) = default;
+	TVoxelWorld& operator=(TVoxelWorld&&) = default;
+
+#pragma region API
+public:
+	/** Get the voxel at a world position (EmptyVoxel if the chunk doesn't exist) */
+	VoxelId GetVoxel(const glm::ivec3& position) const;
+	/**
+	 * Set the voxel at a world position.
+	 * The chunk is created when needed and destroyed when its last solid voxel is removed.
+	 * When the voxel change, the chunk get a new revision (@see TVoxelChunk::GetRevision).
+	 *
+	 * \return the voxel that was previously at this position
+	 */
+	VoxelId SetVoxel(const glm::ivec3& position, VoxelId voxel);
+
+	/** Remove every chunks (the revision counter isn't reset, so a new chunk can't have the revision of a removed one) */
+	void Clear() { m_Chunks.clear(); }
+	/** Compact the storage of every chunks (@see TVoxelChunk::Compact) */
+	void Compact();
+
+	/** Find a chunk using its coordinate, return nullptr if the chunk doesn't exist */
+	const ChunkType* FindChunk(const ChunkCoordinate& coordinate) const;
+
+	/** Return the revision given to the last modified chunk, it changes every time a voxel is modified */
+	__forceinline uint64_t GetRevision() const { return (m_Revision); }
+
+	/** Return how many chunks are allocated */
+	__forceinline size_t GetChunkCount() const { return (m_Chunks.size()); }
+	/** Return how many solid voxels there is in the whole world */
+	size_t GetSolidCount() const;
+	/** Return how many bytes are used by the chunks */
+	size_t GetMemoryUsage() const;
+	/** Access all the allocated chunks */
+	__forceinline const ChunkMap& GetChunks() const { return (m_Chunks); }
+
+	/**
+	 * Call a function for every solid voxel of the world.
+	 * The function signature must be: void(const glm::ivec3& position, VoxelId voxel)
+	 */
+	template<typename F>
+	void ForEachSolidVoxel(F&& function) const
+	{
+		for (const auto& [coordinate, chunk] : m_Chunks)
+		{
+			const glm::ivec3 chunkOrigin = ToChunkOrigin(coordinate);
+			chunk->ForEachSolidVoxel(
+				[&function, &chunkOrigin](const glm::ivec3& localPosition, VoxelId voxel)
+				{
+					function(chunkOrigin + localPosition, voxel);
+				}
+			);
+		}
+	}
+
+	/** Add the AABB of every solid voxels at the end of the list (this is the input of the BLAS build) */
+	void AppendAabbs(std::vector<VoxelAabb>& aabbs) const;
+	/** Create the list of the AABB of every solid voxels (this is the input of the BLAS build) */
+	std::vector<VoxelAabb> GenerateAabbs() const;
+#pragma endregion
+
+#pragma region API - Static
+public:
+	/** Get the coordinate of the chunk that contain a world position */
+	__forceinline static ChunkCoordinate ToChunkCoordinate(const glm::ivec3& position)
+	{
+		// Arithmetic shift round toward negative infinity, so -1 is in the chunk -1 (not 0)
+		return (ChunkCoordinate(
+			position.x >> VoxelChunkDimension::SizeShift,
+			position.y >> VoxelChunkDimension::SizeShift,
+			position.z >> VoxelChunkDimension::SizeShift
+		));
+	}
+	/** Get the position of a voxel inside of its chunk */
+	__forceinline static glm::ivec3 ToLocalPosition(const glm::ivec3& position)
+	{
+		return (position & glm::ivec3(VoxelChunkDimension::Size - 1));
+	}
+	/** Get the world position of the first voxel of a chunk */
+	__forceinline static glm::ivec3 ToChunkOrigin(const ChunkCoordinate& coordinate)
+	{
+		return (coordinate * VoxelChunkDimension::Size);
+	}
+	/** Get the AABB of the voxel at a world position */
+	__forceinline static VoxelAabb MakeVoxelAabb(const glm::ivec3& position)
+	{
+		const glm::vec3 center(position);
+		return (VoxelAabb{ center - glm::vec3(0.5f), center + glm::vec3(0.5f) });
+	}
+
+	/**
+	 * Self test, no GPU needed: set and get voxels on both sides of the chunk borders (negative positions included),
+	 * grow the palette of a chunk up to 16 bits indices then compact it, and empty chunks until they are removed,
+	 * and log every broken expectation.
+	 *
+	 * \return true if every expectation held
+	 */
+	static bool LogSelfTest();
+#pragma endregion
+
+private:
+	ChunkMap m_Chunks;
+	/** Incremented every time a voxel is modified, @see TVoxelChunk::GetRevision */
+	uint64_t m_Revision = 0;
+};
+
+// The implementation live in VoxelWorld.cpp, only those storages are available
+extern template class VOXEL_API TVoxelWorld<DenseVoxelStorage>;
+extern template class VOXEL_API TVoxelWorld<PaletteVoxelStorage>;
+
+/** World storing a full VoxelId per voxel */
+using VoxelWorld = TVoxelWorld<DenseVoxelStorage>;
+/** World storing the voxels of each chunk in a palette + bit packed indices */
+using PaletteVoxelWorld = TVoxelWorld<PaletteVoxelStorage>;
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "MacrosHelper.h"
+
+#ifdef OV_BUILD_VOXEL_DLL
+# define VOXEL_API OV_DLL_EXPORT
+#else
+# define VOXEL_API OV_DLL_IMPORT
+#endif
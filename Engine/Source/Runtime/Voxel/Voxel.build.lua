@@ -0,0 +1,22 @@
+function VoxelModule(config)
+	local Voxel = {}
+
+	Voxel.Public_IncludeDirs = {
+		"Public",
+	}
+	Voxel.Private_IncludeDirs = {
+		"Private",
+	}
+
+	-- The voxel module must stay headless (no Vulkan/GLFW), so it can be used without a GPU
+	Voxel.ModuleDependency = {
+		"Core",
+	}
+	Voxel.ThirdPartyDependency = {
+		"glm",
+	}
+
+	return Voxel
+end
+
+return VoxelModule
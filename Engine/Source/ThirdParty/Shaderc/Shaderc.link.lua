@@ -0,0 +1,26 @@
+local VulkanSDK = os.getenv("VULKAN_SDK")
+VulkanSDK = string.gsub(VulkanSDK, '\\', '/')
+
+function ShadercThirdParty(config)
+	local Shaderc = {}
+
+	-- shaderc (and the glslang/SPIRV-Tools it wrap) ship with the Vulkan SDK, like the vulkan loader
+	Shaderc.RootDirectory = VulkanSDK
+
+	-- The combined library contain shaderc and all its dependencies, so nothing else has to be linked
+	if os.target() == "windows" then
+		Shaderc.LinkName = VulkanSDK .. "/Lib/shaderc_combined.lib"
+		Shaderc.IncludeDirs = {
+			"/Include"
+		}
+	else
+		Shaderc.LinkName = VulkanSDK .. "/lib/libshaderc_combined.a"
+		Shaderc.IncludeDirs = {
+			"/include"
+		}
+	end
+
+	return Shaderc
+end
+
+return ShadercThirdParty;
\ No newline at end of file